@@ -0,0 +1,563 @@
+/*
+ * Benchmark driver over a fixed corpus: random soups at
+ * several sizes and densities, every embedded pattern under
+ * several rules, pattern parsing, rendering and process
+ * startup. Results are written to stdout as JSON, to be
+ * compared against a stored baseline by bench_compare.pl
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <ncurses.h>
+
+#include "../src/grid.h"
+#include "../src/cell.h"
+#include "../src/rule.h"
+#include "../src/rand.h"
+#include "../src/pattern.h"
+#include "../src/render.h"
+#include "../src/render_fb.h"
+#include "../src/render_ansi.h"
+#include "../src/bitgrid.h"
+#include "../src/tilegrid.h"
+#include "../src/parallel.h"
+
+#define SEED            42
+#define REPEATS         3
+#define CELL_BUDGET     (1L << 22)
+#define PATTERN_SIDE    128
+#define PATTERN_GENS    100
+#define BLOCK_GENS      8
+#define PATTERN_PARSES  1000
+#define RENDER_ROWS     60
+#define RENDER_COLS     200
+#define RENDER_FRAMES   200
+#define STARTUP_RUNS    20
+#define FB_GRID         1024
+#define FB_MAX_SCALE    3
+
+extern char **environ;
+
+static const int sizes[] = {64, 256, 1024};
+static const float densities[] = {0.10, 0.35, 0.50};
+static const char *rules[] = {"conway", "highlife", "day_and_night", "seeds"};
+static const int views[] = {32, 128, 512};
+
+#define LEN(a) ((int) (sizeof (a) / sizeof ((a)[0])))
+
+typedef struct
+{
+	char   name[128];
+	double cells;
+	long   iterations;
+	double seconds;
+	double bytes;
+} BenchCase;
+
+static int first_case = 1;
+
+static double
+now (void)
+{
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void
+bench_print_case (const char *kind, const BenchCase *c)
+{
+	printf ("%s\n    {\"name\": \"%s\", \"kind\": \"%s\", \"iterations\": %ld,"
+			" \"seconds\": %.6f, \"ns_per_op\": %.3f",
+			first_case ? "" : ",", c->name, kind, c->iterations,
+			c->seconds, c->seconds * 1e9 / c->iterations);
+
+	if (c->cells > 0)
+		printf (", \"cells_per_sec\": %.6e, \"ns_per_cell\": %.6f",
+				c->cells * c->iterations / c->seconds,
+				c->seconds * 1e9 / (c->cells * c->iterations));
+
+	if (c->bytes > 0)
+		printf (", \"bytes_per_op\": %.1f", c->bytes);
+
+	printf ("}");
+	first_case = 0;
+}
+
+static double
+bench_step_dense (Grid *seed, const char *rule_str, long gens)
+{
+	Grid *cur  = grid_new (seed->rows, seed->cols);
+	Grid *next = grid_new (seed->rows, seed->cols);
+	Rule *rule = rule_new (rule_str);
+
+	memcpy (cur->data, seed->data, sizeof (int) * seed->rows * seed->cols);
+
+	double start = now ();
+
+	for (long g = 0; g < gens; g++)
+		{
+			cell_step_generation (next, cur, rule, NULL);
+
+			Grid *tmp = cur;
+			cur = next;
+			next = tmp;
+		}
+
+	double elapsed = now () - start;
+
+	rule_free (rule);
+	grid_free (cur);
+	grid_free (next);
+
+	return elapsed;
+}
+
+static double
+bench_step_bitgrid (Grid *seed, const char *rule_str, long gens)
+{
+	BitGrid *cur  = bitgrid_new (seed->rows, seed->cols);
+	BitGrid *next = bitgrid_new (seed->rows, seed->cols);
+	Rule *rule = rule_new (rule_str);
+	BitRule bit_rule;
+
+	bitlife_rule_init (&bit_rule, rule);
+	bitgrid_from_grid (cur, seed);
+
+	double start = now ();
+
+	for (long g = 0; g < gens; g++)
+		{
+			bitgrid_step (next, cur, &bit_rule);
+
+			BitGrid *tmp = cur;
+			cur = next;
+			next = tmp;
+		}
+
+	double elapsed = now () - start;
+
+	rule_free (rule);
+	bitgrid_free (cur);
+	bitgrid_free (next);
+
+	return elapsed;
+}
+
+static double
+bench_step_tilegrid (Grid *seed, const char *rule_str, long gens)
+{
+	TileGrid *cur  = tilegrid_new (seed->rows, seed->cols);
+	TileGrid *next = tilegrid_new (seed->rows, seed->cols);
+	Rule *rule = rule_new (rule_str);
+	BitRule bit_rule;
+
+	bitlife_rule_init (&bit_rule, rule);
+	tilegrid_from_grid (cur, seed);
+
+	double start = now ();
+
+	for (long g = 0; g < gens; g++)
+		{
+			tilegrid_step (next, cur, &bit_rule);
+
+			TileGrid *tmp = cur;
+			cur = next;
+			next = tmp;
+		}
+
+	double elapsed = now () - start;
+
+	rule_free (rule);
+	tilegrid_free (cur);
+	tilegrid_free (next);
+
+	return elapsed;
+}
+
+// BLOCK_GENS generations per cache tile
+static double
+bench_step_temporal (Grid *seed, const char *rule_str, long gens)
+{
+	BitGrid *cur  = bitgrid_new (seed->rows, seed->cols);
+	BitGrid *next = bitgrid_new (seed->rows, seed->cols);
+	Rule *rule = rule_new (rule_str);
+	BitRule bit_rule;
+
+	bitlife_rule_init (&bit_rule, rule);
+	bitgrid_from_grid (cur, seed);
+
+	double start = now ();
+
+	for (long g = 0; g < gens; g += BLOCK_GENS)
+		{
+			bitgrid_step_blocked (next, cur, &bit_rule,
+					gens - g < BLOCK_GENS ? gens - g : BLOCK_GENS, NULL);
+
+			BitGrid *tmp = cur;
+			cur = next;
+			next = tmp;
+		}
+
+	double elapsed = now () - start;
+
+	rule_free (rule);
+	bitgrid_free (cur);
+	bitgrid_free (next);
+
+	return elapsed;
+}
+
+static void
+bench_step (const char *name, Grid *seed, const char *rule, long gens)
+{
+	BenchCase dense = {.cells = (double) seed->rows * seed->cols, .iterations = gens};
+	BenchCase bit = dense;
+	BenchCase tiled = dense;
+	BenchCase temporal = dense;
+
+	snprintf (dense.name, sizeof (dense.name), "step/dense/%s/%s", name, rule);
+	snprintf (bit.name, sizeof (bit.name), "step/bitgrid/%s/%s", name, rule);
+	snprintf (tiled.name, sizeof (tiled.name), "step/tilegrid/%s/%s", name, rule);
+	snprintf (temporal.name, sizeof (temporal.name), "step/temporal/%s/%s", name, rule);
+
+	// Best of REPEATS to filter out scheduling noise
+	for (int r = 0; r < REPEATS; r++)
+		{
+			double t = bench_step_dense (seed, rule, gens);
+			if (r == 0 || t < dense.seconds)
+				dense.seconds = t;
+
+			t = bench_step_bitgrid (seed, rule, gens);
+			if (r == 0 || t < bit.seconds)
+				bit.seconds = t;
+
+			t = bench_step_tilegrid (seed, rule, gens);
+			if (r == 0 || t < tiled.seconds)
+				tiled.seconds = t;
+
+			t = bench_step_temporal (seed, rule, gens);
+			if (r == 0 || t < temporal.seconds)
+				temporal.seconds = t;
+		}
+
+	bench_print_case ("step", &dense);
+	bench_print_case ("step", &bit);
+	bench_print_case ("step", &tiled);
+	bench_print_case ("step", &temporal);
+}
+
+static void
+bench_random_soups (void)
+{
+	char name[64];
+
+	for (int s = 0; s < LEN (sizes); s++)
+		for (int d = 0; d < LEN (densities); d++)
+			{
+				Grid *seed = grid_new (sizes[s], sizes[s]);
+				Rand *rng = rand_new (SEED);
+				long gens = CELL_BUDGET / ((long) sizes[s] * sizes[s]);
+
+				cell_seed_random_generation (seed, rng, densities[d], NULL);
+				snprintf (name, sizeof (name), "random/%dx%d/p%.2f",
+						sizes[s], sizes[s], densities[d]);
+
+				bench_step (name, seed, "conway", gens);
+
+				rand_free (rng);
+				grid_free (seed);
+			}
+}
+
+static void
+bench_patterns (void)
+{
+	char name[64];
+
+	for (const PatternDef *def = pattern_defs; def->name != NULL; def++)
+		{
+			Pattern *pattern = pattern_new (def->name);
+			int rows = pattern->grid->rows > PATTERN_SIDE ? pattern->grid->rows : PATTERN_SIDE;
+			int cols = pattern->grid->cols > PATTERN_SIDE ? pattern->grid->cols : PATTERN_SIDE;
+
+			Grid *seed = grid_new (rows, cols);
+			cell_seed_from_grid (seed, pattern->grid, NULL);
+
+			snprintf (name, sizeof (name), "pattern/%s", def->name);
+
+			for (int r = 0; r < LEN (rules); r++)
+				bench_step (name, seed, rules[r], PATTERN_GENS);
+
+			grid_free (seed);
+			pattern_free (pattern);
+		}
+}
+
+static void
+bench_pattern_new (void)
+{
+	for (const PatternDef *def = pattern_defs; def->name != NULL; def++)
+		{
+			BenchCase c = {.iterations = PATTERN_PARSES};
+			snprintf (c.name, sizeof (c.name), "pattern_new/%s", def->name);
+
+			double start = now ();
+
+			for (long i = 0; i < c.iterations; i++)
+				pattern_free (pattern_new (def->name));
+
+			c.seconds = now () - start;
+			bench_print_case ("pattern_new", &c);
+		}
+}
+
+static void
+bench_render_draw (void)
+{
+	char buf[16];
+
+	// The terminal size is taken from the environment when
+	// there is no tty to ask
+	snprintf (buf, sizeof (buf), "%d", RENDER_ROWS);
+	setenv ("LINES", buf, 1);
+	snprintf (buf, sizeof (buf), "%d", RENDER_COLS);
+	setenv ("COLUMNS", buf, 1);
+
+	FILE *out = fopen ("/dev/null", "w");
+	FILE *in  = fopen ("/dev/null", "r");
+
+	if (out == NULL || in == NULL)
+		return;
+
+	SCREEN *screen = newterm ("xterm-256color", out, in);
+
+	if (screen == NULL)
+		{
+			fclose (out);
+			fclose (in);
+			return;
+		}
+
+	Grid *grids[2] = {
+		grid_new (RENDER_ROWS, RENDER_COLS),
+		grid_new (RENDER_ROWS, RENDER_COLS)
+	};
+
+	Rand *rng = rand_new (SEED);
+	Rule *rule = rule_new ("conway");
+
+	cell_seed_random_generation (grids[0], rng, 0.35, NULL);
+	cell_step_generation (grids[1], grids[0], rule, NULL);
+
+	Render *render = render_new ("bench", RENDER_ROWS, RENDER_COLS);
+	RenderStat stat = {0};
+
+	BenchCase c = {.cells = RENDER_ROWS * RENDER_COLS, .iterations = RENDER_FRAMES};
+	snprintf (c.name, sizeof (c.name), "render_draw/%dx%d", RENDER_ROWS, RENDER_COLS);
+
+	double start = now ();
+
+	// Alternate two generations so every frame has changes to flush
+	for (long i = 0; i < c.iterations; i++)
+		{
+			stat.gen = i;
+			render_draw (render, grids[i & 1], &stat);
+		}
+
+	c.seconds = now () - start;
+
+	render_free (render);
+	endwin ();
+	delscreen (screen);
+
+	rule_free (rule);
+	rand_free (rng);
+	grid_free (grids[0]);
+	grid_free (grids[1]);
+
+	fclose (out);
+	fclose (in);
+
+	bench_print_case ("render_draw", &c);
+}
+
+/*
+ * Frame cost of the framebuffer backend, that is the shading
+ * of the view without any terminal in the way
+ */
+static void
+bench_render_fb (void)
+{
+	Grid *grid = grid_new (FB_GRID, FB_GRID);
+	Rand *rng = rand_new (SEED);
+	RenderStat stat = {0};
+
+	cell_seed_random_generation (grid, rng, 0.35, NULL);
+
+	for (int v = 0; v < LEN (views); v++)
+		for (int scale = 0; scale <= FB_MAX_SCALE; scale++)
+			{
+				Render *render = render_new_backend (&render_fb_backend, "bench",
+						views[v], views[v]);
+
+				for (int s = 0; s < scale; s++)
+					render_scale (render, grid, +1);
+
+				int side = views[v] << scale < FB_GRID ? views[v] << scale : FB_GRID;
+
+				BenchCase c = {.cells = (double) side * side};
+				c.iterations = CELL_BUDGET / (long) c.cells;
+				snprintf (c.name, sizeof (c.name), "render_fb/%dx%d/scale%d",
+						views[v], views[v], scale);
+
+				double start = now ();
+
+				for (long i = 0; i < c.iterations; i++)
+					render_draw (render, grid, &stat);
+
+				c.seconds = now () - start;
+				bench_print_case ("render_fb", &c);
+
+				render_free (render);
+			}
+
+	rand_free (rng);
+	grid_free (grid);
+}
+
+/*
+ * Frame cost and bytes written per frame of the ANSI backend,
+ * alternating two generations as render_draw does
+ */
+static void
+bench_render_ansi (void)
+{
+	int fd = open ("/dev/null", O_WRONLY);
+
+	if (fd < 0)
+		return;
+
+	Grid *grids[2] = {
+		grid_new (FB_GRID, FB_GRID),
+		grid_new (FB_GRID, FB_GRID)
+	};
+
+	Rand *rng = rand_new (SEED);
+	Rule *rule = rule_new ("conway");
+	RenderStat stat = {0};
+
+	cell_seed_random_generation (grids[0], rng, 0.35, NULL);
+	cell_step_generation (grids[1], grids[0], rule, NULL);
+
+	for (int v = 0; v < LEN (views); v++)
+		{
+			Render *render = render_new_backend (&render_ansi_backend, "bench",
+					views[v], views[v]);
+			RenderAnsi *ansi = render_backend_state (render);
+
+			render_ansi_set_fd (ansi, fd);
+
+			BenchCase c = {.cells = (double) views[v] * views[v]};
+			c.iterations = CELL_BUDGET / (long) c.cells;
+			snprintf (c.name, sizeof (c.name), "render_ansi/%dx%d",
+					views[v], views[v]);
+
+			double start = now ();
+
+			for (long i = 0; i < c.iterations; i++)
+				{
+					stat.gen = i;
+					render_draw (render, grids[i & 1], &stat);
+				}
+
+			c.seconds = now () - start;
+			c.bytes = render_ansi_mean_bytes (ansi);
+			bench_print_case ("render_ansi", &c);
+
+			render_free (render);
+		}
+
+	rule_free (rule);
+	rand_free (rng);
+	grid_free (grids[0]);
+	grid_free (grids[1]);
+
+	close (fd);
+}
+
+static void
+bench_startup (const char *conga)
+{
+	char *argv[] = {
+		(char *) conga, "--headless", "-g", "1", "-s", "1", NULL
+	};
+
+	posix_spawn_file_actions_t actions;
+	posix_spawn_file_actions_init (&actions);
+	posix_spawn_file_actions_addopen (&actions, STDOUT_FILENO,
+			"/dev/null", O_WRONLY, 0);
+
+	BenchCase c = {.iterations = STARTUP_RUNS};
+	snprintf (c.name, sizeof (c.name), "startup/headless");
+
+	double start = now ();
+
+	for (long i = 0; i < c.iterations; i++)
+		{
+			pid_t pid;
+			int status;
+
+			if (posix_spawn (&pid, conga, &actions, NULL, argv, environ) != 0
+					|| waitpid (pid, &status, 0) < 0
+					|| !WIFEXITED (status) || WEXITSTATUS (status) != 0)
+				{
+					fprintf (stderr, "bench: failed to run '%s'\n", conga);
+					exit (EXIT_FAILURE);
+				}
+		}
+
+	c.seconds = now () - start;
+
+	posix_spawn_file_actions_destroy (&actions);
+
+	bench_print_case ("startup", &c);
+}
+
+int
+main (int argc, char **argv)
+{
+	if (argc > 2)
+		{
+			fprintf (stderr, "Usage: %s [CONGA]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+
+	printf ("{\n  \"cpus\": %d,\n  \"cases\": [", parallel_num_cpus ());
+
+	bench_random_soups ();
+	bench_patterns ();
+	bench_pattern_new ();
+	bench_render_draw ();
+	bench_render_fb ();
+	bench_render_ansi ();
+
+	if (argc == 2)
+		bench_startup (argv[1]);
+
+	struct rusage self, children;
+	getrusage (RUSAGE_SELF, &self);
+	getrusage (RUSAGE_CHILDREN, &children);
+
+	printf ("\n  ],\n  \"peak_rss_kb\": %ld,\n  \"startup_peak_rss_kb\": %ld\n}\n",
+			self.ru_maxrss, children.ru_maxrss);
+
+	return EXIT_SUCCESS;
+}
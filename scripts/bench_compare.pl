@@ -0,0 +1,64 @@
+#!/usr/bin/env perl
+
+use strict;
+use warnings;
+use autodie;
+use JSON::PP;
+use Getopt::Long;
+
+# Nothing to compare against is a failure, unless asked to skip
+my $allow_missing = 0;
+GetOptions("allow-missing" => \$allow_missing)
+	or die "Usage: $0 [--allow-missing] <BASELINE> <CURRENT> [THRESHOLD]\n";
+
+die "Usage: $0 [--allow-missing] <BASELINE> <CURRENT> [THRESHOLD]\n" unless @ARGV >= 2;
+
+my ($baseline_file, $current_file, $threshold) = @ARGV;
+$threshold //= 0.10;
+
+sub load {
+	open my $fh, "<", shift;
+	my $json = do { local $/; <$fh> };
+	close $fh;
+	return decode_json($json);
+}
+
+my $current = load($current_file);
+
+unless (-e $baseline_file) {
+	print "No baseline at $baseline_file. Run 'make bench-baseline' to store one\n";
+	exit($allow_missing ? 0 : 1);
+}
+
+my $baseline = load($baseline_file);
+my %base = map { $_->{name} => $_ } @{$baseline->{cases}};
+
+# Throughput where there is one, otherwise time per operation.
+# Either way the ratio is > 1 when the current run is faster
+sub speedup {
+	my ($old, $new) = @_;
+	return $new->{cells_per_sec} / $old->{cells_per_sec}
+		if defined $old->{cells_per_sec} && defined $new->{cells_per_sec};
+	return $old->{ns_per_op} / $new->{ns_per_op};
+}
+
+my ($compared, $regressions) = (0, 0);
+
+for my $case (@{$current->{cases}}) {
+	my $old = $base{$case->{name}} or next;
+	my $ratio = speedup($old, $case);
+
+	$compared++;
+
+	if ($ratio < 1 - $threshold) {
+		$regressions++;
+		printf "REGRESSION  %-50s  %6.1f%%\n", $case->{name}, ($ratio - 1) * 100;
+	}
+}
+
+printf "Compared %d cases against %s: %d regressions beyond %.0f%%\n",
+	$compared, $baseline_file, $regressions, $threshold * 100;
+printf "Peak RSS: %d KiB (baseline %d KiB)\n",
+	$current->{peak_rss_kb}, $baseline->{peak_rss_kb};
+
+exit($regressions ? 1 : 0);
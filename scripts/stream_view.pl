@@ -0,0 +1,106 @@
+#!/usr/bin/env perl
+
+# Reference viewer for 'conga --serve': subscribes to a viewport
+# and draws every frame received with ANSI escape sequences.
+# See src/stream.h for the protocol
+
+use strict;
+use warnings;
+use IO::Socket::INET;
+use IO::Socket::UNIX;
+
+die "Usage: $0 <SOCKET|tcp:PORT> [ROW COL ROWS COLS]\n" unless @ARGV == 1 || @ARGV == 5;
+
+my ($addr, @view) = @ARGV;
+
+my $sock = $addr =~ /^tcp:(\d+)$/
+	? IO::Socket::INET->new(PeerAddr => "127.0.0.1", PeerPort => $1)
+	: IO::Socket::UNIX->new(Peer => $addr, Type => SOCK_STREAM);
+
+die "Could not connect to '$addr': $!\n" unless $sock;
+
+my $buf = "";
+
+sub fill {
+	my $want = shift;
+	while (length($buf) < $want) {
+		my $n = sysread($sock, $buf, 65536, length($buf));
+		die "Could not read from '$addr': $!\n" unless defined $n;
+		exit 0 if $n == 0;
+	}
+}
+
+sub take {
+	my $len = shift;
+	fill($len);
+	return substr($buf, 0, $len, "");
+}
+
+sub varint {
+	my ($x, $shift) = (0, 0);
+	while (1) {
+		my $b = ord(take(1));
+		$x |= ($b & 0x7f) << $shift;
+		return $x unless $b & 0x80;
+		$shift += 7;
+	}
+}
+
+sub put_varint {
+	my $x = shift;
+	my $out = "";
+	while ($x >= 0x80) {
+		$out .= chr(($x & 0x7f) | 0x80);
+		$x >>= 7;
+	}
+	return $out . chr($x);
+}
+
+die "'$addr' is not a conga stream\n" unless take(4) eq "CGST";
+die "Unknown stream version\n" unless ord(take(1)) == 1;
+
+my ($grid_rows, $grid_cols) = (varint(), varint());
+
+# Fit the terminal by default, two columns per cell
+unless (@view) {
+	my ($term_rows, $term_cols) = split ' ', (`stty size 2>/dev/null` || "24 80");
+	@view = (0, 0, $term_rows - 1, int($term_cols / 2));
+}
+
+syswrite($sock, "V" . join("", map { put_varint($_) } @view));
+
+my @cells;
+local $| = 1;
+$SIG{INT} = sub { print "\e[0m\e[?25h\n"; exit 0 };
+print "\e[?25l\e[2J";
+
+while (1) {
+	my $type = take(1);
+	my ($gen, $row, $col, $rows, $cols, $len) = map { varint() } 1 .. 6;
+
+	die "Unknown frame type '$type'\n" unless $type eq "K" || $type eq "D";
+
+	fill($len);
+
+	# Deltas toggle cells, a keyframe is a delta from nothing
+	@cells = (0) x ($rows * $cols) if $type eq "K";
+
+	my ($births, $deaths) = (varint(), varint());
+	for my $count ($births, $deaths) {
+		my $idx = -1;
+		for (1 .. $count) {
+			$idx += varint() + 1;
+			$cells[$idx] ^= 1;
+		}
+	}
+
+	my $out = "\e[H";
+	for my $i (0 .. $rows - 1) {
+		$out .= join("", map { $_ ? "\e[40m  " : "\e[47m  " } @cells[$i * $cols .. ($i + 1) * $cols - 1]);
+		$out .= "\e[0m\n";
+	}
+	$out .= sprintf "\e[0m\e[KGen:%d View:[%d,%d] %dx%d Grid:%dx%d",
+		$gen, $row, $col, $rows, $cols, $grid_rows, $grid_cols;
+
+	print $out;
+}
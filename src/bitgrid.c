@@ -0,0 +1,367 @@
+#include "bitgrid.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include "wrapper.h"
+#include "pages.h"
+
+#define WORD_BITS 64
+
+#define LAST_MASK(g) ( \
+	(g)->cols % WORD_BITS \
+		? ((uint64_t) 1 << ((g)->cols % WORD_BITS)) - 1 \
+		: ~(uint64_t) 0 \
+)
+
+BitGrid *
+bitgrid_new (int rows, int cols)
+{
+	return bitgrid_new_banded (rows, cols, 1);
+}
+
+// Large grids get huge pages, first touched by bands threads
+BitGrid *
+bitgrid_new_banded (int rows, int cols, int bands)
+{
+	assert (rows > 0 && cols > 0);
+	assert (bands > 0);
+
+	BitGrid *grid = xcalloc (1, sizeof (BitGrid));
+	int words = (cols + WORD_BITS - 1) / WORD_BITS;
+	size_t size = (size_t) rows * words * sizeof (uint64_t);
+
+	*grid = (BitGrid) {
+		.rows  = rows,
+		.cols  = cols,
+		.words = words,
+		.data  = pages_wanted (size)
+			? pages_alloc (size, bands)
+			: xcalloc ((long) rows * words, sizeof (uint64_t))
+	};
+
+	return grid;
+}
+
+void
+bitgrid_free (BitGrid *grid)
+{
+	if (grid == NULL)
+		return;
+
+	size_t size = (size_t) grid->rows * grid->words * sizeof (uint64_t);
+
+	if (pages_wanted (size))
+		pages_free (grid->data, size);
+	else
+		xfree (grid->data);
+
+	xfree (grid);
+}
+
+void
+bitgrid_clear (BitGrid *grid)
+{
+	assert (grid != NULL);
+	memset (grid->data, 0, sizeof (uint64_t) * grid->rows * grid->words);
+}
+
+void
+bitgrid_from_grid (BitGrid *bit_grid, const Grid *grid)
+{
+	assert (bit_grid != NULL);
+	bitgrid_from_grid_rect (bit_grid, grid, 0, bit_grid->rows, 0, bit_grid->words);
+}
+
+// Only rows [row_from, row_to) and words [word_from, word_to)
+void
+bitgrid_from_grid_rect (BitGrid *bit_grid, const Grid *grid,
+		int row_from, int row_to, int word_from, int word_to)
+{
+	assert (bit_grid != NULL && grid != NULL);
+	assert (bit_grid->rows == grid->rows && bit_grid->cols == grid->cols);
+	assert (row_from >= 0 && row_to <= bit_grid->rows);
+	assert (word_from >= 0 && word_to <= bit_grid->words);
+
+	for (int i = row_from; i < row_to; i++)
+		{
+			const int *src = &GRID_GET (grid, i, 0);
+			uint64_t *dst = BITGRID_ROW (bit_grid, i);
+
+			for (int w = word_from; w < word_to; w++)
+				{
+					int n = grid->cols - w * WORD_BITS;
+					uint64_t word = 0;
+
+					if (n > WORD_BITS)
+						n = WORD_BITS;
+
+					for (int b = 0; b < n; b++)
+						word |= (uint64_t) (src[w * WORD_BITS + b] != 0) << b;
+
+					dst[w] = word;
+				}
+		}
+}
+
+void
+bitgrid_to_grid (Grid *grid, const BitGrid *bit_grid)
+{
+	assert (bit_grid != NULL);
+	bitgrid_to_grid_rect (grid, bit_grid, 0, bit_grid->rows, 0, bit_grid->words);
+}
+
+void
+bitgrid_to_grid_rect (Grid *grid, const BitGrid *bit_grid,
+		int row_from, int row_to, int word_from, int word_to)
+{
+	assert (bit_grid != NULL && grid != NULL);
+	assert (bit_grid->rows == grid->rows && bit_grid->cols == grid->cols);
+	assert (row_from >= 0 && row_to <= bit_grid->rows);
+	assert (word_from >= 0 && word_to <= bit_grid->words);
+
+	int col_from = word_from * WORD_BITS;
+	int col_to = word_to * WORD_BITS < grid->cols ? word_to * WORD_BITS : grid->cols;
+
+	for (int i = row_from; i < row_to; i++)
+		{
+			const uint64_t *src = BITGRID_ROW (bit_grid, i);
+			int *dst = &GRID_GET (grid, i, 0);
+
+			for (int j = col_from; j < col_to; j++)
+				dst[j] = (src[j / WORD_BITS] >> (j % WORD_BITS)) & 1;
+		}
+}
+
+long
+bitgrid_population (const BitGrid *grid)
+{
+	assert (grid != NULL);
+
+	long alive = 0;
+	long size = (long) grid->rows * grid->words;
+
+	for (long i = 0; i < size; i++)
+		alive += __builtin_popcountll (grid->data[i]);
+
+	return alive;
+}
+
+static inline void
+bitgrid_shift_row (const BitGrid *grid, const uint64_t *row, int w,
+		uint64_t *left, uint64_t *right)
+{
+	int last = grid->words - 1;
+	uint64_t c = row[w];
+
+	// Cell j - 1 seen at position j, wrapping around the torus
+	*left = (c << 1) | (w > 0
+			? row[w - 1] >> (WORD_BITS - 1)
+			: (row[last] >> ((grid->cols - 1) % WORD_BITS)) & 1);
+
+	// Cell j + 1 seen at position j
+	*right = (c >> 1) | (w < last
+			? row[w + 1] << (WORD_BITS - 1)
+			: (row[0] & 1) << ((grid->cols - 1) % WORD_BITS));
+}
+
+void
+bitgrid_step_rows (BitGrid *grid_next, const BitGrid *grid_cur,
+		const BitRule *rule, int row_from, int row_to)
+{
+	assert (grid_cur != NULL);
+	bitgrid_step_rect (grid_next, grid_cur, rule, row_from, row_to,
+			0, grid_cur->words);
+}
+
+void
+bitgrid_step_rect (BitGrid *grid_next, const BitGrid *grid_cur,
+		const BitRule *rule, int row_from, int row_to, int word_from, int word_to)
+{
+	assert (grid_next != NULL && grid_cur != NULL);
+	assert (grid_next->rows == grid_cur->rows
+			&& grid_next->cols == grid_cur->cols);
+	assert (rule != NULL);
+	assert (row_from >= 0 && row_to <= grid_cur->rows);
+	assert (word_from >= 0 && word_to <= grid_cur->words);
+
+	int rows = grid_cur->rows;
+	int last = grid_cur->words - 1;
+	uint64_t mask = LAST_MASK (grid_cur);
+
+	for (int i = row_from; i < row_to; i++)
+		{
+			const uint64_t *up  = BITGRID_ROW (grid_cur, i == 0 ? rows - 1 : i - 1);
+			const uint64_t *mid = BITGRID_ROW (grid_cur, i);
+			const uint64_t *dn  = BITGRID_ROW (grid_cur, i == rows - 1 ? 0 : i + 1);
+			uint64_t *out = BITGRID_ROW (grid_next, i);
+
+			for (int w = word_from; w < word_to; w++)
+				{
+					uint64_t ul, ur, ml, mr, dl, dr;
+
+					bitgrid_shift_row (grid_cur, up,  w, &ul, &ur);
+					bitgrid_shift_row (grid_cur, mid, w, &ml, &mr);
+					bitgrid_shift_row (grid_cur, dn,  w, &dl, &dr);
+
+					out[w] = bitlife_next (rule, mid[w],
+							ul, up[w], ur, ml, mr, dl, dn[w], dr);
+				}
+
+			if (word_to > last)
+				out[last] &= mask;
+		}
+}
+
+void
+bitgrid_step (BitGrid *grid_next, const BitGrid *grid_cur,
+		const BitRule *rule)
+{
+	bitgrid_step_rows (grid_next, grid_cur, rule, 0, grid_cur->rows);
+}
+
+// 64 cells from column col on, wrapping around the torus
+static inline uint64_t
+bitgrid_fetch (const BitGrid *grid, int row, long col)
+{
+	const uint64_t *r = BITGRID_ROW (grid, row);
+	long c = col % grid->cols;
+
+	if (c < 0)
+		c += grid->cols;
+
+	int w = c / WORD_BITS;
+	int s = c % WORD_BITS;
+
+	if (c + WORD_BITS <= grid->cols)
+		return s == 0 ? r[w] : (r[w] >> s) | (r[w + 1] << (WORD_BITS - s));
+
+	// Across the seam, only at the edges of the grid
+	uint64_t word = 0;
+
+	for (int b = 0; b < WORD_BITS; b++, c = c + 1 < grid->cols ? c + 1 : 0)
+		word |= (uint64_t) ((r[c / WORD_BITS] >> (c % WORD_BITS)) & 1) << b;
+
+	return word;
+}
+
+static void
+bitgrid_tile_step (uint64_t *dst, const uint64_t *src, const BitRule *rule,
+		int width, int row_from, int row_to)
+{
+	int last = width - 1;
+
+	for (int t = row_from; t < row_to; t++)
+		{
+			const uint64_t *up  = src + (long) (t - 1) * width;
+			const uint64_t *mid = src + (long) t * width;
+			const uint64_t *dn  = src + (long) (t + 1) * width;
+			uint64_t *out = dst + (long) t * width;
+
+			// Nothing beyond the tile, the halo absorbs it
+			for (int x = 0; x <= last; x++)
+				{
+					uint64_t ul = (up[x] << 1)  | (x > 0 ? up[x - 1] >> (WORD_BITS - 1) : 0);
+					uint64_t ml = (mid[x] << 1) | (x > 0 ? mid[x - 1] >> (WORD_BITS - 1) : 0);
+					uint64_t dl = (dn[x] << 1)  | (x > 0 ? dn[x - 1] >> (WORD_BITS - 1) : 0);
+
+					uint64_t ur = (up[x] >> 1)  | (x < last ? up[x + 1] << (WORD_BITS - 1) : 0);
+					uint64_t mr = (mid[x] >> 1) | (x < last ? mid[x + 1] << (WORD_BITS - 1) : 0);
+					uint64_t dr = (dn[x] >> 1)  | (x < last ? dn[x + 1] << (WORD_BITS - 1) : 0);
+
+					out[x] = bitlife_next (rule, mid[x], ul, up[x], ur, ml, mr, dl, dn[x], dr);
+				}
+		}
+}
+
+/*
+ * Advances grid_cur by gens generations into grid_next, which
+ * must be another grid. Each generation spoils one more cell
+ * from the edges of a tile, so after gens of them the inner
+ * part, gens rows and a word away, is still exact. Columns
+ * past the last one of the grid hold the wrapped first ones,
+ * so the torus needs no special case inside a tile. alive, if
+ * set, gets the population of the generation before the last.
+ */
+void
+bitgrid_step_blocked (BitGrid *grid_next, const BitGrid *grid_cur,
+		const BitRule *rule, int gens, long *alive)
+{
+	assert (grid_next != NULL && grid_cur != NULL);
+	assert (grid_next != grid_cur);
+	assert (grid_next->rows == grid_cur->rows
+			&& grid_next->cols == grid_cur->cols);
+	assert (rule != NULL);
+	assert (gens > 0 && gens <= BITGRID_BLOCK_MAX);
+
+	int rows  = grid_cur->rows;
+	int words = grid_cur->words;
+	int k     = gens;
+
+	int core_words = words < BITGRID_TILE_WORDS ? words : BITGRID_TILE_WORDS;
+	long tile_size = (long) (BITGRID_TILE_ROWS + 2 * k) * (core_words + 2);
+
+	uint64_t *tile[2] = {
+		xmalloc (tile_size * sizeof (uint64_t)),
+		xmalloc (tile_size * sizeof (uint64_t))
+	};
+
+	uint64_t mask = LAST_MASK (grid_cur);
+	long count = 0;
+
+	for (int r0 = 0; r0 < rows; r0 += BITGRID_TILE_ROWS)
+		for (int w0 = 0; w0 < words; w0 += core_words)
+			{
+				int nr = rows - r0 < BITGRID_TILE_ROWS ? rows - r0 : BITGRID_TILE_ROWS;
+				int nw = words - w0 < core_words ? words - w0 : core_words;
+				int height = nr + 2 * k;
+				int width = nw + 2;
+				int cur = 0;
+
+				for (int t = 0; t < height; t++)
+					{
+						int row = ((r0 - k + t) % rows + rows) % rows;
+						uint64_t *dst = tile[0] + (long) t * width;
+
+						for (int x = 0; x < width; x++)
+							dst[x] = bitgrid_fetch (grid_cur, row,
+									(long) (w0 - 1 + x) * WORD_BITS);
+					}
+
+				for (int s = 1; s <= k; s++)
+					{
+						// Population of the generation before the last
+						if (s == k && alive != NULL)
+							for (int t = k; t < k + nr; t++)
+								for (int x = 1; x <= nw; x++)
+									{
+										uint64_t word = tile[cur][(long) t * width + x];
+
+										if (w0 + x == words)
+											word &= mask;
+
+										count += __builtin_popcountll (word);
+									}
+
+						bitgrid_tile_step (tile[!cur], tile[cur], rule, width, s, height - s);
+						cur = !cur;
+					}
+
+				for (int t = k; t < k + nr; t++)
+					{
+						uint64_t *dst = BITGRID_ROW (grid_next, r0 + t - k) + w0;
+						const uint64_t *src = tile[cur] + (long) t * width + 1;
+
+						memcpy (dst, src, nw * sizeof (uint64_t));
+
+						if (w0 + nw == words)
+							dst[nw - 1] &= mask;
+					}
+			}
+
+	if (alive != NULL)
+		*alive = count;
+
+	xfree (tile[0]);
+	xfree (tile[1]);
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stdint.h>
+#include "grid.h"
+#include "bitlife.h"
+
+/*
+ * Row-major grid packed 64 cells per word. Column j lives
+ * in bit j % 64 of word j / 64; the unused high bits of the
+ * last word of every row are kept at zero.
+ */
+
+typedef struct
+{
+	int       rows;
+	int       cols;
+	int       words;
+	uint64_t *data;
+} BitGrid;
+
+#define BITGRID_ROW(g,r) ((g)->data + (long) (r) * (g)->words)
+
+#define BITGRID_GET(g,r,c) ( \
+		(int) ((BITGRID_ROW (g, r)[(c) >> 6] >> ((c) & 63)) & 1) \
+)
+
+#define BITGRID_SET(g,r,c,x) do { \
+		uint64_t *__w = &BITGRID_ROW (g, r)[(c) >> 6]; \
+		uint64_t __b = (uint64_t) 1 << ((c) & 63); \
+		*__w = (x) ? (*__w | __b) : (*__w & ~__b); \
+	} while (0)
+
+/*
+ * Temporal blocking: the grid is stepped in tiles of
+ * BITGRID_TILE_ROWS x BITGRID_TILE_WORDS words, each loaded
+ * with a halo of one row per generation and one word on each
+ * side, advanced up to BITGRID_BLOCK_MAX generations while it
+ * stays in cache, and only its inner part written back.
+ */
+
+#define BITGRID_TILE_ROWS  256
+#define BITGRID_TILE_WORDS 16
+#define BITGRID_BLOCK_MAX  32
+
+BitGrid * bitgrid_new        (int rows, int cols);
+BitGrid * bitgrid_new_banded (int rows, int cols, int bands);
+void      bitgrid_free       (BitGrid *grid);
+void      bitgrid_clear      (BitGrid *grid);
+void      bitgrid_from_grid  (BitGrid *bit_grid, const Grid *grid);
+void      bitgrid_to_grid    (Grid *grid, const BitGrid *bit_grid);
+void      bitgrid_from_grid_rect (BitGrid *bit_grid, const Grid *grid,
+                                  int row_from, int row_to, int word_from, int word_to);
+void      bitgrid_to_grid_rect   (Grid *grid, const BitGrid *bit_grid,
+                                  int row_from, int row_to, int word_from, int word_to);
+long      bitgrid_population (const BitGrid *grid);
+void      bitgrid_step_rows  (BitGrid *grid_next, const BitGrid *grid_cur,
+                              const BitRule *rule, int row_from, int row_to);
+void      bitgrid_step_rect  (BitGrid *grid_next, const BitGrid *grid_cur,
+                              const BitRule *rule, int row_from, int row_to,
+                              int word_from, int word_to);
+void      bitgrid_step       (BitGrid *grid_next, const BitGrid *grid_cur,
+                              const BitRule *rule);
+void      bitgrid_step_blocked (BitGrid *grid_next, const BitGrid *grid_cur,
+                                const BitRule *rule, int gens, long *alive);
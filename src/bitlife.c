@@ -0,0 +1,24 @@
+#include "bitlife.h"
+
+#include <stdio.h>
+#include <assert.h>
+
+#define NEIGHBORS 9
+
+void
+bitlife_rule_init (BitRule *bit_rule, Rule *rule)
+{
+	assert (bit_rule != NULL);
+	assert (rule != NULL);
+
+	*bit_rule = (BitRule) {0};
+
+	for (int n = 0; n < NEIGHBORS; n++)
+		{
+			if (rule_next_state (rule, 0, n))
+				bit_rule->birth |= 1 << n;
+
+			if (rule_next_state (rule, 1, n))
+				bit_rule->survive |= 1 << n;
+		}
+}
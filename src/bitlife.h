@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdint.h>
+#include "rule.h"
+
+/*
+ * Bitwise Life kernel: every bit of a word is an independent
+ * cell, so one call advances 64 cells at once. Whether those
+ * 64 bits are 64 universes (ensemble) or 64 neighbouring
+ * columns of a row only depends on how the caller gathers
+ * the eight neighbour words.
+ */
+
+typedef struct
+{
+	uint16_t birth;
+	uint16_t survive;
+} BitRule;
+
+void bitlife_rule_init (BitRule *bit_rule, Rule *rule);
+
+static inline uint64_t
+bitlife_next (const BitRule *r, uint64_t alive,
+		uint64_t n0, uint64_t n1, uint64_t n2, uint64_t n3,
+		uint64_t n4, uint64_t n5, uint64_t n6, uint64_t n7)
+{
+	// Carry-save adder tree: neighbour count in bits c1..c8
+	uint64_t s0 = n0 ^ n1 ^ n2;
+	uint64_t t0 = (n0 & n1) | (n2 & (n0 ^ n1));
+	uint64_t s1 = n3 ^ n4 ^ n5;
+	uint64_t t1 = (n3 & n4) | (n5 & (n3 ^ n4));
+	uint64_t s2 = n6 ^ n7;
+	uint64_t t2 = n6 & n7;
+
+	uint64_t c1 = s0 ^ s1 ^ s2;
+	uint64_t t3 = (s0 & s1) | (s2 & (s0 ^ s1));
+
+	uint64_t u0 = t0 ^ t1 ^ t2;
+	uint64_t v0 = (t0 & t1) | (t2 & (t0 ^ t1));
+	uint64_t c2 = u0 ^ t3;
+	uint64_t v1 = u0 & t3;
+	uint64_t c4 = v0 ^ v1;
+	uint64_t c8 = v0 & v1;
+
+	uint64_t birth = 0, survive = 0;
+
+	for (int n = 0; n <= 8; n++)
+		{
+			if (!((r->birth | r->survive) & (1 << n)))
+				continue;
+
+			uint64_t eq = (n & 1 ? c1 : ~c1)
+				& (n & 2 ? c2 : ~c2)
+				& (n & 4 ? c4 : ~c4)
+				& (n & 8 ? c8 : ~c8);
+
+			if (r->birth & (1 << n))
+				birth |= eq;
+
+			if (r->survive & (1 << n))
+				survive |= eq;
+		}
+
+	return (~alive & birth) | (alive & survive);
+}
@@ -12,6 +12,15 @@
 #include "event.h"
 #include "error.h"
 #include "screen.h"
+#include "sweep.h"
+#include "engine.h"
+#include "trace.h"
+#include "render.h"
+#include "frames.h"
+#include "shm.h"
+#include "stream.h"
+#include "domain.h"
+#include "diskgrid.h"
 
 #ifdef HAVE_VERSION_H
 #include "version.h"
@@ -24,8 +33,20 @@
 #define COLS         30
 #define SEED         time (NULL)
 #define DELAY        500000
+#define GENERATIONS  0
+#define HISTORY_MEM  64
+#define SOUP_SIZE    16
+#define CENSUS       "census.txt"
+#define THREADS      0
+#define METRICS_INTERVAL 10
 #define LIVE_PERCENT 0.50
 #define RULE         "conway"
+#define ENGINE       "dense"
+#define RENDERER     "curses"
+#define FRAMES_EVERY 1
+#define FRAMES_SCALE 0
+#define HALO         1
+#define BLOCK_GENS   1
 
 static void
 config_print_usage (FILE *fp)
@@ -35,7 +56,18 @@ config_print_usage (FILE *fp)
 		"%s %s\n"
 		"\n"
 		"Usage: %s [-hV] [-R STR] [-r INT] [-c INT] [-t INT] [-p FLOAT] [-s INT]\n"
-		"       %*c [-P [STR|FILE]] [--list-rules] [--list-patterns]\n"
+		"       %*c [-g INT] [-P [STR|FILE]] [--list-rules] [--list-patterns]\n"
+		"       %*c [--headless] [--delta-out FILE] [--history-mem INT]\n"
+		"       %*c [--ensemble] [--soup-search INT] [--soup-size INT]\n"
+		"       %*c [--census FILE] [--threads INT] [--sweep STR]\n"
+		"       %*c [--engine STR] [--list-engines] [--metrics-file FILE]\n"
+		"       %*c [--metrics-interval INT] [--trace FILE]\n"
+		"       %*c [--record-input FILE] [--replay-input FILE] [--offscreen]\n"
+		"       %*c [--renderer STR] [--frames-out FILE]\n"
+		"       %*c [--frames-every INT] [--frames-scale INT] [--shm NAME]\n"
+		"       %*c [--serve ADDR] [--ranks INT] [--transport STR] [--halo INT]\n"
+		"       %*c [--rank INT] [--peers STR] [--disk-grid FILE] [--band-rows INT]\n"
+		"       %*c [--block-gens INT] [--pipeline] [--engine-log FILE]\n"
 		"\n"
 		"Options:\n"
 		"   -h, --help           Show help options\n"
@@ -45,6 +77,7 @@ config_print_usage (FILE *fp)
 		"   -s, --seed           Seed for reproducibility [time(NULL)]\n"
 		"   -p, --live-percent   Percentage of living cells [%f]\n"
 		"   -t, --delay          Generation delay in microseconds [%d]\n"
+		"   -g, --generations    Stop after INT generations, 0 for no limit [%d]\n"
 		"   -R, --rule           Cellular automaton rule [%s]\n"
 		"                        Use a named alias (e.g., conway, highlife)\n"
 		"                        or a custom rule Golly/RLE (Bx/Sy) format.\n"
@@ -55,6 +88,81 @@ config_print_usage (FILE *fp)
 		"       --pattern-file   Custom pattern from Golly/TLE file format\n"
 		"       --list-rules     List all available rule aliases and exit\n"
 		"       --list-patterns  List all available pattern aliases and exit\n"
+		"       --headless       Run without the terminal interface as fast\n"
+		"                        as possible. Requires --generations\n"
+		"       --delta-out      Write the births and deaths of every\n"
+		"                        generation to FILE. See section DELTA below\n"
+		"       --history-mem    Memory budget in MiB for the rewind history,\n"
+		"                        0 to disable [%d]\n"
+		"       --ensemble       Run 64 random universes of the same rule at\n"
+		"                        once, universe k seeded with --seed + k, and\n"
+		"                        print their population and stabilisation\n"
+		"                        generation. Requires --generations\n"
+		"       --soup-search    Run INT random soups until they stabilise\n"
+		"                        and write the census of the objects left\n"
+		"                        behind. See section SOUP SEARCH below\n"
+		"       --soup-size      Side of each random soup [%d]\n"
+		"       --census         Census output file [%s]\n"
+		"       --threads        Worker threads, 0 for one per core [%d]\n"
+		"       --sweep          Run the same initial grid under many rules\n"
+		"                        and print how each one evolves. Requires\n"
+		"                        --generations. See section SWEEP below\n"
+		"       --engine         Stepping engine [%s]\n"
+		"       --list-engines   List all available engines and exit\n"
+		"       --engine-log     Write each switch of --engine auto and its\n"
+		"                        reason to FILE, to stderr by default with\n"
+		"                        --headless\n"
+		"       --block-gens     Generations stepped at once by --headless\n"
+		"                        runs that write nothing per generation.\n"
+		"                        The temporal engine keeps its tiles in\n"
+		"                        cache for up to %d of them [%d]\n"
+		"       --metrics-file   Write metrics to FILE in the Prometheus text\n"
+		"                        format every --metrics-interval seconds.\n"
+		"                        See section METRICS below\n"
+		"       --metrics-interval\n"
+		"                        Seconds between metrics file writes [%d]\n"
+		"       --trace          Write a Chrome Trace Event JSON of the hot\n"
+		"                        paths to FILE, to be opened in Perfetto\n"
+		"       --record-input   Log every input event with its generation\n"
+		"                        and time to FILE\n"
+		"       --replay-input   Feed the events logged by --record-input\n"
+		"                        back as fast as possible, then print the\n"
+		"                        frame timings. The run must be started\n"
+		"                        with the same options and --seed\n"
+		"       --offscreen      Draw to an offscreen terminal on /dev/null,\n"
+		"                        sized by $LINES and $COLUMNS\n"
+		"       --renderer       Terminal renderer, curses or ansi [%s]\n"
+		"                        The ansi renderer writes only the changed\n"
+		"                        cells, in one write per frame, and shows\n"
+		"                        the bytes written per frame\n"
+		"       --pipeline       Step the next generation on its own thread\n"
+		"                        while the current one is drawn\n"
+		"       --frames-out     Export generations as images to FILE.\n"
+		"                        See section FRAMES below\n"
+		"       --frames-every   Export every INT-th generation [%d]\n"
+		"       --frames-scale   One pixel per 2^INT x 2^INT cells, as the\n"
+		"                        view at the same scale [%d]\n"
+		"       --shm            Keep the grids in the POSIX shared memory\n"
+		"                        segment NAME (e.g. /conga) for external\n"
+		"                        viewers. See section SHARED MEMORY below\n"
+		"       --serve          Stream the grid to viewers on the Unix\n"
+		"                        socket ADDR, or on 127.0.0.1:PORT with\n"
+		"                        tcp:PORT. See section STREAM below\n"
+		"       --ranks          Split the grid among INT processes that\n"
+		"                        exchange their borders. Requires\n"
+		"                        --generations. See section RANKS below\n"
+		"       --transport      Border exchange between ranks, shm, unix\n"
+		"                        or tcp [%s]\n"
+		"       --halo           Exchange borders INT cells wide every INT\n"
+		"                        generations [%d]\n"
+		"       --rank           Run only rank INT of --ranks, the others\n"
+		"                        run elsewhere with the same options\n"
+		"       --peers          Addresses of the ranks, see RANKS below\n"
+		"       --disk-grid      Keep the grid in FILE, for grids larger\n"
+		"                        than memory. Requires --generations. See\n"
+		"                        section DISK GRID below\n"
+		"       --band-rows      Rows stepped at a time by --disk-grid,\n"
+		"                        0 for %d MiB bands [0]\n"
 		"\n"
 		"RULE\n"
 		" A cellular automaton rule defines how cells are born and survive\n"
@@ -109,9 +217,131 @@ config_print_usage (FILE *fp)
 		" Example RLE snippet:\n"
 		"   x = 3, y = 3, rule = B3/S23\n"
 		"   bo$2bo$3o!\n"
+		"\n"
+		"DELTA\n"
+		" The delta stream is a compact binary file whose size scales with\n"
+		" the activity of the grid, not with its area. All integers are\n"
+		" unsigned LEB128 varints.\n"
+		" \n"
+		"   header: 'CGDL', version byte, rows, cols\n"
+		"   record: generation gap, births, deaths,\n"
+		"           births index gaps..., deaths index gaps...\n"
+		" \n"
+		" A cell index is row * cols + col. Each index is stored as the\n"
+		" distance to the previous one of the same kind, minus one.\n"
+		"\n"
+		"REWIND\n"
+		" Past generations are kept as XOR deltas against periodic\n"
+		" keyframes, so the memory used grows with the activity of the\n"
+		" grid. When --history-mem is exhausted the oldest generations\n"
+		" are dropped.\n"
+		" \n"
+		"   b      - Pause and step one generation backward\n"
+		"   <N>b   - Pause and step N generations backward\n"
+		"   <N>J   - Pause and seek to generation N (e.g. 120J)\n"
+		"\n"
+		"SOUP SEARCH\n"
+		" Each soup is a --soup-size square seeded with --seed + N and\n"
+		" --live-percent, placed at the center of a torus four times as\n"
+		" large. It runs until its population becomes periodic, then the\n"
+		" remaining objects are separated and run in isolation to be\n"
+		" classified. Objects are keyed by a hash invariant to translation,\n"
+		" rotation, reflection and phase, with apgsearch-like prefixes:\n"
+		" \n"
+		"   xs<population>  - still life\n"
+		"   xp<period>      - oscillator\n"
+		"   xq<period>      - spaceship\n"
+		"   zz<population>  - not periodic in isolation\n"
+		"   zz_mess         - objects past 2048 cells, counted but not\n"
+		"                     classified, so with no population\n"
+		"\n"
+		"SWEEP\n"
+		" STR is a comma separated list of rules in any --rule form. In\n"
+		" the Bx/Sy format each 'x' stands for one optional extra digit,\n"
+		" so every rule it expands to is swept once:\n"
+		" \n"
+		"   conway,highlife  - Two rules\n"
+		"   B3x/S23          - B3/S23, B03/S23, B13/S23, ..., B38/S23\n"
+		"   B3/S2xx          - B3/S2 plus every one or two extra digits\n"
+		" \n"
+		" The initial grid is random or --pattern, shared by all rules.\n"
+		" Each rule reports its final population, density, growth over\n"
+		" the initial population and the generation and period at which\n"
+		" the grid became periodic (up to %d), or '-' if it did not.\n"
+		"\n"
+		"METRICS\n"
+		" Generation and render time histograms, generation and frame\n"
+		" counters, population, event queue depth and resident memory.\n"
+		" The file is replaced atomically, so it can be read by the\n"
+		" node_exporter textfile collector. Sending SIGUSR1 writes the\n"
+		" metrics at once to --metrics-file or, if not set, to stderr\n"
+		" with --headless and to $TMPDIR/conga-PID.prom otherwise.\n"
+		"\n"
+		"FRAMES\n"
+		" Frames are grayscale, white for empty and black for fully alive\n"
+		" cells, with the live fraction in between when --frames-scale is\n"
+		" above 0. FILE selects the format:\n"
+		" \n"
+		"   -            - YUV4MPEG2 stream on stdout. Requires --headless\n"
+		"   NAME.y4m     - YUV4MPEG2 stream to the file\n"
+		"   PREFIX       - One binary PPM per frame, PREFIX000042.ppm\n"
+		" \n"
+		" The stream runs at %d fps and can be piped to an encoder:\n"
+		" \n"
+		"   conga --headless -g 1000 --frames-out - | ffmpeg -i - out.mp4\n"
+		"\n"
+		"SHARED MEMORY\n"
+		" The segment holds a header and the two generation buffers, one\n"
+		" native int per cell, row major. The header (see src/shm.h) has\n"
+		" the magic 'CONGASHM', rows, cols, the current generation, the\n"
+		" offset of its buffer and a seqlock counter, odd while it is\n"
+		" being updated. Map it read-only, read the counter, the header\n"
+		" and the cells, and retry if the counter was odd or changed.\n"
+		" The segment is removed when the run ends.\n"
+		"\n"
+		"STREAM\n"
+		" Each viewer gets a keyframe of its viewport, the whole grid until\n"
+		" it asks for another, then the births and deaths of every\n"
+		" generation in the DELTA format. A viewer that cannot keep up\n"
+		" skips generations instead of slowing down the run. The protocol\n"
+		" is described in src/stream.h, and scripts/stream_view.pl is a\n"
+		" reference viewer:\n"
+		" \n"
+		"   conga --serve /tmp/conga.sock &\n"
+		"   perl scripts/stream_view.pl /tmp/conga.sock\n"
+		"\n"
+		"RANKS\n"
+		" The torus is cut in --ranks rectangles, as square as possible,\n"
+		" each run by one process holding a border of --halo cells\n"
+		" copied from its neighbors. The result is the same as a single\n"
+		" process run, compare the checksum in the report of each rank\n"
+		" count. Without --rank all the ranks are forked on this host;\n"
+		" with it, each host runs its own ranks and --peers says where\n"
+		" the others are:\n"
+		" \n"
+		"   shm   - Shared memory, all the ranks on this host\n"
+		"   unix  - Unix sockets, --peers PREFIX for PREFIX<rank>.sock\n"
+		"   tcp   - TCP, --peers HOST:PORT,... one per rank, in order\n"
+		" \n"
+		"   conga -g 1000 -r 4096 -c 4096 --ranks 4 --transport unix\n"
+		"\n"
+		"DISK GRID\n"
+		" The grid is kept bit-packed in FILE, which is created from\n"
+		" --rows, --cols and --seed (seeded row by row, unlike the other\n"
+		" modes) or --pattern if it does not exist, and continued from\n"
+		" its last generation if it does. Each generation is written to\n"
+		" FILE.next band by band, then the two are swapped, so the disk\n"
+		" is read and written in order. The report shows the I/O rate\n"
+		" and the major page faults taken.\n"
 		"\n",
-		PROGNAME, VERSION, PROGNAME, pkg_len, ' ', ROWS, COLS,
-		LIVE_PERCENT, DELAY, RULE);
+		PROGNAME, VERSION, PROGNAME, pkg_len, ' ', pkg_len, ' ', pkg_len, ' ',
+		pkg_len, ' ', pkg_len, ' ', pkg_len, ' ', pkg_len, ' ', pkg_len, ' ',
+		pkg_len, ' ', pkg_len, ' ', pkg_len, ' ', pkg_len, ' ', ROWS, COLS,
+		LIVE_PERCENT, DELAY, GENERATIONS, RULE, HISTORY_MEM, SOUP_SIZE, CENSUS,
+		THREADS, ENGINE, BITGRID_BLOCK_MAX, BLOCK_GENS,
+		METRICS_INTERVAL, RENDERER, FRAMES_EVERY, FRAMES_SCALE,
+		DOMAIN_TRANSPORT, HALO, DISKGRID_BAND_BYTES >> 20, SWEEP_MAX_PERIOD,
+		FRAMES_FPS);
 }
 
 static void
@@ -190,6 +420,30 @@ config_print_patterns (FILE *fp)
 	fprintf (fp, "\n");
 }
 
+static void
+config_print_engines (FILE *fp)
+{
+	const EngineDef *def = NULL;
+
+	int biggest_len = 0;
+	int len = 0;
+
+	for (def = engine_defs; def->name != NULL; def++)
+		{
+			len = strlen (def->name);
+			if (len > biggest_len)
+				biggest_len = len;
+		}
+
+	fprintf (fp, "Available engines:\n");
+
+	for (def = engine_defs; def->name != NULL; def++)
+		fprintf (fp, "  - %-*s  %s\n",
+				biggest_len, def->name, def->desc);
+
+	fprintf (fp, "\n");
+}
+
 static void
 config_print_progname (void)
 {
@@ -219,8 +473,22 @@ config_new (void)
 		.rows         = ROWS,
 		.cols         = COLS,
 		.delay        = DELAY,
+		.generations  = GENERATIONS,
+		.history_mem  = HISTORY_MEM,
+		.soup_size    = SOUP_SIZE,
+		.census       = CENSUS,
+		.threads      = THREADS,
+		.metrics_interval = METRICS_INTERVAL,
 		.live_percent = LIVE_PERCENT,
-		.rule         = RULE
+		.rule         = RULE,
+		.engine       = ENGINE,
+		.renderer     = RENDERER,
+		.frames_every = FRAMES_EVERY,
+		.frames_scale = FRAMES_SCALE,
+		.transport    = DOMAIN_TRANSPORT,
+		.rank         = -1,
+		.halo         = HALO,
+		.block_gens   = BLOCK_GENS
 	};
 
 	return cfg;
@@ -245,12 +513,119 @@ config_validate_args (const Config *cfg)
 		error (1, 0, "--delay must be [%d, %d]",
 				EVENT_DELAY_MIN, EVENT_DELAY_MAX);
 
+	if (cfg->generations < 0)
+		error (1, 0, "--generations must be >= 0");
+
+	if (cfg->headless && cfg->generations == 0)
+		error (1, 0, "--headless requires --generations");
+
+	if (cfg->history_mem < 0)
+		error (1, 0, "--history-mem must be >= 0");
+
+	if (cfg->ensemble && cfg->generations == 0)
+		error (1, 0, "--ensemble requires --generations");
+
+	if (cfg->ensemble && (cfg->pattern != NULL || cfg->pattern_file != NULL))
+		error (1, 0, "--ensemble cannot be set with --pattern or --pattern-file");
+
+	if (cfg->soups < 0)
+		error (1, 0, "--soup-search must be >= 0");
+
+	if (cfg->soup_size <= 0)
+		error (1, 0, "--soup-size must be > 0");
+
+	if (cfg->threads < 0)
+		error (1, 0, "--threads must be >= 0");
+
+	if (cfg->soups > 0 && cfg->ensemble)
+		error (1, 0, "--soup-search and --ensemble cannot be set together");
+
+	if (cfg->sweep != NULL && (cfg->ensemble || cfg->soups > 0))
+		error (1, 0, "--sweep cannot be set with --ensemble or --soup-search");
+
+	if (cfg->sweep != NULL && cfg->generations == 0)
+		error (1, 0, "--sweep requires --generations");
+
+	if (cfg->sweep != NULL && !sweep_spec_is_valid (cfg->sweep))
+		error (1, 0, "--sweep is not a valid list of rules");
+
 	if (cfg->live_percent <= 0.0 || cfg->live_percent >= 1.0)
 		error (1, 0, "--live-percent must be (0.0, 1.0)");
 
 	if (!rule_is_valid (cfg->rule))
 		error (1, 0, "--rule is not a valid rule or alias");
 
+	if (cfg->metrics_interval <= 0)
+		error (1, 0, "--metrics-interval must be > 0");
+
+	if (cfg->record_input != NULL && cfg->replay_input != NULL)
+		error (1, 0, "--record-input and --replay-input cannot be set together");
+
+	if ((cfg->record_input != NULL || cfg->replay_input != NULL || cfg->offscreen)
+			&& cfg->headless)
+		error (1, 0, "--record-input, --replay-input and --offscreen cannot be set with --headless");
+
+	if (cfg->pipeline && cfg->headless)
+		error (1, 0, "--pipeline cannot be set with --headless");
+
+#ifdef DISABLE_TRACE
+	if (cfg->trace != NULL)
+		error (1, 0, "--trace is not available, built with DISABLE_TRACE");
+#endif
+
+	if (!engine_is_valid (cfg->engine))
+		error (1, 0, "--engine is not a valid engine");
+
+	if (!render_backend_is_valid (cfg->renderer))
+		error (1, 0, "--renderer must be 'curses' or 'ansi'");
+
+	if (cfg->frames_every <= 0)
+		error (1, 0, "--frames-every must be > 0");
+
+	if (cfg->frames_scale < 0)
+		error (1, 0, "--frames-scale must be >= 0");
+
+	if (cfg->frames_out != NULL && strcmp (cfg->frames_out, FRAMES_STDOUT) == 0
+			&& !cfg->headless)
+		error (1, 0, "--frames-out to stdout requires --headless");
+
+	if (cfg->shm != NULL && !shm_name_is_valid (cfg->shm))
+		error (1, 0, "--shm must be a name with a single leading '/'");
+
+	if (cfg->serve != NULL && !stream_addr_is_valid (cfg->serve))
+		error (1, 0, "--serve must be a socket path or tcp:PORT");
+
+	if (cfg->ranks < 0 || cfg->ranks > DOMAIN_RANKS_MAX)
+		error (1, 0, "--ranks must be [0, %d]", DOMAIN_RANKS_MAX);
+
+	if (cfg->ranks > 0 && cfg->generations == 0)
+		error (1, 0, "--ranks requires --generations");
+
+	if (cfg->ranks > 0 && (cfg->ensemble || cfg->soups > 0 || cfg->sweep != NULL))
+		error (1, 0, "--ranks cannot be set with --ensemble, --soup-search or --sweep");
+
+	if (!domain_transport_is_valid (cfg->transport))
+		error (1, 0, "--transport must be 'shm', 'unix' or 'tcp'");
+
+	if (cfg->halo <= 0)
+		error (1, 0, "--halo must be > 0");
+
+	if (cfg->rank >= 0 && cfg->rank >= cfg->ranks)
+		error (1, 0, "--rank must be less than --ranks");
+
+	if (cfg->disk_grid != NULL && cfg->generations == 0)
+		error (1, 0, "--disk-grid requires --generations");
+
+	if (cfg->disk_grid != NULL
+			&& (cfg->ensemble || cfg->soups > 0 || cfg->sweep != NULL || cfg->ranks > 0))
+		error (1, 0, "--disk-grid cannot be set with --ensemble, --soup-search, --sweep or --ranks");
+
+	if (cfg->band_rows < 0)
+		error (1, 0, "--band-rows must be >= 0");
+
+	if (cfg->block_gens <= 0)
+		error (1, 0, "--block-gens must be > 0");
+
 	if (cfg->pattern != NULL && cfg->pattern_file != NULL)
 		error (1, 0, "--pattern and --pattern-file cannot be set together");
 
@@ -284,13 +659,47 @@ config_apply_args (Config *cfg, int argc, char **argv)
 		{"pattern",       required_argument, 0, 'P'},
 		{"pattern-file",  required_argument, 0,  2 },
 		{"list-patterns", no_argument,       0,  3 },
+		{"generations",   required_argument, 0, 'g'},
+		{"headless",      no_argument,       0,  4 },
+		{"delta-out",     required_argument, 0,  5 },
+		{"history-mem",   required_argument, 0,  6 },
+		{"ensemble",      no_argument,       0,  7 },
+		{"soup-search",   required_argument, 0,  8 },
+		{"soup-size",     required_argument, 0,  9 },
+		{"census",        required_argument, 0, 10 },
+		{"threads",       required_argument, 0, 11 },
+		{"sweep",         required_argument, 0, 12 },
+		{"engine",        required_argument, 0, 13 },
+		{"list-engines",  no_argument,       0, 14 },
+		{"metrics-file",  required_argument, 0, 15 },
+		{"metrics-interval", required_argument, 0, 16 },
+		{"trace",         required_argument, 0, 17 },
+		{"record-input",  required_argument, 0, 18 },
+		{"replay-input",  required_argument, 0, 19 },
+		{"offscreen",     no_argument,       0, 20 },
+		{"renderer",      required_argument, 0, 21 },
+		{"frames-out",    required_argument, 0, 22 },
+		{"frames-every",  required_argument, 0, 23 },
+		{"frames-scale",  required_argument, 0, 24 },
+		{"shm",           required_argument, 0, 25 },
+		{"serve",         required_argument, 0, 26 },
+		{"ranks",         required_argument, 0, 27 },
+		{"transport",     required_argument, 0, 28 },
+		{"halo",          required_argument, 0, 29 },
+		{"rank",          required_argument, 0, 30 },
+		{"peers",         required_argument, 0, 31 },
+		{"disk-grid",     required_argument, 0, 32 },
+		{"band-rows",     required_argument, 0, 33 },
+		{"block-gens",    required_argument, 0, 34 },
+		{"pipeline",      no_argument,       0, 35 },
+		{"engine-log",    required_argument, 0, 36 },
 		{0,               0,                 0,  0 }
 	};
 
 	// progname for getopt
 	argv[0] = PROGNAME;
 
-	while ((o = getopt_long (argc, argv, "hVr:c:s:t:p:R:P:", opt, &option_index)) >= 0)
+	while ((o = getopt_long (argc, argv, "hVr:c:s:t:g:p:R:P:", opt, &option_index)) >= 0)
 		{
 			switch (o)
 				{
@@ -324,6 +733,11 @@ config_apply_args (Config *cfg, int argc, char **argv)
 						cfg->delay = atoi (optarg);
 						break;
 					}
+				case 'g':
+					{
+						cfg->generations = atoi (optarg);
+						break;
+					}
 				case 'p':
 					{
 						cfg->live_percent = atof (optarg);
@@ -354,6 +768,171 @@ config_apply_args (Config *cfg, int argc, char **argv)
 						config_print_patterns (stdout);
 						exit (EXIT_SUCCESS);
 					}
+				case 4:
+					{
+						cfg->headless = 1;
+						break;
+					}
+				case 5:
+					{
+						cfg->delta_out = optarg;
+						break;
+					}
+				case 6:
+					{
+						cfg->history_mem = atoi (optarg);
+						break;
+					}
+				case 7:
+					{
+						cfg->ensemble = 1;
+						break;
+					}
+				case 8:
+					{
+						cfg->soups = atoi (optarg);
+						break;
+					}
+				case 9:
+					{
+						cfg->soup_size = atoi (optarg);
+						break;
+					}
+				case 10:
+					{
+						cfg->census = optarg;
+						break;
+					}
+				case 11:
+					{
+						cfg->threads = atoi (optarg);
+						break;
+					}
+				case 12:
+					{
+						cfg->sweep = optarg;
+						break;
+					}
+				case 13:
+					{
+						cfg->engine = optarg;
+						break;
+					}
+				case 14:
+					{
+						config_print_engines (stdout);
+						exit (EXIT_SUCCESS);
+					}
+				case 15:
+					{
+						cfg->metrics_file = optarg;
+						break;
+					}
+				case 16:
+					{
+						cfg->metrics_interval = atoi (optarg);
+						break;
+					}
+				case 17:
+					{
+						cfg->trace = optarg;
+						break;
+					}
+				case 18:
+					{
+						cfg->record_input = optarg;
+						break;
+					}
+				case 19:
+					{
+						cfg->replay_input = optarg;
+						break;
+					}
+				case 20:
+					{
+						cfg->offscreen = 1;
+						break;
+					}
+				case 21:
+					{
+						cfg->renderer = optarg;
+						break;
+					}
+				case 22:
+					{
+						cfg->frames_out = optarg;
+						break;
+					}
+				case 23:
+					{
+						cfg->frames_every = atoi (optarg);
+						break;
+					}
+				case 24:
+					{
+						cfg->frames_scale = atoi (optarg);
+						break;
+					}
+				case 25:
+					{
+						cfg->shm = optarg;
+						break;
+					}
+				case 26:
+					{
+						cfg->serve = optarg;
+						break;
+					}
+				case 27:
+					{
+						cfg->ranks = atoi (optarg);
+						break;
+					}
+				case 28:
+					{
+						cfg->transport = optarg;
+						break;
+					}
+				case 29:
+					{
+						cfg->halo = atoi (optarg);
+						break;
+					}
+				case 30:
+					{
+						cfg->rank = atoi (optarg);
+						break;
+					}
+				case 31:
+					{
+						cfg->peers = optarg;
+						break;
+					}
+				case 32:
+					{
+						cfg->disk_grid = optarg;
+						break;
+					}
+				case 33:
+					{
+						cfg->band_rows = atoi (optarg);
+						break;
+					}
+				case 34:
+					{
+						cfg->block_gens = atoi (optarg);
+						break;
+					}
+				case 35:
+					{
+						cfg->pipeline = 1;
+						break;
+					}
+				case 36:
+					{
+						cfg->engine_log = optarg;
+						break;
+					}
 				case '?':
 				case ':':
 					{
@@ -7,10 +7,43 @@ typedef struct
 	const char *pattern_file;
 	const char *pattern;
 	const char *rule;
+	const char *delta_out;
+	const char *census;
+	const char *sweep;
+	const char *engine;
+	const char *engine_log;
+	const char *renderer;
+	const char *frames_out;
+	const char *shm;
+	const char *serve;
+	const char *transport;
+	const char *peers;
+	const char *disk_grid;
+	const char *metrics_file;
+	const char *trace;
+	const char *record_input;
+	const char *replay_input;
 	long        seed;
 	int         rows;
 	int         cols;
 	int         delay;
+	int         generations;
+	int         headless;
+	int         offscreen;
+	int         pipeline;
+	int         history_mem;
+	int         ensemble;
+	int         soups;
+	int         soup_size;
+	int         threads;
+	int         metrics_interval;
+	int         frames_every;
+	int         frames_scale;
+	int         ranks;
+	int         rank;
+	int         halo;
+	int         band_rows;
+	int         block_gens;
 	float       live_percent;
 } Config;
 
@@ -2,23 +2,50 @@
 
 #include <ncurses.h>
 #include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
 #include <assert.h>
 #include "wrapper.h"
+#include "error.h"
 #include "event.h"
 #include "grid.h"
 #include "cell.h"
 #include "render.h"
+#include "render_ansi.h"
+#include "screen.h"
 #include "rule.h"
 #include "rand.h"
 #include "pattern.h"
+#include "delta.h"
+#include "frames.h"
+#include "shm.h"
+#include "stream.h"
+#include "history.h"
+#include "engine.h"
+#include "perf.h"
+#include "metrics.h"
+#include "trace.h"
+#include "input.h"
+#include "parallel.h"
+#include "pages.h"
 
 #define FPS         60
 #define DELAY_STEP  10000
+#define MIB         (1024 * 1024)
 
 #define GEN_RATE(delay) ( \
 	(double) EVENT_QUEUE_SEC / (delay) \
 )
 
+enum
+{
+	PIPELINE_IDLE,
+	PIPELINE_STEP,
+	PIPELINE_DONE,
+	PIPELINE_QUIT
+};
+
 struct _Conga
 {
 	EventQueue *queue;
@@ -31,9 +58,47 @@ struct _Conga
 
 	Rule       *rule;
 	Rand       *rng;
+	Engine     *engine;
+	FILE       *engine_log;
+	Perf       *perf;
+	RenderAnsi *ansi;
 
 	Cell        cell;
 
+	DeltaWriter *delta;
+	FrameWriter *frames;
+	ShmGrid     *shm;
+	StreamServer *stream;
+	History     *history;
+
+	int         gen_limit;
+	int         block_gens;
+	int         headless;
+	int         count;
+
+	InputLog   *record;
+	InputLog   *replay;
+	long        replayed;
+
+	// The next generation stepped on its own thread while the
+	// current one is drawn, see conga_pipeline_start
+	struct
+	{
+		int              on;
+		pthread_t        thread;
+		pthread_mutex_t  lock;
+		pthread_cond_t   cond;
+		int              state;
+		int              gens;
+		double           secs;
+		Cell             cell;
+	} pipeline;
+
+	const char *metrics_file;
+	char       *metrics_dump_file;
+	double      metrics_interval;
+	double      metrics_last;
+
 	struct
 	{
 		int   done;
@@ -43,6 +108,13 @@ struct _Conga
 	} status;
 };
 
+// Threads that first touch the grid, as many as would step it
+static inline int
+conga_bands (const Config *cfg)
+{
+	return cfg->threads > 0 ? cfg->threads : parallel_num_cpus ();
+}
+
 static void
 conga_set_game_from_pattern (Conga *game, const Config *cfg)
 {
@@ -64,14 +136,9 @@ conga_set_game_from_pattern (Conga *game, const Config *cfg)
 		? cfg->cols
 		: pattern->grid->cols;
 
-	char *title = NULL;
-	asprintf (&title, "%s %s", cfg->progname, cfg->version);
-
 	*game = (Conga) {
-		.queue     = event_queue_new (FPS, cfg->delay),
-		.render    = render_new      (title, rows, cols),
-		.grid_cur  = grid_new        (rows, cols),
-		.grid_next = grid_new        (rows, cols),
+		.grid_cur  = grid_new_banded (rows, cols, conga_bands (cfg)),
+		.grid_next = grid_new_banded (rows, cols, conga_bands (cfg)),
 		.rule      = rule_new        (rule),
 		.rng       = NULL
 	};
@@ -79,31 +146,126 @@ conga_set_game_from_pattern (Conga *game, const Config *cfg)
 	cell_seed_from_grid (game->grid_cur,
 			pattern->grid, &game->cell);
 
-	xfree (title);
 	pattern_free (pattern);
 }
 
 static void
 conga_set_random_game (Conga *game, const Config *cfg)
 {
-	char *title = NULL;
-	asprintf (&title, "%s %s", cfg->progname, cfg->version);
-
 	*game = (Conga) {
-		.queue     = event_queue_new (FPS, cfg->delay),
-		.render    = render_new      (title, cfg->rows, cfg->cols),
-		.grid_cur  = grid_new        (cfg->rows, cfg->cols),
-		.grid_next = grid_new        (cfg->rows, cfg->cols),
+		.grid_cur  = grid_new_banded (cfg->rows, cfg->cols, conga_bands (cfg)),
+		.grid_next = grid_new_banded (cfg->rows, cfg->cols, conga_bands (cfg)),
 		.rule      = rule_new        (cfg->rule),
 		.rng       = rand_new        (cfg->seed)
 	};
 
 	cell_seed_random_generation (game->grid_cur, game->rng,
 			cfg->live_percent, &game->cell);
+}
+
+// While stderr is still the terminal's, before the interface takes it
+static void
+conga_report_pages (const Conga *game)
+{
+	if (game->grid_cur->alloc != GRID_ALLOC_PAGES)
+		return;
+
+	size_t size = (size_t) game->grid_cur->rows
+		* game->grid_cur->cols * sizeof (int);
+
+	pages_report (game->grid_cur->data, size, "grid", stderr);
+	pages_report (game->grid_next->data, size, "next grid", stderr);
+}
+
+static void
+conga_set_interface (Conga *game, const Config *cfg)
+{
+	char *title = NULL;
+	asprintf (&title, "%s %s", cfg->progname, cfg->version);
+
+	if (cfg->offscreen)
+		screen_init_offscreen ();
+	else
+		screen_init ();
+
+	game->queue  = event_queue_new (FPS, cfg->delay);
+	game->render = render_new_backend (render_backend_get (cfg->renderer), title,
+			game->grid_cur->rows, game->grid_cur->cols);
 
 	xfree (title);
 }
 
+static void
+conga_share_grids (Conga *game, const char *name)
+{
+	int rows = game->grid_cur->rows;
+	int cols = game->grid_cur->cols;
+
+	game->shm = shm_grid_new (name, rows, cols);
+
+	Grid *grid_cur  = grid_new_extern (rows, cols, shm_grid_data (game->shm, 0));
+	Grid *grid_next = grid_new_extern (rows, cols, shm_grid_data (game->shm, 1));
+
+	memcpy (grid_cur->data, game->grid_cur->data,
+			(size_t) rows * cols * sizeof (int));
+
+	grid_free (game->grid_cur);
+	grid_free (game->grid_next);
+
+	game->grid_cur  = grid_cur;
+	game->grid_next = grid_next;
+
+	shm_grid_publish (game->shm, game->grid_cur->data, game->cell.gen);
+}
+
+static void
+conga_serve (void *data)
+{
+	Conga *game = data;
+	stream_server_update (game->stream, game->grid_cur, game->cell.gen);
+}
+
+static void *
+conga_pipeline_thread (void *data)
+{
+	Conga *game = data;
+
+	pthread_mutex_lock (&game->pipeline.lock);
+
+	for (;;)
+		{
+			while (game->pipeline.state == PIPELINE_IDLE
+					|| game->pipeline.state == PIPELINE_DONE)
+				pthread_cond_wait (&game->pipeline.cond, &game->pipeline.lock);
+
+			if (game->pipeline.state == PIPELINE_QUIT)
+				break;
+
+			pthread_mutex_unlock (&game->pipeline.lock);
+
+			TRACE_BEGIN ("pipeline_step");
+
+			double start = perf_now ();
+
+			engine_step_many (game->engine, game->grid_next, game->grid_cur,
+					game->pipeline.gens, &game->pipeline.cell);
+
+			double secs = perf_now () - start;
+
+			TRACE_END ("pipeline_step");
+
+			pthread_mutex_lock (&game->pipeline.lock);
+
+			game->pipeline.secs = secs;
+			game->pipeline.state = PIPELINE_DONE;
+			pthread_cond_broadcast (&game->pipeline.cond);
+		}
+
+	pthread_mutex_unlock (&game->pipeline.lock);
+
+	return NULL;
+}
+
 Conga *
 conga_new (const Config *cfg)
 {
@@ -116,12 +278,116 @@ conga_new (const Config *cfg)
 	else
 		conga_set_random_game (game, cfg);
 
+	// Shared grids are mapped anew, in pages of their own
+	if (cfg->shm == NULL)
+		conga_report_pages (game);
+
+	if (!cfg->headless)
+		conga_set_interface (game, cfg);
+
 	game->stat = (RenderStat) {
 		.alive = game->cell.alive,
 		.gen   = game->cell.gen,
 		.rate  = GEN_RATE (cfg->delay)
 	};
 
+	if (cfg->shm != NULL)
+		conga_share_grids (game, cfg->shm);
+
+	game->engine = engine_new (cfg->engine, game->grid_cur->rows,
+			game->grid_cur->cols, game->rule, conga_bands (cfg));
+
+	game->stat.engine = engine_current (game->engine);
+
+	if (cfg->engine_log != NULL)
+		game->engine_log = xfopen (cfg->engine_log, "w");
+
+	if (game->engine_log != NULL)
+		engine_set_log (game->engine, game->engine_log);
+	else if (cfg->headless)
+		engine_set_log (game->engine, stderr);
+
+	if (!cfg->headless)
+		{
+			game->perf = perf_new ();
+			game->stat.perf = game->perf;
+
+			if (render_backend_get (cfg->renderer) == &render_ansi_backend)
+				game->ansi = render_backend_state (game->render);
+		}
+
+	if (cfg->record_input != NULL)
+		game->record = input_log_record (cfg->record_input);
+
+	if (cfg->replay_input != NULL)
+		{
+			game->replay = input_log_replay (cfg->replay_input);
+			event_queue_set_replay (game->queue, game->replay);
+		}
+
+	game->metrics_file     = cfg->metrics_file;
+	game->metrics_interval = cfg->metrics_interval;
+	game->metrics_last     = perf_now ();
+
+	// The terminal interface owns stderr as much as the screen
+	if (cfg->metrics_file == NULL && !cfg->headless)
+		{
+			const char *tmpdir = getenv ("TMPDIR");
+
+			xasprintf (&game->metrics_dump_file, "%s/conga-%d.prom",
+					tmpdir != NULL && *tmpdir != '\0' ? tmpdir : "/tmp",
+					(int) getpid ());
+		}
+
+	game->gen_limit = cfg->generations;
+	game->headless  = cfg->headless;
+
+	if (cfg->delta_out != NULL)
+		game->delta = delta_writer_new (cfg->delta_out,
+				game->grid_cur->rows, game->grid_cur->cols);
+
+	if (cfg->frames_out != NULL)
+		{
+			game->frames = frames_new (cfg->frames_out, game->grid_cur->rows,
+					game->grid_cur->cols, cfg->frames_every, cfg->frames_scale);
+			frames_write (game->frames, game->grid_cur, game->cell.gen);
+		}
+
+	if (cfg->serve != NULL)
+		{
+			game->stream = stream_server_new (cfg->serve, game->grid_cur->rows,
+					game->grid_cur->cols);
+
+			// Viewers are served between generations too, e.g. when paused
+			if (game->queue != NULL)
+				event_queue_set_idle (game->queue, conga_serve, game);
+		}
+
+	// Rewinding only makes sense when someone is watching
+	if (!cfg->headless && cfg->history_mem > 0)
+		game->history = history_new (game->grid_cur, game->cell.gen,
+				(size_t) cfg->history_mem * MIB);
+
+	// Blocks of generations only when none is looked at on its own
+	game->block_gens = cfg->headless && game->delta == NULL
+		&& game->frames == NULL && game->shm == NULL && game->stream == NULL
+		? cfg->block_gens
+		: 1;
+
+	// Headless runs draw nothing to overlap with
+	if (cfg->pipeline && !cfg->headless)
+		{
+			int rc = 0;
+
+			game->pipeline.on = 1;
+			pthread_mutex_init (&game->pipeline.lock, NULL);
+			pthread_cond_init (&game->pipeline.cond, NULL);
+
+			if ((rc = pthread_create (&game->pipeline.thread, NULL,
+							conga_pipeline_thread, game)) != 0)
+				error (1, 0, "pthread_create failed: %s", strerror (rc));
+		}
+
 	return game;
 }
 
@@ -133,16 +399,178 @@ conga_swap_grids (Conga *game)
 	game->grid_next = tmp;
 }
 
+static inline int
+conga_step_gens (const Conga *game)
+{
+	int gens = game->block_gens;
+
+	if (game->gen_limit > 0 && game->gen_limit - game->cell.gen < gens)
+		gens = game->gen_limit - game->cell.gen;
+
+	return gens;
+}
+
+// Everything after the step: grid_next holds the new generation
+static void
+conga_finish_step (Conga *game, int gens, double secs)
+{
+	if (game->perf != NULL)
+		perf_add (game->perf, PERF_STEP, secs);
+
+	for (int g = 0; g < gens; g++)
+		{
+			metrics_observe (METRICS_GENERATION, secs / gens);
+			metrics_add_generation (game->cell.alive);
+		}
+
+	// Of the tiles the step changed, if the engine kept them
+	if (game->delta != NULL)
+		{
+			GridChanges changes;
+
+			delta_writer_write (game->delta, game->grid_next, game->grid_cur,
+					engine_changes (game->engine, &changes) ? &changes : NULL,
+					game->cell.gen);
+		}
+
+	if (game->history != NULL)
+		history_push (game->history, game->grid_next,
+				game->grid_cur, game->cell.gen);
+
+	if (game->frames != NULL)
+		frames_write (game->frames, game->grid_next, game->cell.gen);
+
+	game->stat.alive  = game->cell.alive;
+	game->stat.gen    = game->cell.gen;
+	game->stat.engine = engine_current (game->engine);
+
+	conga_swap_grids (game);
+
+	if (game->shm != NULL)
+		shm_grid_publish (game->shm, game->grid_cur->data, game->cell.gen);
+
+	if (game->stream != NULL)
+		stream_server_update (game->stream, game->grid_cur, game->cell.gen);
+
+	if (game->gen_limit > 0 && game->cell.gen >= game->gen_limit)
+		game->status.done = 1;
+}
+
 static inline void
 conga_update_logic (Conga *game)
 {
-	cell_step_generation (game->grid_next, game->grid_cur,
-			game->rule, &game->cell);
+	TRACE_BEGIN ("update_logic");
+
+	int gens = conga_step_gens (game);
+	double start = perf_now ();
+
+	engine_step_many (game->engine, game->grid_next, game->grid_cur,
+			gens, &game->cell);
+
+	conga_finish_step (game, gens, perf_now () - start);
+
+	TRACE_END ("update_logic");
+}
+
+/*
+ * Starts stepping grid_cur into grid_next on the pipeline thread.
+ * Until it is joined, grid_cur is only read, by the step and the
+ * renderer, and grid_next is written by the step alone; the
+ * Cell of the step is its own, so the event loop keeps seeing
+ * the generation on screen.
+ */
+static void
+conga_pipeline_start (Conga *game)
+{
+	pthread_mutex_lock (&game->pipeline.lock);
+
+	if (game->pipeline.state == PIPELINE_IDLE)
+		{
+			game->pipeline.gens = conga_step_gens (game);
+			game->pipeline.cell = game->cell;
+			game->pipeline.state = PIPELINE_STEP;
+			pthread_cond_broadcast (&game->pipeline.cond);
+		}
+
+	pthread_mutex_unlock (&game->pipeline.lock);
+}
+
+// Waits for the step in flight, if any, and returns 1 if there was
+static int
+conga_pipeline_wait (Conga *game)
+{
+	pthread_mutex_lock (&game->pipeline.lock);
+
+	while (game->pipeline.state == PIPELINE_STEP)
+		pthread_cond_wait (&game->pipeline.cond, &game->pipeline.lock);
+
+	int done = game->pipeline.state == PIPELINE_DONE;
+
+	if (done)
+		game->pipeline.state = PIPELINE_IDLE;
+
+	pthread_mutex_unlock (&game->pipeline.lock);
+
+	return done;
+}
+
+// Takes the generation stepped meanwhile and starts the next one
+static void
+conga_update_pipeline (Conga *game)
+{
+	TRACE_BEGIN ("update_logic");
+
+	conga_pipeline_start (game);
+	conga_pipeline_wait (game);
+
+	game->cell = game->pipeline.cell;
+	conga_finish_step (game, game->pipeline.gens, game->pipeline.secs);
+
+	if (!game->status.done)
+		conga_pipeline_start (game);
+
+	TRACE_END ("update_logic");
+}
+
+static void
+conga_seek_generation (Conga *game, int gen)
+{
+	if (game->history == NULL)
+		return;
+
+	// A step in flight reads the generation about to be replaced
+	if (game->pipeline.on)
+		conga_pipeline_wait (game);
+
+	// The restored generation is written over the shared one
+	if (game->shm != NULL)
+		shm_grid_begin (game->shm);
+
+	int ok = history_seek (game->history, game->grid_cur, game->cell.gen, gen);
+
+	if (game->shm != NULL)
+		shm_grid_publish (game->shm, game->grid_cur->data,
+				ok ? gen : game->cell.gen);
+
+	if (!ok)
+		return;
+
+	engine_reset (game->engine);
+
+	int cells_alive = 0;
+	for (int i = 0; i < game->grid_cur->rows * game->grid_cur->cols; i++)
+		cells_alive += game->grid_cur->data[i];
+
+	game->cell.gen   = gen;
+	game->cell.alive = cells_alive;
 
 	game->stat.alive = game->cell.alive;
 	game->stat.gen   = game->cell.gen;
 
-	conga_swap_grids (game);
+	// Stay at the restored generation until asked to run
+	game->status.paused = 1;
+	event_queue_pause (game->queue, game->status.paused);
+	game->status.redraw = 1;
 }
 
 static inline void
@@ -151,12 +579,50 @@ conga_update_graphics (Conga *game)
 	if (game->status.resize)
 		render_force_resize (game->render);
 
+	double start = perf_now ();
+
 	render_draw (game->render, game->grid_cur, &game->stat);
+
+	metrics_observe (METRICS_RENDER, perf_now () - start);
+	metrics_add_frame ();
+}
+
+static void
+conga_dump_metrics (Conga *game)
+{
+	if (game->metrics_file != NULL)
+		metrics_write_file (game->metrics_file);
+	else if (game->metrics_dump_file != NULL)
+		metrics_write_file (game->metrics_dump_file);
+	else
+		metrics_dump (stderr);
+}
+
+static inline void
+conga_update_metrics (Conga *game, double now)
+{
+	if (game->metrics_file != NULL
+			&& now - game->metrics_last >= game->metrics_interval)
+		{
+			metrics_write_file (game->metrics_file);
+			game->metrics_last = now;
+		}
 }
 
 static inline void
 conga_input_key (Conga *game, int key)
 {
+	// Vim-like count prefix, as in 120J. A leading
+	// '0' is still the scroll to the first column
+	if ((key >= '1' && key <= '9') || (key == '0' && game->count > 0))
+		{
+			game->count = game->count * 10 + key - '0';
+			return;
+		}
+
+	int count = game->count;
+	game->count = 0;
+
 	switch (key)
 		{
 		case 'q':
@@ -259,20 +725,88 @@ conga_input_key (Conga *game, int key)
 				game->status.redraw = render_scale (game->render, game->grid_cur, +1);
 				break;
 			}
+		case 'b':
+			{
+				conga_seek_generation (game,
+						game->cell.gen - (count > 0 ? count : 1));
+				break;
+			}
+		case 'J':
+			{
+				conga_seek_generation (game, count);
+				break;
+			}
+		case 'p':
+			{
+				game->stat.show_perf = !game->stat.show_perf;
+				game->status.redraw = 1;
+				break;
+			}
 		}
 }
 
+static inline void
+conga_check_replay (Conga *game)
+{
+	if (game->replay == NULL
+			|| input_log_count (game->replay) == game->replayed)
+		return;
+
+	game->replayed = input_log_count (game->replay);
+
+	// Same events at the same generations or the replay is meaningless
+	if (input_log_gen (game->replay) != game->cell.gen)
+		error (1, 0, "Replay diverged at event %ld: recorded at gen %d, now at gen %d",
+				game->replayed, input_log_gen (game->replay), game->cell.gen);
+}
+
+static void
+conga_run_headless (Conga *game)
+{
+	event_watch_dump ();
+
+	while (!game->status.done)
+		{
+			conga_update_logic (game);
+
+			if (event_dump_pending ())
+				conga_dump_metrics (game);
+
+			conga_update_metrics (game, perf_now ());
+		}
+
+	// Leave the final state for the collector
+	if (game->metrics_file != NULL)
+		metrics_write_file (game->metrics_file);
+}
+
 void
 conga_run (Conga *game)
 {
 	Event event  = {0};
 
+	if (game->headless)
+		{
+			conga_run_headless (game);
+			return;
+		}
+
 	conga_update_graphics (game);
 
 	while (!game->status.done)
 		{
+			double idle = perf_now ();
 			event_queue_wait_for_event (game->queue, &event);
 
+			double now = perf_now ();
+			perf_add (game->perf, PERF_IDLE, now - idle);
+			metrics_set_queue_depth (event_queue_depth (game->queue));
+
+			if (game->record != NULL && event.type != EVENT_DUMP)
+				input_log_write (game->record, &event, game->cell.gen);
+
+			conga_check_replay (game);
+
 			switch (event.type)
 				{
 				case EVENT_NONE:
@@ -292,7 +826,10 @@ conga_run (Conga *game)
 					}
 				case EVENT_TIMER:
 					{
-						conga_update_logic (game);
+						if (game->pipeline.on)
+							conga_update_pipeline (game);
+						else
+							conga_update_logic (game);
 						game->status.redraw = 1;
 						break;
 					}
@@ -302,6 +839,11 @@ conga_run (Conga *game)
 						game->status.resize = 1;
 						break;
 					}
+				case EVENT_DUMP:
+					{
+						conga_dump_metrics (game);
+						break;
+					}
 				}
 
 			if (game->status.redraw)
@@ -310,7 +852,12 @@ conga_run (Conga *game)
 					game->status.redraw = 0;
 					game->status.resize = 0;
 				}
+
+			conga_update_metrics (game, now);
 		}
+
+	if (game->metrics_file != NULL)
+		metrics_write_file (game->metrics_file);
 }
 
 void
@@ -319,12 +866,65 @@ conga_free (Conga *game)
 	if  (game == NULL)
 		return;
 
+	if (game->pipeline.on)
+		{
+			conga_pipeline_wait (game);
+
+			pthread_mutex_lock (&game->pipeline.lock);
+			game->pipeline.state = PIPELINE_QUIT;
+			pthread_cond_broadcast (&game->pipeline.cond);
+			pthread_mutex_unlock (&game->pipeline.lock);
+
+			pthread_join (game->pipeline.thread, NULL);
+			pthread_mutex_destroy (&game->pipeline.lock);
+			pthread_cond_destroy (&game->pipeline.cond);
+		}
+
 	event_queue_free (game->queue);
 	render_free      (game->render);
 	grid_free        (game->grid_cur);
 	grid_free        (game->grid_next);
+	engine_free      (game->engine);
 	rule_free        (game->rule);
 	rand_free        (game->rng);
+	perf_free        (game->perf);
+
+	input_log_free    (game->record);
+	input_log_free    (game->replay);
+	delta_writer_free (game->delta);
+	frames_free       (game->frames);
+	shm_grid_free     (game->shm);
+	stream_server_free (game->stream);
+	history_free      (game->history);
 
+	if (game->engine_log != NULL)
+		xfclose (game->engine_log);
+
+	xfree (game->metrics_dump_file);
 	xfree (game);
 }
+
+void
+conga_report (const Conga *game, FILE *fp)
+{
+	assert (game != NULL);
+	assert (fp != NULL);
+
+	fprintf (fp, "events=%ld generations=%d\n",
+			game->replay != NULL ? input_log_count (game->replay) : 0L,
+			game->cell.gen);
+
+	if (game->ansi != NULL)
+		fprintf (fp, "bytes_per_frame=%.1f\n",
+				render_ansi_mean_bytes (game->ansi));
+
+	if (game->perf == NULL)
+		return;
+
+	fprintf (fp, "%-8s  %10s  %10s\n", "phase", "mean_ms", "p99_ms");
+
+	for (int p = 0; p < PERF_PHASES; p++)
+		fprintf (fp, "%-8s  %10.4f  %10.4f\n", perf_phase_names[p],
+				perf_mean (game->perf, p) * 1e3,
+				perf_p99 (game->perf, p) * 1e3);
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stdio.h>
 #include "config.h"
 
 typedef struct _Conga Conga;
@@ -8,4 +9,5 @@ void    conga_startup  (void);
 void    conga_shutdown (void);
 Conga * conga_new      (const Config *c);
 void    conga_run      (Conga *g);
+void    conga_report   (const Conga *g, FILE *fp);
 void    conga_free     (Conga *g);
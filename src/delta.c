@@ -0,0 +1,316 @@
+#include "delta.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include "wrapper.h"
+#include "error.h"
+
+#define VARINT_MAX  10
+#define HEADER_MAX  (2 * VARINT_MAX)
+#define BUF_MIN     256
+
+struct _DeltaWriter
+{
+	FILE   *fp;
+	int     rows;
+	int     cols;
+	int     gen;
+	Delta   delta;
+};
+
+typedef struct
+{
+	uint8_t *data;
+	size_t   len;
+	size_t   size;
+} DeltaBuf;
+
+static inline void
+delta_buf_reserve (DeltaBuf *buf, size_t len)
+{
+	if (buf->len + len <= buf->size)
+		return;
+
+	size_t size = buf->size < BUF_MIN ? BUF_MIN : buf->size;
+	while (size < buf->len + len)
+		size *= 2;
+
+	uint8_t *data = xmalloc (size);
+	if (buf->data != NULL && buf->len)
+		memcpy (data, buf->data, buf->len);
+
+	xfree (buf->data);
+
+	buf->data = data;
+	buf->size = size;
+}
+
+static inline void
+delta_buf_put_varint (DeltaBuf *buf, uint64_t val)
+{
+	delta_buf_reserve (buf, VARINT_MAX);
+	buf->len += delta_put_varint (buf->data + buf->len, val);
+}
+
+size_t
+delta_put_varint (uint8_t *buf, uint64_t val)
+{
+	size_t i = 0;
+
+	while (val >= 0x80)
+		{
+			buf[i++] = (uint8_t) (val | 0x80);
+			val >>= 7;
+		}
+
+	buf[i++] = (uint8_t) val;
+
+	return i;
+}
+
+size_t
+delta_get_varint (const uint8_t *buf, size_t len, uint64_t *val)
+{
+	uint64_t x = 0;
+
+	for (size_t i = 0; i < len && i < VARINT_MAX; i++)
+		{
+			x |= (uint64_t) (buf[i] & 0x7f) << (7 * i);
+
+			if (!(buf[i] & 0x80))
+				{
+					*val = x;
+					return i + 1;
+				}
+		}
+
+	// Truncated or overlong
+	return 0;
+}
+
+void
+delta_init (Delta *delta)
+{
+	assert (delta != NULL);
+	*delta = (Delta) {0};
+}
+
+void
+delta_destroy (Delta *delta)
+{
+	if (delta == NULL)
+		return;
+
+	xfree (delta->data);
+	*delta = (Delta) {0};
+}
+
+// Cells from..to of row, in order; only those that flipped count
+static inline void
+delta_encode_run (Delta *delta, DeltaBuf *births, DeltaBuf *deaths,
+		long *last_birth, long *last_death, const Grid *grid_next,
+		const Grid *grid_cur, int row, int from, int to)
+{
+	for (long i = (long) row * grid_cur->cols + from,
+			end = (long) row * grid_cur->cols + to; i < end; i++)
+		{
+			if (!(grid_next->data[i] ^ grid_cur->data[i]))
+				continue;
+
+			if (grid_next->data[i])
+				{
+					delta_buf_put_varint (births, i - *last_birth - 1);
+					*last_birth = i;
+					delta->births++;
+				}
+			else
+				{
+					delta_buf_put_varint (deaths, i - *last_death - 1);
+					*last_death = i;
+					delta->deaths++;
+				}
+		}
+}
+
+void
+delta_encode (Delta *delta, const Grid *grid_next, const Grid *grid_cur,
+		const GridChanges *changes)
+{
+	assert (delta != NULL);
+	assert (grid_next != NULL && grid_cur != NULL);
+	assert (grid_next->rows == grid_cur->rows
+			&& grid_next->cols == grid_cur->cols);
+	assert (changes == NULL
+			|| ((long) changes->rows * changes->tile_rows >= grid_cur->rows
+				&& (long) changes->cols * changes->tile_cols >= grid_cur->cols));
+
+	// Births are written after room for the header,
+	// deaths go to a scratch buffer and are appended
+	DeltaBuf births = {delta->data, HEADER_MAX, delta->size};
+	DeltaBuf deaths = {0};
+
+	long last_birth = -1, last_death = -1;
+
+	delta_buf_reserve (&births, 0);
+
+	delta->births = 0;
+	delta->deaths = 0;
+
+	// Row by row, so the indices still come in order
+	for (int i = 0; i < grid_cur->rows; i++)
+		{
+			if (changes == NULL)
+				{
+					delta_encode_run (delta, &births, &deaths, &last_birth, &last_death,
+							grid_next, grid_cur, i, 0, grid_cur->cols);
+					continue;
+				}
+
+			const uint8_t *map = changes->map
+				+ (long) (i / changes->tile_rows) * changes->cols;
+
+			for (int tc = 0; tc < changes->cols; tc++)
+				{
+					int from = tc * changes->tile_cols;
+					int to = from + changes->tile_cols < grid_cur->cols
+						? from + changes->tile_cols
+						: grid_cur->cols;
+
+					if (map[tc] && from < to)
+						delta_encode_run (delta, &births, &deaths, &last_birth,
+								&last_death, grid_next, grid_cur, i, from, to);
+				}
+		}
+
+	uint8_t header[HEADER_MAX];
+	size_t header_len = 0;
+
+	header_len += delta_put_varint (header, delta->births);
+	header_len += delta_put_varint (header + header_len, delta->deaths);
+
+	delta_buf_reserve (&births, deaths.len);
+
+	memmove (births.data + header_len, births.data + HEADER_MAX,
+			births.len - HEADER_MAX);
+	memcpy (births.data, header, header_len);
+	births.len -= HEADER_MAX - header_len;
+
+	if (deaths.len)
+		memcpy (births.data + births.len, deaths.data, deaths.len);
+	births.len += deaths.len;
+
+	xfree (deaths.data);
+
+	delta->data = births.data;
+	delta->len  = births.len;
+	delta->size = births.size;
+}
+
+void
+delta_apply (Grid *grid, const uint8_t *data, size_t len)
+{
+	assert (grid != NULL);
+	assert (data != NULL || len == 0);
+
+	uint64_t births = 0, deaths = 0, gap = 0;
+	long total = (long) grid->rows * grid->cols;
+	size_t off = 0, n = 0;
+
+	if ((n = delta_get_varint (data, len, &births)) == 0)
+		error (1, 0, "Truncated delta header");
+	off += n;
+
+	if ((n = delta_get_varint (data + off, len - off, &deaths)) == 0)
+		error (1, 0, "Truncated delta header");
+	off += n;
+
+	// A delta is its own inverse: every listed cell is toggled,
+	// so applying it to generation N+1 yields generation N back
+	for (int pass = 0; pass < 2; pass++)
+		{
+			uint64_t count = pass == 0 ? births : deaths;
+			long idx = -1;
+
+			for (uint64_t k = 0; k < count; k++)
+				{
+					if ((n = delta_get_varint (data + off, len - off, &gap)) == 0)
+						error (1, 0, "Truncated delta body");
+					off += n;
+
+					idx += gap + 1;
+					if (idx >= total)
+						error (1, 0, "Delta index '%ld' out of range", idx);
+
+					grid->data[idx] ^= 1;
+				}
+		}
+}
+
+DeltaWriter *
+delta_writer_new (const char *path, int rows, int cols)
+{
+	assert (path != NULL);
+	assert (rows > 0 && cols > 0);
+
+	DeltaWriter *writer = xcalloc (1, sizeof (DeltaWriter));
+
+	*writer = (DeltaWriter) {
+		.fp   = xfopen (path, "wb"),
+		.rows = rows,
+		.cols = cols,
+		.gen  = 0
+	};
+
+	delta_init (&writer->delta);
+
+	uint8_t header[HEADER_MAX];
+	size_t len = 0;
+
+	len += delta_put_varint (header, rows);
+	len += delta_put_varint (header + len, cols);
+
+	fwrite (DELTA_MAGIC, 1, strlen (DELTA_MAGIC), writer->fp);
+	fputc (DELTA_VERSION, writer->fp);
+	fwrite (header, 1, len, writer->fp);
+
+	return writer;
+}
+
+void
+delta_writer_write (DeltaWriter *writer, const Grid *grid_next,
+		const Grid *grid_cur, const GridChanges *changes, int gen)
+{
+	assert (writer != NULL);
+	assert (grid_cur->rows == writer->rows
+			&& grid_cur->cols == writer->cols);
+	uint8_t header[VARINT_MAX];
+	size_t len = 0;
+
+	// Generations replayed after a rewind were already written
+	if (gen <= writer->gen)
+		return;
+
+	delta_encode (&writer->delta, grid_next, grid_cur, changes);
+
+	// Generations are stored as a gap to the last record
+	len = delta_put_varint (header, gen - writer->gen);
+	writer->gen = gen;
+
+	if (fwrite (header, 1, len, writer->fp) != len
+			|| fwrite (writer->delta.data, 1, writer->delta.len, writer->fp)
+				!= writer->delta.len)
+		error (1, 1, "Could not write delta stream");
+}
+
+void
+delta_writer_free (DeltaWriter *writer)
+{
+	if (writer == NULL)
+		return;
+
+	xfclose (writer->fp);
+	delta_destroy (&writer->delta);
+
+	xfree (writer);
+}
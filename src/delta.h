@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "grid.h"
+
+/*
+ * Births/deaths between two generations, encoded as:
+ *   varint births, varint deaths,
+ *   births gaps..., deaths gaps...
+ * Each gap is the distance to the previous linear
+ * index (row * cols + col) minus one, so a dense
+ * run of changes costs one byte per cell.
+ *
+ * Only the tiles that changes flags are looked at, when given;
+ * NULL compares every cell.
+ */
+
+#define DELTA_MAGIC   "CGDL"
+#define DELTA_VERSION 1
+
+typedef struct _DeltaWriter DeltaWriter;
+
+typedef struct
+{
+	uint8_t *data;
+	size_t   len;
+	size_t   size;
+	int      births;
+	int      deaths;
+} Delta;
+
+void          delta_init         (Delta *delta);
+void          delta_destroy      (Delta *delta);
+void          delta_encode       (Delta *delta, const Grid *grid_next, const Grid *grid_cur,
+                                  const GridChanges *changes);
+void          delta_apply        (Grid *grid, const uint8_t *data, size_t len);
+
+size_t        delta_put_varint   (uint8_t *buf, uint64_t val);
+size_t        delta_get_varint   (const uint8_t *buf, size_t len, uint64_t *val);
+
+DeltaWriter * delta_writer_new   (const char *path, int rows, int cols);
+void          delta_writer_write (DeltaWriter *writer, const Grid *grid_next,
+                                  const Grid *grid_cur, const GridChanges *changes,
+                                  int gen);
+void          delta_writer_free  (DeltaWriter *writer);
@@ -0,0 +1,405 @@
+#include "diskgrid.h"
+
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <assert.h>
+#include "wrapper.h"
+#include "error.h"
+#include "rule.h"
+#include "pattern.h"
+
+#define WORD_BITS 64
+
+struct _DiskGrid
+{
+	char    *path[2];
+	int      fd[2];
+	uint8_t *map[2];
+	size_t   size;
+	size_t   page;
+
+	// Index of the file holding the current generation
+	int      cur;
+
+	// The cells of each file, as mapped
+	BitGrid  cells[2];
+	BitRule  rule;
+	int      band;
+
+	long     gen_start;
+	long     gen_limit;
+
+	double   elapsed;
+	long     faults;
+};
+
+static inline DiskGridHeader *
+diskgrid_header (const DiskGrid *disk, int index)
+{
+	return (DiskGridHeader *) disk->map[index];
+}
+
+static void
+diskgrid_map (DiskGrid *disk, int index, int create)
+{
+	const char *path = disk->path[index];
+	int fd = open (path, O_RDWR | (create ? O_CREAT | O_TRUNC : 0), 0644);
+
+	if (fd < 0)
+		error (1, 1, "Could not open '%s'", path);
+
+	// Sparse, the cells are written as they are stepped
+	if (create && ftruncate (fd, disk->size) < 0)
+		error (1, 1, "Could not resize '%s'", path);
+
+	uint8_t *map = mmap (NULL, disk->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+	if (map == MAP_FAILED)
+		error (1, 1, "Could not map '%s'", path);
+
+	madvise (map, disk->size, MADV_SEQUENTIAL);
+
+	disk->fd[index] = fd;
+	disk->map[index] = map;
+}
+
+// Reads the header of an existing FILE, returns 0 if there is none
+static int
+diskgrid_probe (DiskGrid *disk, DiskGridHeader *header)
+{
+	struct stat st;
+	int fd = open (disk->path[0], O_RDONLY);
+
+	if (fd < 0)
+		return 0;
+
+	if (read (fd, header, sizeof (DiskGridHeader)) != sizeof (DiskGridHeader)
+			|| memcmp (header->magic, DISKGRID_MAGIC, sizeof (header->magic)) != 0
+			|| header->version != DISKGRID_VERSION
+			|| header->word_size != sizeof (uint64_t)
+			|| header->rows <= 0 || header->rows > INT32_MAX
+			|| header->cols <= 0 || header->cols > INT32_MAX
+			|| fstat (fd, &st) < 0
+			|| (uint64_t) st.st_size < header->data_offset
+				+ (uint64_t) header->rows * header->words * sizeof (uint64_t))
+		error (1, 0, "'%s' is not a conga disk grid", disk->path[0]);
+
+	close (fd);
+
+	return 1;
+}
+
+// The same bits whatever the band size or the number of runs
+static inline uint64_t
+diskgrid_random (uint64_t *state)
+{
+	uint64_t x = (*state += 0x9e3779b97f4a7c15ULL);
+
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+
+	return x ^ (x >> 31);
+}
+
+static long
+diskgrid_seed_random (DiskGrid *disk, long seed, float live_percent)
+{
+	BitGrid *cells = &disk->cells[disk->cur];
+	uint64_t threshold = live_percent * 0x1p53;
+	long alive = 0;
+
+	for (int i = 0; i < cells->rows; i++)
+		{
+			uint64_t state = (uint64_t) seed * 0x100000001b3ULL + i;
+			uint64_t *row = BITGRID_ROW (cells, i);
+
+			for (int j = 0; j < cells->cols; j++)
+				if ((diskgrid_random (&state) >> 11) < threshold)
+					{
+						row[j / WORD_BITS] |= (uint64_t) 1 << (j % WORD_BITS);
+						alive++;
+					}
+		}
+
+	return alive;
+}
+
+static long
+diskgrid_seed_pattern (DiskGrid *disk, const Pattern *pattern)
+{
+	BitGrid *cells = &disk->cells[disk->cur];
+	int offset_row = (cells->rows - pattern->grid->rows) / 2;
+	int offset_col = (cells->cols - pattern->grid->cols) / 2;
+	long alive = 0;
+
+	for (int i = 0; i < pattern->grid->rows; i++)
+		for (int j = 0; j < pattern->grid->cols; j++)
+			if (GRID_GET (pattern->grid, i, j))
+				{
+					BITGRID_SET (cells, offset_row + i, offset_col + j, 1);
+					alive++;
+				}
+
+	return alive;
+}
+
+static void
+diskgrid_set_cells (DiskGrid *disk, int index, const DiskGridHeader *header)
+{
+	disk->cells[index] = (BitGrid) {
+		.rows  = header->rows,
+		.cols  = header->cols,
+		.words = header->words,
+		.data  = (uint64_t *) (disk->map[index] + header->data_offset)
+	};
+}
+
+DiskGrid *
+diskgrid_new (const Config *cfg)
+{
+	assert (cfg != NULL);
+	assert (cfg->disk_grid != NULL);
+	assert (cfg->generations > 0);
+
+	DiskGrid *disk = xcalloc (1, sizeof (DiskGrid));
+	DiskGridHeader header;
+	Pattern *pattern = NULL;
+	const char *rule = cfg->rule;
+
+	*disk = (DiskGrid) {
+		.path      = {xstrdup (cfg->disk_grid)},
+		.fd        = {-1, -1},
+		.page      = sysconf (_SC_PAGESIZE),
+		.gen_limit = cfg->generations
+	};
+
+	xasprintf (&disk->path[1], "%s%s", cfg->disk_grid, DISKGRID_NEXT);
+
+	if (cfg->pattern != NULL || cfg->pattern_file != NULL)
+		{
+			pattern = pattern_new (cfg->pattern_file != NULL
+					? cfg->pattern_file
+					: cfg->pattern);
+
+			if (pattern->header.rule != NULL)
+				rule = pattern->header.rule;
+		}
+
+	int exists = diskgrid_probe (disk, &header);
+
+	if (!exists)
+		{
+			int rows = cfg->rows, cols = cfg->cols;
+
+			if (pattern != NULL)
+				{
+					rows = pattern->grid->rows < rows ? rows : pattern->grid->rows;
+					cols = pattern->grid->cols < cols ? cols : pattern->grid->cols;
+				}
+
+			header = (DiskGridHeader) {
+				.magic       = DISKGRID_MAGIC,
+				.version     = DISKGRID_VERSION,
+				.word_size   = sizeof (uint64_t),
+				.rows        = rows,
+				.cols        = cols,
+				.words       = (cols + WORD_BITS - 1) / WORD_BITS,
+				.data_offset = disk->page
+			};
+		}
+
+	disk->size = header.data_offset
+		+ (size_t) header.rows * header.words * sizeof (uint64_t);
+
+	diskgrid_map (disk, 0, !exists);
+	diskgrid_map (disk, 1, 1);
+
+	diskgrid_set_cells (disk, 0, &header);
+	diskgrid_set_cells (disk, 1, &header);
+
+	if (!exists)
+		{
+			header.population = pattern != NULL
+				? diskgrid_seed_pattern (disk, pattern)
+				: diskgrid_seed_random (disk, cfg->seed, cfg->live_percent);
+
+			*diskgrid_header (disk, 0) = header;
+		}
+
+	*diskgrid_header (disk, 1) = *diskgrid_header (disk, 0);
+	disk->gen_start = header.gen;
+
+	// Bands of a few MiB, enough to keep the disk busy
+	long row_bytes = header.words * sizeof (uint64_t);
+	long band = cfg->band_rows > 0 ? cfg->band_rows : DISKGRID_BAND_BYTES / row_bytes;
+
+	disk->band = band < 1 ? 1 : band > header.rows ? header.rows : band;
+
+	Rule *r = rule_new (rule);
+	bitlife_rule_init (&disk->rule, r);
+	rule_free (r);
+
+	pattern_free (pattern);
+
+	return disk;
+}
+
+void
+diskgrid_free (DiskGrid *disk)
+{
+	if (disk == NULL)
+		return;
+
+	for (int i = 0; i < 2; i++)
+		{
+			munmap (disk->map[i], disk->size);
+			close (disk->fd[i]);
+		}
+
+	// FILE keeps the last generation, the other one goes
+	if (disk->cur == 1)
+		rename (disk->path[1], disk->path[0]);
+	else
+		unlink (disk->path[1]);
+
+	xfree (disk->path[0]);
+	xfree (disk->path[1]);
+	xfree (disk);
+}
+
+// Applies advice to the whole pages within rows [from, to)
+static void
+diskgrid_advise (const DiskGrid *disk, int index, int from, int to, int advice)
+{
+	const BitGrid *cells = &disk->cells[index];
+
+	uintptr_t start = (uintptr_t) BITGRID_ROW (cells, from);
+	uintptr_t end   = (uintptr_t) BITGRID_ROW (cells, to);
+
+	if (advice == MADV_WILLNEED)
+		start &= ~(disk->page - 1);
+	else
+		start = (start + disk->page - 1) & ~(disk->page - 1);
+
+	end &= ~(disk->page - 1);
+
+	if (end > start)
+		madvise ((void *) start, end - start, advice);
+}
+
+void
+diskgrid_step (DiskGrid *disk)
+{
+	assert (disk != NULL);
+
+	int next = !disk->cur;
+	const BitGrid *cells_cur = &disk->cells[disk->cur];
+	BitGrid *cells_next = &disk->cells[next];
+	int rows = cells_cur->rows;
+	long population = 0;
+
+	for (int from = 0; from < rows; from += disk->band)
+		{
+			int to = from + disk->band < rows ? from + disk->band : rows;
+
+			// The next band is read while this one is stepped
+			if (to < rows)
+				diskgrid_advise (disk, disk->cur, to,
+						to + disk->band < rows ? to + disk->band : rows, MADV_WILLNEED);
+
+			bitgrid_step_rows (cells_next, cells_cur, &disk->rule, from, to);
+
+			for (long w = (long) from * cells_next->words; w < (long) to * cells_next->words; w++)
+				population += __builtin_popcountll (cells_next->data[w]);
+
+			// Rows above to - 1 are done with, but row 0 is needed
+			// again by the last row. Written pages stay in the page
+			// cache until written back, they just leave this process
+			diskgrid_advise (disk, disk->cur, from > 0 ? from - 1 : 1, to - 1, MADV_DONTNEED);
+			diskgrid_advise (disk, next, from, to, MADV_DONTNEED);
+		}
+
+	DiskGridHeader *header = diskgrid_header (disk, next);
+
+	*header = *diskgrid_header (disk, disk->cur);
+	header->gen++;
+	header->population = population;
+
+	disk->cur = next;
+}
+
+static long
+diskgrid_major_faults (void)
+{
+	struct rusage usage;
+	getrusage (RUSAGE_SELF, &usage);
+	return usage.ru_majflt;
+}
+
+void
+diskgrid_run (DiskGrid *disk)
+{
+	assert (disk != NULL);
+
+	struct timespec start, end;
+	long faults = diskgrid_major_faults ();
+
+	clock_gettime (CLOCK_MONOTONIC, &start);
+
+	while (diskgrid_gen (disk) < disk->gen_start + disk->gen_limit)
+		diskgrid_step (disk);
+
+	clock_gettime (CLOCK_MONOTONIC, &end);
+
+	disk->faults = diskgrid_major_faults () - faults;
+	disk->elapsed = (end.tv_sec - start.tv_sec)
+		+ (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+const BitGrid *
+diskgrid_cells (const DiskGrid *disk)
+{
+	assert (disk != NULL);
+	return &disk->cells[disk->cur];
+}
+
+long
+diskgrid_gen (const DiskGrid *disk)
+{
+	assert (disk != NULL);
+	return diskgrid_header (disk, disk->cur)->gen;
+}
+
+long
+diskgrid_population (const DiskGrid *disk)
+{
+	assert (disk != NULL);
+	return diskgrid_header (disk, disk->cur)->population;
+}
+
+void
+diskgrid_report (const DiskGrid *disk, FILE *fp)
+{
+	assert (disk != NULL);
+	assert (fp != NULL);
+
+	const BitGrid *cells = diskgrid_cells (disk);
+	long gens = diskgrid_gen (disk) - disk->gen_start;
+	double bytes = 2.0 * cells->rows * cells->words * sizeof (uint64_t) * gens;
+
+	fprintf (fp, "# file=%s rows=%d cols=%d band=%d rows\n",
+			disk->path[0], cells->rows, cells->cols, disk->band);
+	fprintf (fp, "# generation=%ld population=%ld\n",
+			diskgrid_gen (disk), diskgrid_population (disk));
+
+	if (disk->elapsed > 0)
+		fprintf (fp, "# elapsed=%.3fs cells/s=%.3e io=%.1fMiB/s major_faults=%ld\n",
+				disk->elapsed,
+				(double) cells->rows * cells->cols * gens / disk->elapsed,
+				bytes / disk->elapsed / (1 << 20), disk->faults);
+}
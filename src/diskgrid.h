@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include "config.h"
+#include "bitgrid.h"
+
+/*
+ * A grid too large for memory kept in a file, bit-packed as a
+ * BitGrid after a DiskGridHeader at data_offset. The file and a
+ * second one, FILE.next, are mapped; each generation is stepped
+ * from one into the other band by band, reading ahead the next
+ * band and dropping the rows already used, so the pages stream
+ * through memory in order. At the end FILE holds the last
+ * generation, and a run on an existing FILE continues it.
+ */
+
+#define DISKGRID_MAGIC      "CONGABIT"
+#define DISKGRID_VERSION    1
+#define DISKGRID_NEXT       ".next"
+#define DISKGRID_BAND_BYTES (8 << 20)
+
+typedef struct
+{
+	char     magic[8];
+	uint32_t version;
+	uint32_t word_size;
+	int64_t  rows;
+	int64_t  cols;
+	int64_t  words;
+	int64_t  gen;
+	int64_t  population;
+	uint64_t data_offset;
+} DiskGridHeader;
+
+typedef struct _DiskGrid DiskGrid;
+
+DiskGrid *      diskgrid_new        (const Config *cfg);
+void            diskgrid_step       (DiskGrid *disk);
+void            diskgrid_run        (DiskGrid *disk);
+const BitGrid * diskgrid_cells      (const DiskGrid *disk);
+long            diskgrid_gen        (const DiskGrid *disk);
+long            diskgrid_population (const DiskGrid *disk);
+void            diskgrid_report     (const DiskGrid *disk, FILE *fp);
+void            diskgrid_free       (DiskGrid *disk);
@@ -0,0 +1,563 @@
+#include "domain.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <assert.h>
+#include "wrapper.h"
+#include "error.h"
+#include "cell.h"
+#include "rule.h"
+#include "rand.h"
+#include "pattern.h"
+#include "engine.h"
+#include "perf.h"
+#include "domain_shm.h"
+#include "domain_sock.h"
+
+typedef struct
+{
+	int      valid;
+	int      rank;
+	int      row, col;
+	int      rows, cols;
+	long     population;
+	uint64_t checksum;
+	long     exchanges;
+	double   step_time;
+	double   halo_time;
+} DomainStats;
+
+struct _Domain
+{
+	DomainLayout           layout;
+	const DomainTransport *transport;
+	void                  *link;
+
+	// This process' rank, or -1 to fork all of them
+	int                    rank;
+	int                    gen_limit;
+
+	const char            *engine;
+	char                  *rule;
+
+	// Generation 0 of the whole torus, each rank takes its part
+	Grid                  *init;
+
+	// Every rank's numbers, mapped shared with the forked ranks
+	DomainStats           *stats;
+	double                 elapsed;
+};
+
+// Transports, the first one is the default
+static const DomainTransport *domain_transports[] =
+{
+	&domain_shm_transport,
+	&domain_unix_transport,
+	&domain_tcp_transport,
+	NULL
+};
+
+const DomainTransport *
+domain_transport_get (const char *name)
+{
+	assert (name != NULL);
+
+	for (int i = 0; domain_transports[i] != NULL; i++)
+		if (strcmp (domain_transports[i]->name, name) == 0)
+			return domain_transports[i];
+
+	return NULL;
+}
+
+int
+domain_transport_is_valid (const char *name)
+{
+	return name != NULL && domain_transport_get (name) != NULL;
+}
+
+void
+domain_layout_init (DomainLayout *layout, int ranks, int rows, int cols, int halo)
+{
+	assert (layout != NULL);
+	assert (ranks > 0 && ranks <= DOMAIN_RANKS_MAX);
+	assert (rows > 0 && cols > 0);
+	assert (halo > 0);
+
+	int px = 1;
+
+	// The split with the shortest cuts, so the least halo to send
+	for (int p = 1; p <= ranks; p++)
+		if (ranks % p == 0
+				&& (long) p * rows + (long) (ranks / p) * cols
+				< (long) px * rows + (long) (ranks / px) * cols)
+			px = p;
+
+	int py = ranks / px;
+
+	int max_rows = (rows + py - 1) / py;
+	int max_cols = (cols + px - 1) / px;
+
+	size_t msg_max = (size_t) max_rows * halo * sizeof (int);
+	size_t row_msg = (size_t) (max_cols + 2 * halo) * halo * sizeof (int);
+	size_t stats_msg = (size_t) ranks * sizeof (DomainStats);
+
+	msg_max = msg_max > row_msg ? msg_max : row_msg;
+	msg_max = msg_max > stats_msg ? msg_max : stats_msg;
+
+	*layout = (DomainLayout) {
+		.ranks   = ranks,
+		.px      = px,
+		.py      = py,
+		.rows    = rows,
+		.cols    = cols,
+		.halo    = halo,
+		.msg_max = msg_max
+	};
+}
+
+int
+domain_neighbor (const DomainLayout *layout, int rank, int axis, int side)
+{
+	assert (layout != NULL);
+	assert (rank >= 0 && rank < layout->ranks);
+
+	int rx = rank % layout->px;
+	int ry = rank / layout->px;
+	int step = side ? 1 : -1;
+
+	if (axis == 0)
+		rx = (rx + step + layout->px) % layout->px;
+	else
+		ry = (ry + step + layout->py) % layout->py;
+
+	return ry * layout->px + rx;
+}
+
+void
+domain_bounds (const DomainLayout *layout, int rank,
+		int *row, int *col, int *rows, int *cols)
+{
+	assert (layout != NULL);
+	assert (rank >= 0 && rank < layout->ranks);
+
+	int rx = rank % layout->px;
+	int ry = rank / layout->px;
+
+	int row_end = (long) layout->rows * (ry + 1) / layout->py;
+	int col_end = (long) layout->cols * (rx + 1) / layout->px;
+
+	*row  = (long) layout->rows * ry / layout->py;
+	*col  = (long) layout->cols * rx / layout->px;
+	*rows = row_end - *row;
+	*cols = col_end - *col;
+}
+
+// Seeds the whole torus as a plain run with the same options would
+static void
+domain_seed (Domain *domain, const Config *cfg)
+{
+	if (cfg->pattern == NULL && cfg->pattern_file == NULL)
+		{
+			Rand *rng = rand_new (cfg->seed);
+
+			domain->init = grid_new (cfg->rows, cfg->cols);
+			domain->rule = xstrdup (cfg->rule);
+
+			cell_seed_random_generation (domain->init, rng, cfg->live_percent, NULL);
+
+			rand_free (rng);
+			return;
+		}
+
+	Pattern *pattern = pattern_new (cfg->pattern_file != NULL
+			? cfg->pattern_file
+			: cfg->pattern);
+
+	int rows = pattern->grid->rows < cfg->rows
+		? cfg->rows
+		: pattern->grid->rows;
+
+	int cols = pattern->grid->cols < cfg->cols
+		? cfg->cols
+		: pattern->grid->cols;
+
+	domain->init = grid_new (rows, cols);
+	domain->rule = xstrdup (pattern->header.rule != NULL
+			? pattern->header.rule
+			: cfg->rule);
+
+	cell_seed_from_grid (domain->init, pattern->grid, NULL);
+
+	pattern_free (pattern);
+}
+
+Domain *
+domain_new (const Config *cfg)
+{
+	assert (cfg != NULL);
+	assert (cfg->ranks > 0 && cfg->ranks <= DOMAIN_RANKS_MAX);
+	assert (cfg->generations > 0);
+
+	Domain *domain = xcalloc (1, sizeof (Domain));
+
+	*domain = (Domain) {
+		.transport = domain_transport_get (cfg->transport),
+		.rank      = cfg->rank,
+		.gen_limit = cfg->generations,
+		.engine    = cfg->engine
+	};
+
+	assert (domain->transport != NULL);
+
+	domain_seed (domain, cfg);
+
+	domain_layout_init (&domain->layout, cfg->ranks,
+			domain->init->rows, domain->init->cols, cfg->halo);
+
+	// A halo comes from the next sub-domain only
+	int rows = domain->layout.rows;
+	int cols = domain->layout.cols;
+
+	for (int r = 0; r < cfg->ranks; r++)
+		{
+			int r_row, r_col, r_rows, r_cols;
+			domain_bounds (&domain->layout, r, &r_row, &r_col, &r_rows, &r_cols);
+
+			rows = r_rows < rows ? r_rows : rows;
+			cols = r_cols < cols ? r_cols : cols;
+		}
+
+	if (cfg->halo > rows || cfg->halo > cols)
+		error (1, 0, "--halo %d is wider than the smallest %dx%d sub-domain",
+				cfg->halo, rows, cols);
+
+	domain->stats = mmap (NULL, cfg->ranks * sizeof (DomainStats),
+			PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+	if (domain->stats == MAP_FAILED)
+		error (1, 1, "Could not map the rank statistics");
+
+	domain->link = domain->transport->new (&domain->layout, cfg->peers, cfg->rank);
+
+	return domain;
+}
+
+void
+domain_free (Domain *domain)
+{
+	if (domain == NULL)
+		return;
+
+	domain->transport->free (domain->link);
+	munmap (domain->stats, domain->layout.ranks * sizeof (DomainStats));
+
+	grid_free (domain->init);
+	xfree (domain->rule);
+	xfree (domain);
+}
+
+// Order independent, so the parts of the torus can be summed up
+static inline uint64_t
+domain_cell_hash (uint64_t index)
+{
+	uint64_t x = index + 0x9e3779b97f4a7c15ULL;
+
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+
+	return x ^ (x >> 31);
+}
+
+uint64_t
+domain_grid_checksum (const Grid *grid)
+{
+	assert (grid != NULL);
+
+	uint64_t sum = 0;
+
+	for (long i = 0; i < (long) grid->rows * grid->cols; i++)
+		if (grid->data[i])
+			sum += domain_cell_hash (i);
+
+	return sum;
+}
+
+static void
+domain_exchange (Domain *domain, Grid *grid, int *strip[2], int *halo[2])
+{
+	int k    = domain->layout.halo;
+	int rows = grid->rows - 2 * k;
+	int cols = grid->cols - 2 * k;
+
+	// Columns: the k outer columns of the inner rows
+	for (int i = 0; i < rows; i++)
+		{
+			memcpy (strip[0] + i * k, &GRID_GET (grid, k + i, k), k * sizeof (int));
+			memcpy (strip[1] + i * k, &GRID_GET (grid, k + i, cols), k * sizeof (int));
+		}
+
+	domain->transport->exchange (domain->link, 0,
+			(void *const []) {strip[0], strip[1]},
+			(void *const []) {halo[0], halo[1]},
+			(size_t) rows * k * sizeof (int));
+
+	for (int i = 0; i < rows; i++)
+		{
+			memcpy (&GRID_GET (grid, k + i, 0), halo[0] + i * k, k * sizeof (int));
+			memcpy (&GRID_GET (grid, k + i, k + cols), halo[1] + i * k, k * sizeof (int));
+		}
+
+	// Rows: whole padded rows, with the corners just received
+	domain->transport->exchange (domain->link, 1,
+			(void *const []) {&GRID_GET (grid, k, 0), &GRID_GET (grid, rows, 0)},
+			(void *const []) {&GRID_GET (grid, 0, 0), &GRID_GET (grid, rows + k, 0)},
+			(size_t) k * grid->cols * sizeof (int));
+}
+
+// Passes the table around each ring, so every rank gets all of it
+static void
+domain_allgather (Domain *domain, DomainStats *stats)
+{
+	const DomainLayout *layout = &domain->layout;
+	size_t size = layout->ranks * sizeof (DomainStats);
+
+	DomainStats *in[2] = {
+		xcalloc (layout->ranks, sizeof (DomainStats)),
+		xcalloc (layout->ranks, sizeof (DomainStats))
+	};
+
+	for (int axis = 0; axis < 2; axis++)
+		{
+			int ring = axis == 0 ? layout->px : layout->py;
+
+			for (int step = 1; step < ring; step++)
+				{
+					domain->transport->exchange (domain->link, axis,
+							(void *const []) {stats, stats},
+							(void *const []) {in[0], in[1]}, size);
+
+					for (int r = 0; r < layout->ranks; r++)
+						if (in[0][r].valid)
+							stats[r] = in[0][r];
+				}
+		}
+
+	xfree (in[0]);
+	xfree (in[1]);
+}
+
+static void
+domain_run_rank (Domain *domain, int rank)
+{
+	const DomainLayout *layout = &domain->layout;
+	int k = layout->halo;
+
+	DomainStats *stats = xcalloc (layout->ranks, sizeof (DomainStats));
+	DomainStats *own = &stats[rank];
+
+	*own = (DomainStats) {.valid = 1, .rank = rank};
+	domain_bounds (layout, rank, &own->row, &own->col, &own->rows, &own->cols);
+
+	Grid *cur  = grid_new (own->rows + 2 * k, own->cols + 2 * k);
+	Grid *next = grid_new (own->rows + 2 * k, own->cols + 2 * k);
+
+	for (int i = 0; i < own->rows; i++)
+		memcpy (&GRID_GET (cur, k + i, k),
+				&GRID_GET (domain->init, own->row + i, own->col),
+				own->cols * sizeof (int));
+
+	grid_free (domain->init);
+	domain->init = NULL;
+
+	// The engine wraps the padded grid on itself, which only
+	// spoils the halo that is refreshed before it reaches inside
+	Rule *rule = rule_new (domain->rule);
+	// One thread each, the ranks already share the cores
+	Engine *engine = engine_new (domain->engine, cur->rows, cur->cols, rule, 1);
+
+	int *strip[2] = {
+		xcalloc (own->rows * k, sizeof (int)),
+		xcalloc (own->rows * k, sizeof (int))
+	};
+
+	int *halo[2] = {
+		xcalloc (own->rows * k, sizeof (int)),
+		xcalloc (own->rows * k, sizeof (int))
+	};
+
+	domain->transport->open (domain->link, rank);
+
+	for (int gen = 0; gen < domain->gen_limit; )
+		{
+			int steps = domain->gen_limit - gen < k ? domain->gen_limit - gen : k;
+			double start = perf_now ();
+
+			domain_exchange (domain, cur, strip, halo);
+			engine_reset (engine);
+
+			double exchanged = perf_now ();
+
+			// A halo this deep lasts for as many generations, an
+			// engine that blocks in time takes them all at once
+			engine_step_many (engine, next, cur, steps, NULL);
+
+			Grid *tmp = cur;
+			cur = next;
+			next = tmp;
+
+			own->halo_time += exchanged - start;
+			own->step_time += perf_now () - exchanged;
+			own->exchanges++;
+
+			gen += steps;
+		}
+
+	for (int i = 0; i < own->rows; i++)
+		for (int j = 0; j < own->cols; j++)
+			if (GRID_GET (cur, k + i, k + j))
+				{
+					own->population++;
+					own->checksum += domain_cell_hash (
+							(uint64_t) (own->row + i) * layout->cols + own->col + j);
+				}
+
+	domain_allgather (domain, stats);
+
+	// Forked ranks share the table, one copy is enough
+	if (rank == 0 || domain->rank >= 0)
+		memcpy (domain->stats, stats, layout->ranks * sizeof (DomainStats));
+
+	xfree (strip[0]);
+	xfree (strip[1]);
+	xfree (halo[0]);
+	xfree (halo[1]);
+
+	engine_free (engine);
+	rule_free (rule);
+	grid_free (cur);
+	grid_free (next);
+	xfree (stats);
+}
+
+void
+domain_run (Domain *domain)
+{
+	assert (domain != NULL);
+
+	pid_t pids[DOMAIN_RANKS_MAX];
+	int ranks = domain->layout.ranks;
+	double start = perf_now ();
+
+	if (domain->rank >= 0)
+		{
+			domain_run_rank (domain, domain->rank);
+			domain->elapsed = perf_now () - start;
+			return;
+		}
+
+	// Nothing buffered may be written twice by the children
+	fflush (NULL);
+
+	for (int r = 0; r < ranks; r++)
+		{
+			pids[r] = fork ();
+
+			if (pids[r] < 0)
+				error (1, 1, "Could not start rank %d", r);
+
+			if (pids[r] == 0)
+				{
+					domain_run_rank (domain, r);
+					_exit (EXIT_SUCCESS);
+				}
+		}
+
+	for (int n = 0; n < ranks; n++)
+		{
+			int status = 0;
+			pid_t pid = wait (&status);
+
+			if (pid < 0 || (WIFEXITED (status) && WEXITSTATUS (status) == 0))
+				continue;
+
+			// The others would wait forever for their neighbor
+			for (int r = 0; r < ranks; r++)
+				if (pids[r] != pid)
+					kill (pids[r], SIGTERM);
+
+			for (int r = 0; r < ranks; r++)
+				if (pids[r] == pid)
+					error (1, 0, "Rank %d failed", r);
+		}
+
+	domain->elapsed = perf_now () - start;
+}
+
+long
+domain_population (const Domain *domain)
+{
+	assert (domain != NULL);
+
+	long population = 0;
+
+	for (int r = 0; r < domain->layout.ranks; r++)
+		population += domain->stats[r].population;
+
+	return population;
+}
+
+uint64_t
+domain_checksum (const Domain *domain)
+{
+	assert (domain != NULL);
+
+	uint64_t checksum = 0;
+
+	for (int r = 0; r < domain->layout.ranks; r++)
+		checksum += domain->stats[r].checksum;
+
+	return checksum;
+}
+
+void
+domain_report (const Domain *domain, FILE *fp)
+{
+	assert (domain != NULL);
+	assert (fp != NULL);
+
+	const DomainLayout *layout = &domain->layout;
+
+	fprintf (fp, "# rows=%d cols=%d generations=%d ranks=%d split=%dx%d"
+			" transport=%s halo=%d\n",
+			layout->rows, layout->cols, domain->gen_limit, layout->ranks,
+			layout->py, layout->px, domain->transport->name, layout->halo);
+	fprintf (fp, "%-4s  %-17s  %-10s  %-10s  %-10s  %s\n",
+			"rank", "sub-domain", "population", "step_s", "halo_s", "exchanges");
+
+	for (int r = 0; r < layout->ranks; r++)
+		{
+			const DomainStats *s = &domain->stats[r];
+			char bounds[64];
+
+			snprintf (bounds, sizeof (bounds), "%d,%d+%dx%d",
+					s->row, s->col, s->rows, s->cols);
+
+			fprintf (fp, "%-4d  %-17s  %-10ld  %-10.3f  %-10.3f  %ld\n",
+					r, bounds, s->population, s->step_time, s->halo_time,
+					s->exchanges);
+		}
+
+	fprintf (fp, "# population=%ld checksum=%016llx\n",
+			domain_population (domain),
+			(unsigned long long) domain_checksum (domain));
+
+	if (domain->elapsed > 0)
+		fprintf (fp, "# elapsed=%.3fs cells/s=%.3e\n",
+				domain->elapsed,
+				(double) layout->rows * layout->cols * domain->gen_limit
+					/ domain->elapsed);
+}
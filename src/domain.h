@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include "config.h"
+#include "grid.h"
+
+/*
+ * The torus split in a px x py grid of rectangular sub-domains,
+ * one per rank. Each rank keeps its cells with a border of
+ * --halo cells copied from its neighbors, exchanged every halo
+ * generations: the border is stale by one more cell each
+ * generation, so after halo generations the inner cells are
+ * still exact.
+ *
+ * A halo exchange runs on one axis at a time, columns and then
+ * rows including the corners just received. On each axis a rank
+ * sends one message to its lower (west or north) and one to its
+ * upper (east or south) neighbor, and receives the matching
+ * ones: recv[0] is what the lower neighbor sent up.
+ */
+
+#define DOMAIN_RANKS_MAX 64
+#define DOMAIN_TRANSPORT "shm"
+
+typedef struct
+{
+	int    ranks;
+	int    px, py;
+	int    rows, cols;
+	int    halo;
+
+	// Largest message a rank may send
+	size_t msg_max;
+} DomainLayout;
+
+typedef struct
+{
+	const char *name;
+	const char *desc;
+
+	// rank < 0 sets up all ranks before they are forked
+	void *      (*new)      (const DomainLayout *layout, const char *peers, int rank);
+	void        (*open)     (void *state, int rank);
+	void        (*exchange) (void *state, int axis, void *const send[2],
+	                         void *const recv[2], size_t len);
+	void        (*free)     (void *state);
+} DomainTransport;
+
+typedef struct _Domain Domain;
+
+const DomainTransport * domain_transport_get      (const char *name);
+int                     domain_transport_is_valid (const char *name);
+
+void     domain_layout_init    (DomainLayout *layout, int ranks, int rows, int cols, int halo);
+int      domain_neighbor       (const DomainLayout *layout, int rank, int axis, int side);
+void     domain_bounds         (const DomainLayout *layout, int rank,
+                                int *row, int *col, int *rows, int *cols);
+
+Domain * domain_new            (const Config *cfg);
+void     domain_run            (Domain *domain);
+long     domain_population     (const Domain *domain);
+uint64_t domain_checksum       (const Domain *domain);
+uint64_t domain_grid_checksum  (const Grid *grid);
+void     domain_report         (const Domain *domain, FILE *fp);
+void     domain_free           (Domain *domain);
@@ -0,0 +1,133 @@
+#include "domain_shm.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <assert.h>
+#include "wrapper.h"
+#include "error.h"
+
+/*
+ * Ranks forked from one process share an anonymous mapping with
+ * a barrier and one slot per rank and side. The slots come in
+ * two sets used in turn: a set is written again only after every
+ * rank went through the next barrier, so after all of them read
+ * it.
+ */
+
+#define SLOT_ALIGN 64
+
+typedef struct
+{
+	DomainLayout       layout;
+	int                rank;
+	int                turn;
+
+	size_t             slot_size;
+	size_t             size;
+	pthread_barrier_t *barrier;
+	uint8_t           *slots;
+} DomainShm;
+
+static inline size_t
+domain_shm_align (size_t size)
+{
+	return (size + SLOT_ALIGN - 1) & ~((size_t) SLOT_ALIGN - 1);
+}
+
+static void *
+domain_shm_new (const DomainLayout *layout, const char *peers, int rank)
+{
+	if (rank >= 0)
+		error (1, 0, "The shm transport runs all the ranks on this host, without --rank");
+
+	DomainShm *shm = xcalloc (1, sizeof (DomainShm));
+	size_t header = domain_shm_align (sizeof (pthread_barrier_t));
+	size_t slot_size = domain_shm_align (layout->msg_max);
+
+	*shm = (DomainShm) {
+		.layout    = *layout,
+		.rank      = -1,
+		.slot_size = slot_size,
+		.size      = header + 2 * layout->ranks * 2 * slot_size
+	};
+
+	uint8_t *mem = mmap (NULL, shm->size, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+	if (mem == MAP_FAILED)
+		error (1, 1, "Could not map the halo buffers");
+
+	shm->barrier = (pthread_barrier_t *) mem;
+	shm->slots = mem + header;
+
+	pthread_barrierattr_t attr;
+	pthread_barrierattr_init (&attr);
+	pthread_barrierattr_setpshared (&attr, PTHREAD_PROCESS_SHARED);
+	pthread_barrier_init (shm->barrier, &attr, layout->ranks);
+	pthread_barrierattr_destroy (&attr);
+
+	return shm;
+}
+
+static void
+domain_shm_open (void *state, int rank)
+{
+	DomainShm *shm = state;
+	shm->rank = rank;
+}
+
+static inline uint8_t *
+domain_shm_slot (DomainShm *shm, int rank, int side)
+{
+	size_t slot = ((size_t) shm->turn * shm->layout.ranks + rank) * 2 + side;
+	return shm->slots + slot * shm->slot_size;
+}
+
+static void
+domain_shm_exchange (void *state, int axis, void *const send[2],
+		void *const recv[2], size_t len)
+{
+	DomainShm *shm = state;
+
+	assert (shm->rank >= 0);
+	assert (len <= shm->slot_size);
+
+	int lower = domain_neighbor (&shm->layout, shm->rank, axis, 0);
+	int upper = domain_neighbor (&shm->layout, shm->rank, axis, 1);
+
+	memcpy (domain_shm_slot (shm, shm->rank, 0), send[0], len);
+	memcpy (domain_shm_slot (shm, shm->rank, 1), send[1], len);
+
+	pthread_barrier_wait (shm->barrier);
+
+	memcpy (recv[0], domain_shm_slot (shm, lower, 1), len);
+	memcpy (recv[1], domain_shm_slot (shm, upper, 0), len);
+
+	shm->turn ^= 1;
+}
+
+static void
+domain_shm_free (void *state)
+{
+	DomainShm *shm = state;
+
+	if (shm == NULL)
+		return;
+
+	pthread_barrier_destroy (shm->barrier);
+	munmap (shm->barrier, shm->size);
+
+	xfree (shm);
+}
+
+const DomainTransport domain_shm_transport =
+{
+	"shm",
+	"Shared memory between ranks forked on this host",
+	domain_shm_new,
+	domain_shm_open,
+	domain_shm_exchange,
+	domain_shm_free
+};
@@ -0,0 +1,5 @@
+#pragma once
+
+#include "domain.h"
+
+extern const DomainTransport domain_shm_transport;
@@ -0,0 +1,429 @@
+#include "domain_sock.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <assert.h>
+#include "wrapper.h"
+#include "error.h"
+
+/*
+ * One stream socket per neighbor and side. Each rank listens on
+ * its own address, connects to its upper neighbors and accepts
+ * its lower ones, which say who they are and for which axis.
+ * On a ring of one rank the messages are just copied back.
+ */
+
+#define CONNECT_TRIES 300
+#define CONNECT_WAIT  100000
+
+typedef struct
+{
+	DomainLayout            layout;
+	int                     tcp;
+	int                     rank;
+
+	int                     listen_fd[DOMAIN_RANKS_MAX];
+	int                     bound[DOMAIN_RANKS_MAX];
+	struct sockaddr_storage addr[DOMAIN_RANKS_MAX];
+	socklen_t               addr_len[DOMAIN_RANKS_MAX];
+
+	// Links by axis and side, -1 for a ring of one
+	int                     fd[2][2];
+} DomainSock;
+
+static void
+domain_sock_unix_addrs (DomainSock *sock, const char *peers)
+{
+	char prefix[64];
+
+	// Without a prefix the paths are unique to this run
+	if (peers == NULL)
+		{
+			snprintf (prefix, sizeof (prefix), "/tmp/conga-%d-", (int) getpid ());
+			peers = prefix;
+		}
+
+	for (int r = 0; r < sock->layout.ranks; r++)
+		{
+			struct sockaddr_un *sa = (struct sockaddr_un *) &sock->addr[r];
+			int len = snprintf (sa->sun_path, sizeof (sa->sun_path), "%s%d.sock", peers, r);
+
+			if (len >= (int) sizeof (sa->sun_path))
+				error (1, 0, "Socket path '%s%d.sock' is too long", peers, r);
+
+			sa->sun_family = AF_UNIX;
+			sock->addr_len[r] = sizeof (struct sockaddr_un);
+		}
+}
+
+static void
+domain_sock_tcp_addrs (DomainSock *sock, const char *peers)
+{
+	// All local, each rank gets a free port when it binds
+	if (peers == NULL)
+		{
+			for (int r = 0; r < sock->layout.ranks; r++)
+				{
+					struct sockaddr_in *sa = (struct sockaddr_in *) &sock->addr[r];
+
+					*sa = (struct sockaddr_in) {
+						.sin_family = AF_INET,
+						.sin_addr   = {htonl (INADDR_LOOPBACK)}
+					};
+
+					sock->addr_len[r] = sizeof (struct sockaddr_in);
+				}
+			return;
+		}
+
+	char *list = xstrdup (peers);
+	char *save = NULL;
+	int r = 0;
+
+	for (char *peer = strtok_r (list, ",", &save); peer != NULL;
+			peer = strtok_r (NULL, ",", &save), r++)
+		{
+			char *port = strrchr (peer, ':');
+			struct addrinfo hints = {.ai_family = AF_INET, .ai_socktype = SOCK_STREAM};
+			struct addrinfo *res = NULL;
+
+			if (r >= sock->layout.ranks)
+				error (1, 0, "--peers has more than %d addresses", sock->layout.ranks);
+
+			if (port == NULL)
+				error (1, 0, "Peer '%s' is not HOST:PORT", peer);
+
+			*port++ = '\0';
+
+			if (getaddrinfo (peer, port, &hints, &res) != 0)
+				error (1, 0, "Could not resolve peer '%s'", peer);
+
+			memcpy (&sock->addr[r], res->ai_addr, res->ai_addrlen);
+			sock->addr_len[r] = res->ai_addrlen;
+
+			freeaddrinfo (res);
+		}
+
+	if (r != sock->layout.ranks)
+		error (1, 0, "--peers must have one address per rank, %d", sock->layout.ranks);
+
+	xfree (list);
+}
+
+static void
+domain_sock_listen (DomainSock *sock, int rank, int any)
+{
+	struct sockaddr_storage addr = sock->addr[rank];
+	int on = 1;
+
+	int fd = socket (addr.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+	if (fd < 0)
+		error (1, 1, "Could not create socket");
+
+	if (sock->tcp)
+		setsockopt (fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof (on));
+	else
+		unlink (((struct sockaddr_un *) &addr)->sun_path);
+
+	// Peers may name this host by any of its addresses
+	if (any)
+		((struct sockaddr_in *) &addr)->sin_addr.s_addr = htonl (INADDR_ANY);
+
+	if (bind (fd, (struct sockaddr *) &addr, sock->addr_len[rank]) < 0
+			|| listen (fd, 4) < 0)
+		error (1, 1, "Could not listen for rank %d", rank);
+
+	// A free port was picked, tell the others which one
+	if (sock->tcp && !any)
+		getsockname (fd, (struct sockaddr *) &sock->addr[rank], &sock->addr_len[rank]);
+
+	sock->listen_fd[rank] = fd;
+	sock->bound[rank] = 1;
+}
+
+static void *
+domain_sock_new (const DomainLayout *layout, const char *peers, int rank, int tcp)
+{
+	DomainSock *sock = xcalloc (1, sizeof (DomainSock));
+
+	*sock = (DomainSock) {
+		.layout = *layout,
+		.tcp    = tcp,
+		.rank   = -1,
+		.fd     = {{-1, -1}, {-1, -1}}
+	};
+
+	for (int r = 0; r < DOMAIN_RANKS_MAX; r++)
+		sock->listen_fd[r] = -1;
+
+	if (tcp)
+		domain_sock_tcp_addrs (sock, peers);
+	else
+		domain_sock_unix_addrs (sock, peers);
+
+	// Bound before the ranks start, so none connects too early
+	for (int r = 0; r < layout->ranks; r++)
+		if (rank < 0 || r == rank)
+			domain_sock_listen (sock, r, tcp && peers != NULL);
+
+	return sock;
+}
+
+static void *
+domain_unix_new (const DomainLayout *layout, const char *peers, int rank)
+{
+	if (rank >= 0 && peers == NULL)
+		error (1, 0, "--rank with the unix transport requires --peers PREFIX");
+
+	return domain_sock_new (layout, peers, rank, 0);
+}
+
+static void *
+domain_tcp_new (const DomainLayout *layout, const char *peers, int rank)
+{
+	if (rank >= 0 && peers == NULL)
+		error (1, 0, "--rank with the tcp transport requires --peers");
+
+	return domain_sock_new (layout, peers, rank, 1);
+}
+
+static void
+domain_sock_io (int fd, void *buf, size_t len, int out)
+{
+	for (size_t done = 0; done < len; )
+		{
+			ssize_t n = out
+				? send (fd, (uint8_t *) buf + done, len - done, MSG_NOSIGNAL)
+				: recv (fd, (uint8_t *) buf + done, len - done, 0);
+
+			if (n < 0 && errno == EINTR)
+				continue;
+
+			if (n <= 0)
+				error (1, n < 0, "Lost the connection to a neighbor");
+
+			done += n;
+		}
+}
+
+static int
+domain_sock_connect (DomainSock *sock, int peer)
+{
+	for (int tries = 0; tries < CONNECT_TRIES; tries++)
+		{
+			int fd = socket (sock->addr[peer].ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+			if (fd < 0)
+				error (1, 1, "Could not create socket");
+
+			if (connect (fd, (struct sockaddr *) &sock->addr[peer], sock->addr_len[peer]) == 0)
+				return fd;
+
+			int err = errno;
+			close (fd);
+
+			// The peer may not be up yet on another host
+			if (err != ECONNREFUSED && err != ENOENT && err != EINTR)
+				break;
+
+			usleep (CONNECT_WAIT);
+		}
+
+	error (1, 1, "Could not connect to rank %d", peer);
+	return -1;
+}
+
+static void
+domain_sock_open (void *state, int rank)
+{
+	DomainSock *sock = state;
+	int lower = 0;
+
+	sock->rank = rank;
+
+	for (int r = 0; r < sock->layout.ranks; r++)
+		if (r != rank && sock->listen_fd[r] >= 0)
+			{
+				close (sock->listen_fd[r]);
+				sock->listen_fd[r] = -1;
+			}
+
+	for (int axis = 0; axis < 2; axis++)
+		{
+			int upper = domain_neighbor (&sock->layout, rank, axis, 1);
+
+			if (upper == rank)
+				continue;
+
+			int32_t hello[2] = {rank, axis};
+
+			sock->fd[axis][1] = domain_sock_connect (sock, upper);
+			domain_sock_io (sock->fd[axis][1], hello, sizeof (hello), 1);
+
+			lower++;
+		}
+
+	// As many lower neighbors as upper ones
+	for (int n = 0; n < lower; n++)
+		{
+			int32_t hello[2];
+			int fd = accept (sock->listen_fd[rank], NULL, NULL);
+
+			if (fd < 0)
+				error (1, 1, "Could not accept a neighbor of rank %d", rank);
+
+			domain_sock_io (fd, hello, sizeof (hello), 0);
+
+			if (hello[1] < 0 || hello[1] > 1
+					|| hello[0] != domain_neighbor (&sock->layout, rank, hello[1], 0))
+				error (1, 0, "Rank %d got a connection from a stranger", rank);
+
+			sock->fd[hello[1]][0] = fd;
+		}
+
+	close (sock->listen_fd[rank]);
+	sock->listen_fd[rank] = -1;
+
+	for (int axis = 0; axis < 2; axis++)
+		for (int side = 0; side < 2; side++)
+			{
+				int fd = sock->fd[axis][side];
+				int on = 1;
+
+				if (fd < 0)
+					continue;
+
+				fcntl (fd, F_SETFL, O_NONBLOCK);
+
+				if (sock->tcp)
+					setsockopt (fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof (on));
+			}
+}
+
+static void
+domain_sock_exchange (void *state, int axis, void *const send_buf[2],
+		void *const recv_buf[2], size_t len)
+{
+	DomainSock *sock = state;
+	int *fd = sock->fd[axis];
+
+	assert (sock->rank >= 0);
+
+	// A ring of one: what goes up comes back from below
+	if (fd[0] < 0)
+		{
+			memcpy (recv_buf[0], send_buf[1], len);
+			memcpy (recv_buf[1], send_buf[0], len);
+			return;
+		}
+
+	size_t sent[2] = {0, 0};
+	size_t got[2] = {0, 0};
+
+	// Both ways at once, so two ranks sending to each other never
+	// wait on full socket buffers
+	while (sent[0] < len || sent[1] < len || got[0] < len || got[1] < len)
+		{
+			struct pollfd pfd[2];
+
+			for (int side = 0; side < 2; side++)
+				pfd[side] = (struct pollfd) {
+					.fd     = fd[side],
+					.events = (sent[side] < len ? POLLOUT : 0)
+						| (got[side] < len ? POLLIN : 0)
+				};
+
+			if (poll (pfd, 2, -1) < 0)
+				{
+					if (errno == EINTR)
+						continue;
+					error (1, 1, "Could not wait for the neighbors of rank %d", sock->rank);
+				}
+
+			for (int side = 0; side < 2; side++)
+				{
+					ssize_t n;
+
+					// A neighbor done with its side may hang up already
+					if (sent[side] < len && (pfd[side].revents & (POLLOUT | POLLERR)))
+						{
+							n = send (fd[side], (uint8_t *) send_buf[side] + sent[side],
+									len - sent[side], MSG_NOSIGNAL);
+
+							if (n < 0 && errno != EAGAIN && errno != EINTR)
+								error (1, 1, "Rank %d lost a neighbor", sock->rank);
+
+							sent[side] += n > 0 ? n : 0;
+						}
+
+					if (got[side] < len && (pfd[side].revents & (POLLIN | POLLHUP | POLLERR)))
+						{
+							n = recv (fd[side], (uint8_t *) recv_buf[side] + got[side],
+									len - got[side], 0);
+
+							if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR))
+								error (1, n < 0, "Rank %d lost a neighbor", sock->rank);
+
+							got[side] += n > 0 ? n : 0;
+						}
+				}
+		}
+}
+
+static void
+domain_sock_free (void *state)
+{
+	DomainSock *sock = state;
+
+	if (sock == NULL)
+		return;
+
+	for (int axis = 0; axis < 2; axis++)
+		for (int side = 0; side < 2; side++)
+			if (sock->fd[axis][side] >= 0)
+				close (sock->fd[axis][side]);
+
+	for (int r = 0; r < sock->layout.ranks; r++)
+		{
+			if (sock->listen_fd[r] >= 0)
+				close (sock->listen_fd[r]);
+
+			if (sock->bound[r] && !sock->tcp)
+				unlink (((struct sockaddr_un *) &sock->addr[r])->sun_path);
+		}
+
+	xfree (sock);
+}
+
+const DomainTransport domain_unix_transport =
+{
+	"unix",
+	"Unix domain sockets, PREFIX<rank>.sock with --peers PREFIX",
+	domain_unix_new,
+	domain_sock_open,
+	domain_sock_exchange,
+	domain_sock_free
+};
+
+const DomainTransport domain_tcp_transport =
+{
+	"tcp",
+	"TCP, loopback or HOST:PORT of each rank with --peers",
+	domain_tcp_new,
+	domain_sock_open,
+	domain_sock_exchange,
+	domain_sock_free
+};
@@ -0,0 +1,6 @@
+#pragma once
+
+#include "domain.h"
+
+extern const DomainTransport domain_unix_transport;
+extern const DomainTransport domain_tcp_transport;
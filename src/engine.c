@@ -0,0 +1,1304 @@
+#include "engine.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include "wrapper.h"
+#include "bitgrid.h"
+#include "tilegrid.h"
+#include "steal.h"
+#include "perf.h"
+
+struct _Engine
+{
+	const EngineDef *def;
+	void            *state;
+
+	// Between the generations of step_many without the hook
+	Grid            *scratch;
+
+	// Generations of the last step, 0 after a reset
+	int              gens;
+};
+
+/* dense: the reference cell by cell stepper */
+
+static void *
+engine_dense_new (int rows, int cols, Rule *rule, int threads)
+{
+	return rule;
+}
+
+static void
+engine_dense_step (void *state, Grid *grid_next, const Grid *grid_cur, Cell *cell)
+{
+	cell_step_generation (grid_next, grid_cur, state, cell);
+}
+
+static void
+engine_dense_free (void *state)
+{
+}
+
+/* changes of the bit engines, by comparing their input and output */
+
+#define ENGINE_CHANGES_ROWS  64
+#define ENGINE_CHANGES_WORDS 4
+
+static inline int
+engine_bits_differ (const BitGrid *a, const BitGrid *b, int r0, int r1,
+		int w0, int w1)
+{
+	for (int i = r0; i < r1; i++)
+		if (memcmp (BITGRID_ROW (a, i) + w0, BITGRID_ROW (b, i) + w0,
+					(w1 - w0) * sizeof (uint64_t)) != 0)
+			return 1;
+
+	return 0;
+}
+
+// A word compare per 64 cells, the map kept in *map between calls
+static int
+engine_bits_changes (uint8_t **map, const BitGrid *out, const BitGrid *in,
+		GridChanges *changes)
+{
+	int rows = (out->rows + ENGINE_CHANGES_ROWS - 1) / ENGINE_CHANGES_ROWS;
+	int cols = (out->words + ENGINE_CHANGES_WORDS - 1) / ENGINE_CHANGES_WORDS;
+
+	if (*map == NULL)
+		*map = xcalloc ((long) rows * cols, sizeof (uint8_t));
+
+	for (int tr = 0; tr < rows; tr++)
+		for (int tc = 0; tc < cols; tc++)
+			{
+				int r0 = tr * ENGINE_CHANGES_ROWS;
+				int w0 = tc * ENGINE_CHANGES_WORDS;
+				int r1 = r0 + ENGINE_CHANGES_ROWS < out->rows
+					? r0 + ENGINE_CHANGES_ROWS
+					: out->rows;
+				int w1 = w0 + ENGINE_CHANGES_WORDS < out->words
+					? w0 + ENGINE_CHANGES_WORDS
+					: out->words;
+
+				(*map)[(long) tr * cols + tc] = engine_bits_differ (out, in, r0, r1, w0, w1);
+			}
+
+	*changes = (GridChanges) {
+		.map       = *map,
+		.rows      = rows,
+		.cols      = cols,
+		.tile_rows = ENGINE_CHANGES_ROWS,
+		.tile_cols = ENGINE_CHANGES_WORDS * 64
+	};
+
+	return 1;
+}
+
+/* bitpack: 64 cells per word stepped by the bitwise adder */
+
+typedef struct
+{
+	BitRule  rule;
+	BitGrid *cur;
+	BitGrid *next;
+	uint8_t *changed;
+} EngineBitpack;
+
+static void *
+engine_bitpack_new (int rows, int cols, Rule *rule, int threads)
+{
+	EngineBitpack *e = xcalloc (1, sizeof (EngineBitpack));
+
+	*e = (EngineBitpack) {
+		.cur  = bitgrid_new (rows, cols),
+		.next = bitgrid_new (rows, cols)
+	};
+
+	bitlife_rule_init (&e->rule, rule);
+
+	return e;
+}
+
+static void
+engine_bitpack_step (void *state, Grid *grid_next, const Grid *grid_cur, Cell *cell)
+{
+	EngineBitpack *e = state;
+
+	bitgrid_from_grid (e->cur, grid_cur);
+	bitgrid_step (e->next, e->cur, &e->rule);
+	bitgrid_to_grid (grid_next, e->next);
+
+	if (cell != NULL)
+		{
+			cell->alive = bitgrid_population (e->cur);
+			cell->gen += 1;
+		}
+}
+
+static int
+engine_bitpack_changes (void *state, GridChanges *changes)
+{
+	EngineBitpack *e = state;
+	return engine_bits_changes (&e->changed, e->next, e->cur, changes);
+}
+
+static void
+engine_bitpack_free (void *state)
+{
+	EngineBitpack *e = state;
+
+	bitgrid_free (e->cur);
+	bitgrid_free (e->next);
+
+	xfree (e->changed);
+	xfree (e);
+}
+
+/* tiled: 64x64 bit tiles in Z-order */
+
+typedef struct
+{
+	BitRule   rule;
+	TileGrid *cur;
+	TileGrid *next;
+	uint8_t  *changed;
+} EngineTiled;
+
+static void *
+engine_tiled_new (int rows, int cols, Rule *rule, int threads)
+{
+	EngineTiled *e = xcalloc (1, sizeof (EngineTiled));
+
+	*e = (EngineTiled) {
+		.cur  = tilegrid_new (rows, cols),
+		.next = tilegrid_new (rows, cols)
+	};
+
+	bitlife_rule_init (&e->rule, rule);
+
+	return e;
+}
+
+// The tiles stay in their layout between the generations
+static void
+engine_tiled_step_many (void *state, Grid *grid_next, const Grid *grid_cur,
+		int gens, Cell *cell)
+{
+	EngineTiled *e = state;
+
+	tilegrid_from_grid (e->cur, grid_cur);
+
+	for (int g = 0; g < gens; g++)
+		{
+			TileGrid *tmp = e->cur;
+
+			if (g == gens - 1 && cell != NULL)
+				cell->alive = tilegrid_population (e->cur);
+
+			tilegrid_step (e->next, e->cur, &e->rule);
+
+			e->cur = e->next;
+			e->next = tmp;
+		}
+
+	tilegrid_to_grid (grid_next, e->cur);
+
+	if (cell != NULL)
+		cell->gen += gens;
+}
+
+static void
+engine_tiled_step (void *state, Grid *grid_next, const Grid *grid_cur, Cell *cell)
+{
+	engine_tiled_step_many (state, grid_next, grid_cur, 1, cell);
+}
+
+// The output is in cur and the input in next, tile by tile
+static int
+engine_tiled_changes (void *state, GridChanges *changes)
+{
+	EngineTiled *e = state;
+	long tiles = (long) e->cur->tile_rows * e->cur->tile_cols;
+
+	if (e->changed == NULL)
+		e->changed = xcalloc (tiles, sizeof (uint8_t));
+
+	for (int tr = 0; tr < e->cur->tile_rows; tr++)
+		for (int tc = 0; tc < e->cur->tile_cols; tc++)
+			e->changed[(long) tr * e->cur->tile_cols + tc] =
+				memcmp (TILEGRID_TILE (e->cur, tr, tc), TILEGRID_TILE (e->next, tr, tc),
+						TILEGRID_SIDE * sizeof (uint64_t)) != 0;
+
+	*changes = (GridChanges) {
+		.map       = e->changed,
+		.rows      = e->cur->tile_rows,
+		.cols      = e->cur->tile_cols,
+		.tile_rows = TILEGRID_SIDE,
+		.tile_cols = TILEGRID_SIDE
+	};
+
+	return 1;
+}
+
+static void
+engine_tiled_free (void *state)
+{
+	EngineTiled *e = state;
+
+	tilegrid_free (e->cur);
+	tilegrid_free (e->next);
+
+	xfree (e->changed);
+	xfree (e);
+}
+
+/* temporal: bitpack in cache tiles, several generations at once */
+
+typedef struct
+{
+	BitRule  rule;
+	BitGrid *cur;
+	BitGrid *next;
+	uint8_t *changed;
+} EngineTemporal;
+
+static void *
+engine_temporal_new (int rows, int cols, Rule *rule, int threads)
+{
+	EngineTemporal *e = xcalloc (1, sizeof (EngineTemporal));
+
+	*e = (EngineTemporal) {
+		.cur  = bitgrid_new (rows, cols),
+		.next = bitgrid_new (rows, cols)
+	};
+
+	bitlife_rule_init (&e->rule, rule);
+
+	return e;
+}
+
+static void
+engine_temporal_step_many (void *state, Grid *grid_next, const Grid *grid_cur,
+		int gens, Cell *cell)
+{
+	EngineTemporal *e = state;
+	long alive = 0;
+
+	bitgrid_from_grid (e->cur, grid_cur);
+
+	for (int left = gens; left > 0; left -= BITGRID_BLOCK_MAX)
+		{
+			BitGrid *tmp = e->cur;
+
+			bitgrid_step_blocked (e->next, e->cur, &e->rule,
+					left < BITGRID_BLOCK_MAX ? left : BITGRID_BLOCK_MAX, &alive);
+
+			e->cur = e->next;
+			e->next = tmp;
+		}
+
+	bitgrid_to_grid (grid_next, e->cur);
+
+	if (cell != NULL)
+		{
+			cell->alive = alive;
+			cell->gen += gens;
+		}
+}
+
+static void
+engine_temporal_step (void *state, Grid *grid_next, const Grid *grid_cur, Cell *cell)
+{
+	engine_temporal_step_many (state, grid_next, grid_cur, 1, cell);
+}
+
+// Of one generation, the output is in cur and the input in next
+static int
+engine_temporal_changes (void *state, GridChanges *changes)
+{
+	EngineTemporal *e = state;
+	return engine_bits_changes (&e->changed, e->cur, e->next, changes);
+}
+
+static void
+engine_temporal_free (void *state)
+{
+	EngineTemporal *e = state;
+
+	bitgrid_free (e->cur);
+	bitgrid_free (e->next);
+
+	xfree (e->changed);
+	xfree (e);
+}
+
+/* steal: the tiles that may change, on work-stealing threads */
+
+#define STEAL_TILE_ROWS  64
+#define STEAL_TILE_WORDS 4
+
+typedef struct
+{
+	BitRule     rule;
+
+	// The last input and output, and an input packed anew
+	BitGrid    *in;
+	BitGrid    *out;
+	BitGrid    *pack;
+
+	int         tile_rows;
+	int         tile_cols;
+
+	// Of each tile, whether the last output differs from the
+	// last input, and how many cells the output has alive
+	uint8_t    *changed;
+	long       *alive;
+	long        out_alive;
+
+	long       *tasks;
+	long        split[STEAL_WORKERS_MAX + 1];
+	int         primed;
+	StealPool  *pool;
+
+	// The grids of the last step, to tell if this one follows it
+	const Grid *last_in;
+	const Grid *last_out;
+
+	Grid       *grid_next;
+	const Grid *grid_cur;
+} EngineSteal;
+
+static void *
+engine_steal_new (int rows, int cols, Rule *rule, int threads)
+{
+	EngineSteal *e = xcalloc (1, sizeof (EngineSteal));
+	int words = (cols + 63) / 64;
+	int workers = threads < STEAL_WORKERS_MAX ? threads : STEAL_WORKERS_MAX;
+
+	int tile_rows = (rows + STEAL_TILE_ROWS - 1) / STEAL_TILE_ROWS;
+	int tile_cols = (words + STEAL_TILE_WORDS - 1) / STEAL_TILE_WORDS;
+	long tiles = (long) tile_rows * tile_cols;
+
+	// Each band of the bits on the node of the worker it starts with
+	*e = (EngineSteal) {
+		.in        = bitgrid_new_banded (rows, cols, workers),
+		.out       = bitgrid_new_banded (rows, cols, workers),
+		.pack      = bitgrid_new_banded (rows, cols, workers),
+		.tile_rows = tile_rows,
+		.tile_cols = tile_cols,
+		.changed   = xcalloc (tiles, sizeof (uint8_t)),
+		.alive     = xcalloc (tiles, sizeof (long)),
+		.tasks     = xcalloc (tiles, sizeof (long)),
+		.pool      = steal_pool_new (workers, tiles)
+	};
+
+	bitlife_rule_init (&e->rule, rule);
+
+	return e;
+}
+
+static inline void
+engine_steal_bounds (const EngineSteal *e, long task, int *row_from,
+		int *row_to, int *word_from, int *word_to)
+{
+	int tr = task / e->tile_cols;
+	int tc = task % e->tile_cols;
+
+	*row_from = tr * STEAL_TILE_ROWS;
+	*row_to = *row_from + STEAL_TILE_ROWS < e->out->rows
+		? *row_from + STEAL_TILE_ROWS
+		: e->out->rows;
+
+	*word_from = tc * STEAL_TILE_WORDS;
+	*word_to = *word_from + STEAL_TILE_WORDS < e->out->words
+		? *word_from + STEAL_TILE_WORDS
+		: e->out->words;
+}
+
+static inline long
+engine_steal_count (const BitGrid *grid, int r0, int r1, int w0, int w1)
+{
+	long alive = 0;
+
+	for (int i = r0; i < r1; i++)
+		for (int w = w0; w < w1; w++)
+			alive += __builtin_popcountll (BITGRID_ROW (grid, i)[w]);
+
+	return alive;
+}
+
+// Packs a tile of an input that is not the last output, and sees
+// if it changed from the last input
+static void
+engine_steal_load (int worker, long task, void *arg)
+{
+	EngineSteal *e = arg;
+	int r0, r1, w0, w1;
+
+	engine_steal_bounds (e, task, &r0, &r1, &w0, &w1);
+	bitgrid_from_grid_rect (e->pack, e->grid_cur, r0, r1, w0, w1);
+
+	e->changed[task] = !e->primed
+		|| engine_bits_differ (e->pack, e->in, r0, r1, w0, w1);
+}
+
+// Writes out a tile of the output, already stepped or as it was
+static void
+engine_steal_store (int worker, long task, void *arg)
+{
+	EngineSteal *e = arg;
+	int r0, r1, w0, w1;
+
+	engine_steal_bounds (e, task, &r0, &r1, &w0, &w1);
+
+	e->changed[task] = engine_bits_differ (e->out, e->in, r0, r1, w0, w1);
+	e->alive[task] = engine_steal_count (e->out, r0, r1, w0, w1);
+
+	bitgrid_to_grid_rect (e->grid_next, e->out, r0, r1, w0, w1);
+}
+
+/*
+ * Tasks in row order, worker w given those in its band of rows,
+ * the w-th share of them, as bitgrid_new_banded touched it
+ */
+static void
+engine_steal_run (EngineSteal *e, const long *tasks, long len, StealFunc func)
+{
+	int n = steal_pool_workers (e->pool);
+	long i = 0;
+
+	for (int w = 0; w < n; w++)
+		{
+			long row_from = (long) e->out->rows * w / n;
+
+			while (i < len && (long) (tasks[i] / e->tile_cols) * STEAL_TILE_ROWS < row_from)
+				i++;
+
+			e->split[w] = i;
+		}
+
+	e->split[n] = len;
+
+	steal_pool_run_split (e->pool, tasks, e->split, func, e);
+}
+
+static void
+engine_steal_tile (int worker, long task, void *arg)
+{
+	EngineSteal *e = arg;
+	int r0, r1, w0, w1;
+
+	engine_steal_bounds (e, task, &r0, &r1, &w0, &w1);
+	bitgrid_step_rect (e->out, e->in, &e->rule, r0, r1, w0, w1);
+
+	engine_steal_store (worker, task, arg);
+}
+
+/*
+ * A tile whose cells and those around it are as in the last
+ * input steps to the last output; only the others are stepped.
+ *
+ * An input that is the last output, as the caller swaps its
+ * grids, is not packed nor compared: the changed map says which
+ * tiles differ from the last input, and its bits are the last
+ * output's. A tile left alone is then the same in its output as
+ * in its input and, if grid_next was the last input, already in
+ * place there too. Any other input, or a grid written since the
+ * last step (see engine_reset), is packed and compared whole.
+ */
+static void
+engine_steal_step (void *state, Grid *grid_next, const Grid *grid_cur, Cell *cell)
+{
+	EngineSteal *e = state;
+	long tiles = (long) e->tile_rows * e->tile_cols;
+	long active = 0, quiet = tiles;
+	long alive;
+
+	int follows = e->primed && grid_cur == e->last_out;
+	int in_place = follows && grid_next == e->last_in;
+
+	e->grid_next = grid_next;
+	e->grid_cur = grid_cur;
+
+	if (follows)
+		{
+			// The last input's bits hold the quiet tiles of the output
+			BitGrid *tmp = e->in;
+			e->in = e->out;
+			e->out = tmp;
+
+			alive = e->out_alive;
+		}
+	else
+		{
+			for (long t = 0; t < tiles; t++)
+				e->tasks[t] = t;
+
+			engine_steal_run (e, e->tasks, tiles, engine_steal_load);
+
+			// The quiet tiles of the last output are kept
+			BitGrid *tmp = e->in;
+			e->in = e->pack;
+			e->pack = tmp;
+
+			alive = bitgrid_population (e->in);
+		}
+
+	// The tiles to step first, the others from the end
+	for (int tr = 0; tr < e->tile_rows; tr++)
+		for (int tc = 0; tc < e->tile_cols; tc++)
+			{
+				int changed = 0;
+
+				for (int dr = -1; dr <= 1 && !changed; dr++)
+					for (int dc = -1; dc <= 1 && !changed; dc++)
+						{
+							int r = (tr + dr + e->tile_rows) % e->tile_rows;
+							int c = (tc + dc + e->tile_cols) % e->tile_cols;
+
+							changed = e->changed[(long) r * e->tile_cols + c];
+						}
+
+				if (changed)
+					e->tasks[active++] = (long) tr * e->tile_cols + tc;
+				else
+					e->tasks[--quiet] = (long) tr * e->tile_cols + tc;
+			}
+
+	engine_steal_run (e, e->tasks, active, engine_steal_tile);
+
+	if (!in_place)
+		{
+			// The others back in row order
+			for (long i = quiet, j = tiles - 1; i < j; i++, j--)
+				{
+					long tmp = e->tasks[i];
+					e->tasks[i] = e->tasks[j];
+					e->tasks[j] = tmp;
+				}
+
+			engine_steal_run (e, e->tasks + quiet, tiles - quiet, engine_steal_store);
+		}
+
+	e->out_alive = 0;
+
+	for (long t = 0; t < tiles; t++)
+		e->out_alive += e->alive[t];
+
+	if (cell != NULL)
+		{
+			cell->alive = alive;
+			cell->gen += 1;
+		}
+
+	e->last_in = grid_cur;
+	e->last_out = grid_next;
+	e->primed = 1;
+}
+
+static void
+engine_steal_reset (void *state)
+{
+	EngineSteal *e = state;
+	e->primed = 0;
+}
+
+// The map the step keeps anyway
+static int
+engine_steal_changes (void *state, GridChanges *changes)
+{
+	EngineSteal *e = state;
+
+	if (!e->primed)
+		return 0;
+
+	*changes = (GridChanges) {
+		.map       = e->changed,
+		.rows      = e->tile_rows,
+		.cols      = e->tile_cols,
+		.tile_rows = STEAL_TILE_ROWS,
+		.tile_cols = STEAL_TILE_WORDS * 64
+	};
+
+	return 1;
+}
+
+static void
+engine_steal_free (void *state)
+{
+	EngineSteal *e = state;
+
+	steal_pool_free (e->pool);
+	bitgrid_free (e->in);
+	bitgrid_free (e->out);
+	bitgrid_free (e->pack);
+
+	xfree (e->changed);
+	xfree (e->alive);
+	xfree (e->tasks);
+	xfree (e);
+}
+
+/*
+ * auto: one of the engines above, chosen while running. Every
+ * ENGINE_AUTO_SAMPLE calls the step is sampled for its density,
+ * the share of tiles that changed and whether the grid came back
+ * to one it was a call or two before; an engine proposed by
+ * ENGINE_AUTO_STREAK samples in a row takes over. The time per
+ * generation of the window after a switch is held against the
+ * one before, and a switch that turned out slower is undone and
+ * its engine barred for twice as long as the last time.
+ *
+ * A grid that repeats is in a cycle for good, so its states are
+ * kept and copied out instead of stepped, for as long as each
+ * input is the state expected.
+ */
+
+#define ENGINE_AUTO_SAMPLE   16
+#define ENGINE_AUTO_STREAK   3
+#define ENGINE_AUTO_BACKOFF  8
+#define ENGINE_AUTO_SLOWER   1.10
+#define ENGINE_AUTO_AREA_IN  0.25
+#define ENGINE_AUTO_AREA_OUT 0.40
+#define ENGINE_AUTO_CACHE    (1L << 20)
+
+typedef enum
+{
+	ENGINE_AUTO_BITPACK = 0,
+	ENGINE_AUTO_TILED,
+	ENGINE_AUTO_TEMPORAL,
+	ENGINE_AUTO_STEAL,
+	ENGINE_AUTO_KINDS
+} EngineAutoKind;
+
+static const char *engine_auto_names[ENGINE_AUTO_KINDS] =
+{
+	"bitpack",
+	"tiled",
+	"temporal",
+	"steal"
+};
+
+typedef struct
+{
+	long   alive;
+	double density;
+	double area;
+	int    period;
+} EngineAutoSample;
+
+typedef struct
+{
+	Rule     *rule;
+	int       rows;
+	int       cols;
+	int       threads;
+	FILE     *log;
+
+	Engine   *engine;
+	int       kind;
+
+	long      calls;
+	long      samples;
+	int       tile_rows;
+	int       tile_cols;
+	uint8_t  *changed;
+
+	// The input one call before the sample
+	Grid     *before;
+
+	// The states of the cycle and the next input expected
+	Grid     *cycle[2];
+	long      cycle_alive[2];
+	int       cycle_len;
+	int       cycle_at;
+
+	int       proposed;
+	int       streak;
+
+	// The window since the last sample
+	double    secs;
+	long      gens;
+
+	// The engine before the switch on trial and its time
+	int       trial_from;
+	double    trial_rate;
+
+	long      barred[ENGINE_AUTO_KINDS];
+	long      backoff[ENGINE_AUTO_KINDS];
+} EngineAuto;
+
+static inline size_t
+engine_auto_grid_size (const EngineAuto *e)
+{
+	return (size_t) e->rows * e->cols * sizeof (int);
+}
+
+static inline long
+engine_auto_packed_size (const EngineAuto *e)
+{
+	return (long) e->rows * ((e->cols + 63) / 64) * sizeof (uint64_t);
+}
+
+static void
+engine_auto_copy (const EngineAuto *e, Grid **dst, const Grid *src)
+{
+	if (*dst == NULL)
+		*dst = grid_new (e->rows, e->cols);
+
+	memcpy ((*dst)->data, src->data, engine_auto_grid_size (e));
+}
+
+static long
+engine_auto_population (const Grid *grid)
+{
+	long alive = 0;
+
+	for (long i = 0; i < (long) grid->rows * grid->cols; i++)
+		alive += grid->data[i];
+
+	return alive;
+}
+
+static void *
+engine_auto_new (int rows, int cols, Rule *rule, int threads)
+{
+	EngineAuto *e = xcalloc (1, sizeof (EngineAuto));
+
+	// In the tiles of the steal engine
+	int tile_rows = (rows + STEAL_TILE_ROWS - 1) / STEAL_TILE_ROWS;
+	int tile_cols = (cols + STEAL_TILE_WORDS * 64 - 1) / (STEAL_TILE_WORDS * 64);
+
+	*e = (EngineAuto) {
+		.rule       = rule,
+		.rows       = rows,
+		.cols       = cols,
+		.threads    = threads,
+		.tile_rows  = tile_rows,
+		.tile_cols  = tile_cols,
+		.changed    = xcalloc ((long) tile_rows * tile_cols, sizeof (uint8_t)),
+		.proposed   = -1,
+		.trial_from = -1
+	};
+
+	for (int k = 0; k < ENGINE_AUTO_KINDS; k++)
+		e->backoff[k] = ENGINE_AUTO_BACKOFF;
+
+	e->kind = engine_auto_packed_size (e) >= ENGINE_AUTO_CACHE
+		? ENGINE_AUTO_TILED
+		: ENGINE_AUTO_BITPACK;
+
+	e->engine = engine_new (engine_auto_names[e->kind], rows, cols, rule, threads);
+
+	return e;
+}
+
+static void
+engine_auto_log (const EngineAuto *e, long gen, const char *from, const char *to,
+		const char *reason, const EngineAutoSample *s)
+{
+	if (e->log == NULL)
+		return;
+
+	fprintf (e->log, "# gen %ld: engine %s -> %s: %s", gen, from, to, reason);
+
+	if (s != NULL)
+		fprintf (e->log, " (density %.1f%%, %.0f%% of the tiles change)",
+				100 * s->density, 100 * s->area);
+
+	fprintf (e->log, "\n");
+	fflush (e->log);
+}
+
+// grid_next was stepped from grid_cur by the last call
+static void
+engine_auto_sample (EngineAuto *e, const Grid *grid_next, const Grid *grid_cur,
+		int gens, EngineAutoSample *s)
+{
+	long tiles = (long) e->tile_rows * e->tile_cols;
+	long alive = 0, changed = 0;
+
+	memset (e->changed, 0, tiles);
+
+	for (int i = 0; i < e->rows; i++)
+		{
+			const int *next = grid_next->data + (long) i * e->cols;
+			const int *cur = grid_cur->data + (long) i * e->cols;
+			uint8_t *row = e->changed + (long) (i / STEAL_TILE_ROWS) * e->tile_cols;
+
+			for (int j = 0; j < e->cols; j++)
+				{
+					alive += next[j];
+					row[j / (STEAL_TILE_WORDS * 64)] |= next[j] != cur[j];
+				}
+		}
+
+	for (long t = 0; t < tiles; t++)
+		changed += e->changed[t];
+
+	*s = (EngineAutoSample) {
+		.alive   = alive,
+		.density = (double) alive / ((long) e->rows * e->cols),
+		.area    = (double) changed / tiles
+	};
+
+	// Only single generations are replayed, as the Cell wants
+	// the population of the input
+	if (gens > 1)
+		return;
+
+	if (changed == 0)
+		s->period = 1;
+	else if (e->before != NULL && memcmp (grid_next->data, e->before->data,
+				engine_auto_grid_size (e)) == 0)
+		s->period = 2;
+}
+
+// grid_next is the first state of the cycle, grid_cur the last
+static void
+engine_auto_enter_cycle (EngineAuto *e, const Grid *grid_next, const Grid *grid_cur,
+		const EngineAutoSample *s, long gen)
+{
+	char reason[64];
+
+	engine_auto_copy (e, &e->cycle[0], grid_next);
+	e->cycle_alive[0] = s->alive;
+
+	if (s->period == 2)
+		{
+			engine_auto_copy (e, &e->cycle[1], grid_cur);
+			e->cycle_alive[1] = engine_auto_population (grid_cur);
+		}
+
+	e->cycle_len = s->period;
+	e->cycle_at = 0;
+
+	snprintf (reason, sizeof (reason), "repeats every %d generations", s->period);
+	engine_auto_log (e, gen, engine_auto_names[e->kind], "cycle", reason, s);
+}
+
+static int
+engine_auto_replay (EngineAuto *e, Grid *grid_next, const Grid *grid_cur,
+		int gens, Cell *cell)
+{
+	int at = e->cycle_at;
+
+	if (gens == 1 && memcmp (grid_cur->data, e->cycle[at]->data,
+				engine_auto_grid_size (e)) == 0)
+		{
+			int next = (at + 1) % e->cycle_len;
+
+			memcpy (grid_next->data, e->cycle[next]->data, engine_auto_grid_size (e));
+
+			if (cell != NULL)
+				{
+					cell->alive = e->cycle_alive[at];
+					cell->gen += 1;
+				}
+
+			e->cycle_at = next;
+			return 1;
+		}
+
+	// The grids went on without it
+	engine_reset (e->engine);
+
+	engine_auto_log (e, cell != NULL ? cell->gen : e->calls, "cycle",
+			engine_auto_names[e->kind], gens == 1
+				? "the grid left the cycle"
+				: "several generations stepped at once", NULL);
+
+	// The window was spent replaying
+	e->cycle_len = 0;
+	e->secs = 0;
+	e->gens = 0;
+	e->trial_from = -1;
+
+	return 0;
+}
+
+static int
+engine_auto_propose (const EngineAuto *e, const EngineAutoSample *s, int gens,
+		char *reason, size_t len)
+{
+	double area = e->kind == ENGINE_AUTO_STEAL
+		? ENGINE_AUTO_AREA_OUT
+		: ENGINE_AUTO_AREA_IN;
+
+	// Skipping tiles pays off once the others are shared out
+	if (e->threads > 1 && s->area < area)
+		{
+			snprintf (reason, len, "few tiles change");
+			return ENGINE_AUTO_STEAL;
+		}
+
+	if (gens > 1)
+		{
+			snprintf (reason, len, "%d generations stepped at once", gens);
+			return ENGINE_AUTO_TEMPORAL;
+		}
+
+	if (engine_auto_packed_size (e) >= ENGINE_AUTO_CACHE)
+		{
+			snprintf (reason, len, "%.1f MiB packed does not stay in cache",
+					engine_auto_packed_size (e) / (double) (1 << 20));
+			return ENGINE_AUTO_TILED;
+		}
+
+	snprintf (reason, len, "%.0f KiB packed stays in cache",
+			engine_auto_packed_size (e) / 1024.0);
+	return ENGINE_AUTO_BITPACK;
+}
+
+static void
+engine_auto_switch (EngineAuto *e, int kind, long gen, const char *reason,
+		const EngineAutoSample *s)
+{
+	engine_auto_log (e, gen, engine_auto_names[e->kind], engine_auto_names[kind],
+			reason, s);
+
+	engine_free (e->engine);
+
+	e->engine = engine_new (engine_auto_names[kind], e->rows, e->cols,
+			e->rule, e->threads);
+
+	e->kind = kind;
+	e->proposed = -1;
+	e->streak = 0;
+}
+
+static void
+engine_auto_decide (EngineAuto *e, const EngineAutoSample *s, int gens, long gen)
+{
+	char reason[128];
+	double rate = e->secs / e->gens;
+
+	e->secs = 0;
+	e->gens = 0;
+	e->samples++;
+
+	if (e->trial_from >= 0)
+		{
+			int from = e->trial_from;
+			e->trial_from = -1;
+
+			if (rate > e->trial_rate * ENGINE_AUTO_SLOWER)
+				{
+					snprintf (reason, sizeof (reason),
+							"%.3f ms per generation against %.3f ms on %s",
+							1e3 * rate, 1e3 * e->trial_rate, engine_auto_names[from]);
+
+					e->barred[e->kind] = e->samples + e->backoff[e->kind];
+					e->backoff[e->kind] *= 2;
+
+					engine_auto_switch (e, from, gen, reason, NULL);
+					return;
+				}
+		}
+
+	int kind = engine_auto_propose (e, s, gens, reason, sizeof (reason));
+
+	if (kind == e->kind || e->barred[kind] > e->samples)
+		{
+			e->proposed = -1;
+			e->streak = 0;
+			return;
+		}
+
+	if (kind != e->proposed)
+		{
+			e->proposed = kind;
+			e->streak = 0;
+		}
+
+	if (++e->streak < ENGINE_AUTO_STREAK)
+		return;
+
+	e->trial_from = e->kind;
+	e->trial_rate = rate;
+
+	engine_auto_switch (e, kind, gen, reason, s);
+}
+
+static void
+engine_auto_step_many (void *state, Grid *grid_next, const Grid *grid_cur,
+		int gens, Cell *cell)
+{
+	EngineAuto *e = state;
+
+	if (e->cycle_len > 0 && engine_auto_replay (e, grid_next, grid_cur, gens, cell))
+		return;
+
+	long phase = ++e->calls % ENGINE_AUTO_SAMPLE;
+
+	if (phase == ENGINE_AUTO_SAMPLE - 1)
+		engine_auto_copy (e, &e->before, grid_cur);
+
+	double start = perf_now ();
+
+	engine_step_many (e->engine, grid_next, grid_cur, gens, cell);
+
+	e->secs += perf_now () - start;
+	e->gens += gens;
+
+	if (phase != 0)
+		return;
+
+	EngineAutoSample s;
+	long gen = cell != NULL ? cell->gen : e->calls * gens;
+
+	engine_auto_sample (e, grid_next, grid_cur, gens, &s);
+
+	if (s.period > 0)
+		engine_auto_enter_cycle (e, grid_next, grid_cur, &s, gen);
+	else
+		engine_auto_decide (e, &s, gens, gen);
+}
+
+static void
+engine_auto_step (void *state, Grid *grid_next, const Grid *grid_cur, Cell *cell)
+{
+	engine_auto_step_many (state, grid_next, grid_cur, 1, cell);
+}
+
+static void
+engine_auto_reset (void *state)
+{
+	EngineAuto *e = state;
+	engine_reset (e->engine);
+}
+
+// Nothing is stepped while a cycle is replayed
+static int
+engine_auto_changes (void *state, GridChanges *changes)
+{
+	EngineAuto *e = state;
+
+	if (e->cycle_len > 0)
+		return 0;
+
+	return engine_changes (e->engine, changes);
+}
+
+static void
+engine_auto_free (void *state)
+{
+	EngineAuto *e = state;
+
+	engine_free (e->engine);
+	grid_free (e->before);
+	grid_free (e->cycle[0]);
+	grid_free (e->cycle[1]);
+
+	xfree (e->changed);
+	xfree (e);
+}
+
+const EngineDef engine_defs[] =
+{
+	{
+		"dense",
+		"Reference stepper, one int per cell",
+		engine_dense_new,
+		engine_dense_step,
+		NULL,
+		NULL,
+		NULL,
+		engine_dense_free
+	},
+	{
+		"bitpack",
+		"64 cells per word, bitwise adder",
+		engine_bitpack_new,
+		engine_bitpack_step,
+		NULL,
+		NULL,
+		engine_bitpack_changes,
+		engine_bitpack_free
+	},
+	{
+		"tiled",
+		"64x64 bit tiles in Z-order",
+		engine_tiled_new,
+		engine_tiled_step,
+		engine_tiled_step_many,
+		NULL,
+		engine_tiled_changes,
+		engine_tiled_free
+	},
+	{
+		"temporal",
+		"Bitpack in cache tiles, several generations at once",
+		engine_temporal_new,
+		engine_temporal_step,
+		engine_temporal_step_many,
+		NULL,
+		engine_temporal_changes,
+		engine_temporal_free
+	},
+	{
+		"steal",
+		"Bitpack tiles that may change, work-stealing threads",
+		engine_steal_new,
+		engine_steal_step,
+		NULL,
+		engine_steal_reset,
+		engine_steal_changes,
+		engine_steal_free
+	},
+	{
+		"auto",
+		"One of the above, switched by density and activity",
+		engine_auto_new,
+		engine_auto_step,
+		engine_auto_step_many,
+		engine_auto_reset,
+		engine_auto_changes,
+		engine_auto_free
+	},
+	{ NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL }
+};
+
+static const EngineDef *
+engine_get_def (const char *name)
+{
+	for (const EngineDef *def = engine_defs; def->name != NULL; def++)
+		if (strcmp (def->name, name) == 0)
+			return def;
+
+	return NULL;
+}
+
+int
+engine_is_valid (const char *name)
+{
+	assert (name != NULL);
+	return engine_get_def (name) != NULL;
+}
+
+Engine *
+engine_new (const char *name, int rows, int cols, Rule *rule, int threads)
+{
+	assert (name != NULL);
+	assert (rows > 0 && cols > 0);
+	assert (rule != NULL);
+	assert (threads > 0);
+
+	const EngineDef *def = engine_get_def (name);
+	assert (def != NULL);
+
+	Engine *engine = xcalloc (1, sizeof (Engine));
+
+	*engine = (Engine) {
+		.def   = def,
+		.state = def->new (rows, cols, rule, threads)
+	};
+
+	return engine;
+}
+
+void
+engine_step (Engine *engine, Grid *grid_next, const Grid *grid_cur, Cell *cell)
+{
+	assert (engine != NULL);
+	assert (grid_next != NULL && grid_cur != NULL);
+
+	engine->def->step (engine->state, grid_next, grid_cur, cell);
+	engine->gens = 1;
+}
+
+void
+engine_step_many (Engine *engine, Grid *grid_next, const Grid *grid_cur,
+		int gens, Cell *cell)
+{
+	assert (engine != NULL);
+	assert (grid_next != NULL && grid_cur != NULL);
+	assert (gens > 0);
+
+	engine->gens = gens;
+
+	if (engine->def->step_many != NULL)
+		{
+			engine->def->step_many (engine->state, grid_next, grid_cur, gens, cell);
+			return;
+		}
+
+	if (gens > 1 && engine->scratch == NULL)
+		engine->scratch = grid_new (grid_cur->rows, grid_cur->cols);
+
+	// Ping-pong so that the last generation lands in grid_next
+	const Grid *src = grid_cur;
+
+	for (int g = 0; g < gens; g++)
+		{
+			Grid *dst = (gens - g) % 2 ? grid_next : engine->scratch;
+
+			engine->def->step (engine->state, dst, src, cell);
+			src = dst;
+		}
+}
+
+void
+engine_reset (Engine *engine)
+{
+	assert (engine != NULL);
+
+	engine->gens = 0;
+
+	if (engine->def->reset != NULL)
+		engine->def->reset (engine->state);
+}
+
+int
+engine_changes (Engine *engine, GridChanges *changes)
+{
+	assert (engine != NULL);
+	assert (changes != NULL);
+
+	if (engine->gens != 1 || engine->def->changes == NULL)
+		return 0;
+
+	return engine->def->changes (engine->state, changes);
+}
+
+const char *
+engine_name (const Engine *engine)
+{
+	assert (engine != NULL);
+	return engine->def->name;
+}
+
+const char *
+engine_current (const Engine *engine)
+{
+	assert (engine != NULL);
+
+	if (engine->def->new == engine_auto_new)
+		{
+			const EngineAuto *e = engine->state;
+			return e->cycle_len > 0 ? "cycle" : engine_current (e->engine);
+		}
+
+	return engine->def->name;
+}
+
+// Only auto has anything to say
+void
+engine_set_log (Engine *engine, FILE *fp)
+{
+	assert (engine != NULL);
+
+	if (engine->def->new == engine_auto_new)
+		((EngineAuto *) engine->state)->log = fp;
+}
+
+void
+engine_free (Engine *engine)
+{
+	if (engine == NULL)
+		return;
+
+	engine->def->free (engine->state);
+	grid_free (engine->scratch);
+	xfree (engine);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdio.h>
+#include "grid.h"
+#include "rule.h"
+#include "cell.h"
+
+/*
+ * A stepping engine advances a Grid by one generation with
+ * the same result and Cell accounting as cell_step_generation,
+ * which is the reference "dense" engine. Engines may keep their
+ * own working buffers between steps.
+ *
+ * step_many, if set, advances several generations in one call;
+ * the Cell then counts them all, with the population of the
+ * generation before the last as step leaves it. Engines without
+ * it are stepped once per generation. threads is how many the
+ * engine may use, those that step on one ignore it.
+ *
+ * Engines may also rely on the grids being left as their last
+ * step left them: engine_reset, and the reset hook if set, are
+ * for after the grids were written by anything else.
+ *
+ * engine_changes says which tiles the last step changed, if it
+ * was of one generation, not followed by a reset, and the engine
+ * has the changes hook; it returns 0 otherwise, and every cell
+ * is then to be compared.
+ *
+ * engine_current is the engine doing the steps, which differs
+ * from engine_name for auto; auto writes its switches and why
+ * to the FILE given by engine_set_log.
+ */
+
+typedef struct _Engine Engine;
+
+typedef struct
+{
+	const char *name;
+	const char *desc;
+	void *      (*new)  (int rows, int cols, Rule *rule, int threads);
+	void        (*step) (void *state, Grid *grid_next, const Grid *grid_cur, Cell *cell);
+	void        (*step_many) (void *state, Grid *grid_next, const Grid *grid_cur,
+	                          int gens, Cell *cell);
+	void        (*reset) (void *state);
+	int         (*changes) (void *state, GridChanges *changes);
+	void        (*free) (void *state);
+} EngineDef;
+
+extern const EngineDef engine_defs[];
+
+Engine *     engine_new      (const char *name, int rows, int cols, Rule *rule,
+                              int threads);
+void         engine_step     (Engine *engine, Grid *grid_next, const Grid *grid_cur, Cell *cell);
+void         engine_step_many (Engine *engine, Grid *grid_next, const Grid *grid_cur,
+                               int gens, Cell *cell);
+void         engine_reset    (Engine *engine);
+int          engine_changes  (Engine *engine, GridChanges *changes);
+const char * engine_name     (const Engine *engine);
+const char * engine_current  (const Engine *engine);
+void         engine_set_log  (Engine *engine, FILE *fp);
+int          engine_is_valid (const char *name);
+void         engine_free     (Engine *engine);
@@ -0,0 +1,215 @@
+#include "ensemble.h"
+
+#include <stdint.h>
+#include <time.h>
+#include <assert.h>
+#include "wrapper.h"
+#include "grid.h"
+#include "cell.h"
+#include "rule.h"
+#include "rand.h"
+#include "bitlife.h"
+
+/*
+ * Bit k of every cell word belongs to universe k, so one
+ * pass of the bitwise kernel advances all 64 universes
+ */
+
+struct _Ensemble
+{
+	int       rows;
+	int       cols;
+	int       gen;
+	int       gen_limit;
+	long      seed;
+
+	// Generations N - 2, N - 1 and N
+	uint64_t *prev;
+	uint64_t *cur;
+	uint64_t *next;
+
+	BitRule   rule;
+
+	// First generation since which each universe
+	// repeats itself with period 1 or 2
+	int       stable_since[ENSEMBLE_UNIVERSES];
+
+	double    elapsed;
+};
+
+#define CELL(e,buf,i,j) ((e)->buf[(long) (i) * (e)->cols + (j)])
+
+Ensemble *
+ensemble_new (const Config *cfg)
+{
+	assert (cfg != NULL);
+	assert (cfg->generations > 0);
+
+	Ensemble *ensemble = xcalloc (1, sizeof (Ensemble));
+	long size = (long) cfg->rows * cfg->cols;
+
+	*ensemble = (Ensemble) {
+		.rows      = cfg->rows,
+		.cols      = cfg->cols,
+		.gen       = 0,
+		.gen_limit = cfg->generations,
+		.seed      = cfg->seed,
+		.prev      = xcalloc (size, sizeof (uint64_t)),
+		.cur       = xcalloc (size, sizeof (uint64_t)),
+		.next      = xcalloc (size, sizeof (uint64_t))
+	};
+
+	Rule *rule = rule_new (cfg->rule);
+	bitlife_rule_init (&ensemble->rule, rule);
+	rule_free (rule);
+
+	Grid *grid = grid_new (cfg->rows, cfg->cols);
+
+	// Universe k is seeded exactly as a plain run with --seed + k
+	for (int k = 0; k < ENSEMBLE_UNIVERSES; k++)
+		{
+			Rand *rng = rand_new (cfg->seed + k);
+
+			cell_seed_random_generation (grid, rng, cfg->live_percent, NULL);
+
+			for (long i = 0; i < size; i++)
+				ensemble->cur[i] |= (uint64_t) grid->data[i] << k;
+
+			rand_free (rng);
+		}
+
+	grid_free (grid);
+
+	for (long i = 0; i < size; i++)
+		ensemble->prev[i] = ensemble->cur[i];
+
+	return ensemble;
+}
+
+void
+ensemble_free (Ensemble *ensemble)
+{
+	if (ensemble == NULL)
+		return;
+
+	xfree (ensemble->prev);
+	xfree (ensemble->cur);
+	xfree (ensemble->next);
+
+	xfree (ensemble);
+}
+
+void
+ensemble_step (Ensemble *ensemble)
+{
+	assert (ensemble != NULL);
+
+	int rows = ensemble->rows;
+	int cols = ensemble->cols;
+
+	uint64_t changed = 0;
+
+	for (int i = 0; i < rows; i++)
+		{
+			int up   = i == 0 ? rows - 1 : i - 1;
+			int down = i == rows - 1 ? 0 : i + 1;
+
+			for (int j = 0; j < cols; j++)
+				{
+					int left  = j == 0 ? cols - 1 : j - 1;
+					int right = j == cols - 1 ? 0 : j + 1;
+
+					uint64_t next = bitlife_next (&ensemble->rule,
+							CELL (ensemble, cur, i, j),
+							CELL (ensemble, cur, up,   left),
+							CELL (ensemble, cur, up,   j),
+							CELL (ensemble, cur, up,   right),
+							CELL (ensemble, cur, i,    left),
+							CELL (ensemble, cur, i,    right),
+							CELL (ensemble, cur, down, left),
+							CELL (ensemble, cur, down, j),
+							CELL (ensemble, cur, down, right));
+
+					changed |= next ^ CELL (ensemble, prev, i, j);
+					CELL (ensemble, next, i, j) = next;
+				}
+		}
+
+	ensemble->gen++;
+
+	// Universes that still differ from two generations ago
+	for (int k = 0; k < ENSEMBLE_UNIVERSES; k++)
+		if (changed & ((uint64_t) 1 << k))
+			ensemble->stable_since[k] = ensemble->gen - 1;
+
+	uint64_t *tmp = ensemble->prev;
+	ensemble->prev = ensemble->cur;
+	ensemble->cur  = ensemble->next;
+	ensemble->next = tmp;
+}
+
+void
+ensemble_run (Ensemble *ensemble)
+{
+	assert (ensemble != NULL);
+
+	struct timespec start, end;
+
+	clock_gettime (CLOCK_MONOTONIC, &start);
+
+	while (ensemble->gen < ensemble->gen_limit)
+		ensemble_step (ensemble);
+
+	clock_gettime (CLOCK_MONOTONIC, &end);
+
+	ensemble->elapsed = (end.tv_sec - start.tv_sec)
+		+ (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+void
+ensemble_report (const Ensemble *ensemble, FILE *fp)
+{
+	assert (ensemble != NULL);
+	assert (fp != NULL);
+
+	long size = (long) ensemble->rows * ensemble->cols;
+	long alive[ENSEMBLE_UNIVERSES] = {0};
+	long total = 0;
+	int stable = 0;
+
+	for (long i = 0; i < size; i++)
+		for (uint64_t w = ensemble->cur[i]; w; w &= w - 1)
+			alive[__builtin_ctzll (w)]++;
+
+	fprintf (fp, "# rows=%d cols=%d generations=%d\n",
+			ensemble->rows, ensemble->cols, ensemble->gen);
+	fprintf (fp, "%-8s  %-20s  %-10s  %s\n",
+			"universe", "seed", "population", "stabilised");
+
+	for (int k = 0; k < ENSEMBLE_UNIVERSES; k++)
+		{
+			// Period 2 needs two generations to show up
+			int is_stable = ensemble->gen >= 2
+				&& ensemble->stable_since[k] <= ensemble->gen - 2;
+
+			if (is_stable)
+				fprintf (fp, "%-8d  %-20ld  %-10ld  %d\n",
+						k, ensemble->seed + k, alive[k],
+						ensemble->stable_since[k]);
+			else
+				fprintf (fp, "%-8d  %-20ld  %-10ld  %s\n",
+						k, ensemble->seed + k, alive[k], "-");
+
+			total += alive[k];
+			stable += is_stable;
+		}
+
+	fprintf (fp, "# mean_population=%.2f stabilised=%d/%d\n",
+			(double) total / ENSEMBLE_UNIVERSES, stable, ENSEMBLE_UNIVERSES);
+
+	if (ensemble->elapsed > 0)
+		fprintf (fp, "# elapsed=%.3fs cells/s=%.3e\n",
+				ensemble->elapsed,
+				(double) size * ENSEMBLE_UNIVERSES * ensemble->gen
+					/ ensemble->elapsed);
+}
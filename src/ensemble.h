@@ -0,0 +1,14 @@
+#pragma once
+
+#include <stdio.h>
+#include "config.h"
+
+#define ENSEMBLE_UNIVERSES 64
+
+typedef struct _Ensemble Ensemble;
+
+Ensemble * ensemble_new    (const Config *cfg);
+void       ensemble_step   (Ensemble *ensemble);
+void       ensemble_run    (Ensemble *ensemble);
+void       ensemble_report (const Ensemble *ensemble, FILE *fp);
+void       ensemble_free   (Ensemble *ensemble);
@@ -5,6 +5,8 @@
 #include <signal.h>
 #include <assert.h>
 #include "wrapper.h"
+#include "trace.h"
+#include "input.h"
 
 struct _EventQueue
 {
@@ -18,10 +20,18 @@ struct _EventQueue
 	useconds_t acm;
 
 	int        paused;
+
+	// Events come from here instead of the keyboard and timer
+	InputLog  *replay;
+
+	// Called on every tick spent waiting
+	void     (*idle) (void *);
+	void      *idle_data;
 };
 
 static volatile sig_atomic_t quit   = 0;
 static volatile sig_atomic_t redraw = 0;
+static volatile sig_atomic_t dump   = 0;
 
 static void
 event_set_quit (int signum)
@@ -35,6 +45,12 @@ event_set_redraw (int signum)
 	redraw = 1;
 }
 
+static void
+event_set_dump (int signum)
+{
+	dump = 1;
+}
+
 static inline int
 event_index_next (int i)
 {
@@ -93,6 +109,7 @@ event_init (void)
 	signal (SIGQUIT,  event_set_quit);
 	signal (SIGTERM,  event_set_quit);
 	signal (SIGWINCH, event_set_redraw);
+	signal (SIGUSR1,  event_set_dump);
 }
 
 EventQueue *
@@ -128,6 +145,18 @@ event_queue_wait_for_event (EventQueue *queue, Event *event)
 	assert (queue != NULL);
 	assert (event != NULL);
 
+	TRACE_BEGIN ("wait_for_event");
+
+	if (queue->replay != NULL && event_queue_is_empty (queue))
+		{
+			Event replayed = {0};
+
+			if (input_log_read (queue->replay, &replayed))
+				event_queue_push (queue, replayed.type, replayed.key);
+			else
+				event_queue_push (queue, EVENT_QUIT, -1);
+		}
+
 	while (event_queue_is_empty (queue))
 		{
 			usleep (queue->tick);
@@ -144,6 +173,15 @@ event_queue_wait_for_event (EventQueue *queue, Event *event)
 					redraw = 0;
 				}
 
+			if (dump)
+				{
+					event_queue_push (queue, EVENT_DUMP, -1);
+					dump = 0;
+				}
+
+			if (queue->idle != NULL)
+				queue->idle (queue->idle_data);
+
 			int ch = getch ();
 			if (ch != ERR)
 				event_queue_push (queue, EVENT_KEY, ch);
@@ -161,6 +199,8 @@ event_queue_wait_for_event (EventQueue *queue, Event *event)
 		}
 
 	*event = * (event_queue_shift (queue));
+
+	TRACE_END ("wait_for_event");
 }
 
 void
@@ -184,3 +224,47 @@ event_queue_add_delay (EventQueue *queue, int delay)
 
 	return queue->delay;
 }
+
+void
+event_queue_set_idle (EventQueue *queue, void (*idle) (void *), void *data)
+{
+	assert (queue != NULL);
+
+	queue->idle = idle;
+	queue->idle_data = data;
+}
+
+int
+event_queue_depth (const EventQueue *queue)
+{
+	assert (queue != NULL);
+
+	if (event_queue_is_empty (queue))
+		return 0;
+
+	return (queue->tail - queue->head + EVENT_QUEUE_SIZE) % EVENT_QUEUE_SIZE + 1;
+}
+
+void
+event_watch_dump (void)
+{
+	// Without a queue (headless) only SIGUSR1 is taken over
+	signal (SIGUSR1, event_set_dump);
+}
+
+int
+event_dump_pending (void)
+{
+	if (!dump)
+		return 0;
+
+	dump = 0;
+	return 1;
+}
+
+void
+event_queue_set_replay (EventQueue *queue, InputLog *replay)
+{
+	assert (queue != NULL);
+	queue->replay = replay;
+}
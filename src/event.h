@@ -6,6 +6,7 @@
 #define EVENT_DELAY_MIN  20000
 
 typedef struct _EventQueue EventQueue;
+typedef struct _InputLog   InputLog;
 
 typedef enum
 {
@@ -13,7 +14,8 @@ typedef enum
 	EVENT_QUIT,
 	EVENT_KEY,
 	EVENT_TIMER,
-	EVENT_WINCH
+	EVENT_WINCH,
+	EVENT_DUMP
 } EventType;
 
 typedef struct
@@ -27,3 +29,8 @@ void         event_queue_wait_for_event  (EventQueue *queue, Event *event);
 void         event_queue_free            (EventQueue *queue);
 void         event_queue_pause           (EventQueue *queue, int paused);
 int          event_queue_add_delay       (EventQueue *queue, int delay);
+int          event_queue_depth           (const EventQueue *queue);
+void         event_queue_set_replay      (EventQueue *queue, InputLog *replay);
+void         event_queue_set_idle        (EventQueue *queue, void (*idle) (void *), void *data);
+void         event_watch_dump            (void);
+int          event_dump_pending          (void);
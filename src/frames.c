@@ -0,0 +1,237 @@
+#include "frames.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#include "wrapper.h"
+#include "error.h"
+
+#define FRAMES_Y4M_EXT ".y4m"
+#define FRAMES_LANES   16
+
+typedef int     CellLanes  __attribute__ ((vector_size (FRAMES_LANES * sizeof (int))));
+typedef uint8_t PixelLanes __attribute__ ((vector_size (FRAMES_LANES)));
+
+struct _FrameWriter
+{
+	const char *path;
+	FILE       *fp;
+
+	int         rows, cols;
+	int         every;
+	int         scale;
+	int         width, height;
+
+	uint8_t    *gray;
+	uint8_t    *rgb;
+	uint32_t   *acc;
+
+	int         gen;
+	long        count;
+};
+
+static int
+frames_is_y4m (const char *path)
+{
+	size_t len = strlen (path);
+	size_t ext = strlen (FRAMES_Y4M_EXT);
+
+	return strcmp (path, FRAMES_STDOUT) == 0
+		|| (len > ext && strcmp (path + len - ext, FRAMES_Y4M_EXT) == 0);
+}
+
+FrameWriter *
+frames_new (const char *path, int rows, int cols, int every, int scale)
+{
+	assert (path != NULL);
+	assert (rows > 0 && cols > 0);
+	assert (every > 0 && scale >= 0);
+
+	// Same limit as render_scale
+	int max_scale = log2 (fmin (rows, cols));
+
+	if (scale > max_scale)
+		scale = max_scale;
+
+	int fac = 1 << scale;
+
+	FrameWriter *frames = xcalloc (1, sizeof (FrameWriter));
+
+	*frames = (FrameWriter) {
+		.path   = path,
+		.rows   = rows,
+		.cols   = cols,
+		.every  = every,
+		.scale  = scale,
+		.width  = (cols + fac - 1) / fac,
+		.height = (rows + fac - 1) / fac,
+		.gen    = -1
+	};
+
+	frames->gray = xmalloc ((size_t) frames->width * frames->height);
+	frames->acc  = xcalloc (frames->width, sizeof (uint32_t));
+
+	if (frames_is_y4m (path))
+		{
+			frames->fp = strcmp (path, FRAMES_STDOUT) == 0
+				? stdout
+				: xfopen (path, "wb");
+
+			fprintf (frames->fp, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 Cmono\n",
+					frames->width, frames->height, FRAMES_FPS);
+		}
+	else
+		frames->rgb = xmalloc ((size_t) frames->width * 3);
+
+	return frames;
+}
+
+void
+frames_free (FrameWriter *frames)
+{
+	if (frames == NULL)
+		return;
+
+	if (frames->fp == stdout)
+		fflush (stdout);
+	else if (frames->fp != NULL)
+		xfclose (frames->fp);
+
+	xfree (frames->gray);
+	xfree (frames->rgb);
+	xfree (frames->acc);
+	xfree (frames);
+}
+
+long
+frames_count (const FrameWriter *frames)
+{
+	assert (frames != NULL);
+	return frames->count;
+}
+
+/*
+ * One pixel per cell: a dead cell (0) wraps around to 255 and
+ * a live one (1) to 0. Done FRAMES_LANES cells at a time with
+ * the vector extensions, which narrow the ints to bytes in a
+ * few instructions on any target.
+ */
+void
+frames_pixels_row (uint8_t *pixels, const int *cells, int n)
+{
+	int j = 0;
+
+	for (; j + FRAMES_LANES <= n; j += FRAMES_LANES)
+		{
+			CellLanes c;
+			memcpy (&c, cells + j, sizeof (c));
+
+			PixelLanes p = __builtin_convertvector (c, PixelLanes) - 1;
+			memcpy (pixels + j, &p, sizeof (p));
+		}
+
+	for (; j < n; j++)
+		pixels[j] = (uint8_t) (cells[j] - 1);
+}
+
+static void
+frames_convert (FrameWriter *frames, const Grid *grid)
+{
+	int scale = frames->scale;
+	int fac = 1 << scale;
+
+	if (scale == 0)
+		{
+			for (int i = 0; i < grid->rows; i++)
+				frames_pixels_row (frames->gray + (long) i * frames->width,
+						&GRID_GET (grid, i, 0), grid->cols);
+			return;
+		}
+
+	for (int r = 0; r < frames->height; r++)
+		{
+			int i0 = r * fac;
+			int block_rows = i0 + fac <= grid->rows ? fac : grid->rows - i0;
+
+			memset (frames->acc, 0, frames->width * sizeof (uint32_t));
+
+			for (int i = i0; i < i0 + block_rows; i++)
+				{
+					const int *cells = &GRID_GET (grid, i, 0);
+
+					for (int j = 0; j < grid->cols; j++)
+						frames->acc[j >> scale] += cells[j];
+				}
+
+			uint8_t *pixels = frames->gray + (long) r * frames->width;
+
+			for (int c = 0; c < frames->width; c++)
+				{
+					int j0 = c * fac;
+					int block_cols = j0 + fac <= grid->cols ? fac : grid->cols - j0;
+					uint32_t area = block_rows * block_cols;
+
+					pixels[c] = 255 - (frames->acc[c] * 255 + area / 2) / area;
+				}
+		}
+}
+
+static void
+frames_write_ppm (FrameWriter *frames, int gen)
+{
+	char *path = NULL;
+	xasprintf (&path, "%s%06d.ppm", frames->path, gen);
+
+	FILE *fp = xfopen (path, "wb");
+	fprintf (fp, "P6\n%d %d\n255\n", frames->width, frames->height);
+
+	for (int r = 0; r < frames->height; r++)
+		{
+			const uint8_t *gray = frames->gray + (long) r * frames->width;
+
+			for (int c = 0; c < frames->width; c++)
+				{
+					uint8_t *rgb = frames->rgb + c * 3;
+					rgb[0] = rgb[1] = rgb[2] = gray[c];
+				}
+
+			if (fwrite (frames->rgb, 3, frames->width, fp) != (size_t) frames->width)
+				error (1, 1, "Could not write frame '%s'", path);
+		}
+
+	xfclose (fp);
+	xfree (path);
+}
+
+static void
+frames_write_y4m (FrameWriter *frames)
+{
+	size_t len = (size_t) frames->width * frames->height;
+
+	if (fputs ("FRAME\n", frames->fp) == EOF
+			|| fwrite (frames->gray, 1, len, frames->fp) != len)
+		error (1, 1, "Could not write frame to '%s'", frames->path);
+}
+
+void
+frames_write (FrameWriter *frames, const Grid *grid, int gen)
+{
+	assert (frames != NULL);
+	assert (grid != NULL);
+	assert (grid->rows == frames->rows && grid->cols == frames->cols);
+
+	// Generations replayed after a rewind were already written
+	if (gen <= frames->gen || gen % frames->every != 0)
+		return;
+
+	frames_convert (frames, grid);
+
+	if (frames->fp != NULL)
+		frames_write_y4m (frames);
+	else
+		frames_write_ppm (frames, gen);
+
+	frames->gen = gen;
+	frames->count++;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdint.h>
+#include "grid.h"
+
+/*
+ * Generations exported as grayscale frames, either one binary
+ * PPM (P6) per frame named <prefix><gen>.ppm, or a single
+ * YUV4MPEG2 (Cmono) stream, to a *.y4m file or to stdout
+ * when the path is "-". Each pixel covers 2^scale x 2^scale
+ * cells, as the view does at the same render_scale, with the
+ * gray level given by the live fraction: white empty, black
+ * full.
+ */
+
+#define FRAMES_STDOUT "-"
+#define FRAMES_FPS    30
+
+typedef struct _FrameWriter FrameWriter;
+
+FrameWriter * frames_new        (const char *path, int rows, int cols, int every, int scale);
+void          frames_write      (FrameWriter *frames, const Grid *grid, int gen);
+long          frames_count      (const FrameWriter *frames);
+void          frames_free       (FrameWriter *frames);
+
+void          frames_pixels_row (uint8_t *pixels, const int *cells, int n);
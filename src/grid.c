@@ -3,6 +3,7 @@
 #include <stdio.h>
 #include <assert.h>
 #include "wrapper.h"
+#include "pages.h"
 
 #define NEIGHBORS 8
 
@@ -11,15 +12,46 @@ static const int delta_j[] = {-1,  0, +1, -1, +1, -1, 0, +1};
 
 Grid *
 grid_new (int rows, int cols)
+{
+	return grid_new_banded (rows, cols, 1);
+}
+
+// Large grids get huge pages, first touched by bands threads
+Grid *
+grid_new_banded (int rows, int cols, int bands)
+{
+	assert (rows * cols > 0);
+	assert (bands > 0);
+
+	Grid *grid = xcalloc (1, sizeof (Grid));
+	size_t size = (size_t) rows * cols * sizeof (int);
+
+	*grid = (Grid) {
+		.rows  = rows,
+		.cols  = cols,
+		.data  = pages_wanted (size)
+			? pages_alloc (size, bands)
+			: xcalloc (rows * cols, sizeof (int)),
+		.alloc = pages_wanted (size) ? GRID_ALLOC_PAGES : GRID_ALLOC_HEAP
+	};
+
+	return grid;
+}
+
+// The cells live in memory owned by the caller, e.g. shared memory
+Grid *
+grid_new_extern (int rows, int cols, int *data)
 {
 	assert (rows * cols > 0);
+	assert (data != NULL);
 
 	Grid *grid = xcalloc (1, sizeof (Grid));
 
 	*grid = (Grid) {
 		.rows  = rows,
 		.cols  = cols,
-		.data  = xcalloc (rows * cols, sizeof (int))
+		.data  = data,
+		.alloc = GRID_ALLOC_EXTERN
 	};
 
 	return grid;
@@ -31,7 +63,10 @@ grid_free (Grid *grid)
 	if (grid == NULL)
 		return;
 
-	xfree (grid->data);
+	if (grid->alloc == GRID_ALLOC_HEAP)
+		xfree (grid->data);
+	else if (grid->alloc == GRID_ALLOC_PAGES)
+		pages_free (grid->data, (size_t) grid->rows * grid->cols * sizeof (int));
 	xfree (grid);
 }
 
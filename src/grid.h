@@ -1,12 +1,37 @@
 #pragma once
 
+#include <stdint.h>
+
+typedef enum
+{
+	GRID_ALLOC_HEAP,
+	GRID_ALLOC_EXTERN,
+	GRID_ALLOC_PAGES
+} GridAlloc;
+
 typedef struct
 {
-	int  rows;
-	int  cols;
-	int *data;
+	int        rows;
+	int        cols;
+	int       *data;
+	GridAlloc  alloc;
 } Grid;
 
+/*
+ * Which tiles of a grid may differ from the grid it was stepped
+ * from: rows x cols flags, nonzero for those that may, each for
+ * tile_rows x tile_cols cells. The last row and column of tiles
+ * may be cut short by the edges of the grid.
+ */
+typedef struct
+{
+	const uint8_t *map;
+	int            rows;
+	int            cols;
+	int            tile_rows;
+	int            tile_cols;
+} GridChanges;
+
 #define GRID_GET(g,r,c) ( \
 		(g)->data[(r) * (g)->cols + (c)] \
 )
@@ -21,5 +46,7 @@ typedef struct
 )
 
 Grid * grid_new             (int rows, int cols);
+Grid * grid_new_banded      (int rows, int cols, int bands);
+Grid * grid_new_extern      (int rows, int cols, int *data);
 void   grid_free            (Grid *grid);
 int    grid_count_neighbors (const Grid *grid, int i, int j);
@@ -0,0 +1,272 @@
+#include "history.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "wrapper.h"
+#include "delta.h"
+
+#define ENTRIES_MIN 64
+
+typedef struct
+{
+	int      gen;
+
+	// XOR from gen - 1 to gen. NULL for the very first entry
+	uint8_t *delta;
+	size_t   delta_len;
+
+	// Full state of gen, encoded as a delta from the empty grid
+	uint8_t *key;
+	size_t   key_len;
+} HistoryEntry;
+
+struct _History
+{
+	HistoryEntry *entries;
+
+	int           head;
+	int           len;
+	int           size;
+
+	size_t        mem;
+	size_t        budget;
+
+	Grid         *empty;
+	Delta         delta;
+};
+
+#define ENTRY(h,i) (&(h)->entries[((h)->head + (i)) % (h)->size])
+
+#define ENTRY_MEM(e) ( \
+	sizeof (HistoryEntry) + (e)->delta_len + (e)->key_len \
+)
+
+static inline uint8_t *
+history_copy_delta (const Delta *delta)
+{
+	uint8_t *buf = xmalloc (delta->len);
+	memcpy (buf, delta->data, delta->len);
+	return buf;
+}
+
+static inline void
+history_entry_clear (History *history, HistoryEntry *entry)
+{
+	history->mem -= ENTRY_MEM (entry);
+
+	xfree (entry->delta);
+	xfree (entry->key);
+
+	*entry = (HistoryEntry) {0};
+}
+
+static void
+history_grow (History *history)
+{
+	int size = history->size * 2;
+	HistoryEntry *entries = xcalloc (size, sizeof (HistoryEntry));
+
+	for (int i = 0; i < history->len; i++)
+		entries[i] = *ENTRY (history, i);
+
+	xfree (history->entries);
+
+	history->entries = entries;
+	history->size    = size;
+	history->head    = 0;
+}
+
+static void
+history_append (History *history, const Grid *grid, const Grid *grid_prev, int gen)
+{
+	if (history->len == history->size)
+		history_grow (history);
+
+	HistoryEntry *entry = ENTRY (history, history->len);
+	*entry = (HistoryEntry) { .gen = gen };
+
+	if (grid_prev != NULL)
+		{
+			delta_encode (&history->delta, grid, grid_prev, NULL);
+			entry->delta     = history_copy_delta (&history->delta);
+			entry->delta_len = history->delta.len;
+		}
+
+	// Keyframes bound the number of deltas replayed by a seek
+	if (grid_prev == NULL || gen % HISTORY_KEYFRAME_INTERVAL == 0)
+		{
+			delta_encode (&history->delta, grid, history->empty, NULL);
+			entry->key     = history_copy_delta (&history->delta);
+			entry->key_len = history->delta.len;
+		}
+
+	history->mem += ENTRY_MEM (entry);
+	history->len++;
+}
+
+static void
+history_evict (History *history)
+{
+	// Always keep the newest entry, it matches the current grid
+	while (history->mem > history->budget && history->len > 1)
+		{
+			history_entry_clear (history, ENTRY (history, 0));
+			history->head = (history->head + 1) % history->size;
+			history->len--;
+		}
+}
+
+History *
+history_new (const Grid *grid, int gen, size_t budget)
+{
+	assert (grid != NULL);
+	assert (gen >= 0);
+
+	History *history = xcalloc (1, sizeof (History));
+
+	*history = (History) {
+		.entries = xcalloc (ENTRIES_MIN, sizeof (HistoryEntry)),
+		.head    = 0,
+		.len     = 0,
+		.size    = ENTRIES_MIN,
+		.mem     = 0,
+		.budget  = budget,
+		.empty   = grid_new (grid->rows, grid->cols)
+	};
+
+	delta_init (&history->delta);
+	history_append (history, grid, NULL, gen);
+
+	return history;
+}
+
+void
+history_free (History *history)
+{
+	if (history == NULL)
+		return;
+
+	for (int i = 0; i < history->len; i++)
+		history_entry_clear (history, ENTRY (history, i));
+
+	xfree (history->entries);
+	grid_free (history->empty);
+	delta_destroy (&history->delta);
+
+	xfree (history);
+}
+
+void
+history_push (History *history, const Grid *grid_next,
+		const Grid *grid_cur, int gen)
+{
+	assert (history != NULL);
+	assert (grid_next != NULL && grid_cur != NULL);
+
+	// After a rewind the simulation forks from an older
+	// generation, so everything ahead of it is discarded
+	while (history->len > 0 && ENTRY (history, history->len - 1)->gen >= gen)
+		{
+			history_entry_clear (history, ENTRY (history, history->len - 1));
+			history->len--;
+		}
+
+	// Rewound to the oldest state, which has no entry of its own
+	if (history->len == 0)
+		history_append (history, grid_cur, NULL, gen - 1);
+
+	assert (ENTRY (history, history->len - 1)->gen == gen - 1);
+
+	history_append (history, grid_next, grid_cur, gen);
+	history_evict (history);
+}
+
+int
+history_oldest (const History *history)
+{
+	assert (history != NULL);
+
+	const HistoryEntry *entry = ENTRY (history, 0);
+
+	return entry->delta != NULL
+		? entry->gen - 1
+		: entry->gen;
+}
+
+int
+history_newest (const History *history)
+{
+	assert (history != NULL);
+	return ENTRY (history, history->len - 1)->gen;
+}
+
+size_t
+history_memory (const History *history)
+{
+	assert (history != NULL);
+	return history->mem;
+}
+
+static void
+history_replay (History *history, Grid *grid, int from, int to)
+{
+	int first = ENTRY (history, 0)->gen;
+
+	// Deltas are their own inverse, so walking
+	// backwards applies the same records in reverse
+	if (from < to)
+		for (int g = from + 1; g <= to; g++)
+			{
+				HistoryEntry *entry = ENTRY (history, g - first);
+				delta_apply (grid, entry->delta, entry->delta_len);
+			}
+	else
+		for (int g = from; g > to; g--)
+			{
+				HistoryEntry *entry = ENTRY (history, g - first);
+				delta_apply (grid, entry->delta, entry->delta_len);
+			}
+}
+
+int
+history_seek (History *history, Grid *grid, int gen_cur, int gen)
+{
+	assert (history != NULL);
+	assert (grid != NULL);
+
+	if (gen < history_oldest (history) || gen > history_newest (history))
+		return 0;
+
+	assert (gen_cur >= history_oldest (history)
+			&& gen_cur <= history_newest (history));
+
+	int from  = gen_cur;
+	int cost  = abs (gen - gen_cur);
+
+	const HistoryEntry *key = NULL;
+
+	// Look for a keyframe closer than the current grid
+	for (int i = 0; i < history->len; i++)
+		{
+			const HistoryEntry *entry = ENTRY (history, i);
+
+			if (entry->key != NULL && abs (gen - entry->gen) + 1 < cost)
+				{
+					key  = entry;
+					cost = abs (gen - entry->gen) + 1;
+				}
+		}
+
+	if (key != NULL)
+		{
+			memset (grid->data, 0, sizeof (int) * grid->rows * grid->cols);
+			delta_apply (grid, key->key, key->key_len);
+			from = key->gen;
+		}
+
+	history_replay (history, grid, from, gen);
+
+	return 1;
+}
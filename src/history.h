@@ -0,0 +1,17 @@
+#pragma once
+
+#include <stddef.h>
+#include "grid.h"
+
+#define HISTORY_KEYFRAME_INTERVAL 128
+
+typedef struct _History History;
+
+History * history_new    (const Grid *grid, int gen, size_t budget);
+void      history_push   (History *history, const Grid *grid_next,
+                          const Grid *grid_cur, int gen);
+int       history_seek   (History *history, Grid *grid, int gen_cur, int gen);
+int       history_oldest (const History *history);
+int       history_newest (const History *history);
+size_t    history_memory (const History *history);
+void      history_free   (History *history);
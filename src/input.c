@@ -0,0 +1,132 @@
+#include "input.h"
+
+#include <stdio.h>
+#include <time.h>
+#include <assert.h>
+#include "wrapper.h"
+#include "error.h"
+
+#define INPUT_HEADER   "# conga input 1\n"
+#define INPUT_LINE_MAX 128
+
+struct _InputLog
+{
+	FILE       *fp;
+	const char *path;
+	int         replay;
+
+	struct timespec start;
+
+	int         gen;
+	long        count;
+	long        line;
+};
+
+static InputLog *
+input_log_new (const char *path, int replay)
+{
+	assert (path != NULL);
+
+	InputLog *log = xcalloc (1, sizeof (InputLog));
+
+	*log = (InputLog) {
+		.fp     = xfopen (path, replay ? "r" : "w"),
+		.path   = path,
+		.replay = replay
+	};
+
+	clock_gettime (CLOCK_MONOTONIC, &log->start);
+
+	return log;
+}
+
+InputLog *
+input_log_record (const char *path)
+{
+	InputLog *log = input_log_new (path, 0);
+	fputs (INPUT_HEADER, log->fp);
+	return log;
+}
+
+InputLog *
+input_log_replay (const char *path)
+{
+	return input_log_new (path, 1);
+}
+
+void
+input_log_free (InputLog *log)
+{
+	if (log == NULL)
+		return;
+
+	xfclose (log->fp);
+	xfree (log);
+}
+
+void
+input_log_write (InputLog *log, const Event *event, int gen)
+{
+	assert (log != NULL && !log->replay);
+	assert (event != NULL);
+
+	struct timespec now;
+	clock_gettime (CLOCK_MONOTONIC, &now);
+
+	long usec = (now.tv_sec - log->start.tv_sec) * 1000000L
+		+ (now.tv_nsec - log->start.tv_nsec) / 1000;
+
+	fprintf (log->fp, "%d %ld %d %d\n", gen, usec, event->type, event->key);
+
+	log->gen = gen;
+	log->count++;
+}
+
+int
+input_log_read (InputLog *log, Event *event)
+{
+	assert (log != NULL && log->replay);
+	assert (event != NULL);
+
+	char buf[INPUT_LINE_MAX];
+	int gen, type, key;
+	long usec;
+
+	while (fgets (buf, sizeof (buf), log->fp) != NULL)
+		{
+			log->line++;
+
+			if (*buf == '#' || *buf == '\n')
+				continue;
+
+			if (sscanf (buf, "%d %ld %d %d", &gen, &usec, &type, &key) != 4
+					|| type < EVENT_NONE || type > EVENT_DUMP)
+				error (1, 0, "%s:%ld: Invalid input event", log->path, log->line);
+
+			*event = (Event) {
+				.type = type,
+				.key  = key
+			};
+
+			log->gen = gen;
+			log->count++;
+
+			return 1;
+		}
+
+	return 0;
+}
+
+int
+input_log_gen (const InputLog *log)
+{
+	assert (log != NULL);
+	return log->gen;
+}
+
+long
+input_log_count (const InputLog *log)
+{
+	assert (log != NULL);
+	return log->count;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "event.h"
+
+/*
+ * Input log: every Event handled by the interactive loop with
+ * the generation it was handled at and the microseconds since
+ * the start of the recording, one per line:
+ *
+ *   <gen> <usec> <type> <key>
+ */
+
+InputLog * input_log_record (const char *path);
+InputLog * input_log_replay (const char *path);
+void       input_log_write  (InputLog *log, const Event *event, int gen);
+int        input_log_read   (InputLog *log, Event *event);
+int        input_log_gen    (const InputLog *log);
+long       input_log_count  (const InputLog *log);
+void       input_log_free   (InputLog *log);
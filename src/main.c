@@ -1,6 +1,73 @@
 #include "conga.h"
 #include "config.h"
 #include "screen.h"
+#include "ensemble.h"
+#include "soup.h"
+#include "sweep.h"
+#include "domain.h"
+#include "diskgrid.h"
+#include "trace.h"
+
+static void
+run_ensemble (const Config *cfg)
+{
+	Ensemble *ensemble = ensemble_new (cfg);
+	ensemble_run (ensemble);
+	ensemble_report (ensemble, stdout);
+	ensemble_free (ensemble);
+}
+
+static void
+run_soup_search (const Config *cfg)
+{
+	Soup *soup = soup_new (cfg);
+	soup_run (soup);
+	soup_write (soup, cfg->census);
+	soup_report (soup, stdout);
+	soup_free (soup);
+}
+
+static void
+run_sweep (const Config *cfg)
+{
+	Sweep *sweep = sweep_new (cfg);
+	sweep_run (sweep);
+	sweep_report (sweep, stdout);
+	sweep_free (sweep);
+}
+
+static void
+run_domain (const Config *cfg)
+{
+	Domain *domain = domain_new (cfg);
+	domain_run (domain);
+	domain_report (domain, stdout);
+	domain_free (domain);
+}
+
+static void
+run_disk_grid (const Config *cfg)
+{
+	DiskGrid *disk = diskgrid_new (cfg);
+	diskgrid_run (disk);
+	diskgrid_report (disk, stdout);
+	diskgrid_free (disk);
+}
+
+// conga_new takes the terminal, once it is done with stderr
+static void
+run_game (const Config *cfg)
+{
+	Conga *game = conga_new (cfg);
+	conga_run (game);
+
+	screen_finish ();
+
+	if (cfg->replay_input != NULL)
+		conga_report (game, stdout);
+
+	conga_free (game);
+}
 
 int
 main (int argc, char **argv)
@@ -10,14 +77,23 @@ main (int argc, char **argv)
 	Config *cfg = config_new ();
 	config_apply_args (cfg, argc, argv);
 
-	screen_init ();
+	if (cfg->trace != NULL)
+		trace_start (cfg->trace);
 
-	Conga *game = conga_new (cfg);
-	conga_run (game);
-	conga_free (game);
-
-	screen_finish ();
+	if (cfg->ensemble)
+		run_ensemble (cfg);
+	else if (cfg->soups > 0)
+		run_soup_search (cfg);
+	else if (cfg->sweep != NULL)
+		run_sweep (cfg);
+	else if (cfg->ranks > 0)
+		run_domain (cfg);
+	else if (cfg->disk_grid != NULL)
+		run_disk_grid (cfg);
+	else
+		run_game (cfg);
 
+	trace_finish ();
 	config_free (cfg);
 
 	return 0;
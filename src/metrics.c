@@ -0,0 +1,218 @@
+#include "metrics.h"
+
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <assert.h>
+#include "wrapper.h"
+#include "error.h"
+
+#define BUCKETS 8
+
+#define LOAD(x)    __atomic_load_n    (&(x), __ATOMIC_RELAXED)
+#define STORE(x,v) __atomic_store_n   (&(x), (v), __ATOMIC_RELAXED)
+#define ADD(x,v)   __atomic_fetch_add (&(x), (v), __ATOMIC_RELAXED)
+
+typedef struct
+{
+	uint64_t buckets[BUCKETS];
+	uint64_t sum_ns;
+} Histogram;
+
+typedef struct
+{
+	int      seen;
+	uint64_t busy_ns;
+	uint64_t tasks;
+	uint64_t steals;
+} Worker;
+
+static struct
+{
+	uint64_t  generations;
+	uint64_t  frames;
+	int64_t   population;
+	int64_t   queue_depth;
+	Histogram histograms[METRICS_HISTOGRAMS];
+	Worker    workers[METRICS_WORKERS_MAX];
+} metrics;
+
+// Upper bounds in seconds, the last bucket is +Inf
+static const double bucket_bounds[BUCKETS - 1] =
+{
+	1e-6, 1e-5, 1e-4, 1e-3, 1e-2, 1e-1, 1
+};
+
+static const struct
+{
+	const char *name;
+	const char *help;
+} histogram_info[METRICS_HISTOGRAMS] =
+{
+	{"conga_generation_seconds", "Time to step one generation"},
+	{"conga_render_seconds",     "Time to draw and refresh one frame"}
+};
+
+void
+metrics_observe (MetricsHistogram histogram, double secs)
+{
+	assert (histogram >= 0 && histogram < METRICS_HISTOGRAMS);
+
+	Histogram *h = &metrics.histograms[histogram];
+	int b = 0;
+
+	while (b < BUCKETS - 1 && secs > bucket_bounds[b])
+		b++;
+
+	ADD (h->buckets[b], 1);
+	ADD (h->sum_ns, (uint64_t) (secs * 1e9));
+}
+
+void
+metrics_add_generation (long alive)
+{
+	ADD (metrics.generations, 1);
+	STORE (metrics.population, alive);
+}
+
+void
+metrics_add_frame (void)
+{
+	ADD (metrics.frames, 1);
+}
+
+void
+metrics_set_queue_depth (int depth)
+{
+	STORE (metrics.queue_depth, depth);
+}
+
+// Worker threads of the tile scheduler, one label each
+void
+metrics_add_worker (int worker, double busy, long tasks, long steals)
+{
+	assert (worker >= 0 && worker < METRICS_WORKERS_MAX);
+
+	Worker *w = &metrics.workers[worker];
+
+	STORE (w->seen, 1);
+	ADD (w->busy_ns, (uint64_t) (busy * 1e9));
+	ADD (w->tasks, tasks);
+	ADD (w->steals, steals);
+}
+
+static long
+metrics_rss_bytes (void)
+{
+	long pages = 0, resident = 0;
+	FILE *fp = fopen ("/proc/self/statm", "r");
+
+	if (fp == NULL)
+		return 0;
+
+	if (fscanf (fp, "%ld %ld", &pages, &resident) != 2)
+		resident = 0;
+
+	fclose (fp);
+
+	return resident * sysconf (_SC_PAGESIZE);
+}
+
+static void
+metrics_dump_value (FILE *fp, const char *name, const char *type,
+		const char *help, double value)
+{
+	fprintf (fp, "# HELP %s %s\n# TYPE %s %s\n%s %.17g\n",
+			name, help, name, type, name, value);
+}
+
+void
+metrics_dump (FILE *fp)
+{
+	assert (fp != NULL);
+
+	struct rusage usage;
+	getrusage (RUSAGE_SELF, &usage);
+
+	metrics_dump_value (fp, "conga_generations_total", "counter",
+			"Generations stepped", LOAD (metrics.generations));
+	metrics_dump_value (fp, "conga_frames_total", "counter",
+			"Frames rendered", LOAD (metrics.frames));
+	metrics_dump_value (fp, "conga_population", "gauge",
+			"Live cells in the last generation stepped", LOAD (metrics.population));
+	metrics_dump_value (fp, "conga_event_queue_depth", "gauge",
+			"Events left in the queue after the last wait", LOAD (metrics.queue_depth));
+	metrics_dump_value (fp, "conga_resident_memory_bytes", "gauge",
+			"Resident set size", metrics_rss_bytes ());
+	metrics_dump_value (fp, "conga_peak_resident_memory_bytes", "gauge",
+			"Peak resident set size", usage.ru_maxrss * 1024.0);
+
+	for (int i = 0; i < METRICS_HISTOGRAMS; i++)
+		{
+			const char *name = histogram_info[i].name;
+			Histogram *h = &metrics.histograms[i];
+			uint64_t cumulative = 0;
+
+			fprintf (fp, "# HELP %s %s\n# TYPE %s histogram\n",
+					name, histogram_info[i].help, name);
+
+			for (int b = 0; b < BUCKETS - 1; b++)
+				{
+					cumulative += LOAD (h->buckets[b]);
+					fprintf (fp, "%s_bucket{le=\"%g\"} %lu\n",
+							name, bucket_bounds[b], (unsigned long) cumulative);
+				}
+
+			cumulative += LOAD (h->buckets[BUCKETS - 1]);
+			fprintf (fp, "%s_bucket{le=\"+Inf\"} %lu\n",
+					name, (unsigned long) cumulative);
+
+			// Count as the +Inf bucket, so the dump is self consistent
+			fprintf (fp, "%s_sum %.9f\n%s_count %lu\n",
+					name, LOAD (h->sum_ns) / 1e9,
+					name, (unsigned long) cumulative);
+		}
+
+	if (!LOAD (metrics.workers[0].seen))
+		return;
+
+	fprintf (fp, "# HELP conga_worker_busy_seconds_total Time each worker spent in tasks\n"
+			"# TYPE conga_worker_busy_seconds_total counter\n");
+
+	for (int i = 0; i < METRICS_WORKERS_MAX && LOAD (metrics.workers[i].seen); i++)
+		fprintf (fp, "conga_worker_busy_seconds_total{worker=\"%d\"} %.9f\n",
+				i, LOAD (metrics.workers[i].busy_ns) / 1e9);
+
+	fprintf (fp, "# HELP conga_worker_tasks_total Tasks each worker ran\n"
+			"# TYPE conga_worker_tasks_total counter\n");
+
+	for (int i = 0; i < METRICS_WORKERS_MAX && LOAD (metrics.workers[i].seen); i++)
+		fprintf (fp, "conga_worker_tasks_total{worker=\"%d\"} %lu\n",
+				i, (unsigned long) LOAD (metrics.workers[i].tasks));
+
+	fprintf (fp, "# HELP conga_worker_steals_total Tasks each worker took from another\n"
+			"# TYPE conga_worker_steals_total counter\n");
+
+	for (int i = 0; i < METRICS_WORKERS_MAX && LOAD (metrics.workers[i].seen); i++)
+		fprintf (fp, "conga_worker_steals_total{worker=\"%d\"} %lu\n",
+				i, (unsigned long) LOAD (metrics.workers[i].steals));
+}
+
+void
+metrics_write_file (const char *path)
+{
+	assert (path != NULL);
+
+	char *tmp = NULL;
+	xasprintf (&tmp, "%s.tmp", path);
+
+	// Readers such as node_exporter must never see a partial file
+	FILE *fp = xfopen (tmp, "w");
+	metrics_dump (fp);
+	xfclose (fp);
+
+	if (rename (tmp, path) < 0)
+		error (1, 1, "Could not rename '%s' to '%s'", tmp, path);
+
+	xfree (tmp);
+}
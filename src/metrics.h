@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdio.h>
+
+/*
+ * Process wide counters, gauges and histograms. Updates are
+ * relaxed atomics so they can be called from the hot paths
+ * of any thread; a dump is a consistent-enough snapshot.
+ */
+
+typedef enum
+{
+	METRICS_GENERATION = 0,
+	METRICS_RENDER,
+	METRICS_HISTOGRAMS
+} MetricsHistogram;
+
+#define METRICS_WORKERS_MAX 64
+
+void metrics_observe         (MetricsHistogram histogram, double secs);
+void metrics_add_generation  (long alive);
+void metrics_add_frame       (void);
+void metrics_set_queue_depth (int depth);
+void metrics_add_worker      (int worker, double busy, long tasks, long steals);
+void metrics_dump            (FILE *fp);
+void metrics_write_file      (const char *path);
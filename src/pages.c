@@ -0,0 +1,162 @@
+#include "pages.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <assert.h>
+#include "error.h"
+#include "parallel.h"
+
+#define MIB (1 << 20)
+
+typedef struct
+{
+	uint8_t *mem;
+	size_t   size;
+	size_t   len;
+} PagesTouch;
+
+static inline size_t
+pages_round (size_t size)
+{
+	return (size + PAGES_HUGE_SIZE - 1) & ~(PAGES_HUGE_SIZE - 1);
+}
+
+int
+pages_wanted (size_t size)
+{
+	return size >= PAGES_HUGE_SIZE;
+}
+
+/*
+ * Worker w zeroes the w-th share of the block, in whole huge pages,
+ * pinned where steal worker w runs. Worker 0 is the calling thread
+ * and is let go afterwards
+ */
+static void
+pages_touch (int worker, int num_workers, void *arg)
+{
+	PagesTouch *touch = arg;
+
+	parallel_pin (worker, num_workers);
+
+	size_t from = touch->size / num_workers * worker & ~(PAGES_HUGE_SIZE - 1);
+	size_t to = worker == num_workers - 1
+		? touch->len
+		: touch->size / num_workers * (worker + 1) & ~(PAGES_HUGE_SIZE - 1);
+
+	if (to > from)
+		memset (touch->mem + from, 0, to - from);
+
+	if (worker == 0 && num_workers > 1)
+		parallel_unpin ();
+}
+
+void *
+pages_alloc (size_t size, int bands)
+{
+	assert (size > 0);
+	assert (bands > 0);
+
+	size_t len = pages_round (size);
+
+	uint8_t *mem = mmap (NULL, len, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+	if (mem == MAP_FAILED)
+		{
+			// Without reserved pages: aligned on a huge page, so that
+			// the kernel can back all of it with them
+			size_t extra = len + PAGES_HUGE_SIZE;
+			uint8_t *raw = mmap (NULL, extra, PROT_READ | PROT_WRITE,
+					MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+			if (raw == MAP_FAILED)
+				error (1, 1, "Could not map %zu MiB", len / MIB);
+
+			mem = (uint8_t *) (((uintptr_t) raw + PAGES_HUGE_SIZE - 1)
+					& ~(PAGES_HUGE_SIZE - 1));
+
+			if (mem > raw)
+				munmap (raw, mem - raw);
+
+			munmap (mem + len, raw + extra - (mem + len));
+			madvise (mem, len, MADV_HUGEPAGE);
+		}
+
+	PagesTouch touch = {mem, size, len};
+
+	if (bands > 1)
+		parallel_run (bands, pages_touch, &touch);
+	else
+		pages_touch (0, 1, &touch);
+
+	return mem;
+}
+
+void
+pages_free (void *ptr, size_t size)
+{
+	if (ptr == NULL)
+		return;
+
+	munmap (ptr, pages_round (size));
+}
+
+// What the kernel says of the mappings within the block
+void
+pages_stats (const void *ptr, size_t size, PagesStats *stats)
+{
+	assert (ptr != NULL);
+	assert (stats != NULL);
+
+	uintptr_t from = (uintptr_t) ptr;
+	uintptr_t to = from + pages_round (size);
+
+	*stats = (PagesStats) {.size = pages_round (size)};
+
+	FILE *fp = fopen ("/proc/self/smaps", "r");
+
+	if (fp == NULL)
+		return;
+
+	char line[256];
+	int inside = 0;
+
+	while (fgets (line, sizeof (line), fp) != NULL)
+		{
+			unsigned long start, end, kb;
+
+			if (sscanf (line, "%lx-%lx ", &start, &end) == 2)
+				inside = start < to && end > from;
+			else if (!inside)
+				continue;
+			else if (sscanf (line, "AnonHugePages: %lu kB", &kb) == 1
+					|| sscanf (line, "Private_Hugetlb: %lu kB", &kb) == 1
+					|| sscanf (line, "Shared_Hugetlb: %lu kB", &kb) == 1)
+				stats->huge += kb << 10;
+			else if (sscanf (line, "KernelPageSize: %lu kB", &kb) == 1)
+				stats->hugetlb |= (kb << 10) >= PAGES_HUGE_SIZE;
+		}
+
+	fclose (fp);
+
+	// Neighbouring blocks may share a mapping
+	if (stats->huge > stats->size)
+		stats->huge = stats->size;
+}
+
+void
+pages_report (const void *ptr, size_t size, const char *what, FILE *fp)
+{
+	assert (what != NULL);
+	assert (fp != NULL);
+
+	PagesStats stats;
+	pages_stats (ptr, size, &stats);
+
+	fprintf (fp, "# %s: %.1f MiB, %.1f MiB in %s huge pages (%.0f%%)\n",
+			what, (double) stats.size / MIB, (double) stats.huge / MIB,
+			stats.hugetlb ? "hugetlbfs" : "transparent",
+			100.0 * stats.huge / stats.size);
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdio.h>
+#include <stddef.h>
+
+/*
+ * Memory for large grids, mapped on its own in 2 MiB huge pages:
+ * hugetlbfs pages if some are reserved, else transparent huge
+ * pages asked for with madvise. The pages are zeroed by bands
+ * workers, each one the same share of rows a stepper with as
+ * many threads would take and pinned to the same CPUs, so that
+ * the first touch places them on the node of the thread that
+ * will use them. Smaller blocks are left to malloc.
+ */
+
+#define PAGES_HUGE_SIZE (2UL << 20)
+
+typedef struct
+{
+	size_t size;
+	size_t huge;
+	int    hugetlb;
+} PagesStats;
+
+int    pages_wanted (size_t size);
+void * pages_alloc  (size_t size, int bands);
+void   pages_free   (void *ptr, size_t size);
+void   pages_stats  (const void *ptr, size_t size, PagesStats *stats);
+void   pages_report (const void *ptr, size_t size, const char *what, FILE *fp);
@@ -0,0 +1,138 @@
+#define _GNU_SOURCE
+
+#include "parallel.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+#include <assert.h>
+#include "wrapper.h"
+#include "error.h"
+#include "trace.h"
+
+typedef struct
+{
+	pthread_t     thread;
+	int           worker;
+	int           num_workers;
+	ParallelFunc  func;
+	void         *arg;
+} ParallelJob;
+
+static void *
+parallel_thread (void *data)
+{
+	ParallelJob *job = data;
+
+	TRACE_BEGIN ("worker");
+	job->func (job->worker, job->num_workers, job->arg);
+	TRACE_END ("worker");
+
+	return NULL;
+}
+
+// The CPUs the process may run on, before any thread is pinned
+static cpu_set_t      parallel_cpus;
+static int            parallel_cpus_len;
+static pthread_once_t parallel_cpus_once = PTHREAD_ONCE_INIT;
+
+static void
+parallel_cpus_init (void)
+{
+	if (sched_getaffinity (0, sizeof (cpu_set_t), &parallel_cpus) != 0)
+		CPU_ZERO (&parallel_cpus);
+
+	parallel_cpus_len = CPU_COUNT (&parallel_cpus);
+}
+
+int
+parallel_num_cpus (void)
+{
+	long n = sysconf (_SC_NPROCESSORS_ONLN);
+	return n > 0 ? n : 1;
+}
+
+void
+parallel_run (int num_workers, ParallelFunc func, void *arg)
+{
+	assert (num_workers > 0);
+	assert (func != NULL);
+
+	ParallelJob *jobs = xcalloc (num_workers, sizeof (ParallelJob));
+	int rc = 0;
+
+	for (int i = 0; i < num_workers; i++)
+		jobs[i] = (ParallelJob) {
+			.worker      = i,
+			.num_workers = num_workers,
+			.func        = func,
+			.arg         = arg
+		};
+
+	// Worker 0 runs on the calling thread
+	for (int i = 1; i < num_workers; i++)
+		if ((rc = pthread_create (&jobs[i].thread, NULL,
+						parallel_thread, &jobs[i])) != 0)
+			error (1, 0, "pthread_create failed: %s", strerror (rc));
+
+	parallel_thread (&jobs[0]);
+
+	for (int i = 1; i < num_workers; i++)
+		pthread_join (jobs[i].thread, NULL);
+
+	xfree (jobs);
+}
+
+/*
+ * Pins the calling thread to the band-th of bands contiguous
+ * shares of the CPUs, so that the thread that first touches a
+ * band of memory and the one that steps it later run on the
+ * same node. Only a hint: failures are ignored.
+ */
+void
+parallel_pin (int band, int bands)
+{
+	assert (bands > 0);
+	assert (band >= 0 && band < bands);
+
+	pthread_once (&parallel_cpus_once, parallel_cpus_init);
+
+	int n = parallel_cpus_len;
+
+	if (n < 2 || bands < 2)
+		return;
+
+	// More bands than CPUs share them
+	int from = (long) n * band / bands;
+	int to = (long) n * (band + 1) / bands;
+
+	if (to == from)
+		to = from + 1;
+
+	cpu_set_t set;
+	CPU_ZERO (&set);
+
+	for (int cpu = 0, k = 0; cpu < CPU_SETSIZE && k < to; cpu++)
+		if (CPU_ISSET (cpu, &parallel_cpus))
+			{
+				if (k >= from)
+					CPU_SET (cpu, &set);
+
+				k++;
+			}
+
+	pthread_setaffinity_np (pthread_self (), sizeof (cpu_set_t), &set);
+}
+
+void
+parallel_unpin (void)
+{
+	pthread_once (&parallel_cpus_once, parallel_cpus_init);
+
+	if (parallel_cpus_len < 2)
+		return;
+
+	pthread_setaffinity_np (pthread_self (), sizeof (cpu_set_t), &parallel_cpus);
+}
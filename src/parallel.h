@@ -0,0 +1,8 @@
+#pragma once
+
+typedef void (*ParallelFunc) (int worker, int num_workers, void *arg);
+
+int  parallel_num_cpus (void);
+void parallel_run      (int num_workers, ParallelFunc func, void *arg);
+void parallel_pin      (int band, int bands);
+void parallel_unpin    (void);
@@ -2,12 +2,15 @@
 
 #include <stdio.h>
 #include <ctype.h>
+#include <errno.h>
+#include <stdarg.h>
 #include <string.h>
 #include <assert.h>
 #include "wrapper.h"
 #include "error.h"
 #include "utils.h"
 #include "rule.h"
+#include "trace.h"
 
 #ifdef HAVE_PATTERN_DEFS_H
 #include "pattern_defs.h"
@@ -34,6 +37,36 @@ enum PatternTokenType
 	MISTERY = 271
 };
 
+/*
+ * Where parse errors go: NULL prints them with error, for the
+ * command line; otherwise the first one is kept in buf, for
+ * library callers that have no business writing to stderr
+ */
+typedef struct
+{
+	char   *buf;
+	size_t  len;
+} PatternDiag;
+
+static void pattern_diag (PatternDiag *diag, const char *format, ...)
+	__attribute__((format (printf, 2, 3)));
+
+static void
+pattern_diag (PatternDiag *diag, const char *format, ...)
+{
+	char msg[256];
+	va_list ap;
+
+	va_start (ap, format);
+	vsnprintf (msg, sizeof (msg), format, ap);
+	va_end (ap);
+
+	if (diag == NULL)
+		error (0, 0, "%s", msg);
+	else if (diag->len > 0 && diag->buf[0] == '\0')
+		snprintf (diag->buf, diag->len, "%s", msg);
+}
+
 static const PatternDef *
 pattern_get_def_from_alias (const char *alias)
 {
@@ -52,7 +85,7 @@ pattern_get_def_from_alias (const char *alias)
 }
 
 static int
-pattern_rle_lex (const char *rle, const char **pp, int *val)
+pattern_rle_lex (const char *rle, const char **pp, int *val, PatternDiag *diag)
 {
 	if (rle != NULL)
 		*pp = rle;
@@ -89,7 +122,7 @@ pattern_rle_lex (const char *rle, const char **pp, int *val)
 				case '\n' : case '\r': break;
 				default   :
 					{
-						error (0, 0, "Mistery character '%c'", c);
+						pattern_diag (diag, "Mistery character '%c'", c);
 						return MISTERY;
 					}
 				}
@@ -99,7 +132,7 @@ pattern_rle_lex (const char *rle, const char **pp, int *val)
 }
 
 static int
-pattern_rle_header_parse (Pattern *pattern, const char *h)
+pattern_rle_header_parse (Pattern *pattern, const char *h, PatternDiag *diag)
 {
 	int x = 0, y = 0;
 	char rule[64] = {0};
@@ -114,14 +147,14 @@ pattern_rle_header_parse (Pattern *pattern, const char *h)
 		}
 	else
 		{
-			error (0, 0, "Invalid header '%s'", h);
+			pattern_diag (diag, "Invalid header '%s'", h);
 			return 0;
 		}
 }
 
 static int
 pattern_rle_parse (Pattern *pattern, const char *rle,
-		int *rows, int *cols)
+		int *rows, int *cols, PatternDiag *diag)
 {
 	const char *p = NULL;
 	int val = 0;
@@ -131,8 +164,8 @@ pattern_rle_parse (Pattern *pattern, const char *rle,
 	int count = 1;
 	int rc = 1, break_all = 0;
 
-	for (int token = pattern_rle_lex (rle, &p, &val); token;
-			token = pattern_rle_lex (NULL, &p, &val))
+	for (int token = pattern_rle_lex (rle, &p, &val, diag); token;
+			token = pattern_rle_lex (NULL, &p, &val, diag))
 		{
 			switch (token)
 				{
@@ -172,7 +205,7 @@ pattern_rle_parse (Pattern *pattern, const char *rle,
 						{
 							if (count > 1)
 								{
-									error (0, 0, "Count '%d' misplaced", count);
+									pattern_diag (diag, "Count '%d' misplaced", count);
 									rc = 0;
 								}
 
@@ -181,7 +214,7 @@ pattern_rle_parse (Pattern *pattern, const char *rle,
 						}
 					case MISTERY:
 						{
-							error (0, 0, "What is that?");
+							pattern_diag (diag, "What is that?");
 							rc = 0;
 							break_all = 1;
 							break;
@@ -234,42 +267,40 @@ pattern_get_header_and_body (char *buf, const char **h, const char **b)
 	return 1;
 }
 
+// Parses the RLE text in buf, which is cut in place; what names it in errors
 static int
-pattern_parse_from_file (Pattern *pattern, const char *filename)
+pattern_parse_from_buf (Pattern *pattern, char *buf, const char *what,
+		PatternDiag *diag)
 {
 	const char *h = NULL, *b = NULL;
-	char *buf = NULL;
 	int rows = 0, cols = 0;
-	int rc = 0;
-
-	buf = file_slurp (filename);
 
 	// Get header
 	if (!pattern_get_header_and_body (buf, &h, &b))
 		{
-			error (0, 0, "Empty or truncated file '%s'", filename);
-			goto CLEAN;
+			pattern_diag (diag, "Empty or truncated %s", what);
+			return 0;
 		}
 
 	// Parse header
-	if (!pattern_rle_header_parse (pattern, h))
+	if (!pattern_rle_header_parse (pattern, h, diag))
 		{
-			error (0, 0, "Failed to parse header from '%s'", filename);
-			goto CLEAN;
+			pattern_diag (diag, "Failed to parse header from %s", what);
+			return 0;
 		}
 
 	// Parse rule
 	if (pattern->header.rule != NULL && !rule_is_valid (pattern->header.rule))
 		{
-			error (0, 0, "Invalid rule or alias '%s'", pattern->header.rule);
-			goto CLEAN;
+			pattern_diag (diag, "Invalid rule or alias '%s'", pattern->header.rule);
+			return 0;
 		}
 
 	// Parse and get grid dimensions
-	if (!pattern_rle_parse (NULL, b, &rows, &cols))
+	if (!pattern_rle_parse (NULL, b, &rows, &cols, diag))
 		{
-			error (0, 0, "Failed to parse RLE string from '%s'", filename);
-			goto CLEAN;
+			pattern_diag (diag, "Failed to parse RLE string from %s", what);
+			return 0;
 		}
 
 	if (rows < pattern->header.rows)
@@ -281,12 +312,22 @@ pattern_parse_from_file (Pattern *pattern, const char *filename)
 	pattern->grid = grid_new (rows, cols);
 
 	// Set the grid with the pattern
-	assert (pattern_rle_parse (pattern, b, NULL, NULL));
+	assert (pattern_rle_parse (pattern, b, NULL, NULL, diag));
 
-	// No error found
-	rc = 1;
+	return 1;
+}
 
-CLEAN:
+static int
+pattern_parse_from_file (Pattern *pattern, const char *filename)
+{
+	char *buf = file_slurp (filename);
+	char *what = NULL;
+
+	xasprintf (&what, "file '%s'", filename);
+
+	int rc = pattern_parse_from_buf (pattern, buf, what, NULL);
+
+	xfree (what);
 	xfree (buf);
 
 	return rc;
@@ -301,7 +342,7 @@ pattern_parse_from_def (Pattern *pattern, const PatternDef *def)
 
 	pattern->grid = grid_new (def->header.rows, def->header.cols);
 
-	return pattern_rle_parse (pattern, def->rle, NULL, NULL);
+	return pattern_rle_parse (pattern, def->rle, NULL, NULL, NULL);
 }
 
 Pattern *
@@ -313,6 +354,8 @@ pattern_new (const char *pattern_str)
 	const PatternDef *def = NULL;
 	int rc = 0;
 
+	TRACE_BEGIN ("pattern_new");
+
 	pattern = xcalloc (1, sizeof (Pattern));
 
 	if ((def = pattern_get_def_from_alias (pattern_str)) == NULL)
@@ -322,6 +365,118 @@ pattern_new (const char *pattern_str)
 
 	assert (rc);
 
+	TRACE_END ("pattern_new");
+
+	return pattern;
+}
+
+// The whole file, or NULL if it cannot be read
+static char *
+pattern_read (const char *filename, PatternDiag *diag)
+{
+	FILE *fp = fopen (filename, "r");
+	char *buf = NULL;
+	long size = -1;
+
+	if (fp == NULL)
+		{
+			pattern_diag (diag, "Could not open '%s': %s", filename, strerror (errno));
+			return NULL;
+		}
+
+	if (fseek (fp, 0L, SEEK_END) == 0 && (size = ftell (fp)) >= 0
+			&& fseek (fp, 0L, SEEK_SET) == 0)
+		{
+			buf = xmalloc (size + 1);
+
+			if (fread (buf, 1, size, fp) != (size_t) size)
+				{
+					xfree (buf);
+					buf = NULL;
+				}
+			else
+				buf[size] = '\0';
+		}
+
+	if (buf == NULL)
+		pattern_diag (diag, "Could not read '%s'", filename);
+
+	fclose (fp);
+
+	return buf;
+}
+
+static Pattern *
+pattern_new_from_buf (char *buf, const char *what, PatternDiag *diag)
+{
+	Pattern *pattern = xcalloc (1, sizeof (Pattern));
+
+	if (!pattern_parse_from_buf (pattern, buf, what, diag))
+		{
+			pattern_free (pattern);
+			return NULL;
+		}
+
+	return pattern;
+}
+
+/*
+ * Like pattern_new, for library callers: nothing is printed and
+ * nothing is fatal. NULL if pattern_str is neither an alias nor
+ * a readable pattern file, with why in err if not NULL
+ */
+Pattern *
+pattern_load (const char *pattern_str, char *err, size_t len)
+{
+	assert (pattern_str != NULL);
+	assert (err != NULL || len == 0);
+
+	PatternDiag diag = {err, len};
+	const PatternDef *def = NULL;
+
+	if (len > 0)
+		err[0] = '\0';
+
+	if ((def = pattern_get_def_from_alias (pattern_str)) != NULL)
+		{
+			Pattern *pattern = xcalloc (1, sizeof (Pattern));
+			pattern_parse_from_def (pattern, def);
+			return pattern;
+		}
+
+	char *buf = pattern_read (pattern_str, &diag);
+
+	if (buf == NULL)
+		return NULL;
+
+	char *what = NULL;
+	xasprintf (&what, "file '%s'", pattern_str);
+
+	Pattern *pattern = pattern_new_from_buf (buf, what, &diag);
+
+	xfree (what);
+	xfree (buf);
+
+	return pattern;
+}
+
+// NULL if rle is not a valid pattern, with why in err as pattern_load
+Pattern *
+pattern_new_from_rle (const char *rle, char *err, size_t len)
+{
+	assert (rle != NULL);
+	assert (err != NULL || len == 0);
+
+	PatternDiag diag = {err, len};
+	char *buf = xstrdup (rle);
+
+	if (len > 0)
+		err[0] = '\0';
+
+	Pattern *pattern = pattern_new_from_buf (buf, "RLE text", &diag);
+
+	xfree (buf);
+
 	return pattern;
 }
 
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stddef.h>
 #include "grid.h"
 
 typedef struct
@@ -26,6 +27,8 @@ typedef struct
 extern const PatternDef pattern_defs[];
 
 Pattern * pattern_new            (const char *pattern_str);
+Pattern * pattern_load           (const char *pattern_str, char *err, size_t len);
+Pattern * pattern_new_from_rle   (const char *rle, char *err, size_t len);
 int       pattern_file_is_valid  (const char *pattern_file);
 int       pattern_alias_is_valid (const char *pattern_alias);
 void      pattern_free           (Pattern *pattern);
@@ -0,0 +1,104 @@
+#include "perf.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+#include "wrapper.h"
+
+typedef struct
+{
+	double samples[PERF_WINDOW];
+	int    head;
+	int    len;
+	double sum;
+} PerfWindow;
+
+struct _Perf
+{
+	PerfWindow phases[PERF_PHASES];
+};
+
+const char *perf_phase_names[] =
+{
+	"Step",
+	"Render",
+	"Refresh",
+	"Idle",
+	NULL
+};
+
+Perf *
+perf_new (void)
+{
+	return xcalloc (1, sizeof (Perf));
+}
+
+void
+perf_free (Perf *perf)
+{
+	xfree (perf);
+}
+
+double
+perf_now (void)
+{
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void
+perf_add (Perf *perf, PerfPhase phase, double secs)
+{
+	assert (perf != NULL);
+	assert (phase >= 0 && phase < PERF_PHASES);
+
+	PerfWindow *w = &perf->phases[phase];
+
+	if (w->len == PERF_WINDOW)
+		w->sum -= w->samples[w->head];
+	else
+		w->len++;
+
+	w->samples[w->head] = secs;
+	w->sum += secs;
+	w->head = (w->head + 1) % PERF_WINDOW;
+}
+
+double
+perf_mean (const Perf *perf, PerfPhase phase)
+{
+	assert (perf != NULL);
+	assert (phase >= 0 && phase < PERF_PHASES);
+
+	const PerfWindow *w = &perf->phases[phase];
+	return w->len > 0 ? w->sum / w->len : 0.0;
+}
+
+static int
+perf_cmp (const void *a, const void *b)
+{
+	double x = *(const double *) a;
+	double y = *(const double *) b;
+	return (x > y) - (x < y);
+}
+
+double
+perf_p99 (const Perf *perf, PerfPhase phase)
+{
+	assert (perf != NULL);
+	assert (phase >= 0 && phase < PERF_PHASES);
+
+	const PerfWindow *w = &perf->phases[phase];
+	double sorted[PERF_WINDOW];
+
+	if (w->len == 0)
+		return 0.0;
+
+	memcpy (sorted, w->samples, sizeof (double) * w->len);
+	qsort (sorted, w->len, sizeof (double), perf_cmp);
+
+	return sorted[(w->len * 99 - 1) / 100];
+}
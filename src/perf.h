@@ -0,0 +1,28 @@
+#pragma once
+
+#define PERF_WINDOW 128
+
+/*
+ * Frame phase timings kept over a sliding window of the
+ * last PERF_WINDOW samples of each phase
+ */
+
+typedef enum
+{
+	PERF_STEP = 0,
+	PERF_RENDER,
+	PERF_REFRESH,
+	PERF_IDLE,
+	PERF_PHASES
+} PerfPhase;
+
+typedef struct _Perf Perf;
+
+extern const char *perf_phase_names[];
+
+Perf * perf_new  (void);
+double perf_now  (void);
+void   perf_add  (Perf *perf, PerfPhase phase, double secs);
+double perf_mean (const Perf *perf, PerfPhase phase);
+double perf_p99  (const Perf *perf, PerfPhase phase);
+void   perf_free (Perf *perf);
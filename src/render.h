@@ -1,19 +1,58 @@
 #pragma once
 
 #include "grid.h"
+#include "perf.h"
 
 typedef struct _Render Render;
 
 typedef struct
 {
-	int    alive;
-	int    gen;
-	double rate;
+	int         alive;
+	int         gen;
+	double      rate;
+
+	// Frame timings, render_draw adds its own phases
+	Perf       *perf;
+	int         show_perf;
+	const char *engine;
 } RenderStat;
 
-Render * render_new          (const char *title, int rows, int cols);
-void     render_draw         (Render *render, const Grid *grid, const RenderStat *stat);
-int      render_scroll       (Render *render, const Grid *grid, int dx, int dy);
-int      render_scale        (Render *render, const Grid *grid, int dx);
-void     render_force_resize (Render *render);
-void     render_free         (Render *render);
+/*
+ * Part of the grid on display. Each view cell covers a square
+ * of 2^scale grid cells, shaded from 0 (empty) to RENDER_SHADES
+ * (mostly alive).
+ */
+
+#define RENDER_SHADES 4
+
+typedef struct
+{
+	int row, col;
+	int rows, cols;
+	int scale;
+} RenderView;
+
+typedef struct
+{
+	const char *name;
+	void *      (*new)    (const char *title, int win_rows, int win_cols);
+	void        (*resize) (void *state, RenderView *view, int force);
+	void        (*clear)  (void *state);
+	void        (*cell)   (void *state, int row, int col, int shade);
+	void        (*frame)  (void *state, const RenderView *view,
+	                       const Grid *grid, const RenderStat *stat);
+	void        (*flush)  (void *state);
+	void        (*free)   (void *state);
+} RenderBackend;
+
+const RenderBackend * render_backend_get      (const char *name);
+int                   render_backend_is_valid (const char *name);
+
+Render * render_new           (const char *title, int rows, int cols);
+Render * render_new_backend   (const RenderBackend *backend, const char *title, int rows, int cols);
+void *   render_backend_state (const Render *render);
+void     render_draw          (Render *render, const Grid *grid, const RenderStat *stat);
+int      render_scroll        (Render *render, const Grid *grid, int dx, int dy);
+int      render_scale         (Render *render, const Grid *grid, int dx);
+void     render_force_resize  (Render *render);
+void     render_free          (Render *render);
@@ -0,0 +1,350 @@
+#include "render_ansi.h"
+
+#include <ncurses.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <errno.h>
+#include <assert.h>
+#include <math.h>
+#include "wrapper.h"
+#include "error.h"
+#include "screen.h"
+#include "trace.h"
+
+#define FRAME_ROWS      2
+#define CELL_COLS       2
+#define SHADE_UNKNOWN   0xff
+#define STATUS_MAX      512
+
+// Worst case for one cell: cursor jump, background color and two spaces
+#define CELL_BYTES_MAX  32
+
+// Background of each shade in the 256 color palette
+static const char *shade_colors[RENDER_SHADES + 1] =
+{
+	"\033[48;5;231m",
+	"\033[48;5;245m",
+	"\033[48;5;238m",
+	"\033[48;5;16m",
+	"\033[48;5;16m"
+};
+
+struct _RenderAnsi
+{
+	char          *title;
+	int            fd;
+
+	int            win_rows, win_cols;
+	int            term_rows, term_cols;
+	int            top, left;
+	int            rows, cols;
+
+	// Wanted and on screen shades of every view cell
+	unsigned char *cur;
+	unsigned char *prev;
+	int            full;
+
+	char           status[STATUS_MAX];
+	char           status_prev[STATUS_MAX];
+
+	char          *out;
+	size_t         out_len;
+	size_t         out_size;
+
+	int            cursor_row, cursor_col;
+	int            color;
+
+	long           frame_bytes;
+	long           total_bytes;
+	long           frames;
+};
+
+static void *
+render_ansi_new (const char *title, int win_rows, int win_cols)
+{
+	assert (title != NULL);
+
+	RenderAnsi *ansi = xcalloc (1, sizeof (RenderAnsi));
+
+	*ansi = (RenderAnsi) {
+		.title    = xstrdup (title),
+		.fd       = screen_fd (),
+		.win_rows = win_rows,
+		.win_cols = win_cols
+	};
+
+	return ansi;
+}
+
+static void
+render_ansi_free (void *state)
+{
+	RenderAnsi *ansi = state;
+
+	xfree (ansi->title);
+	xfree (ansi->cur);
+	xfree (ansi->prev);
+	xfree (ansi->out);
+	xfree (ansi);
+}
+
+void
+render_ansi_set_fd (RenderAnsi *ansi, int fd)
+{
+	assert (ansi != NULL);
+	assert (fd >= 0);
+
+	ansi->fd = fd;
+	ansi->full = 1;
+}
+
+long
+render_ansi_frame_bytes (const RenderAnsi *ansi)
+{
+	assert (ansi != NULL);
+	return ansi->frame_bytes;
+}
+
+double
+render_ansi_mean_bytes (const RenderAnsi *ansi)
+{
+	assert (ansi != NULL);
+	return ansi->frames > 0 ? (double) ansi->total_bytes / ansi->frames : 0.0;
+}
+
+static void
+render_ansi_resize (void *state, RenderView *view, int force)
+{
+	RenderAnsi *ansi = state;
+
+	if (stdscr != NULL)
+		{
+			if (force)
+				{
+					// Force ncurses to update terminal size info
+					// (workaround for SIGWINCH)
+					endwin ();
+				}
+
+			// Let ncurses flush its pending clear now, or its next
+			// getch would wipe out our frame
+			refresh ();
+			getmaxyx (stdscr, ansi->term_rows, ansi->term_cols);
+		}
+	else
+		{
+			ansi->term_rows = ansi->win_rows + FRAME_ROWS;
+			ansi->term_cols = ansi->win_cols * CELL_COLS;
+		}
+
+	ansi->rows = fmax (1, fmin (ansi->win_rows, ansi->term_rows - FRAME_ROWS));
+	ansi->cols = fmax (1, fmin (ansi->win_cols, ansi->term_cols / CELL_COLS));
+
+	ansi->top  = 1 + fmax (0, (ansi->term_rows - FRAME_ROWS - ansi->rows) / 2);
+	ansi->left = fmax (0, (ansi->term_cols - ansi->cols * CELL_COLS) / 2);
+
+	size_t cells = (size_t) ansi->rows * ansi->cols;
+
+	xfree (ansi->cur);
+	xfree (ansi->prev);
+	xfree (ansi->out);
+
+	ansi->cur  = xcalloc (cells, sizeof (unsigned char));
+	ansi->prev = xmalloc (cells);
+	ansi->out_size = cells * CELL_BYTES_MAX + ansi->term_cols + strlen (ansi->title) + 64;
+	ansi->out  = xmalloc (ansi->out_size);
+	ansi->full = 1;
+
+	view->rows = ansi->rows;
+	view->cols = ansi->cols;
+}
+
+static void
+render_ansi_clear (void *state)
+{
+	RenderAnsi *ansi = state;
+	memset (ansi->cur, 0, (size_t) ansi->rows * ansi->cols);
+}
+
+static void
+render_ansi_cell (void *state, int row, int col, int shade)
+{
+	RenderAnsi *ansi = state;
+	ansi->cur[(long) row * ansi->cols + col] = shade;
+}
+
+static void
+render_ansi_status (RenderAnsi *ansi, const char *fmt, ...)
+{
+	size_t len = strlen (ansi->status);
+
+	if (len >= STATUS_MAX - 1)
+		return;
+
+	va_list ap;
+	va_start (ap, fmt);
+	vsnprintf (ansi->status + len, STATUS_MAX - len, fmt, ap);
+	va_end (ap);
+}
+
+static void
+render_ansi_frame (void *state, const RenderView *view,
+		const Grid *grid, const RenderStat *stat)
+{
+	RenderAnsi *ansi = state;
+	int fac = exp2 (view->scale);
+
+	*ansi->status = '\0';
+
+	render_ansi_status (ansi, " [%d,%d] View:%dx%d Grid:%dx%d Alive:%u Gen:%u"
+			" Gen/s:%.2f Scale:1:%d Bytes:%ld",
+			view->row/fac, view->col/fac, view->rows, view->cols,
+			grid->rows, grid->cols, stat->alive, stat->gen,
+			stat->rate, fac, ansi->frame_bytes);
+
+	if (stat->show_perf && stat->perf != NULL)
+		{
+			for (int p = 0; p < PERF_PHASES; p++)
+				render_ansi_status (ansi, " %s:%.3fms", perf_phase_names[p],
+						perf_mean (stat->perf, p) * 1e3);
+
+			render_ansi_status (ansi, " Engine:%s",
+					stat->engine != NULL ? stat->engine : "-");
+		}
+}
+
+static inline void
+render_ansi_put (RenderAnsi *ansi, const char *fmt, ...)
+{
+	va_list ap;
+	va_start (ap, fmt);
+	ansi->out_len += vsnprintf (ansi->out + ansi->out_len,
+			ansi->out_size - ansi->out_len, fmt, ap);
+	va_end (ap);
+}
+
+static inline void
+render_ansi_puts (RenderAnsi *ansi, const char *str, size_t len)
+{
+	memcpy (ansi->out + ansi->out_len, str, len);
+	ansi->out_len += len;
+}
+
+static inline void
+render_ansi_move (RenderAnsi *ansi, int row, int col)
+{
+	if (row == ansi->cursor_row && col == ansi->cursor_col)
+		return;
+
+	// Forward on the same row is shorter as a relative move
+	if (row == ansi->cursor_row && col > ansi->cursor_col)
+		render_ansi_put (ansi, "\033[%dC", col - ansi->cursor_col);
+	else
+		render_ansi_put (ansi, "\033[%d;%dH", row + 1, col + 1);
+
+	ansi->cursor_row = row;
+	ansi->cursor_col = col;
+}
+
+static void
+render_ansi_write (RenderAnsi *ansi)
+{
+	const char *p = ansi->out;
+	size_t left = ansi->out_len;
+
+	while (left > 0)
+		{
+			ssize_t n = write (ansi->fd, p, left);
+
+			if (n < 0)
+				{
+					if (errno == EINTR)
+						continue;
+
+					error (1, 1, "Could not write to the terminal");
+				}
+
+			p += n;
+			left -= n;
+		}
+}
+
+static void
+render_ansi_flush (void *state)
+{
+	RenderAnsi *ansi = state;
+	int cells = ansi->rows * ansi->cols;
+
+	ansi->out_len = 0;
+
+	if (ansi->full)
+		{
+			memset (ansi->prev, SHADE_UNKNOWN, cells);
+			*ansi->status_prev = '\0';
+
+			render_ansi_put (ansi, "\033[0m\033[H\033[2J\033[1m %s\033[0m", ansi->title);
+
+			ansi->cursor_row = -1;
+			ansi->cursor_col = -1;
+			ansi->color = -1;
+			ansi->full = 0;
+		}
+
+	for (int i = 0; i < cells; i++)
+		{
+			int shade = ansi->cur[i];
+
+			if (shade == ansi->prev[i])
+				continue;
+
+			render_ansi_move (ansi, ansi->top + i / ansi->cols,
+					ansi->left + (i % ansi->cols) * CELL_COLS);
+
+			if (shade != ansi->color)
+				{
+					render_ansi_puts (ansi, shade_colors[shade], strlen (shade_colors[shade]));
+					ansi->color = shade;
+				}
+
+			render_ansi_puts (ansi, "  ", CELL_COLS);
+			ansi->cursor_col += CELL_COLS;
+			ansi->prev[i] = shade;
+		}
+
+	if (strcmp (ansi->status, ansi->status_prev) != 0)
+		{
+			// Short of the last column, so the terminal never scrolls
+			int width = ansi->term_cols - 1;
+
+			render_ansi_move (ansi, ansi->term_rows - 1, 0);
+			render_ansi_put (ansi, "\033[97;41m%-*.*s\033[0m",
+					width, width, ansi->status);
+
+			ansi->cursor_col += width;
+			ansi->color = -1;
+
+			memcpy (ansi->status_prev, ansi->status, STATUS_MAX);
+		}
+
+	TRACE_BEGIN ("write");
+	render_ansi_write (ansi);
+	TRACE_END ("write");
+
+	ansi->frame_bytes = ansi->out_len;
+	ansi->total_bytes += ansi->out_len;
+	ansi->frames++;
+}
+
+const RenderBackend render_ansi_backend =
+{
+	"ansi",
+	render_ansi_new,
+	render_ansi_resize,
+	render_ansi_clear,
+	render_ansi_cell,
+	render_ansi_frame,
+	render_ansi_flush,
+	render_ansi_free
+};
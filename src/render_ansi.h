@@ -0,0 +1,21 @@
+#pragma once
+
+#include "render.h"
+
+/*
+ * Renderer writing ANSI escape sequences straight to the
+ * terminal from its own screen buffer. Only the cells whose
+ * shade changed since the last frame are sent, the cursor is
+ * moved only across gaps, the background color is set only
+ * when the shade changes, and the whole frame goes out in a
+ * single write(). ncurses is still used for the terminal mode,
+ * the size and the input.
+ */
+
+typedef struct _RenderAnsi RenderAnsi;
+
+extern const RenderBackend render_ansi_backend;
+
+void   render_ansi_set_fd      (RenderAnsi *ansi, int fd);
+long   render_ansi_frame_bytes (const RenderAnsi *ansi);
+double render_ansi_mean_bytes  (const RenderAnsi *ansi);
@@ -0,0 +1,394 @@
+#include "render_curses.h"
+
+#include <ncurses.h>
+#include <assert.h>
+#include <math.h>
+#include "wrapper.h"
+#include "trace.h"
+
+#define WIN_FRAME_ROWS         2
+#define WIN_FRAME_COLS         3
+#define WIN_START_ROW          1
+#define WIN_START_COL          1
+#define HELP_BOX_COLS          33
+#define STATUS_BOX_MIN_COLS    35
+#define COLOR_LIGHT_GRAY       8
+#define COLOR_DARK_GRAY        9
+#define COLOR_PAIR_OUTER_BOX   1
+#define COLOR_PAIR_INNER_BOX   2
+#define COLOR_PAIR_STATUS_BOX  3
+#define COLOR_PAIR_CELL_00     4
+#define COLOR_PAIR_CELL_25     5
+#define COLOR_PAIR_CELL_50     6
+#define COLOR_PAIR_CELL_75     7
+#define PERF_BOX_ROW           14
+#define PERF_BOX_LINES         (PERF_PHASES + 3)
+
+#define WIN_TOTAL_ROWS(rows) ((rows) + WIN_FRAME_ROWS)
+#define WIN_TOTAL_COLS(cols) ((cols) * 2 + WIN_FRAME_COLS)
+
+#define WIN_GRID_ROWS(rows) ((rows) - WIN_FRAME_ROWS)
+#define WIN_GRID_COLS(cols) (((cols) - WIN_FRAME_COLS) / 2)
+
+typedef struct
+{
+	const char *title;
+
+	int         win_rows, win_cols;
+
+	WINDOW     *outer_box;
+	WINDOW     *inner_box;
+	WINDOW     *status_box;
+	WINDOW     *help_box;
+} RenderCurses;
+
+static void
+render_curses_init_colors (void)
+{
+	start_color ();
+
+	init_color (COLOR_RED,        700, 0,   0);
+	init_color (COLOR_LIGHT_GRAY, 500, 500, 500);
+	init_color (COLOR_DARK_GRAY,  250, 250, 250);
+
+	init_pair (COLOR_PAIR_OUTER_BOX,  COLOR_WHITE, COLOR_BLACK);
+	init_pair (COLOR_PAIR_INNER_BOX,  COLOR_BLACK, COLOR_WHITE);
+	init_pair (COLOR_PAIR_STATUS_BOX, COLOR_WHITE, COLOR_RED);
+	init_pair (COLOR_PAIR_CELL_00,    COLOR_BLACK, COLOR_WHITE);
+	init_pair (COLOR_PAIR_CELL_25,    COLOR_BLACK, COLOR_LIGHT_GRAY);
+	init_pair (COLOR_PAIR_CELL_50,    COLOR_BLACK, COLOR_DARK_GRAY);
+	init_pair (COLOR_PAIR_CELL_75,    COLOR_BLACK, COLOR_BLACK);
+}
+
+static void *
+render_curses_new (const char *title, int win_rows, int win_cols)
+{
+	render_curses_init_colors ();
+
+	RenderCurses *render = xcalloc (1, sizeof (RenderCurses));
+
+	*render = (RenderCurses) {
+		.title      = xstrdup (title),
+		.outer_box  = newwin (0, 0, 0, 0),
+		.inner_box  = newwin (0, 0, 0, 0),
+		.status_box = newwin (0, 0, 0, 0),
+		.help_box   = newwin (0, 0, 0, 0),
+		.win_rows   = win_rows,
+		.win_cols   = win_cols
+	};
+
+	wbkgd (render->outer_box,
+			COLOR_PAIR (COLOR_PAIR_OUTER_BOX));
+	wbkgd (render->inner_box,
+			COLOR_PAIR (COLOR_PAIR_INNER_BOX));
+	wbkgd (render->help_box,
+			COLOR_PAIR (COLOR_PAIR_OUTER_BOX));
+	wbkgd (render->status_box,
+			COLOR_PAIR (COLOR_PAIR_STATUS_BOX));
+
+	return render;
+}
+
+static void
+render_curses_free (void *state)
+{
+	RenderCurses *render = state;
+
+	delwin (render->outer_box);
+	delwin (render->inner_box);
+	delwin (render->help_box);
+	delwin (render->status_box);
+
+	xfree ((char *) render->title);
+	xfree (render);
+}
+
+static void
+render_curses_resize_viewport (RenderCurses *render, RenderView *view)
+{
+	int term_rows = 0;
+	int term_cols = 0;
+
+	getmaxyx (stdscr, term_rows, term_cols);
+
+	// Resize terminal
+	resizeterm (term_rows, term_cols);
+	clear ();
+
+	// Resize outer_box
+	wresize (render->outer_box, term_rows, term_cols);
+	wclear (render->outer_box);
+	box (render->outer_box, 0, 0);
+
+	// Place title
+	wmove (render->outer_box, 0, 2);
+	waddch (render->outer_box, ACS_URCORNER);
+	wattron (render->outer_box, A_BOLD);
+	wprintw (render->outer_box, "%s", render->title);
+	wattroff (render->outer_box, A_BOLD);
+	waddch (render->outer_box, ACS_ULCORNER);
+
+	// Get help box cols wih box
+	int help_cols = WIN_FRAME_COLS * 2 + HELP_BOX_COLS;
+
+	// Get inner_rows dimensions
+	int inner_rows = term_rows - (WIN_FRAME_ROWS * 2 + 1);
+	int inner_cols = term_cols - (WIN_FRAME_COLS * 2 + 2 + help_cols);
+	int total_rows = WIN_TOTAL_ROWS (render->win_rows);
+	int total_cols = WIN_TOTAL_COLS (render->win_cols);
+
+	// Set inner_box limits
+	if (total_rows < WIN_TOTAL_ROWS (1))
+		total_rows = WIN_TOTAL_ROWS (1);
+	else if (total_rows > inner_rows)
+		total_rows = inner_rows;
+
+	if (total_cols < WIN_TOTAL_COLS (1))
+		total_cols = WIN_TOTAL_COLS (1);
+	else if (total_cols > inner_cols)
+		total_cols = inner_cols;
+
+	view->rows = WIN_GRID_ROWS (total_rows);
+	view->cols = WIN_GRID_COLS (total_cols);
+
+	// Set inner_box position at the center
+	int inner_startx = (term_cols - (total_cols + help_cols + 1)) / 2;
+	int inner_starty = (term_rows - total_rows) / 2;
+
+	// Draw inner_box
+	wresize (render->inner_box, total_rows, total_cols);
+	wclear (render->inner_box);
+	box (render->inner_box, 0, 0);
+	mvwin (render->inner_box, inner_starty, inner_startx);
+
+	// Draw help_box
+	wresize (render->help_box, term_rows - (WIN_FRAME_ROWS * 2 + 1), help_cols);
+	wclear (render->help_box);
+	box (render->help_box, 0, 0);
+	mvwin (render->help_box, WIN_FRAME_ROWS, term_cols - (help_cols + WIN_FRAME_COLS));
+
+	// Draw status_box
+	wresize (render->status_box,
+			1, term_cols - 2 * WIN_FRAME_COLS);
+	wclear (render->status_box);
+	mvwin (render->status_box,
+			term_rows - WIN_FRAME_ROWS, WIN_FRAME_COLS);
+}
+
+static void
+render_curses_resize (void *state, RenderView *view, int force)
+{
+	if (force)
+		{
+			// Force ncurses to update terminal size info
+			// (workaround for SIGWINCH)
+			endwin();
+			refresh();
+		}
+
+	render_curses_resize_viewport (state, view);
+}
+
+static void
+render_curses_clear (void *state)
+{
+	RenderCurses *render = state;
+
+	wclear (render->inner_box);
+	box (render->inner_box, 0, 0);
+}
+
+static void
+render_curses_cell (void *state, int row, int col, int shade)
+{
+	RenderCurses *render = state;
+	int color_pair = COLOR_PAIR_CELL_00 + shade;
+
+	wattron  (render->inner_box, COLOR_PAIR (color_pair));
+
+	mvwaddch (render->inner_box,
+			row + WIN_START_ROW,
+			col * 2 + WIN_START_COL,
+			' ');
+
+	mvwaddch (render->inner_box,
+			row + WIN_START_ROW,
+			col * 2 + WIN_START_COL + 1,
+			' ');
+
+	wattroff (render->inner_box, COLOR_PAIR (color_pair));
+}
+
+static inline void
+render_curses_update_status (RenderCurses *render, const RenderView *view,
+		const Grid *grid, const RenderStat *stat)
+{
+	int cols = WIN_TOTAL_COLS (view->cols);
+	int fac = exp2 (view->scale);
+
+	// Clean windows
+	wmove (render->status_box, 0, 0);
+	for (int i = 0; i < cols; i++)
+		waddch (render->status_box, ' ');
+
+	wmove (render->status_box, 0, 0);
+	wprintw (render->status_box, "[%d,%d] ",
+			view->row/fac, view->col/fac);
+
+	if (cols > STATUS_BOX_MIN_COLS)
+		{
+			wattron (render->status_box, A_BOLD);
+			wprintw (render->status_box, "View:");
+			wattroff (render->status_box, A_BOLD);
+			wprintw (render->status_box, "%dx%d ",
+					view->rows, view->cols);
+
+			wattron (render->status_box, A_BOLD);
+			wprintw (render->status_box, "Grid:");
+			wattroff (render->status_box, A_BOLD);
+			wprintw (render->status_box, "%dx%d ",
+					grid->rows, grid->cols);
+		}
+
+	wattron (render->status_box, A_BOLD);
+	wprintw (render->status_box, "Alive:");
+	wattroff (render->status_box, A_BOLD);
+	wprintw (render->status_box, "%u ",
+			stat->alive);
+
+	wattron (render->status_box, A_BOLD);
+	wprintw (render->status_box, "Gen:");
+	wattroff (render->status_box, A_BOLD);
+	wprintw (render->status_box, "%u ",
+			stat->gen);
+
+	wattron (render->status_box, A_BOLD);
+	wprintw (render->status_box, "Gen/s:");
+	wattroff (render->status_box, A_BOLD);
+	wprintw (render->status_box, "%.2f ",
+			stat->rate);
+
+	wattron (render->status_box, A_BOLD);
+	wprintw (render->status_box, "Scale:");
+	wattroff (render->status_box, A_BOLD);
+	wprintw (render->status_box, "1:%d ", fac);
+}
+
+static inline void
+render_curses_update_help_box (RenderCurses *render)
+{
+	// Título do help box
+	wattron(render->help_box, A_BOLD | COLOR_PAIR(4));
+	mvwprintw(render->help_box, 0, 2, " Help ");
+	wattroff(render->help_box, A_BOLD | COLOR_PAIR(4));
+
+	wattron(render->help_box, COLOR_PAIR(2));
+
+	// Conteúdo
+	mvwprintw(render->help_box, 1, 1, " Arrows: Move view");
+	mvwprintw(render->help_box, 2, 1, " Space : Pause/Run");
+	mvwprintw(render->help_box, 3, 1, " Q     : Quit");
+	mvwprintw(render->help_box, 4, 1, " b/NJ  : Back/Seek gen N");
+	mvwprintw(render->help_box, 5, 1, " p     : Perf overlay");
+
+	// Mostrando setas de forma gráfica (usando ACS ou unicode)
+	// Exemplo: usando ACS_CKBOARD para seta vertical
+	mvwprintw(render->help_box, 6, 1, " Arrows:");
+	mvwaddch(render->help_box, 7, 4, ACS_UARROW); // ↑
+	mvwprintw(render->help_box, 7, 6, " Up");
+
+	mvwaddch(render->help_box, 8, 4, ACS_DARROW); // ↓
+	mvwprintw(render->help_box, 8, 6, " Down");
+
+	mvwaddch(render->help_box, 9, 4, ACS_LARROW); // ←
+	mvwprintw(render->help_box, 9, 6, " Left");
+
+	mvwaddch(render->help_box, 10, 4, ACS_RARROW); // →
+	mvwprintw(render->help_box, 10, 6, " Right");
+
+	// Status do jogo (running / paused) – Exemplo dinâmico
+	// Suponha que você tenha uma variável global "paused"
+	mvwprintw(render->help_box, 12, 1, " State: ");
+	if (0) {
+		wattron(render->help_box, A_BOLD | COLOR_PAIR(3)); // Vermelho para pausado
+		wprintw(render->help_box, "Paused ");
+		wattroff(render->help_box, A_BOLD | COLOR_PAIR(3));
+	} else {
+		wattron(render->help_box, A_BOLD | COLOR_PAIR(1)); // Normal (running)
+		wprintw(render->help_box, "Running");
+		wattroff(render->help_box, A_BOLD | COLOR_PAIR(1));
+	}
+
+	wattroff(render->help_box, COLOR_PAIR(2));
+}
+
+static inline void
+render_curses_update_perf (RenderCurses *render, const Grid *grid,
+		const RenderStat *stat)
+{
+	int row = PERF_BOX_ROW;
+
+	// Blank the overlay lines so it can be hidden again
+	for (int i = 0; i < PERF_BOX_LINES; i++)
+		mvwprintw (render->help_box, row + i, 1, "%-*s", HELP_BOX_COLS, "");
+
+	if (!stat->show_perf || stat->perf == NULL)
+		return;
+
+	wattron (render->help_box, A_BOLD);
+	mvwprintw (render->help_box, row++, 1, " Perf    mean / p99 (ms)");
+	wattroff (render->help_box, A_BOLD);
+
+	for (int p = 0; p < PERF_PHASES; p++)
+		mvwprintw (render->help_box, row++, 1, " %-7s %7.3f / %7.3f",
+				perf_phase_names[p],
+				perf_mean (stat->perf, p) * 1e3,
+				perf_p99 (stat->perf, p) * 1e3);
+
+	double step = perf_mean (stat->perf, PERF_STEP);
+
+	mvwprintw (render->help_box, row++, 1, " Cells/s %.3e",
+			step > 0 ? (double) grid->rows * grid->cols / step : 0.0);
+
+	mvwprintw (render->help_box, row++, 1, " Engine  %s",
+			stat->engine != NULL ? stat->engine : "-");
+}
+
+static void
+render_curses_frame (void *state, const RenderView *view,
+		const Grid *grid, const RenderStat *stat)
+{
+	RenderCurses *render = state;
+
+	render_curses_update_status   (render, view, grid, stat);
+	render_curses_update_help_box (render);
+	render_curses_update_perf     (render, grid, stat);
+}
+
+static void
+render_curses_flush (void *state)
+{
+	RenderCurses *render = state;
+
+	TRACE_BEGIN ("wrefresh");
+
+	refresh  ();
+	wrefresh (render->outer_box);
+	wrefresh (render->inner_box);
+	wrefresh (render->help_box);
+	wrefresh (render->status_box);
+
+	TRACE_END ("wrefresh");
+}
+
+const RenderBackend render_curses_backend =
+{
+	"curses",
+	render_curses_new,
+	render_curses_resize,
+	render_curses_clear,
+	render_curses_cell,
+	render_curses_frame,
+	render_curses_flush,
+	render_curses_free
+};
@@ -0,0 +1,5 @@
+#pragma once
+
+#include "render.h"
+
+extern const RenderBackend render_curses_backend;
@@ -0,0 +1,78 @@
+#include "render_fb.h"
+
+#include <string.h>
+#include <assert.h>
+#include "wrapper.h"
+
+static void *
+render_fb_new (const char *title, int win_rows, int win_cols)
+{
+	assert (win_rows > 0 && win_cols > 0);
+
+	RenderFb *fb = xcalloc (1, sizeof (RenderFb));
+
+	*fb = (RenderFb) {
+		.rows   = win_rows,
+		.cols   = win_cols,
+		.shades = xcalloc ((size_t) win_rows * win_cols, sizeof (unsigned char))
+	};
+
+	return fb;
+}
+
+static void
+render_fb_free (void *state)
+{
+	RenderFb *fb = state;
+
+	xfree (fb->shades);
+	xfree (fb);
+}
+
+static void
+render_fb_resize (void *state, RenderView *view, int force)
+{
+	RenderFb *fb = state;
+
+	view->rows = fb->rows;
+	view->cols = fb->cols;
+}
+
+static void
+render_fb_clear (void *state)
+{
+	RenderFb *fb = state;
+	memset (fb->shades, 0, (size_t) fb->rows * fb->cols);
+}
+
+static void
+render_fb_cell (void *state, int row, int col, int shade)
+{
+	RenderFb *fb = state;
+	fb->shades[(long) row * fb->cols + col] = shade;
+}
+
+static void
+render_fb_frame (void *state, const RenderView *view,
+		const Grid *grid, const RenderStat *stat)
+{
+}
+
+static void
+render_fb_flush (void *state)
+{
+	RenderFb *fb = state;
+	fb->frames++;
+}
+
+const RenderBackend render_fb_backend =
+{
+	"framebuffer",
+	render_fb_new,
+	render_fb_resize,
+	render_fb_clear,
+	render_fb_cell,
+	render_fb_frame,
+	render_fb_flush,
+	render_fb_free
+};
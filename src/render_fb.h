@@ -0,0 +1,18 @@
+#pragma once
+
+#include "render.h"
+
+/*
+ * In-memory framebuffer with one shade per view cell, row
+ * major. The view is the size asked to render_new_backend.
+ */
+
+typedef struct
+{
+	int           rows;
+	int           cols;
+	unsigned char *shades;
+	long          frames;
+} RenderFb;
+
+extern const RenderBackend render_fb_backend;
@@ -1,14 +1,20 @@
 #include "screen.h"
 
 #include <ncurses.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
 #include "error.h"
 
+#define OFFSCREEN_TERM "xterm-256color"
+
 static int ncurses_started = 0;
+static int screen_out_fd   = STDOUT_FILENO;
 
-void
-screen_init (void)
+
+static void
+screen_setup (void)
 {
-	initscr  ();
 	cbreak   ();
 	noecho   ();
 	curs_set (0);
@@ -24,9 +30,48 @@ screen_init (void)
 	ncurses_started = 1;
 }
 
+void
+screen_init (void)
+{
+	initscr ();
+	screen_setup ();
+}
+
+void
+screen_init_offscreen (void)
+{
+	// Size comes from $LINES and $COLUMNS, or the terminfo default
+	const char *term = getenv ("TERM");
+
+	FILE *out = fopen ("/dev/null", "w");
+	FILE *in  = fopen ("/dev/null", "r");
+
+	if (out == NULL || in == NULL)
+		error (1, 1, "Could not open /dev/null");
+
+	// Lives until the process exits, as stdscr does
+	SCREEN *screen = newterm (term != NULL ? term : OFFSCREEN_TERM, out, in);
+
+	if (screen == NULL)
+		error (1, 0, "Could not start an offscreen terminal");
+
+	set_term (screen);
+	screen_setup ();
+
+	screen_out_fd = fileno (out);
+}
+
+int
+screen_fd (void)
+{
+	return screen_out_fd;
+}
+
 void
 screen_finish (void)
 {
 	if (ncurses_started)
 		endwin ();
+
+	ncurses_started = 0;
 }
@@ -1,4 +1,6 @@
 #pragma once
 
-void screen_init   (void);
-void screen_finish (void);
+void screen_init           (void);
+void screen_init_offscreen (void);
+int  screen_fd             (void);
+void screen_finish         (void);
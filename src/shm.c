@@ -0,0 +1,212 @@
+#include "shm.h"
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <assert.h>
+#include "wrapper.h"
+#include "error.h"
+
+#define SHM_ALIGN 64
+
+#define ALIGN_UP(x,a) (((x) + (a) - 1) / (a) * (a))
+
+struct _ShmGrid
+{
+	char       *name;
+	ShmHeader  *header;
+	size_t      size;
+	int         owner;
+};
+
+int
+shm_name_is_valid (const char *name)
+{
+	// One leading slash and no other, as portable shm_open wants
+	return name != NULL
+		&& name[0] == '/'
+		&& name[1] != '\0'
+		&& strchr (name + 1, '/') == NULL
+		&& strlen (name) < 256;
+}
+
+static ShmGrid *
+shm_grid_map (const char *name, int fd, size_t size, int owner)
+{
+	void *addr = mmap (NULL, size, owner ? PROT_READ | PROT_WRITE : PROT_READ,
+			MAP_SHARED, fd, 0);
+
+	if (addr == MAP_FAILED)
+		error (1, 1, "Could not map shared memory '%s'", name);
+
+	close (fd);
+
+	ShmGrid *shm = xcalloc (1, sizeof (ShmGrid));
+
+	*shm = (ShmGrid) {
+		.name   = xstrdup (name),
+		.header = addr,
+		.size   = size,
+		.owner  = owner
+	};
+
+	return shm;
+}
+
+ShmGrid *
+shm_grid_new (const char *name, int rows, int cols)
+{
+	assert (shm_name_is_valid (name));
+	assert (rows > 0 && cols > 0);
+
+	size_t cells  = (size_t) rows * cols * sizeof (int);
+	size_t offset = ALIGN_UP (sizeof (ShmHeader), SHM_ALIGN);
+	size_t size   = offset + 2 * ALIGN_UP (cells, SHM_ALIGN);
+
+	// A segment left behind by a crashed run is replaced
+	int fd = shm_open (name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+	if (fd < 0)
+		error (1, 1, "Could not create shared memory '%s'", name);
+
+	if (ftruncate (fd, size) < 0)
+		error (1, 1, "Could not resize shared memory '%s'", name);
+
+	ShmGrid *shm = shm_grid_map (name, fd, size, 1);
+
+	*shm->header = (ShmHeader) {
+		.version     = SHM_VERSION,
+		.cell_size   = sizeof (int),
+		.rows        = rows,
+		.cols        = cols,
+		.gen         = -1,
+		.data_offset = {offset, offset + ALIGN_UP (cells, SHM_ALIGN)}
+	};
+
+	memcpy (shm->header->magic, SHM_MAGIC, sizeof (shm->header->magic));
+
+	return shm;
+}
+
+ShmGrid *
+shm_grid_open (const char *name)
+{
+	assert (name != NULL);
+
+	struct stat st;
+	int fd = shm_open (name, O_RDONLY, 0);
+
+	if (fd < 0)
+		error (1, 1, "Could not open shared memory '%s'", name);
+
+	if (fstat (fd, &st) < 0 || (size_t) st.st_size < sizeof (ShmHeader))
+		error (1, 0, "Shared memory '%s' is too small", name);
+
+	ShmGrid *shm = shm_grid_map (name, fd, st.st_size, 0);
+	const ShmHeader *h = shm->header;
+
+	if (memcmp (h->magic, SHM_MAGIC, sizeof (h->magic)) != 0
+			|| h->version != SHM_VERSION
+			|| h->cell_size != sizeof (int)
+			|| h->data_offset[1] + (size_t) h->rows * h->cols * sizeof (int) > shm->size)
+		error (1, 0, "Shared memory '%s' is not a conga grid", name);
+
+	return shm;
+}
+
+void
+shm_grid_free (ShmGrid *shm)
+{
+	if (shm == NULL)
+		return;
+
+	munmap (shm->header, shm->size);
+
+	// Viewers keep their mapping, new ones can no longer attach
+	if (shm->owner)
+		shm_unlink (shm->name);
+
+	xfree (shm->name);
+	xfree (shm);
+}
+
+int *
+shm_grid_data (ShmGrid *shm, int index)
+{
+	assert (shm != NULL && shm->owner);
+	assert (index == 0 || index == 1);
+
+	return (int *) ((char *) shm->header + shm->header->data_offset[index]);
+}
+
+/*
+ * Called before the current buffer is changed in place, the
+ * next shm_grid_publish ends it
+ */
+void
+shm_grid_begin (ShmGrid *shm)
+{
+	assert (shm != NULL && shm->owner);
+
+	uint64_t seq = __atomic_load_n (&shm->header->seq, __ATOMIC_RELAXED);
+
+	if (seq & 1)
+		return;
+
+	__atomic_store_n (&shm->header->seq, seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence (__ATOMIC_RELEASE);
+}
+
+void
+shm_grid_publish (ShmGrid *shm, const int *data, int gen)
+{
+	assert (shm != NULL && shm->owner);
+	assert (data == shm_grid_data (shm, 0) || data == shm_grid_data (shm, 1));
+
+	ShmHeader *h = shm->header;
+
+	shm_grid_begin (shm);
+
+	__atomic_store_n (&h->current, data == shm_grid_data (shm, 1), __ATOMIC_RELAXED);
+	__atomic_store_n (&h->gen, gen, __ATOMIC_RELAXED);
+
+	uint64_t seq = __atomic_load_n (&h->seq, __ATOMIC_RELAXED);
+	__atomic_store_n (&h->seq, seq + 1, __ATOMIC_RELEASE);
+}
+
+long
+shm_grid_read (const ShmGrid *shm, Grid *grid)
+{
+	assert (shm != NULL);
+	assert (grid != NULL);
+
+	const ShmHeader *h = shm->header;
+	size_t len = (size_t) grid->rows * grid->cols * sizeof (int);
+
+	assert (grid->rows == h->rows && grid->cols == h->cols);
+
+	for (;;)
+		{
+			uint64_t seq = __atomic_load_n (&h->seq, __ATOMIC_ACQUIRE);
+
+			if (seq & 1)
+				{
+					sched_yield ();
+					continue;
+				}
+
+			int64_t gen = __atomic_load_n (&h->gen, __ATOMIC_RELAXED);
+			uint32_t current = __atomic_load_n (&h->current, __ATOMIC_RELAXED);
+			const char *data = (const char *) h + h->data_offset[current & 1];
+
+			memcpy (grid->data, data, len);
+
+			__atomic_thread_fence (__ATOMIC_ACQUIRE);
+
+			if (__atomic_load_n (&h->seq, __ATOMIC_RELAXED) == seq)
+				return gen;
+		}
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdint.h>
+#include "grid.h"
+
+/*
+ * Both generation buffers placed in a named POSIX shared memory
+ * segment, so local viewers can map it read-only and follow the
+ * run without copies or messages. The segment starts with a
+ * ShmHeader; cells are native ints, one per cell, row major, at
+ * data_offset[current] for the generation gen.
+ *
+ * The header is guarded by a seqlock: seq is odd while it or
+ * the current buffer is being changed. A reader loads seq, and
+ * if even reads current, gen and the cells, then loads seq
+ * again and retries if it changed. The other buffer is written
+ * freely while the next generation is computed.
+ */
+
+#define SHM_MAGIC   "CONGASHM"
+#define SHM_VERSION 1
+
+typedef struct
+{
+	char     magic[8];
+	uint32_t version;
+	uint32_t cell_size;
+	int32_t  rows;
+	int32_t  cols;
+	uint64_t seq;
+	int64_t  gen;
+	uint32_t current;
+	uint32_t reserved;
+	uint64_t data_offset[2];
+} ShmHeader;
+
+typedef struct _ShmGrid ShmGrid;
+
+ShmGrid * shm_grid_new       (const char *name, int rows, int cols);
+ShmGrid * shm_grid_open      (const char *name);
+int *     shm_grid_data      (ShmGrid *shm, int index);
+void      shm_grid_begin     (ShmGrid *shm);
+void      shm_grid_publish   (ShmGrid *shm, const int *data, int gen);
+long      shm_grid_read      (const ShmGrid *shm, Grid *grid);
+int       shm_name_is_valid  (const char *name);
+void      shm_grid_free      (ShmGrid *shm);
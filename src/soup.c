@@ -0,0 +1,741 @@
+#include "soup.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+#include "wrapper.h"
+#include "grid.h"
+#include "cell.h"
+#include "rule.h"
+#include "rand.h"
+#include "bitgrid.h"
+#include "parallel.h"
+
+#define SOUP_BOARD_FAC    4
+#define SOUP_BOARD_MIN    64
+#define SOUP_MAX_GENS     20000
+#define SOUP_CHECK_EVERY  60
+#define SOUP_WINDOW       (3 * SOUP_MAX_PERIOD)
+#define SOUP_PAD          (SOUP_MAX_PERIOD + 2)
+#define SOUP_OBJECT_MAX   2048
+#define CENSUS_MIN        256
+#define KEY_COLS          (1 << 16)
+
+#define FNV_OFFSET 0xcbf29ce484222325ULL
+#define FNV_PRIME  0x100000001b3ULL
+
+typedef enum
+{
+	OBJECT_STILL_LIFE = 0,
+	OBJECT_OSCILLATOR,
+	OBJECT_SPACESHIP,
+	OBJECT_UNKNOWN,
+	OBJECT_MESS
+} ObjectClass;
+
+static const char *object_prefix[] = {"xs", "xp", "xq", "zz", "zz"};
+static const char *object_name[]   = {"still", "oscillator", "spaceship", "unknown", "mess"};
+
+typedef struct
+{
+	uint64_t     hash;
+	ObjectClass  class;
+	int          period;
+	int          population;
+	long         count;
+} CensusEntry;
+
+typedef struct
+{
+	CensusEntry *entries;
+	int          size;
+	int          len;
+} Census;
+
+typedef struct
+{
+	Soup     *soup;
+
+	Grid     *soup_grid;
+	Grid     *board;
+	BitGrid  *cur;
+	BitGrid  *next;
+
+	long     *pops;
+
+	// Object separation and classification scratch
+	int      *visited;
+	int      *queue;
+	int      *ys;
+	int      *xs;
+	int      *keys;
+	int      *sym;
+
+	Census    census;
+	long      gens;
+} SoupWorker;
+
+struct _Soup
+{
+	const char *rule_name;
+	BitRule     rule;
+
+	long        seed;
+	float       live_percent;
+
+	int         num_soups;
+	int         soup_size;
+	int         board_size;
+	int         threads;
+
+	long        next_soup;
+	long        gens;
+
+	Census     *worker_census;
+	Census      census;
+
+	double      elapsed;
+};
+
+static void
+census_init (Census *census)
+{
+	*census = (Census) {
+		.entries = xcalloc (CENSUS_MIN, sizeof (CensusEntry)),
+		.size    = CENSUS_MIN,
+		.len     = 0
+	};
+}
+
+static void
+census_destroy (Census *census)
+{
+	xfree (census->entries);
+	*census = (Census) {0};
+}
+
+static inline uint64_t
+census_key (uint64_t hash, ObjectClass class, int period)
+{
+	return hash ^ ((uint64_t) class << 56) ^ ((uint64_t) period * FNV_PRIME);
+}
+
+static void census_add (Census *census, const CensusEntry *entry);
+
+static void
+census_grow (Census *census)
+{
+	Census bigger = {
+		.entries = xcalloc (census->size * 2, sizeof (CensusEntry)),
+		.size    = census->size * 2,
+		.len     = 0
+	};
+
+	for (int i = 0; i < census->size; i++)
+		if (census->entries[i].count > 0)
+			census_add (&bigger, &census->entries[i]);
+
+	census_destroy (census);
+	*census = bigger;
+}
+
+static void
+census_add (Census *census, const CensusEntry *entry)
+{
+	if (2 * (census->len + 1) > census->size)
+		census_grow (census);
+
+	uint64_t key = census_key (entry->hash, entry->class, entry->period);
+	int i = key & (census->size - 1);
+
+	// Linear probing
+	for (;; i = (i + 1) & (census->size - 1))
+		{
+			CensusEntry *e = &census->entries[i];
+
+			if (e->count == 0)
+				{
+					*e = *entry;
+					census->len++;
+					return;
+				}
+
+			if (e->hash == entry->hash && e->class == entry->class
+					&& e->period == entry->period)
+				{
+					e->count += entry->count;
+					if (entry->population < e->population)
+						e->population = entry->population;
+					return;
+				}
+		}
+}
+
+// Counts of the same object add up
+static void
+census_merge (Census *census, const Census *other)
+{
+	for (int i = 0; i < other->size; i++)
+		if (other->entries[i].count > 0)
+			census_add (census, &other->entries[i]);
+}
+
+static int
+census_cmp (const void *a, const void *b)
+{
+	const CensusEntry *ea = a, *eb = b;
+
+	if (ea->count != eb->count)
+		return ea->count < eb->count ? 1 : -1;
+
+	if (ea->class != eb->class)
+		return ea->class - eb->class;
+
+	return ea->population - eb->population;
+}
+
+static int
+int_cmp (const void *a, const void *b)
+{
+	int x = * (const int *) a, y = * (const int *) b;
+	return (x > y) - (x < y);
+}
+
+/*
+ * Hash of a set of cells invariant to translation,
+ * rotation and reflection: the smallest hash among
+ * the 8 symmetries, each normalised to its bounding
+ * box and sorted
+ */
+static uint64_t
+soup_canonical_hash (SoupWorker *w, const int *ys, const int *xs, int n)
+{
+	uint64_t best = UINT64_MAX;
+
+	for (int s = 0; s < 8; s++)
+		{
+			int min_y = KEY_COLS, min_x = KEY_COLS;
+
+			for (int k = 0; k < n; k++)
+				{
+					int y = s & 4 ? xs[k] : ys[k];
+					int x = s & 4 ? ys[k] : xs[k];
+
+					y = s & 1 ? -y : y;
+					x = s & 2 ? -x : x;
+
+					w->sym[2 * k]     = y;
+					w->sym[2 * k + 1] = x;
+
+					if (y < min_y) min_y = y;
+					if (x < min_x) min_x = x;
+				}
+
+			for (int k = 0; k < n; k++)
+				w->keys[k] = (w->sym[2 * k] - min_y) * KEY_COLS
+					+ (w->sym[2 * k + 1] - min_x);
+
+			qsort (w->keys, n, sizeof (int), int_cmp);
+
+			uint64_t hash = FNV_OFFSET;
+			for (int k = 0; k < n; k++)
+				{
+					hash ^= (uint64_t) w->keys[k];
+					hash *= FNV_PRIME;
+				}
+
+			if (hash < best)
+				best = hash;
+		}
+
+	return best;
+}
+
+/*
+ * Live cells of a grid as coordinates relative to their
+ * bounding box, in row-major order, so two phases can be
+ * compared with memcmp. Returns the number of cells
+ */
+static int
+soup_normalise (const BitGrid *grid, int *ys, int *xs, int max,
+		int *min_y, int *min_x)
+{
+	int n = 0;
+
+	*min_y = grid->rows;
+	*min_x = grid->cols;
+
+	for (int i = 0; i < grid->rows; i++)
+		for (int j = 0; j < grid->cols; j++)
+			if (BITGRID_GET (grid, i, j))
+				{
+					if (n == max)
+						return max + 1;
+
+					ys[n] = i;
+					xs[n] = j;
+					n++;
+
+					if (i < *min_y) *min_y = i;
+					if (j < *min_x) *min_x = j;
+				}
+
+	for (int k = 0; k < n; k++)
+		{
+			ys[k] -= *min_y;
+			xs[k] -= *min_x;
+		}
+
+	return n;
+}
+
+/*
+ * Run a single object on its own padded torus until
+ * it repeats its shape, and record it in the census
+ */
+static void
+soup_classify (SoupWorker *w, const int *ys, const int *xs, int n)
+{
+	CensusEntry entry = {
+		.class      = OBJECT_UNKNOWN,
+		.period     = 0,
+		.population = n,
+		.count      = 1
+	};
+
+	int max_y = 0, max_x = 0;
+	for (int k = 0; k < n; k++)
+		{
+			if (ys[k] > max_y) max_y = ys[k];
+			if (xs[k] > max_x) max_x = xs[k];
+		}
+
+	BitGrid *cur  = bitgrid_new (max_y + 1 + 2 * SOUP_PAD, max_x + 1 + 2 * SOUP_PAD);
+	BitGrid *next = bitgrid_new (cur->rows, cur->cols);
+
+	for (int k = 0; k < n; k++)
+		BITGRID_SET (cur, SOUP_PAD + ys[k], SOUP_PAD + xs[k], 1);
+
+	// ys and xs may be the worker scratch itself: from here on
+	// the first half holds the current phase, the second half
+	// the initial one
+	int *ys0 = w->ys + SOUP_OBJECT_MAX, *xs0 = w->xs + SOUP_OBJECT_MAX;
+	int y0, x0, yp, xp;
+	int n0 = soup_normalise (cur, ys0, xs0, SOUP_OBJECT_MAX, &y0, &x0);
+
+	uint64_t hash = soup_canonical_hash (w, ys0, xs0, n0);
+
+	for (int p = 1; p <= SOUP_MAX_PERIOD; p++)
+		{
+			bitgrid_step (next, cur, &w->soup->rule);
+
+			BitGrid *tmp = cur;
+			cur = next;
+			next = tmp;
+
+			int np = soup_normalise (cur, w->ys, w->xs, SOUP_OBJECT_MAX, &yp, &xp);
+
+			if (np == n0
+					&& memcmp (w->ys, ys0, sizeof (int) * n0) == 0
+					&& memcmp (w->xs, xs0, sizeof (int) * n0) == 0)
+				{
+					entry.period = p;
+					entry.class = yp == y0 && xp == x0
+						? (p == 1 ? OBJECT_STILL_LIFE : OBJECT_OSCILLATOR)
+						: OBJECT_SPACESHIP;
+					break;
+				}
+
+			if (np == 0 || np > SOUP_OBJECT_MAX)
+				break;
+
+			// Every phase is a candidate for the canonical form
+			uint64_t h = soup_canonical_hash (w, w->ys, w->xs, np);
+			if (h < hash)
+				hash = h;
+
+			if (np < entry.population)
+				entry.population = np;
+		}
+
+	// Later phases of a non-periodic object are meaningless
+	entry.hash = entry.class == OBJECT_UNKNOWN
+		? soup_canonical_hash (w, ys0, xs0, n0)
+		: hash;
+
+	census_add (&w->census, &entry);
+
+	bitgrid_free (cur);
+	bitgrid_free (next);
+}
+
+/*
+ * Split the board into 8-connected objects. Coordinates are
+ * unwrapped while flooding so objects across the torus edge
+ * stay in one piece. Past SOUP_OBJECT_MAX cells they are no
+ * longer kept, but the flood goes on over the queue of board
+ * cells, so a mess is taken whole and counted once. Messes are
+ * not told apart: they share one census row, with no population
+ */
+static void
+soup_separate (SoupWorker *w)
+{
+	const BitGrid *grid = w->cur;
+	int side = grid->rows;
+
+	memset (w->visited, 0, sizeof (int) * side * side);
+
+	for (int start = 0; start < side * side; start++)
+		{
+			if (w->visited[start]
+					|| !BITGRID_GET (grid, start / side, start % side))
+				continue;
+
+			int head = 0, tail = 1, n = 0;
+
+			w->visited[start] = 1;
+			w->queue[0] = start;
+			w->ys[0] = start / side;
+			w->xs[0] = start % side;
+
+			while (head < tail)
+				{
+					int k = head++;
+					int y = w->queue[k] / side, x = w->queue[k] % side;
+
+					for (int di = -1; di <= 1; di++)
+						for (int dj = -1; dj <= 1; dj++)
+							{
+								int r = (y + di + side) % side;
+								int c = (x + dj + side) % side;
+								int idx = r * side + c;
+
+								if (w->visited[idx] || !BITGRID_GET (grid, r, c))
+									continue;
+
+								w->visited[idx] = 1;
+								w->queue[tail] = idx;
+
+								// Cells are queued in order, so the
+								// one flooded from is kept as well
+								if (tail < SOUP_OBJECT_MAX)
+									{
+										w->ys[tail] = w->ys[k] + di;
+										w->xs[tail] = w->xs[k] + dj;
+									}
+
+								tail++;
+							}
+				}
+
+			n = tail;
+
+			if (n > SOUP_OBJECT_MAX)
+				{
+					// Too big to be anything but a mess
+					CensusEntry entry = {
+						.class = OBJECT_MESS,
+						.count = 1
+					};
+
+					census_add (&w->census, &entry);
+					continue;
+				}
+
+			int min_y = w->ys[0], min_x = w->xs[0];
+			for (int k = 1; k < n; k++)
+				{
+					if (w->ys[k] < min_y) min_y = w->ys[k];
+					if (w->xs[k] < min_x) min_x = w->xs[k];
+				}
+
+			for (int k = 0; k < n; k++)
+				{
+					w->ys[k] -= min_y;
+					w->xs[k] -= min_x;
+				}
+
+			soup_classify (w, w->ys, w->xs, n);
+		}
+}
+
+static int
+soup_is_periodic (const long *pops, int gen)
+{
+	for (int p = 1; p <= SOUP_MAX_PERIOD; p++)
+		{
+			if (gen < SOUP_WINDOW + p)
+				return 0;
+
+			int k = 0;
+			while (k < SOUP_WINDOW && pops[gen - k] == pops[gen - k - p])
+				k++;
+
+			if (k == SOUP_WINDOW)
+				return 1;
+		}
+
+	return 0;
+}
+
+static void
+soup_search_one (SoupWorker *w, long index)
+{
+	Soup *soup = w->soup;
+	Rand *rng = rand_new (soup->seed + index);
+
+	cell_seed_random_generation (w->soup_grid, rng, soup->live_percent, NULL);
+	rand_free (rng);
+
+	memset (w->board->data, 0, sizeof (int) * w->board->rows * w->board->cols);
+	cell_seed_from_grid (w->board, w->soup_grid, NULL);
+	bitgrid_from_grid (w->cur, w->board);
+
+	w->pops[0] = bitgrid_population (w->cur);
+
+	int gen = 0;
+
+	// Population periodicity is the cheap test: it also
+	// holds while spaceships are flying away
+	while (gen < SOUP_MAX_GENS)
+		{
+			bitgrid_step (w->next, w->cur, &soup->rule);
+
+			BitGrid *tmp = w->cur;
+			w->cur = w->next;
+			w->next = tmp;
+
+			w->pops[++gen] = bitgrid_population (w->cur);
+
+			if (gen % SOUP_CHECK_EVERY == 0 && soup_is_periodic (w->pops, gen))
+				break;
+		}
+
+	w->gens += gen;
+
+	soup_separate (w);
+}
+
+static void
+soup_worker_init (SoupWorker *w, Soup *soup)
+{
+	int side = soup->board_size;
+
+	*w = (SoupWorker) {
+		.soup      = soup,
+		.soup_grid = grid_new (soup->soup_size, soup->soup_size),
+		.board     = grid_new (side, side),
+		.cur       = bitgrid_new (side, side),
+		.next      = bitgrid_new (side, side),
+		.pops      = xcalloc (SOUP_MAX_GENS + 1, sizeof (long)),
+		.visited   = xcalloc (side * side, sizeof (int)),
+		.queue     = xcalloc (side * side, sizeof (int)),
+		.ys        = xcalloc (2 * SOUP_OBJECT_MAX + 9, sizeof (int)),
+		.xs        = xcalloc (2 * SOUP_OBJECT_MAX + 9, sizeof (int)),
+		.keys      = xcalloc (SOUP_OBJECT_MAX, sizeof (int)),
+		.sym       = xcalloc (2 * SOUP_OBJECT_MAX, sizeof (int))
+	};
+
+	census_init (&w->census);
+}
+
+// The census is not the worker's to free
+static void
+soup_worker_destroy (SoupWorker *w)
+{
+	grid_free (w->soup_grid);
+	grid_free (w->board);
+	bitgrid_free (w->cur);
+	bitgrid_free (w->next);
+
+	xfree (w->pops);
+	xfree (w->visited);
+	xfree (w->queue);
+	xfree (w->ys);
+	xfree (w->xs);
+	xfree (w->keys);
+	xfree (w->sym);
+}
+
+static void
+soup_worker (int worker, int num_workers, void *arg)
+{
+	Soup *soup = arg;
+	SoupWorker w;
+
+	soup_worker_init (&w, soup);
+
+	long index;
+	while ((index = __atomic_fetch_add (&soup->next_soup, 1, __ATOMIC_RELAXED))
+			< soup->num_soups)
+		soup_search_one (&w, index);
+
+	__atomic_fetch_add (&soup->gens, w.gens, __ATOMIC_RELAXED);
+
+	// Merged by soup_run once all workers are joined
+	soup->worker_census[worker] = w.census;
+
+	soup_worker_destroy (&w);
+}
+
+Soup *
+soup_new (const Config *cfg)
+{
+	assert (cfg != NULL);
+	assert (cfg->soups > 0 && cfg->soup_size > 0);
+
+	Soup *soup = xcalloc (1, sizeof (Soup));
+
+	int board_size = cfg->soup_size * SOUP_BOARD_FAC;
+	if (board_size < SOUP_BOARD_MIN)
+		board_size = SOUP_BOARD_MIN;
+
+	*soup = (Soup) {
+		.rule_name    = cfg->rule,
+		.seed         = cfg->seed,
+		.live_percent = cfg->live_percent,
+		.num_soups    = cfg->soups,
+		.soup_size    = cfg->soup_size,
+		.board_size   = board_size,
+		.threads      = cfg->threads > 0
+			? cfg->threads
+			: parallel_num_cpus ()
+	};
+
+	Rule *rule = rule_new (cfg->rule);
+	bitlife_rule_init (&soup->rule, rule);
+	rule_free (rule);
+
+	census_init (&soup->census);
+
+	return soup;
+}
+
+void
+soup_free (Soup *soup)
+{
+	if (soup == NULL)
+		return;
+
+	census_destroy (&soup->census);
+	xfree (soup);
+}
+
+void
+soup_run (Soup *soup)
+{
+	assert (soup != NULL);
+
+	struct timespec start, end;
+
+	soup->worker_census = xcalloc (soup->threads, sizeof (Census));
+
+	clock_gettime (CLOCK_MONOTONIC, &start);
+
+	parallel_run (soup->threads, soup_worker, soup);
+
+	clock_gettime (CLOCK_MONOTONIC, &end);
+
+	soup->elapsed = (end.tv_sec - start.tv_sec)
+		+ (end.tv_nsec - start.tv_nsec) / 1e9;
+
+	for (int t = 0; t < soup->threads; t++)
+		{
+			census_merge (&soup->census, &soup->worker_census[t]);
+			census_destroy (&soup->worker_census[t]);
+		}
+
+	xfree (soup->worker_census);
+	soup->worker_census = NULL;
+}
+
+void
+soup_report (const Soup *soup, FILE *fp)
+{
+	assert (soup != NULL);
+	assert (fp != NULL);
+
+	long objects = 0;
+
+	for (int i = 0; i < soup->census.size; i++)
+		objects += soup->census.entries[i].count;
+
+	fprintf (fp,
+			"rule=%s soups=%d soup_size=%d threads=%d\n"
+			"objects=%ld distinct=%d generations=%ld\n",
+			soup->rule_name, soup->num_soups, soup->soup_size,
+			soup->threads, objects, soup->census.len, soup->gens);
+
+	if (soup->elapsed > 0)
+		fprintf (fp, "elapsed=%.3fs soups/s=%.2f generations/s=%.3e\n",
+				soup->elapsed, soup->num_soups / soup->elapsed,
+				soup->gens / soup->elapsed);
+}
+
+// Named after apgsearch: xs<pop>, xp<period>, xq<period>
+static void
+soup_object_code (const CensusEntry *e, char *code, size_t size)
+{
+	if (e->class == OBJECT_MESS)
+		{
+			snprintf (code, size, "%s_mess", object_prefix[e->class]);
+			return;
+		}
+
+	snprintf (code, size, "%s%d_%016llx",
+			object_prefix[e->class],
+			e->class == OBJECT_STILL_LIFE || e->class == OBJECT_UNKNOWN
+				? e->population
+				: e->period,
+			(unsigned long long) e->hash);
+}
+
+void
+soup_write (const Soup *soup, const char *path)
+{
+	assert (soup != NULL);
+	assert (path != NULL);
+
+	CensusEntry *entries = xcalloc (soup->census.len + 1, sizeof (CensusEntry));
+	int n = 0;
+
+	for (int i = 0; i < soup->census.size; i++)
+		if (soup->census.entries[i].count > 0)
+			entries[n++] = soup->census.entries[i];
+
+	qsort (entries, n, sizeof (CensusEntry), census_cmp);
+
+	FILE *fp = xfopen (path, "w");
+
+	fprintf (fp, "# conga soup census\n");
+	fprintf (fp, "# rule=%s soups=%d soup_size=%d seed=%ld live_percent=%.2f\n",
+			soup->rule_name, soup->num_soups, soup->soup_size,
+			soup->seed, soup->live_percent);
+
+	if (soup->elapsed > 0)
+		fprintf (fp, "# soups/s=%.2f\n", soup->num_soups / soup->elapsed);
+
+	fprintf (fp, "%-24s  %-10s  %-10s  %-6s  %s\n",
+			"code", "count", "class", "period", "population");
+
+	for (int i = 0; i < n; i++)
+		{
+			const CensusEntry *e = &entries[i];
+			char code[64];
+
+			soup_object_code (e, code, sizeof (code));
+
+			fprintf (fp, "%-24s  %-10ld  %-10s  %-6d  ",
+					code, e->count, object_name[e->class], e->period);
+
+			if (e->class == OBJECT_MESS)
+				fprintf (fp, "-\n");
+			else
+				fprintf (fp, "%d\n", e->population);
+		}
+
+	xfclose (fp);
+	xfree (entries);
+}
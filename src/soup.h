@@ -0,0 +1,14 @@
+#pragma once
+
+#include <stdio.h>
+#include "config.h"
+
+#define SOUP_MAX_PERIOD 30
+
+typedef struct _Soup Soup;
+
+Soup * soup_new    (const Config *cfg);
+void   soup_run    (Soup *soup);
+void   soup_report (const Soup *soup, FILE *fp);
+void   soup_write  (const Soup *soup, const char *path);
+void   soup_free   (Soup *soup);
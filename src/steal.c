@@ -0,0 +1,354 @@
+#include "steal.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <assert.h>
+#include "wrapper.h"
+#include "error.h"
+#include "parallel.h"
+#include "perf.h"
+
+#define LOAD(x)       __atomic_load_n (&(x), __ATOMIC_ACQUIRE)
+#define CAS(x,old,v)  __atomic_compare_exchange_n (&(x), &(old), (v), 0, \
+		__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+
+#define ENDS(top,bottom) (((uint64_t) (top) << 32) | (uint32_t) (bottom))
+
+/*
+ * The tasks of a run are all pushed before it starts, so a deque
+ * only shrinks: top and bottom share one word and both ends are
+ * taken with a compare and swap, the last task going to whoever
+ * gets there first.
+ */
+typedef struct
+{
+	uint64_t  ends;
+	long     *items;
+	uint64_t  rand;
+	char      pad[64 - 2 * sizeof (uint64_t) - sizeof (long *)];
+} StealDeque;
+
+typedef struct
+{
+	StealPool *pool;
+	int        worker;
+	pthread_t  thread;
+} StealThread;
+
+struct _StealPool
+{
+	int              workers;
+	long             tasks_max;
+	StealDeque      *deques;
+	StealStats      *stats;
+	StealThread     *threads;
+
+	StealFunc        func;
+	void            *arg;
+
+	pthread_mutex_t  lock;
+	pthread_cond_t   start;
+	pthread_cond_t   finish;
+	long             round;
+	int              done;
+	int              quit;
+
+	// Whether the thread calling the runs was pinned as worker 0
+	int              pinned;
+};
+
+// The owner takes from the bottom
+static int
+steal_deque_pop (StealDeque *d, long *task)
+{
+	uint64_t ends = LOAD (d->ends);
+
+	for (;;)
+		{
+			uint32_t top = ends >> 32, bottom = (uint32_t) ends;
+
+			if (top >= bottom)
+				return 0;
+
+			if (CAS (d->ends, ends, ENDS (top, bottom - 1)))
+				{
+					*task = d->items[bottom - 1];
+					return 1;
+				}
+		}
+}
+
+// Thieves from the top
+static int
+steal_deque_steal (StealDeque *d, long *task)
+{
+	uint64_t ends = LOAD (d->ends);
+
+	for (;;)
+		{
+			uint32_t top = ends >> 32, bottom = (uint32_t) ends;
+
+			if (top >= bottom)
+				return 0;
+
+			if (CAS (d->ends, ends, ENDS (top + 1, bottom)))
+				{
+					*task = d->items[top];
+					return 1;
+				}
+		}
+}
+
+static inline uint64_t
+steal_random (uint64_t *state)
+{
+	uint64_t x = *state;
+
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+
+	return *state = x;
+}
+
+static int
+steal_find (StealPool *pool, int worker, long *task)
+{
+	int n = pool->workers;
+
+	if (n == 1)
+		return 0;
+
+	// A random victim, then every other one in turn, since
+	// the tasks only run out once all the deques are empty
+	int first = steal_random (&pool->deques[worker].rand) % (n - 1);
+
+	for (int k = 0; k < n - 1; k++)
+		{
+			int victim = (worker + 1 + (first + k) % (n - 1)) % n;
+
+			if (steal_deque_steal (&pool->deques[victim], task))
+				return 1;
+		}
+
+	return 0;
+}
+
+// Busy from the first task to running out of them, steals included
+static void
+steal_work (StealPool *pool, int worker)
+{
+	StealStats *stats = &pool->stats[worker];
+	StealStats before = *stats;
+	double start = perf_now ();
+	long task;
+
+	for (;;)
+		{
+			int stolen = 0;
+
+			if (!steal_deque_pop (&pool->deques[worker], &task))
+				{
+					if (!steal_find (pool, worker, &task))
+						break;
+
+					stolen = 1;
+				}
+
+			pool->func (worker, task, pool->arg);
+
+			stats->tasks++;
+			stats->steals += stolen;
+		}
+
+	stats->busy += perf_now () - start;
+
+	metrics_add_worker (worker, stats->busy - before.busy,
+			stats->tasks - before.tasks, stats->steals - before.steals);
+}
+
+static void *
+steal_thread (void *data)
+{
+	StealThread *thread = data;
+	StealPool *pool = thread->pool;
+	long seen = 0;
+
+	parallel_pin (thread->worker, pool->workers);
+
+	for (;;)
+		{
+			pthread_mutex_lock (&pool->lock);
+
+			while (pool->round == seen && !pool->quit)
+				pthread_cond_wait (&pool->start, &pool->lock);
+
+			seen = pool->round;
+			int quit = pool->quit;
+
+			pthread_mutex_unlock (&pool->lock);
+
+			if (quit)
+				break;
+
+			steal_work (pool, thread->worker);
+
+			pthread_mutex_lock (&pool->lock);
+
+			if (++pool->done == pool->workers - 1)
+				pthread_cond_signal (&pool->finish);
+
+			pthread_mutex_unlock (&pool->lock);
+		}
+
+	return NULL;
+}
+
+StealPool *
+steal_pool_new (int workers, long tasks_max)
+{
+	assert (workers > 0 && workers <= STEAL_WORKERS_MAX);
+	assert (tasks_max > 0 && tasks_max <= UINT32_MAX);
+
+	StealPool *pool = xcalloc (1, sizeof (StealPool));
+
+	*pool = (StealPool) {
+		.workers   = workers,
+		.tasks_max = tasks_max,
+		.deques    = xcalloc (workers, sizeof (StealDeque)),
+		.stats     = xcalloc (workers, sizeof (StealStats)),
+		.threads   = xcalloc (workers, sizeof (StealThread))
+	};
+
+	for (int w = 0; w < workers; w++)
+		pool->deques[w] = (StealDeque) {
+			.items = xcalloc (tasks_max, sizeof (long)),
+			.rand  = 0x9e3779b97f4a7c15ULL * (w + 1)
+		};
+
+	pthread_mutex_init (&pool->lock, NULL);
+	pthread_cond_init (&pool->start, NULL);
+	pthread_cond_init (&pool->finish, NULL);
+
+	int rc = 0;
+
+	// Worker 0 is the thread calling steal_pool_run
+	for (int w = 1; w < workers; w++)
+		{
+			pool->threads[w] = (StealThread) {.pool = pool, .worker = w};
+
+			if ((rc = pthread_create (&pool->threads[w].thread, NULL,
+							steal_thread, &pool->threads[w])) != 0)
+				error (1, 0, "pthread_create failed: %s", strerror (rc));
+		}
+
+	return pool;
+}
+
+void
+steal_pool_run_split (StealPool *pool, const long *tasks, const long *split,
+		StealFunc func, void *arg)
+{
+	assert (pool != NULL);
+	assert (split != NULL);
+	assert (func != NULL);
+
+	int n = pool->workers;
+
+	assert (split[0] == 0 && split[n] <= pool->tasks_max);
+
+	for (int w = 0; w < n; w++)
+		{
+			long from = split[w];
+			long to = split[w + 1];
+
+			assert (from <= to);
+
+			memcpy (pool->deques[w].items, tasks + from, (to - from) * sizeof (long));
+			pool->deques[w].ends = ENDS (0, to - from);
+		}
+
+	pool->func = func;
+	pool->arg = arg;
+
+	pthread_mutex_lock (&pool->lock);
+	pool->round++;
+	pool->done = 0;
+	pthread_cond_broadcast (&pool->start);
+	pthread_mutex_unlock (&pool->lock);
+
+	// Once, so runs cost no affinity calls
+	if (n > 1 && !pool->pinned)
+		{
+			parallel_pin (0, n);
+			pool->pinned = 1;
+		}
+
+	steal_work (pool, 0);
+
+	pthread_mutex_lock (&pool->lock);
+
+	while (pool->done < n - 1)
+		pthread_cond_wait (&pool->finish, &pool->lock);
+
+	pthread_mutex_unlock (&pool->lock);
+}
+
+// Contiguous shares keep neighbouring tasks together
+void
+steal_pool_run (StealPool *pool, const long *tasks, long len,
+		StealFunc func, void *arg)
+{
+	assert (pool != NULL);
+	assert (len >= 0 && len <= pool->tasks_max);
+
+	long split[STEAL_WORKERS_MAX + 1];
+
+	for (int w = 0; w <= pool->workers; w++)
+		split[w] = len * w / pool->workers;
+
+	steal_pool_run_split (pool, tasks, split, func, arg);
+}
+
+int
+steal_pool_workers (const StealPool *pool)
+{
+	assert (pool != NULL);
+	return pool->workers;
+}
+
+const StealStats *
+steal_pool_stats (const StealPool *pool, int worker)
+{
+	assert (pool != NULL);
+	assert (worker >= 0 && worker < pool->workers);
+	return &pool->stats[worker];
+}
+
+void
+steal_pool_free (StealPool *pool)
+{
+	if (pool == NULL)
+		return;
+
+	pthread_mutex_lock (&pool->lock);
+	pool->quit = 1;
+	pthread_cond_broadcast (&pool->start);
+	pthread_mutex_unlock (&pool->lock);
+
+	for (int w = 1; w < pool->workers; w++)
+		pthread_join (pool->threads[w].thread, NULL);
+
+	for (int w = 0; w < pool->workers; w++)
+		xfree (pool->deques[w].items);
+
+	pthread_mutex_destroy (&pool->lock);
+	pthread_cond_destroy (&pool->start);
+	pthread_cond_destroy (&pool->finish);
+
+	xfree (pool->deques);
+	xfree (pool->stats);
+	xfree (pool->threads);
+	xfree (pool);
+}
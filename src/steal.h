@@ -0,0 +1,37 @@
+#pragma once
+
+#include "metrics.h"
+
+/*
+ * Work-stealing pool of threads kept between runs. A run hands
+ * out a list of tasks in contiguous shares, one deque per worker,
+ * even ones or, with steal_pool_run_split, tasks split[w] up to
+ * split[w + 1] to worker w; a worker takes its own tasks from the
+ * bottom and, once out of them, steals from the top of the deque
+ * of a random other one until every deque is empty. The calling
+ * thread is worker 0. Worker w is pinned with parallel_pin to the
+ * w-th share of the CPUs, the calling thread at its first run and
+ * for good.
+ */
+
+#define STEAL_WORKERS_MAX METRICS_WORKERS_MAX
+
+typedef struct _StealPool StealPool;
+
+typedef void (*StealFunc) (int worker, long task, void *arg);
+
+typedef struct
+{
+	long   tasks;
+	long   steals;
+	double busy;
+} StealStats;
+
+StealPool *        steal_pool_new     (int workers, long tasks_max);
+void               steal_pool_run     (StealPool *pool, const long *tasks, long len,
+                                       StealFunc func, void *arg);
+void               steal_pool_run_split (StealPool *pool, const long *tasks,
+                                         const long *split, StealFunc func, void *arg);
+int                steal_pool_workers (const StealPool *pool);
+const StealStats * steal_pool_stats   (const StealPool *pool, int worker);
+void               steal_pool_free    (StealPool *pool);
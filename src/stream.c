@@ -0,0 +1,412 @@
+#include "stream.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <assert.h>
+#include "wrapper.h"
+#include "error.h"
+#include "delta.h"
+
+#define VARINT_MAX   10
+#define IN_BUF_SIZE  64
+#define OUT_BUF_MIN  4096
+#define FRAME_HEADER (1 + 6 * VARINT_MAX)
+
+typedef struct
+{
+	int      fd;
+
+	int      row, col;
+	int      rows, cols;
+	int      keyframe;
+	long     gen;
+
+	// Viewport as last sent, and the one being encoded
+	Grid    *view;
+	Grid    *scratch;
+
+	uint8_t  in[IN_BUF_SIZE];
+	size_t   in_len;
+
+	uint8_t *out;
+	size_t   out_off;
+	size_t   out_len;
+	size_t   out_size;
+} StreamClient;
+
+struct _StreamServer
+{
+	int           fd;
+	char         *path;
+
+	int           rows, cols;
+
+	Delta         delta;
+	StreamClient  clients[STREAM_CLIENTS_MAX];
+};
+
+int
+stream_addr_is_valid (const char *addr)
+{
+	if (addr == NULL || *addr == '\0')
+		return 0;
+
+	if (strncmp (addr, STREAM_TCP_PREFIX, strlen (STREAM_TCP_PREFIX)) == 0)
+		{
+			char *end = NULL;
+			long port = strtol (addr + strlen (STREAM_TCP_PREFIX), &end, 10);
+			return *end == '\0' && port > 0 && port < 65536;
+		}
+
+	return strlen (addr) < sizeof (((struct sockaddr_un *) 0)->sun_path);
+}
+
+static int
+stream_listen_tcp (const char *addr)
+{
+	struct sockaddr_in sa = {
+		.sin_family = AF_INET,
+		.sin_port   = htons (atoi (addr + strlen (STREAM_TCP_PREFIX))),
+		.sin_addr   = {htonl (INADDR_LOOPBACK)}
+	};
+
+	int fd = socket (AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	int on = 1;
+
+	if (fd < 0)
+		error (1, 1, "Could not create socket");
+
+	setsockopt (fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof (on));
+
+	if (bind (fd, (struct sockaddr *) &sa, sizeof (sa)) < 0)
+		error (1, 1, "Could not bind to '%s'", addr);
+
+	return fd;
+}
+
+static int
+stream_listen_unix (const char *path)
+{
+	struct sockaddr_un sa = {.sun_family = AF_UNIX};
+	strncpy (sa.sun_path, path, sizeof (sa.sun_path) - 1);
+
+	int fd = socket (AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+	if (fd < 0)
+		error (1, 1, "Could not create socket");
+
+	// A socket left behind by a previous run is replaced
+	unlink (path);
+
+	if (bind (fd, (struct sockaddr *) &sa, sizeof (sa)) < 0)
+		error (1, 1, "Could not bind to '%s'", path);
+
+	return fd;
+}
+
+StreamServer *
+stream_server_new (const char *addr, int rows, int cols)
+{
+	assert (stream_addr_is_valid (addr));
+	assert (rows > 0 && cols > 0);
+
+	StreamServer *server = xcalloc (1, sizeof (StreamServer));
+	int tcp = strncmp (addr, STREAM_TCP_PREFIX, strlen (STREAM_TCP_PREFIX)) == 0;
+
+	*server = (StreamServer) {
+		.fd   = tcp ? stream_listen_tcp (addr) : stream_listen_unix (addr),
+		.path = tcp ? NULL : xstrdup (addr),
+		.rows = rows,
+		.cols = cols
+	};
+
+	if (listen (server->fd, STREAM_CLIENTS_MAX) < 0)
+		error (1, 1, "Could not listen on '%s'", addr);
+
+	for (int i = 0; i < STREAM_CLIENTS_MAX; i++)
+		server->clients[i].fd = -1;
+
+	delta_init (&server->delta);
+
+	return server;
+}
+
+static void
+stream_client_close (StreamClient *client)
+{
+	if (client->fd < 0)
+		return;
+
+	close (client->fd);
+	grid_free (client->view);
+	grid_free (client->scratch);
+	xfree (client->out);
+
+	*client = (StreamClient) {.fd = -1};
+}
+
+void
+stream_server_free (StreamServer *server)
+{
+	if (server == NULL)
+		return;
+
+	for (int i = 0; i < STREAM_CLIENTS_MAX; i++)
+		stream_client_close (&server->clients[i]);
+
+	close (server->fd);
+
+	if (server->path != NULL)
+		unlink (server->path);
+
+	delta_destroy (&server->delta);
+	xfree (server->path);
+	xfree (server);
+}
+
+static inline void
+stream_client_reserve (StreamClient *client, size_t len)
+{
+	if (client->out_len + len <= client->out_size)
+		return;
+
+	size_t size = client->out_size < OUT_BUF_MIN ? OUT_BUF_MIN : client->out_size;
+	while (size < client->out_len + len)
+		size *= 2;
+
+	uint8_t *out = xmalloc (size);
+	if (client->out_len)
+		memcpy (out, client->out, client->out_len);
+
+	xfree (client->out);
+
+	client->out = out;
+	client->out_size = size;
+}
+
+static inline void
+stream_client_put_varint (StreamClient *client, uint64_t val)
+{
+	stream_client_reserve (client, VARINT_MAX);
+	client->out_len += delta_put_varint (client->out + client->out_len, val);
+}
+
+static void
+stream_client_set_view (StreamClient *client, const StreamServer *server,
+		int row, int col, int rows, int cols)
+{
+	row = row < server->rows ? row : server->rows - 1;
+	col = col < server->cols ? col : server->cols - 1;
+
+	if (rows < 1 || rows > server->rows - row)
+		rows = server->rows - row;
+
+	if (cols < 1 || cols > server->cols - col)
+		cols = server->cols - col;
+
+	if (client->view == NULL || rows != client->rows || cols != client->cols)
+		{
+			grid_free (client->view);
+			grid_free (client->scratch);
+
+			client->view    = grid_new (rows, cols);
+			client->scratch = grid_new (rows, cols);
+		}
+
+	client->row = row;
+	client->col = col;
+	client->rows = rows;
+	client->cols = cols;
+	client->keyframe = 1;
+}
+
+static void
+stream_server_accept (StreamServer *server)
+{
+	int fd;
+
+	while ((fd = accept (server->fd, NULL, NULL)) >= 0)
+		{
+			StreamClient *client = NULL;
+
+			fcntl (fd, F_SETFL, O_NONBLOCK);
+			fcntl (fd, F_SETFD, FD_CLOEXEC);
+
+			for (int i = 0; i < STREAM_CLIENTS_MAX && client == NULL; i++)
+				if (server->clients[i].fd < 0)
+					client = &server->clients[i];
+
+			if (client == NULL)
+				{
+					close (fd);
+					continue;
+				}
+
+			*client = (StreamClient) {.fd = fd, .gen = -1};
+
+			stream_client_set_view (client, server, 0, 0, server->rows, server->cols);
+
+			stream_client_reserve (client, strlen (STREAM_MAGIC) + 1);
+			memcpy (client->out, STREAM_MAGIC, strlen (STREAM_MAGIC));
+			client->out_len = strlen (STREAM_MAGIC);
+			client->out[client->out_len++] = STREAM_VERSION;
+
+			stream_client_put_varint (client, server->rows);
+			stream_client_put_varint (client, server->cols);
+		}
+}
+
+// Returns 0 when the client is gone or broke the protocol
+static int
+stream_client_read (StreamClient *client, const StreamServer *server)
+{
+	ssize_t n;
+
+	while ((n = recv (client->fd, client->in + client->in_len,
+					IN_BUF_SIZE - client->in_len, 0)) > 0)
+		{
+			client->in_len += n;
+
+			for (;;)
+				{
+					uint64_t v[4];
+					size_t off = 1, len = 0;
+
+					if (client->in_len == 0)
+						break;
+
+					if (client->in[0] != 'V')
+						return 0;
+
+					for (int k = 0; k < 4; k++, off += len)
+						if ((len = delta_get_varint (client->in + off,
+										client->in_len - off, &v[k])) == 0)
+							break;
+
+					// Wait for the rest of the message
+					if (len == 0)
+						{
+							if (client->in_len == IN_BUF_SIZE)
+								return 0;
+							break;
+						}
+
+					stream_client_set_view (client, server,
+							v[0] < INT32_MAX ? v[0] : INT32_MAX,
+							v[1] < INT32_MAX ? v[1] : INT32_MAX,
+							v[2] < INT32_MAX ? v[2] : INT32_MAX,
+							v[3] < INT32_MAX ? v[3] : INT32_MAX);
+
+					memmove (client->in, client->in + off, client->in_len - off);
+					client->in_len -= off;
+				}
+		}
+
+	return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR);
+}
+
+// Returns 0 when the client is gone
+static int
+stream_client_flush (StreamClient *client)
+{
+	while (client->out_off < client->out_len)
+		{
+			ssize_t n = send (client->fd, client->out + client->out_off,
+					client->out_len - client->out_off, MSG_NOSIGNAL);
+
+			if (n < 0)
+				{
+					if (errno == EINTR)
+						continue;
+
+					return errno == EAGAIN || errno == EWOULDBLOCK;
+				}
+
+			client->out_off += n;
+		}
+
+	client->out_off = client->out_len = 0;
+
+	return 1;
+}
+
+static void
+stream_client_frame (StreamClient *client, StreamServer *server,
+		const Grid *grid, int gen)
+{
+	for (int i = 0; i < client->rows; i++)
+		memcpy (&GRID_GET (client->scratch, i, 0),
+				&GRID_GET (grid, client->row + i, client->col),
+				client->cols * sizeof (int));
+
+	if (client->keyframe)
+		memset (client->view->data, 0,
+				(size_t) client->rows * client->cols * sizeof (int));
+
+	delta_encode (&server->delta, client->scratch, client->view, NULL);
+
+	stream_client_reserve (client, FRAME_HEADER + VARINT_MAX + server->delta.len);
+	client->out[client->out_len++] = client->keyframe ? 'K' : 'D';
+
+	stream_client_put_varint (client, gen);
+	stream_client_put_varint (client, client->row);
+	stream_client_put_varint (client, client->col);
+	stream_client_put_varint (client, client->rows);
+	stream_client_put_varint (client, client->cols);
+	stream_client_put_varint (client, server->delta.len);
+
+	memcpy (client->out + client->out_len, server->delta.data, server->delta.len);
+	client->out_len += server->delta.len;
+
+	Grid *tmp = client->view;
+	client->view = client->scratch;
+	client->scratch = tmp;
+
+	client->keyframe = 0;
+	client->gen = gen;
+}
+
+void
+stream_server_update (StreamServer *server, const Grid *grid, int gen)
+{
+	assert (server != NULL);
+	assert (grid != NULL);
+	assert (grid->rows == server->rows && grid->cols == server->cols);
+
+	stream_server_accept (server);
+
+	for (int i = 0; i < STREAM_CLIENTS_MAX; i++)
+		{
+			StreamClient *client = &server->clients[i];
+
+			if (client->fd < 0)
+				continue;
+
+			if (!stream_client_read (client, server) || !stream_client_flush (client))
+				{
+					stream_client_close (client);
+					continue;
+				}
+
+			// Still busy with an older frame, skip this generation
+			if (client->out_len > 0)
+				continue;
+
+			if (client->gen == gen && !client->keyframe)
+				continue;
+
+			stream_client_frame (client, server, grid, gen);
+
+			if (!stream_client_flush (client))
+				stream_client_close (client);
+		}
+}
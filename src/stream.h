@@ -0,0 +1,33 @@
+#pragma once
+
+#include "grid.h"
+
+/*
+ * Live stream of the grid to viewers on a Unix domain socket,
+ * or a TCP socket on the loopback with "tcp:PORT". Integers are
+ * unsigned LEB128 varints, as in the delta stream.
+ *
+ *   server hello: 'CGST', version byte, rows, cols
+ *   client view:  'V', row, col, rows, cols
+ *   server frame: 'K' or 'D', gen, row, col, rows, cols,
+ *                 payload length, payload
+ *
+ * The payload is a delta (see delta.h) over the viewport, whose
+ * index is row * cols + col inside it. A 'K' keyframe is a delta
+ * from an empty viewport, sent on connect and on every change of
+ * view; each 'D' follows the last frame the client received.
+ * A client still busy reading is skipped, and its next frame is
+ * the delta to the latest generation, so the run never waits.
+ */
+
+#define STREAM_MAGIC       "CGST"
+#define STREAM_VERSION     1
+#define STREAM_TCP_PREFIX  "tcp:"
+#define STREAM_CLIENTS_MAX 16
+
+typedef struct _StreamServer StreamServer;
+
+StreamServer * stream_server_new    (const char *addr, int rows, int cols);
+void           stream_server_update (StreamServer *server, const Grid *grid, int gen);
+void           stream_server_free   (StreamServer *server);
+int            stream_addr_is_valid (const char *addr);
@@ -0,0 +1,462 @@
+#include "sweep.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <assert.h>
+#include "wrapper.h"
+#include "grid.h"
+#include "cell.h"
+#include "rule.h"
+#include "rand.h"
+#include "pattern.h"
+#include "bitgrid.h"
+#include "parallel.h"
+
+#define STATES       2
+#define NEIGHBORS    9
+#define RESULTS_MIN  64
+
+// One bit per rule, keyed by its birth and survival masks
+#define RULE_KEYS    (1 << (STATES * NEIGHBORS))
+#define RULE_KEY(r)  ((r)->birth | (r)->survive << NEIGHBORS)
+
+#define FNV_OFFSET   0xcbf29ce484222325ULL
+#define FNV_PRIME    0x100000001b3ULL
+
+typedef struct
+{
+	char    *rule;
+	BitRule  bit_rule;
+
+	long     alive;
+	int      gens;
+
+	// First generation of the cycle, -1 if none was found
+	int      stable_gen;
+	int      period;
+} SweepResult;
+
+struct _Sweep
+{
+	SweepResult *results;
+	int          len;
+	int          size;
+	uint8_t     *seen;
+
+	// Shared read-only by all workers
+	BitGrid     *seed;
+	long         seed_alive;
+
+	int          gen_limit;
+	int          threads;
+
+	long         next_rule;
+	long         gens;
+
+	double       elapsed;
+};
+
+/*
+ * Rule spec: comma separated list of rules or aliases.
+ * In the Bx/Sy form every 'x' stands for one optional
+ * extra digit, so B3x/S23 expands to B3/S23, B03/S23,
+ * B13/S23, ..., B38/S23. A rule given more than once,
+ * under any name, is run once
+ */
+
+static int
+sweep_parse_wildcard (const char *token, int mask[STATES], int extra[STATES])
+{
+	const char *p = token;
+
+	for (int i = 0; i < STATES; i++)
+		{
+			mask[i] = 0;
+			extra[i] = 0;
+
+			if (toupper (*p++) != (i == 0 ? 'B' : 'S'))
+				return 0;
+
+			for (; *p != '\0' && *p != '/'; p++)
+				{
+					if (*p == 'x' || *p == 'X')
+						extra[i]++;
+					else if (*p >= '0' && *p <= '8' && !(mask[i] & (1 << (*p - '0'))))
+						mask[i] |= 1 << (*p - '0');
+					else
+						return 0;
+				}
+
+			if (i == 0 && *p++ != '/')
+				return 0;
+		}
+
+	return *p == '\0';
+}
+
+// Rules already in, however they were spelled, are left out
+static int
+sweep_add_seen (Sweep *sweep, const BitRule *bit_rule)
+{
+	int key = RULE_KEY (bit_rule);
+
+	if (sweep->seen[key >> 3] & (1 << (key & 7)))
+		return 0;
+
+	sweep->seen[key >> 3] |= 1 << (key & 7);
+
+	return 1;
+}
+
+static void
+sweep_add_rule (Sweep *sweep, const char *rule, const BitRule *bit_rule)
+{
+	if (!sweep_add_seen (sweep, bit_rule))
+		return;
+
+	if (sweep->len == sweep->size)
+		{
+			SweepResult *results = xcalloc (sweep->size * 2, sizeof (SweepResult));
+			memcpy (results, sweep->results, sizeof (SweepResult) * sweep->len);
+			xfree (sweep->results);
+
+			sweep->results = results;
+			sweep->size *= 2;
+		}
+
+	SweepResult *result = &sweep->results[sweep->len++];
+
+	*result = (SweepResult) {
+		.rule       = xstrdup (rule),
+		.bit_rule   = *bit_rule,
+		.stable_gen = -1
+	};
+}
+
+static void
+sweep_mask_to_str (char *buf, int mask)
+{
+	for (int n = 0; n < NEIGHBORS; n++)
+		if (mask & (1 << n))
+			*buf++ = '0' + n;
+
+	*buf = '\0';
+}
+
+static void
+sweep_expand_wildcard (Sweep *sweep, const int mask[STATES], const int extra[STATES])
+{
+	char rule[2 * NEIGHBORS + 8];
+	char b[NEIGHBORS + 1], s[NEIGHBORS + 1];
+
+	for (int mb = 0; mb < (1 << NEIGHBORS); mb++)
+		{
+			if ((mb & mask[0]) || __builtin_popcount (mb) > extra[0])
+				continue;
+
+			for (int ms = 0; ms < (1 << NEIGHBORS); ms++)
+				{
+					if ((ms & mask[1]) || __builtin_popcount (ms) > extra[1])
+						continue;
+
+					BitRule bit_rule = {
+						.birth   = mask[0] | mb,
+						.survive = mask[1] | ms
+					};
+
+					sweep_mask_to_str (b, bit_rule.birth);
+					sweep_mask_to_str (s, bit_rule.survive);
+					snprintf (rule, sizeof (rule), "B%s/S%s", b, s);
+
+					sweep_add_rule (sweep, rule, &bit_rule);
+				}
+		}
+}
+
+// Aliases such as 2x2 are rules, whatever their name holds
+static int
+sweep_is_wildcard (const char *token)
+{
+	for (const RuleAlias *a = rule_aliases; a->name != NULL; a++)
+		if (strcasecmp (token, a->name) == 0)
+			return 0;
+
+	return toupper (*token) == 'B' && strchr (token, '/') != NULL
+		&& strpbrk (token, "xX") != NULL;
+}
+
+// Every rule or wildcard gives one rule at least, so none gives none
+static int
+sweep_parse_spec (Sweep *sweep, const char *spec)
+{
+	char *buf = xstrdup (spec);
+	char *save = NULL;
+	int tokens = 0;
+	int rc = 1;
+
+	for (char *token = strtok_r (buf, ",", &save); token != NULL;
+			token = strtok_r (NULL, ",", &save))
+		{
+			int mask[STATES], extra[STATES];
+
+			tokens++;
+
+			if (sweep_is_wildcard (token))
+				{
+					if (!sweep_parse_wildcard (token, mask, extra))
+						{
+							rc = 0;
+							break;
+						}
+
+					if (sweep != NULL)
+						sweep_expand_wildcard (sweep, mask, extra);
+				}
+			else if (!rule_is_valid (token))
+				{
+					rc = 0;
+					break;
+				}
+			else if (sweep != NULL)
+				{
+					BitRule bit_rule;
+					Rule *rule = rule_new (token);
+
+					bitlife_rule_init (&bit_rule, rule);
+					sweep_add_rule (sweep, token, &bit_rule);
+
+					rule_free (rule);
+				}
+		}
+
+	xfree (buf);
+
+	return rc && tokens > 0;
+}
+
+int
+sweep_spec_is_valid (const char *spec)
+{
+	assert (spec != NULL);
+	return sweep_parse_spec (NULL, spec);
+}
+
+static void
+sweep_seed (Sweep *sweep, const Config *cfg)
+{
+	Grid *grid = NULL;
+
+	if (cfg->pattern != NULL || cfg->pattern_file != NULL)
+		{
+			Pattern *pattern = pattern_new (cfg->pattern_file != NULL
+					? cfg->pattern_file
+					: cfg->pattern);
+
+			int rows = pattern->grid->rows < cfg->rows ? cfg->rows : pattern->grid->rows;
+			int cols = pattern->grid->cols < cfg->cols ? cfg->cols : pattern->grid->cols;
+
+			grid = grid_new (rows, cols);
+			cell_seed_from_grid (grid, pattern->grid, NULL);
+
+			pattern_free (pattern);
+		}
+	else
+		{
+			Rand *rng = rand_new (cfg->seed);
+
+			grid = grid_new (cfg->rows, cfg->cols);
+			cell_seed_random_generation (grid, rng, cfg->live_percent, NULL);
+
+			rand_free (rng);
+		}
+
+	sweep->seed = bitgrid_new (grid->rows, grid->cols);
+	bitgrid_from_grid (sweep->seed, grid);
+	sweep->seed_alive = bitgrid_population (sweep->seed);
+
+	grid_free (grid);
+}
+
+Sweep *
+sweep_new (const Config *cfg)
+{
+	assert (cfg != NULL);
+	assert (cfg->sweep != NULL);
+	assert (cfg->generations > 0);
+
+	Sweep *sweep = xcalloc (1, sizeof (Sweep));
+
+	*sweep = (Sweep) {
+		.results   = xcalloc (RESULTS_MIN, sizeof (SweepResult)),
+		.size      = RESULTS_MIN,
+		.seen      = xcalloc (RULE_KEYS / 8, sizeof (uint8_t)),
+		.gen_limit = cfg->generations,
+		.threads   = cfg->threads > 0
+			? cfg->threads
+			: parallel_num_cpus ()
+	};
+
+	int rc = sweep_parse_spec (sweep, cfg->sweep);
+	assert (rc);
+
+	sweep_seed (sweep, cfg);
+
+	return sweep;
+}
+
+void
+sweep_free (Sweep *sweep)
+{
+	if (sweep == NULL)
+		return;
+
+	for (int i = 0; i < sweep->len; i++)
+		xfree (sweep->results[i].rule);
+
+	xfree (sweep->results);
+	xfree (sweep->seen);
+	bitgrid_free (sweep->seed);
+
+	xfree (sweep);
+}
+
+static inline uint64_t
+sweep_hash (const BitGrid *grid)
+{
+	long size = (long) grid->rows * grid->words;
+	uint64_t hash = FNV_OFFSET;
+
+	for (long i = 0; i < size; i++)
+		{
+			hash ^= grid->data[i];
+			hash *= FNV_PRIME;
+		}
+
+	return hash;
+}
+
+static void
+sweep_run_rule (Sweep *sweep, SweepResult *result, BitGrid **cur, BitGrid **next)
+{
+	uint64_t hashes[SWEEP_MAX_PERIOD + 1] = {0};
+
+	memcpy ((*cur)->data, sweep->seed->data,
+			sizeof (uint64_t) * sweep->seed->rows * sweep->seed->words);
+
+	hashes[0] = sweep_hash (*cur);
+
+	int gen = 0;
+
+	while (gen < sweep->gen_limit)
+		{
+			bitgrid_step (*next, *cur, &result->bit_rule);
+
+			BitGrid *tmp = *cur;
+			*cur = *next;
+			*next = tmp;
+
+			gen++;
+
+			uint64_t hash = sweep_hash (*cur);
+
+			if (result->stable_gen < 0)
+				for (int p = 1; p <= SWEEP_MAX_PERIOD && p <= gen; p++)
+					if (hashes[(gen - p) % (SWEEP_MAX_PERIOD + 1)] == hash)
+						{
+							result->stable_gen = gen - p;
+							result->period = p;
+							break;
+						}
+
+			hashes[gen % (SWEEP_MAX_PERIOD + 1)] = hash;
+
+			// A still grid would stay the same up to the limit
+			if (result->period == 1)
+				break;
+		}
+
+	result->gens  = gen;
+	result->alive = bitgrid_population (*cur);
+}
+
+static void
+sweep_worker (int worker, int num_workers, void *arg)
+{
+	Sweep *sweep = arg;
+
+	BitGrid *cur  = bitgrid_new (sweep->seed->rows, sweep->seed->cols);
+	BitGrid *next = bitgrid_new (sweep->seed->rows, sweep->seed->cols);
+
+	long gens = 0;
+	long i;
+
+	while ((i = __atomic_fetch_add (&sweep->next_rule, 1, __ATOMIC_RELAXED))
+			< sweep->len)
+		{
+			sweep_run_rule (sweep, &sweep->results[i], &cur, &next);
+			gens += sweep->results[i].gens;
+		}
+
+	__atomic_fetch_add (&sweep->gens, gens, __ATOMIC_RELAXED);
+
+	bitgrid_free (cur);
+	bitgrid_free (next);
+}
+
+void
+sweep_run (Sweep *sweep)
+{
+	assert (sweep != NULL);
+
+	struct timespec start, end;
+	int threads = sweep->threads < sweep->len
+		? sweep->threads
+		: sweep->len;
+
+	clock_gettime (CLOCK_MONOTONIC, &start);
+
+	parallel_run (threads, sweep_worker, sweep);
+
+	clock_gettime (CLOCK_MONOTONIC, &end);
+
+	sweep->elapsed = (end.tv_sec - start.tv_sec)
+		+ (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+void
+sweep_report (const Sweep *sweep, FILE *fp)
+{
+	assert (sweep != NULL);
+	assert (fp != NULL);
+
+	double cells = (double) sweep->seed->rows * sweep->seed->cols;
+
+	fprintf (fp, "# rows=%d cols=%d rules=%d generations=%d initial_alive=%ld\n",
+			sweep->seed->rows, sweep->seed->cols, sweep->len,
+			sweep->gen_limit, sweep->seed_alive);
+	fprintf (fp, "%-22s  %-10s  %-8s  %-8s  %-10s  %s\n",
+			"rule", "alive", "density", "growth", "stabilised", "period");
+
+	for (int i = 0; i < sweep->len; i++)
+		{
+			const SweepResult *r = &sweep->results[i];
+
+			fprintf (fp, "%-22s  %-10ld  %-8.4f  %-8.3f  ",
+					r->rule, r->alive, r->alive / cells,
+					sweep->seed_alive > 0
+						? (double) r->alive / sweep->seed_alive
+						: 0.0);
+
+			if (r->stable_gen >= 0)
+				fprintf (fp, "%-10d  %d\n", r->stable_gen, r->period);
+			else
+				fprintf (fp, "%-10s  %s\n", "-", "-");
+		}
+
+	if (sweep->elapsed > 0)
+		fprintf (fp, "# elapsed=%.3fs rule-generations/s=%.3e cells/s=%.3e\n",
+				sweep->elapsed, sweep->gens / sweep->elapsed,
+				sweep->gens * cells / sweep->elapsed);
+}
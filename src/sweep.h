@@ -0,0 +1,14 @@
+#pragma once
+
+#include <stdio.h>
+#include "config.h"
+
+#define SWEEP_MAX_PERIOD 30
+
+typedef struct _Sweep Sweep;
+
+Sweep * sweep_new           (const Config *cfg);
+void    sweep_run           (Sweep *sweep);
+void    sweep_report        (const Sweep *sweep, FILE *fp);
+void    sweep_free          (Sweep *sweep);
+int     sweep_spec_is_valid (const char *spec);
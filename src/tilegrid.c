@@ -0,0 +1,257 @@
+#include "tilegrid.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "wrapper.h"
+
+#define SIDE TILEGRID_SIDE
+
+typedef struct
+{
+	uint64_t code;
+	long     index;
+} TileOrder;
+
+// Bits of x spread to the even positions
+static inline uint64_t
+tilegrid_spread (uint32_t x)
+{
+	uint64_t v = x;
+
+	v = (v | (v << 16)) & 0x0000ffff0000ffffULL;
+	v = (v | (v << 8))  & 0x00ff00ff00ff00ffULL;
+	v = (v | (v << 4))  & 0x0f0f0f0f0f0f0f0fULL;
+	v = (v | (v << 2))  & 0x3333333333333333ULL;
+	v = (v | (v << 1))  & 0x5555555555555555ULL;
+
+	return v;
+}
+
+static int
+tilegrid_order_cmp (const void *a, const void *b)
+{
+	uint64_t x = ((const TileOrder *) a)->code;
+	uint64_t y = ((const TileOrder *) b)->code;
+	return (x > y) - (x < y);
+}
+
+TileGrid *
+tilegrid_new (int rows, int cols)
+{
+	assert (rows > 0 && cols > 0);
+
+	TileGrid *grid = xcalloc (1, sizeof (TileGrid));
+	int tile_rows = (rows + SIDE - 1) / SIDE;
+	int tile_cols = (cols + SIDE - 1) / SIDE;
+	long tiles = (long) tile_rows * tile_cols;
+
+	*grid = (TileGrid) {
+		.rows      = rows,
+		.cols      = cols,
+		.tile_rows = tile_rows,
+		.tile_cols = tile_cols,
+		.slot      = xcalloc (tiles, sizeof (long)),
+		.order     = xcalloc (tiles, sizeof (long)),
+		.data      = xcalloc (tiles * SIDE, sizeof (uint64_t))
+	};
+
+	// Z-order of the tiles that exist, without the holes a
+	// power of two square around them would leave
+	TileOrder *order = xcalloc (tiles, sizeof (TileOrder));
+
+	for (int tr = 0; tr < tile_rows; tr++)
+		for (int tc = 0; tc < tile_cols; tc++)
+			{
+				long index = (long) tr * tile_cols + tc;
+
+				order[index] = (TileOrder) {
+					.code  = (tilegrid_spread (tr) << 1) | tilegrid_spread (tc),
+					.index = index
+				};
+			}
+
+	qsort (order, tiles, sizeof (TileOrder), tilegrid_order_cmp);
+
+	for (long s = 0; s < tiles; s++)
+		{
+			grid->slot[order[s].index] = s;
+			grid->order[s] = order[s].index;
+		}
+
+	xfree (order);
+
+	return grid;
+}
+
+void
+tilegrid_free (TileGrid *grid)
+{
+	if (grid == NULL)
+		return;
+
+	xfree (grid->slot);
+	xfree (grid->order);
+	xfree (grid->data);
+	xfree (grid);
+}
+
+void
+tilegrid_clear (TileGrid *grid)
+{
+	assert (grid != NULL);
+	memset (grid->data, 0,
+			sizeof (uint64_t) * grid->tile_rows * grid->tile_cols * SIDE);
+}
+
+void
+tilegrid_from_grid (TileGrid *tile_grid, const Grid *grid)
+{
+	assert (tile_grid != NULL && grid != NULL);
+	assert (tile_grid->rows == grid->rows && tile_grid->cols == grid->cols);
+
+	for (int i = 0; i < grid->rows; i++)
+		{
+			const int *src = &GRID_GET (grid, i, 0);
+
+			for (int tc = 0; tc < tile_grid->tile_cols; tc++)
+				{
+					int n = grid->cols - tc * SIDE;
+					uint64_t word = 0;
+
+					if (n > SIDE)
+						n = SIDE;
+
+					for (int b = 0; b < n; b++)
+						word |= (uint64_t) (src[tc * SIDE + b] != 0) << b;
+
+					TILEGRID_TILE (tile_grid, i / SIDE, tc)[i % SIDE] = word;
+				}
+		}
+}
+
+void
+tilegrid_to_grid (Grid *grid, const TileGrid *tile_grid)
+{
+	assert (tile_grid != NULL && grid != NULL);
+	assert (tile_grid->rows == grid->rows && tile_grid->cols == grid->cols);
+
+	for (int i = 0; i < grid->rows; i++)
+		{
+			int *dst = &GRID_GET (grid, i, 0);
+
+			for (int j = 0; j < grid->cols; j++)
+				dst[j] = TILEGRID_GET (tile_grid, i, j);
+		}
+}
+
+long
+tilegrid_population (const TileGrid *grid)
+{
+	assert (grid != NULL);
+
+	long alive = 0;
+	long size = (long) grid->tile_rows * grid->tile_cols * SIDE;
+
+	for (long i = 0; i < size; i++)
+		alive += __builtin_popcountll (grid->data[i]);
+
+	return alive;
+}
+
+// Cells of row r to the left of tile column tc and to its right,
+// as the low bit of each, wrapping around the torus
+static inline void
+tilegrid_edges (const TileGrid *grid, int r, int tc, int width,
+		uint64_t *left, uint64_t *right)
+{
+	int cl = tc * SIDE - 1;
+	int cr = tc * SIDE + width;
+
+	if (cl < 0)
+		cl = grid->cols - 1;
+
+	if (cr >= grid->cols)
+		cr = 0;
+
+	*left  = (TILEGRID_WORD (grid, r, cl) >> (cl & 63)) & 1;
+	*right = (TILEGRID_WORD (grid, r, cr) >> (cr & 63)) & 1;
+}
+
+static void
+tilegrid_step_tile (TileGrid *grid_next, const TileGrid *grid_cur,
+		const BitRule *rule, int tr, int tc)
+{
+	int rows = grid_cur->rows;
+	int height = rows - tr * SIDE < SIDE ? rows - tr * SIDE : SIDE;
+	int width = grid_cur->cols - tc * SIDE < SIDE ? grid_cur->cols - tc * SIDE : SIDE;
+	uint64_t mask = width < SIDE ? ((uint64_t) 1 << width) - 1 : ~(uint64_t) 0;
+
+	const uint64_t *tile = TILEGRID_TILE (grid_cur, tr, tc);
+	uint64_t *out = TILEGRID_TILE (grid_next, tr, tc);
+
+	// The rows above and below come from the tiles around only
+	// at the top and bottom row of the tile
+	int r0 = tr * SIDE;
+	int above = r0 > 0 ? r0 - 1 : rows - 1;
+	int below = r0 + height < rows ? r0 + height : 0;
+
+	uint64_t up = TILEGRID_WORD (grid_cur, above, tc * SIDE);
+	uint64_t up_l, up_r, mid_l, mid_r, dn_l, dn_r;
+
+	tilegrid_edges (grid_cur, above, tc, width, &up_l, &up_r);
+	tilegrid_edges (grid_cur, r0, tc, width, &mid_l, &mid_r);
+
+	for (int i = 0; i < height; i++)
+		{
+			uint64_t mid = tile[i];
+			uint64_t dn;
+
+			if (i + 1 < height)
+				{
+					dn = tile[i + 1];
+					tilegrid_edges (grid_cur, r0 + i + 1, tc, width, &dn_l, &dn_r);
+				}
+			else
+				{
+					dn = TILEGRID_WORD (grid_cur, below, tc * SIDE);
+					tilegrid_edges (grid_cur, below, tc, width, &dn_l, &dn_r);
+				}
+
+			// Cell j - 1 and j + 1 seen at position j
+			uint64_t ul = (up << 1)  | up_l;
+			uint64_t ml = (mid << 1) | mid_l;
+			uint64_t dl = (dn << 1)  | dn_l;
+			uint64_t ur = (up >> 1)  | (up_r << (width - 1));
+			uint64_t mr = (mid >> 1) | (mid_r << (width - 1));
+			uint64_t dr = (dn >> 1)  | (dn_r << (width - 1));
+
+			out[i] = bitlife_next (rule, mid, ul, up, ur, ml, mr, dl, dn, dr) & mask;
+
+			up = mid;
+			up_l = mid_l;
+			up_r = mid_r;
+			mid_l = dn_l;
+			mid_r = dn_r;
+		}
+}
+
+void
+tilegrid_step (TileGrid *grid_next, const TileGrid *grid_cur,
+		const BitRule *rule)
+{
+	assert (grid_next != NULL && grid_cur != NULL);
+	assert (grid_next->rows == grid_cur->rows
+			&& grid_next->cols == grid_cur->cols);
+	assert (rule != NULL);
+
+	long tiles = (long) grid_cur->tile_rows * grid_cur->tile_cols;
+
+	// In memory order, so in Z-order
+	for (long s = 0; s < tiles; s++)
+		{
+			long index = grid_cur->order[s];
+			tilegrid_step_tile (grid_next, grid_cur, rule,
+					index / grid_cur->tile_cols, index % grid_cur->tile_cols);
+		}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdint.h>
+#include "grid.h"
+#include "bitlife.h"
+
+/*
+ * Grid packed in tiles of 64x64 cells, one word per tile row,
+ * with the tiles laid out in Z-order (Morton order of their
+ * tile row and column). The rows of a tile are contiguous and
+ * the tiles around it are mostly close by, so the neighbours
+ * of a cell above and below are one word away instead of a
+ * whole grid row. Column j of a tile lives in bit j of its
+ * row words; cells past the last row or column of the grid
+ * are kept at zero. Grids are converted from and to the
+ * row-major layout at the edges.
+ */
+
+#define TILEGRID_SIDE 64
+
+typedef struct
+{
+	int       rows;
+	int       cols;
+	int       tile_rows;
+	int       tile_cols;
+	long     *slot;
+	long     *order;
+	uint64_t *data;
+} TileGrid;
+
+#define TILEGRID_TILE(g,tr,tc) \
+	((g)->data + (g)->slot[(long) (tr) * (g)->tile_cols + (tc)] * TILEGRID_SIDE)
+
+#define TILEGRID_WORD(g,r,c) \
+	(TILEGRID_TILE (g, (r) >> 6, (c) >> 6)[(r) & 63])
+
+#define TILEGRID_GET(g,r,c) ( \
+		(int) ((TILEGRID_WORD (g, r, c) >> ((c) & 63)) & 1) \
+)
+
+#define TILEGRID_SET(g,r,c,x) do { \
+		uint64_t *__w = &TILEGRID_WORD (g, r, c); \
+		uint64_t __b = (uint64_t) 1 << ((c) & 63); \
+		*__w = (x) ? (*__w | __b) : (*__w & ~__b); \
+	} while (0)
+
+TileGrid * tilegrid_new        (int rows, int cols);
+void       tilegrid_free       (TileGrid *grid);
+void       tilegrid_clear      (TileGrid *grid);
+void       tilegrid_from_grid  (TileGrid *tile_grid, const Grid *grid);
+void       tilegrid_to_grid    (Grid *grid, const TileGrid *tile_grid);
+long       tilegrid_population (const TileGrid *grid);
+void       tilegrid_step       (TileGrid *grid_next, const TileGrid *grid_cur,
+                                const BitRule *rule);
@@ -0,0 +1,146 @@
+#include "trace.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include <assert.h>
+#include "wrapper.h"
+
+#define TRACE_RING_SIZE 4096
+
+typedef struct
+{
+	const char *name;
+	uint64_t    ts;
+	char        phase;
+} TraceEvent;
+
+typedef struct _TraceBuffer TraceBuffer;
+
+struct _TraceBuffer
+{
+	TraceEvent   events[TRACE_RING_SIZE];
+	int          len;
+	int          tid;
+	TraceBuffer *next;
+};
+
+int trace_enabled = 0;
+
+static FILE            *trace_fp      = NULL;
+static TraceBuffer     *trace_buffers = NULL;
+static int              trace_tids    = 0;
+static int              trace_first   = 1;
+static uint64_t         trace_epoch   = 0;
+static pthread_mutex_t  trace_lock    = PTHREAD_MUTEX_INITIALIZER;
+
+static __thread TraceBuffer *trace_buffer = NULL;
+
+static inline uint64_t
+trace_now (void)
+{
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// Called with trace_lock held
+static void
+trace_flush_buffer (TraceBuffer *buf)
+{
+	for (int i = 0; i < buf->len; i++)
+		{
+			const TraceEvent *e = &buf->events[i];
+
+			fprintf (trace_fp,
+					"%s\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%d}",
+					trace_first ? "" : ",", e->name, e->phase,
+					(e->ts - trace_epoch) / 1e3, buf->tid);
+
+			trace_first = 0;
+		}
+
+	buf->len = 0;
+}
+
+static TraceBuffer *
+trace_register_buffer (void)
+{
+	TraceBuffer *buf = xcalloc (1, sizeof (TraceBuffer));
+
+	pthread_mutex_lock (&trace_lock);
+
+	buf->tid = ++trace_tids;
+	buf->next = trace_buffers;
+	trace_buffers = buf;
+
+	pthread_mutex_unlock (&trace_lock);
+
+	return buf;
+}
+
+void
+trace_event (char phase, const char *name)
+{
+	TraceBuffer *buf = trace_buffer;
+
+	if (buf == NULL)
+		buf = trace_buffer = trace_register_buffer ();
+
+	if (buf->len == TRACE_RING_SIZE)
+		{
+			pthread_mutex_lock (&trace_lock);
+			trace_flush_buffer (buf);
+			pthread_mutex_unlock (&trace_lock);
+		}
+
+	buf->events[buf->len++] = (TraceEvent) {
+		.name  = name,
+		.ts    = trace_now (),
+		.phase = phase
+	};
+}
+
+void
+trace_start (const char *path)
+{
+	assert (path != NULL);
+	assert (trace_fp == NULL);
+
+	trace_fp = xfopen (path, "w");
+	trace_epoch = trace_now ();
+
+	fprintf (trace_fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+	trace_enabled = 1;
+}
+
+void
+trace_finish (void)
+{
+	if (trace_fp == NULL)
+		return;
+
+	trace_enabled = 0;
+
+	pthread_mutex_lock (&trace_lock);
+
+	// Workers are joined by now, so their buffers are quiescent
+	while (trace_buffers != NULL)
+		{
+			TraceBuffer *buf = trace_buffers;
+			trace_buffers = buf->next;
+
+			trace_flush_buffer (buf);
+			xfree (buf);
+		}
+
+	fprintf (trace_fp, "\n]}\n");
+	xfclose (trace_fp);
+	trace_fp = NULL;
+
+	pthread_mutex_unlock (&trace_lock);
+
+	trace_buffer = NULL;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+/*
+ * Trace points written as Chrome Trace Event JSON (viewable in
+ * Perfetto or chrome://tracing). Events go to a ring buffer per
+ * thread and are flushed to the file when it fills up and at
+ * trace_finish. When tracing is off a trace point costs a load
+ * and a branch; building with -DDISABLE_TRACE removes them.
+ */
+
+#ifdef DISABLE_TRACE
+
+#define TRACE_BEGIN(name) do {} while (0)
+#define TRACE_END(name)   do {} while (0)
+
+#else
+
+#define TRACE_BEGIN(name) do { \
+		if (trace_enabled) \
+			trace_event ('B', (name)); \
+	} while (0)
+
+#define TRACE_END(name) do { \
+		if (trace_enabled) \
+			trace_event ('E', (name)); \
+	} while (0)
+
+#endif
+
+extern int trace_enabled;
+
+void trace_start  (const char *path);
+void trace_event  (char phase, const char *name);
+void trace_finish (void);
@@ -0,0 +1,428 @@
+#include "universe.h"
+
+#include <string.h>
+#include <assert.h>
+#include "wrapper.h"
+#include "grid.h"
+#include "rule.h"
+#include "cell.h"
+#include "engine.h"
+#include "pattern.h"
+#include "bitgrid.h"
+#include "parallel.h"
+
+#define UNIVERSE_RULE     "conway"
+#define UNIVERSE_ENGINE   "auto"
+#define UNIVERSE_RLE_LINE 70
+#define UNIVERSE_READ     4096
+#define UNIVERSE_ERROR    256
+
+struct _Universe
+{
+	Grid   *grid_cur;
+	Grid   *grid_next;
+	Rule   *rule;
+	char   *rule_str;
+	Engine *engine;
+
+	long    gen;
+
+	// Counted when asked for, -1 until then
+	long    alive;
+
+	// Why the last pattern was not put, empty if it was
+	char    error[UNIVERSE_ERROR];
+};
+
+typedef struct
+{
+	FILE *fp;
+	int   width;
+} UniverseRle;
+
+Universe *
+universe_new (int rows, int cols, const char *rule, const char *engine, int threads)
+{
+	assert (rows > 0 && cols > 0);
+	assert (threads >= 0);
+
+	if (rule == NULL)
+		rule = UNIVERSE_RULE;
+
+	if (engine == NULL)
+		engine = UNIVERSE_ENGINE;
+
+	if (!rule_is_valid (rule) || !engine_is_valid (engine))
+		return NULL;
+
+	if (threads == 0)
+		threads = parallel_num_cpus ();
+
+	Universe *universe = xcalloc (1, sizeof (Universe));
+
+	*universe = (Universe) {
+		.grid_cur  = grid_new_banded (rows, cols, threads),
+		.grid_next = grid_new_banded (rows, cols, threads),
+		.rule      = rule_new (rule),
+		.rule_str  = xstrdup (rule)
+	};
+
+	universe->engine = engine_new (engine, rows, cols, universe->rule, threads);
+
+	return universe;
+}
+
+static inline int
+universe_region_is_valid (const Universe *universe, int row, int col,
+		int rows, int cols)
+{
+	return row >= 0 && col >= 0 && rows >= 0 && cols >= 0
+		&& rows <= universe->grid_cur->rows - row
+		&& cols <= universe->grid_cur->cols - col;
+}
+
+// The pattern replaces the cells under it
+int
+universe_put_pattern (Universe *universe, const char *pattern, int row, int col)
+{
+	assert (universe != NULL);
+	assert (pattern != NULL);
+
+	Pattern *p = pattern_load (pattern, universe->error, sizeof (universe->error));
+
+	if (p == NULL)
+		return -1;
+
+	const Grid *grid = p->grid;
+	int rc = -1;
+
+	if (universe_region_is_valid (universe, row, col, grid->rows, grid->cols))
+		{
+			for (int i = 0; i < grid->rows; i++)
+				memcpy (&GRID_GET (universe->grid_cur, row + i, col),
+						&GRID_GET (grid, i, 0), grid->cols * sizeof (int));
+
+			universe->alive = -1;
+			engine_reset (universe->engine);
+			rc = 0;
+		}
+	else
+		snprintf (universe->error, sizeof (universe->error),
+				"Pattern of %dx%d does not fit at (%d, %d)",
+				grid->rows, grid->cols, row, col);
+
+	pattern_free (p);
+
+	return rc;
+}
+
+/*
+ * In blocks of up to BITGRID_BLOCK_MAX generations, for the
+ * temporal engine to keep its tiles in cache and for auto to
+ * sample along the way
+ */
+void
+universe_step (Universe *universe, long gens)
+{
+	assert (universe != NULL);
+	assert (gens >= 0);
+
+	while (gens > 0)
+		{
+			int block = gens < BITGRID_BLOCK_MAX ? gens : BITGRID_BLOCK_MAX;
+			Cell cell = {0};
+
+			engine_step_many (universe->engine, universe->grid_next,
+					universe->grid_cur, block, &cell);
+
+			Grid *tmp = universe->grid_cur;
+			universe->grid_cur = universe->grid_next;
+			universe->grid_next = tmp;
+
+			universe->gen += block;
+			gens -= block;
+		}
+
+	universe->alive = -1;
+}
+
+long
+universe_generation (const Universe *universe)
+{
+	assert (universe != NULL);
+	return universe->gen;
+}
+
+long
+universe_population (Universe *universe)
+{
+	assert (universe != NULL);
+
+	if (universe->alive < 0)
+		{
+			const Grid *grid = universe->grid_cur;
+			long alive = 0;
+
+			for (long i = 0; i < (long) grid->rows * grid->cols; i++)
+				alive += grid->data[i];
+
+			universe->alive = alive;
+		}
+
+	return universe->alive;
+}
+
+// The box is in grid coordinates, a pattern across an edge spans it whole
+int
+universe_bounds (const Universe *universe, UniverseBox *box)
+{
+	assert (universe != NULL);
+	assert (box != NULL);
+
+	const Grid *grid = universe->grid_cur;
+	int top = -1, bottom = -1;
+	int left = grid->cols, right = -1;
+
+	for (int i = 0; i < grid->rows; i++)
+		for (int j = 0; j < grid->cols; j++)
+			if (GRID_GET (grid, i, j))
+				{
+					if (top < 0)
+						top = i;
+
+					bottom = i;
+
+					if (j < left)
+						left = j;
+
+					if (j > right)
+						right = j;
+				}
+
+	if (top < 0)
+		{
+			*box = (UniverseBox) {0};
+			return 0;
+		}
+
+	*box = (UniverseBox) {
+		.row  = top,
+		.col  = left,
+		.rows = bottom - top + 1,
+		.cols = right - left + 1
+	};
+
+	return 1;
+}
+
+int
+universe_read (const Universe *universe, int row, int col, int rows, int cols,
+		unsigned char *cells)
+{
+	assert (universe != NULL);
+	assert (cells != NULL || rows == 0 || cols == 0);
+
+	if (!universe_region_is_valid (universe, row, col, rows, cols))
+		return -1;
+
+	for (int i = 0; i < rows; i++)
+		{
+			const int *src = &GRID_GET (universe->grid_cur, row + i, col);
+			unsigned char *dst = cells + (long) i * cols;
+
+			for (int j = 0; j < cols; j++)
+				dst[j] = src[j];
+		}
+
+	return 0;
+}
+
+int
+universe_write (Universe *universe, int row, int col, int rows, int cols,
+		const unsigned char *cells)
+{
+	assert (universe != NULL);
+	assert (cells != NULL || rows == 0 || cols == 0);
+
+	if (!universe_region_is_valid (universe, row, col, rows, cols))
+		return -1;
+
+	for (int i = 0; i < rows; i++)
+		{
+			int *dst = &GRID_GET (universe->grid_cur, row + i, col);
+			const unsigned char *src = cells + (long) i * cols;
+
+			for (int j = 0; j < cols; j++)
+				dst[j] = src[j] != 0;
+		}
+
+	universe->alive = -1;
+	engine_reset (universe->engine);
+
+	return 0;
+}
+
+const char *
+universe_error (const Universe *universe)
+{
+	assert (universe != NULL);
+	return universe->error;
+}
+
+const char *
+universe_engine (const Universe *universe)
+{
+	assert (universe != NULL);
+	return engine_current (universe->engine);
+}
+
+static void
+universe_rle_put (UniverseRle *rle, int count, char tag)
+{
+	char run[16];
+	int len = count > 1
+		? snprintf (run, sizeof (run), "%d%c", count, tag)
+		: snprintf (run, sizeof (run), "%c", tag);
+
+	if (rle->width + len > UNIVERSE_RLE_LINE)
+		{
+			fputc ('\n', rle->fp);
+			rle->width = 0;
+		}
+
+	fputs (run, rle->fp);
+	rle->width += len;
+}
+
+/*
+ * As an RLE pattern the size of the grid, with the generation
+ * in a comment, which pattern_new and universe_load read back
+ */
+int
+universe_save (const Universe *universe, FILE *fp)
+{
+	assert (universe != NULL);
+	assert (fp != NULL);
+
+	const Grid *grid = universe->grid_cur;
+	UniverseRle rle = {.fp = fp};
+	int rows_pending = 0;
+
+	fprintf (fp, "#C generation %ld\n", universe->gen);
+	fprintf (fp, "x = %d, y = %d, rule = %s\n", grid->cols, grid->rows,
+			universe->rule_str);
+
+	for (int i = 0; i < grid->rows; i++)
+		{
+			int j = 0;
+
+			while (j < grid->cols)
+				{
+					int state = GRID_GET (grid, i, j);
+					int run = 1;
+
+					while (j + run < grid->cols && GRID_GET (grid, i, j + run) == state)
+						run++;
+
+					// Dead cells to the end of the row go without saying
+					if (state || j + run < grid->cols)
+						{
+							if (rows_pending > 0)
+								universe_rle_put (&rle, rows_pending, '$');
+
+							universe_rle_put (&rle, run, state ? 'o' : 'b');
+							rows_pending = 0;
+						}
+
+					j += run;
+				}
+
+			rows_pending++;
+		}
+
+	universe_rle_put (&rle, 1, '!');
+	fputc ('\n', fp);
+
+	return ferror (fp) ? -1 : 0;
+}
+
+static char *
+universe_slurp (FILE *fp)
+{
+	size_t size = UNIVERSE_READ, len = 0, n;
+	char *buf = xmalloc (size + 1);
+
+	while ((n = fread (buf + len, 1, size - len, fp)) > 0)
+		{
+			len += n;
+
+			if (len == size)
+				{
+					char *more = xmalloc (2 * size + 1);
+
+					memcpy (more, buf, len);
+					xfree (buf);
+
+					buf = more;
+					size *= 2;
+				}
+		}
+
+	buf[len] = '\0';
+
+	return buf;
+}
+
+Universe *
+universe_load (FILE *fp, const char *engine, int threads)
+{
+	assert (fp != NULL);
+
+	char *buf = universe_slurp (fp);
+	const char *comment = strstr (buf, "#C generation ");
+	long gen = 0;
+
+	if (comment != NULL)
+		sscanf (comment, "#C generation %ld", &gen);
+
+	Pattern *pattern = pattern_new_from_rle (buf, NULL, 0);
+	Universe *universe = NULL;
+
+	xfree (buf);
+
+	if (pattern == NULL)
+		return NULL;
+
+	const Grid *grid = pattern->grid;
+
+	universe = universe_new (grid->rows, grid->cols, pattern->header.rule,
+			engine, threads);
+
+	if (universe != NULL)
+		{
+			memcpy (universe->grid_cur->data, grid->data,
+					(size_t) grid->rows * grid->cols * sizeof (int));
+
+			universe->gen = gen;
+			universe->alive = -1;
+		}
+
+	pattern_free (pattern);
+
+	return universe;
+}
+
+void
+universe_free (Universe *universe)
+{
+	if (universe == NULL)
+		return;
+
+	engine_free (universe->engine);
+	rule_free (universe->rule);
+	grid_free (universe->grid_cur);
+	grid_free (universe->grid_next);
+
+	xfree (universe->rule_str);
+	xfree (universe);
+}
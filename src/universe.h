@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdio.h>
+
+/*
+ * Library interface to a universe: a toroidal grid, a rule and
+ * the engine that steps it, with nothing of the terminal. It is
+ * what libconga_core.a is built around, and needs no ncurses to
+ * link. Cells are bytes, 0 dead and 1 alive, in row-major order.
+ *
+ * Names that come from data (rules, engines, patterns, saved
+ * universes) are checked and give NULL or -1 when invalid; the
+ * rest are preconditions. Nothing is printed: universe_error says
+ * why the last pattern could not be put. A universe is used by
+ * one thread at a time.
+ */
+
+typedef struct _Universe Universe;
+
+typedef struct
+{
+	int row;
+	int col;
+	int rows;
+	int cols;
+} UniverseBox;
+
+Universe *   universe_new         (int rows, int cols, const char *rule,
+                                   const char *engine, int threads);
+int          universe_put_pattern (Universe *universe, const char *pattern,
+                                   int row, int col);
+void         universe_step        (Universe *universe, long gens);
+long         universe_generation  (const Universe *universe);
+long         universe_population  (Universe *universe);
+int          universe_bounds      (const Universe *universe, UniverseBox *box);
+int          universe_read        (const Universe *universe, int row, int col,
+                                   int rows, int cols, unsigned char *cells);
+int          universe_write       (Universe *universe, int row, int col,
+                                   int rows, int cols, const unsigned char *cells);
+const char * universe_error       (const Universe *universe);
+const char * universe_engine      (const Universe *universe);
+int          universe_save        (const Universe *universe, FILE *fp);
+Universe *   universe_load        (FILE *fp, const char *engine, int threads);
+void         universe_free        (Universe *universe);
@@ -2,8 +2,25 @@
 
 #include <check.h>
 
-Suite * make_wrapper_suite (void);
-Suite * make_rand_suite    (void);
-Suite * make_utils_suite   (void);
-Suite * make_rule_suite    (void);
-Suite * make_pattern_suite (void);
+Suite * make_wrapper_suite  (void);
+Suite * make_rand_suite     (void);
+Suite * make_utils_suite    (void);
+Suite * make_rule_suite     (void);
+Suite * make_pattern_suite  (void);
+Suite * make_delta_suite    (void);
+Suite * make_history_suite  (void);
+Suite * make_ensemble_suite (void);
+Suite * make_bitgrid_suite  (void);
+Suite * make_tilegrid_suite (void);
+Suite * make_engine_suite   (void);
+Suite * make_render_suite   (void);
+Suite * make_frames_suite   (void);
+Suite * make_shm_suite      (void);
+Suite * make_stream_suite   (void);
+Suite * make_domain_suite   (void);
+Suite * make_diskgrid_suite (void);
+Suite * make_pages_suite    (void);
+Suite * make_steal_suite    (void);
+Suite * make_universe_suite (void);
+Suite * make_sweep_suite    (void);
+Suite * make_soup_suite     (void);
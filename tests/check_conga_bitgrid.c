@@ -0,0 +1,118 @@
+#include "check_conga.h"
+
+#include "../src/grid.h"
+#include "../src/cell.h"
+#include "../src/rule.h"
+#include "../src/rand.h"
+#include "../src/bitgrid.h"
+
+#define GENS  30
+#define SEED  17
+
+static const int dims[][2] =
+{
+	{1,  1},
+	{1,  70},
+	{5,  64},
+	{7,  63},
+	{13, 65},
+	{3,  129},
+	{31, 200}
+};
+
+START_TEST (test_bitgrid_roundtrip)
+{
+	Grid *grid = grid_new (dims[_i][0], dims[_i][1]);
+	Grid *back = grid_new (dims[_i][0], dims[_i][1]);
+	BitGrid *bit_grid = bitgrid_new (dims[_i][0], dims[_i][1]);
+	Rand *rng = rand_new (SEED);
+
+	cell_seed_random_generation (grid, rng, 0.5, NULL);
+
+	bitgrid_from_grid (bit_grid, grid);
+	bitgrid_to_grid (back, bit_grid);
+
+	long alive = 0;
+	for (int i = 0; i < grid->rows * grid->cols; i++)
+		{
+			ck_assert_int_eq (grid->data[i], back->data[i]);
+			alive += grid->data[i];
+		}
+
+	ck_assert_int_eq (bitgrid_population (bit_grid), alive);
+
+	rand_free (rng);
+	bitgrid_free (bit_grid);
+	grid_free (grid);
+	grid_free (back);
+}
+END_TEST
+
+START_TEST (test_bitgrid_step)
+{
+	int rows = dims[_i][0], cols = dims[_i][1];
+
+	Grid *grid_cur  = grid_new (rows, cols);
+	Grid *grid_next = grid_new (rows, cols);
+	Grid *check     = grid_new (rows, cols);
+
+	BitGrid *bit_cur  = bitgrid_new (rows, cols);
+	BitGrid *bit_next = bitgrid_new (rows, cols);
+
+	Rule *rule = rule_new ("B36/S23");
+	Rand *rng = rand_new (SEED);
+	BitRule bit_rule;
+
+	bitlife_rule_init (&bit_rule, rule);
+	cell_seed_random_generation (grid_cur, rng, 0.4, NULL);
+	bitgrid_from_grid (bit_cur, grid_cur);
+
+	for (int g = 0; g < GENS; g++)
+		{
+			cell_step_generation (grid_next, grid_cur, rule, NULL);
+			bitgrid_step (bit_next, bit_cur, &bit_rule);
+
+			bitgrid_to_grid (check, bit_next);
+
+			for (int i = 0; i < rows * cols; i++)
+				ck_assert_int_eq (check->data[i], grid_next->data[i]);
+
+			Grid *tmp = grid_cur;
+			grid_cur = grid_next;
+			grid_next = tmp;
+
+			BitGrid *bit_tmp = bit_cur;
+			bit_cur = bit_next;
+			bit_next = bit_tmp;
+		}
+
+	rand_free (rng);
+	rule_free (rule);
+	bitgrid_free (bit_cur);
+	bitgrid_free (bit_next);
+	grid_free (grid_cur);
+	grid_free (grid_next);
+	grid_free (check);
+}
+END_TEST
+
+Suite *
+make_bitgrid_suite (void)
+{
+	Suite *s;
+	TCase *tc_core;
+
+	int num_dims = sizeof (dims) / sizeof (dims[0]);
+
+	s = suite_create ("BitGrid");
+
+	/* Core test case */
+	tc_core = tcase_create ("Core");
+
+	tcase_add_loop_test (tc_core, test_bitgrid_roundtrip, 0, num_dims);
+	tcase_add_loop_test (tc_core, test_bitgrid_step, 0, num_dims);
+
+	suite_add_tcase (s, tc_core);
+
+	return s;
+}
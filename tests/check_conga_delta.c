@@ -0,0 +1,196 @@
+#include "check_conga.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "../src/wrapper.h"
+#include "../src/grid.h"
+#include "../src/delta.h"
+
+#define ROWS 7
+#define COLS 9
+
+static Grid *grid_cur  = NULL;
+static Grid *grid_next = NULL;
+
+static void
+setup (void)
+{
+	grid_cur  = grid_new (ROWS, COLS);
+	grid_next = grid_new (ROWS, COLS);
+
+	// Blinker going from horizontal to vertical
+	GRID_SET (grid_cur,  3, 3, 1);
+	GRID_SET (grid_cur,  3, 4, 1);
+	GRID_SET (grid_cur,  3, 5, 1);
+
+	GRID_SET (grid_next, 2, 4, 1);
+	GRID_SET (grid_next, 3, 4, 1);
+	GRID_SET (grid_next, 4, 4, 1);
+}
+
+static void
+teardown (void)
+{
+	grid_free (grid_cur);
+	grid_free (grid_next);
+}
+
+START_TEST (test_varint)
+{
+	uint64_t vals[] = {0, 1, 127, 128, 300, 16384, (uint64_t) -1};
+	uint8_t buf[16];
+	uint64_t x = 0;
+
+	for (int i = 0; i < sizeof (vals) / sizeof (uint64_t); i++)
+		{
+			size_t len = delta_put_varint (buf, vals[i]);
+			ck_assert_int_eq (delta_get_varint (buf, len, &x), len);
+			ck_assert (x == vals[i]);
+		}
+
+	// Truncated
+	delta_put_varint (buf, 300);
+	ck_assert_int_eq (delta_get_varint (buf, 1, &x), 0);
+}
+END_TEST
+
+START_TEST (test_delta_encode)
+{
+	Delta delta;
+	delta_init (&delta);
+
+	delta_encode (&delta, grid_next, grid_cur, NULL);
+
+	ck_assert_int_eq (delta.births, 2);
+	ck_assert_int_eq (delta.deaths, 2);
+
+	// 2 counts + 4 one byte gaps
+	ck_assert_int_eq (delta.len, 6);
+
+	// No changes
+	delta_encode (&delta, grid_cur, grid_cur, NULL);
+	ck_assert_int_eq (delta.births, 0);
+	ck_assert_int_eq (delta.deaths, 0);
+	ck_assert_int_eq (delta.len, 2);
+
+	delta_destroy (&delta);
+}
+END_TEST
+
+START_TEST (test_delta_encode_changes)
+{
+	Delta full, part;
+	delta_init (&full);
+	delta_init (&part);
+
+	// Tiles of 2x4 cells, the blinker in rows 2..4 and columns 3..5
+	uint8_t map[4 * 3] = {0};
+	GridChanges changes = {map, 4, 3, 2, 4};
+
+	map[1 * 3 + 0] = map[1 * 3 + 1] = map[2 * 3 + 1] = 1;
+
+	delta_encode (&full, grid_next, grid_cur, NULL);
+	delta_encode (&part, grid_next, grid_cur, &changes);
+
+	ck_assert_int_eq (part.len, full.len);
+	ck_assert (memcmp (part.data, full.data, full.len) == 0);
+
+	// Cells out of the map are not looked at
+	map[1 * 3 + 0] = 0;
+	delta_encode (&part, grid_next, grid_cur, &changes);
+
+	ck_assert_int_eq (part.births, 2);
+	ck_assert_int_eq (part.deaths, 1);
+
+	delta_destroy (&full);
+	delta_destroy (&part);
+}
+END_TEST
+
+START_TEST (test_delta_apply)
+{
+	Delta delta;
+	delta_init (&delta);
+
+	delta_encode (&delta, grid_next, grid_cur, NULL);
+
+	// Forward
+	delta_apply (grid_cur, delta.data, delta.len);
+	for (int i = 0; i < ROWS * COLS; i++)
+		ck_assert_int_eq (grid_cur->data[i], grid_next->data[i]);
+
+	// Backward
+	delta_apply (grid_cur, delta.data, delta.len);
+	ck_assert_int_eq (GRID_GET (grid_cur, 3, 3), 1);
+	ck_assert_int_eq (GRID_GET (grid_cur, 2, 4), 0);
+
+	delta_destroy (&delta);
+}
+END_TEST
+
+START_TEST (test_delta_writer)
+{
+	char path[] = "/tmp/pongaXXXXXX";
+	int fd = mkstemp (path);
+	close (fd);
+
+	DeltaWriter *writer = delta_writer_new (path, ROWS, COLS);
+	delta_writer_write (writer, grid_next, grid_cur, NULL, 1);
+	delta_writer_write (writer, grid_cur, grid_next, NULL, 2);
+	delta_writer_free (writer);
+
+	FILE *fp = xfopen (path, "rb");
+	uint8_t buf[64];
+	size_t len = fread (buf, 1, sizeof (buf), fp);
+	xfclose (fp);
+
+	// magic + version + rows + cols + 2 * (gen + delta)
+	ck_assert_int_eq (len, 4 + 1 + 1 + 1 + 2 * (1 + 6));
+	ck_assert (memcmp (buf, DELTA_MAGIC, 4) == 0);
+	ck_assert_int_eq (buf[4], DELTA_VERSION);
+	ck_assert_int_eq (buf[5], ROWS);
+	ck_assert_int_eq (buf[6], COLS);
+
+	unlink (path);
+}
+END_TEST
+
+START_TEST (test_delta_apply_truncated)
+{
+	uint8_t buf[] = {0x02};
+	delta_apply (grid_cur, buf, sizeof (buf));
+}
+END_TEST
+
+Suite *
+make_delta_suite (void)
+{
+	Suite *s;
+	TCase *tc_core;
+	TCase *tc_abort;
+
+	s = suite_create ("Delta");
+
+	/* Core test case */
+	tc_core = tcase_create ("Core");
+
+	tcase_add_checked_fixture (tc_core, setup, teardown);
+	tcase_add_test (tc_core, test_varint);
+	tcase_add_test (tc_core, test_delta_encode);
+	tcase_add_test (tc_core, test_delta_encode_changes);
+	tcase_add_test (tc_core, test_delta_apply);
+	tcase_add_test (tc_core, test_delta_writer);
+
+	/* Abort test case */
+	tc_abort = tcase_create ("Abort");
+
+	tcase_add_checked_fixture (tc_abort, setup, teardown);
+	tcase_add_exit_test (tc_abort,
+			test_delta_apply_truncated, EXIT_FAILURE);
+
+	suite_add_tcase (s, tc_core);
+	suite_add_tcase (s, tc_abort);
+
+	return s;
+}
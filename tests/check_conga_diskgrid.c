@@ -0,0 +1,117 @@
+#include "check_conga.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "../src/config.h"
+#include "../src/rule.h"
+#include "../src/bitgrid.h"
+#include "../src/diskgrid.h"
+
+#define ROWS 70
+#define COLS 130
+
+static char path[64];
+static char path_next[64];
+
+static void
+setup (void)
+{
+	snprintf (path, sizeof (path), "/tmp/check_conga_%d.bin", (int) getpid ());
+	snprintf (path_next, sizeof (path_next), "%s%s", path, DISKGRID_NEXT);
+	unlink (path);
+}
+
+static void
+teardown (void)
+{
+	unlink (path);
+}
+
+static void
+step_memory (BitGrid *cur, BitGrid *next, int gens)
+{
+	BitRule bit_rule;
+	Rule *rule = rule_new ("conway");
+
+	bitlife_rule_init (&bit_rule, rule);
+
+	for (int g = 0; g < gens; g++)
+		{
+			bitgrid_step (next, cur, &bit_rule);
+
+			uint64_t *tmp = cur->data;
+			cur->data = next->data;
+			next->data = tmp;
+		}
+
+	rule_free (rule);
+}
+
+START_TEST (test_diskgrid_step)
+{
+	Config *cfg = config_new ();
+
+	cfg->rows = ROWS;
+	cfg->cols = COLS;
+	cfg->seed = 11;
+	cfg->generations = 7;
+	cfg->band_rows = 3;
+	cfg->disk_grid = path;
+
+	DiskGrid *disk = diskgrid_new (cfg);
+	BitGrid *cur = bitgrid_new (ROWS, COLS);
+	BitGrid *next = bitgrid_new (ROWS, COLS);
+	long size = (long) cur->rows * cur->words * sizeof (uint64_t);
+
+	memcpy (cur->data, diskgrid_cells (disk)->data, size);
+	ck_assert_int_eq (diskgrid_population (disk), bitgrid_population (cur));
+
+	diskgrid_run (disk);
+	step_memory (cur, next, 7);
+
+	ck_assert_int_eq (diskgrid_gen (disk), 7);
+	ck_assert_int_eq (diskgrid_population (disk), bitgrid_population (cur));
+	ck_assert (memcmp (diskgrid_cells (disk)->data, cur->data, size) == 0);
+
+	diskgrid_free (disk);
+
+	ck_assert_int_eq (access (path, F_OK), 0);
+	ck_assert_int_ne (access (path_next, F_OK), 0);
+
+	// An existing file is continued, whatever the band size
+	cfg->generations = 4;
+	cfg->band_rows = 0;
+
+	disk = diskgrid_new (cfg);
+	diskgrid_run (disk);
+	step_memory (cur, next, 4);
+
+	ck_assert_int_eq (diskgrid_gen (disk), 11);
+	ck_assert (memcmp (diskgrid_cells (disk)->data, cur->data, size) == 0);
+
+	diskgrid_free (disk);
+	bitgrid_free (cur);
+	bitgrid_free (next);
+	config_free (cfg);
+}
+END_TEST
+
+Suite *
+make_diskgrid_suite (void)
+{
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create ("DiskGrid");
+
+	/* Core test case */
+	tc_core = tcase_create ("Core");
+	tcase_add_checked_fixture (tc_core, setup, teardown);
+
+	tcase_add_test (tc_core, test_diskgrid_step);
+
+	suite_add_tcase (s, tc_core);
+
+	return s;
+}
@@ -0,0 +1,131 @@
+#include "check_conga.h"
+
+#include "../src/config.h"
+#include "../src/grid.h"
+#include "../src/cell.h"
+#include "../src/rule.h"
+#include "../src/rand.h"
+#include "../src/domain.h"
+
+#define GENS 40
+
+START_TEST (test_domain_layout)
+{
+	DomainLayout layout;
+	long cells = 0;
+
+	// Cut across the longest side
+	domain_layout_init (&layout, 6, 300, 200, 1);
+	ck_assert_int_eq (layout.py, 3);
+	ck_assert_int_eq (layout.px, 2);
+
+	for (int r = 0; r < layout.ranks; r++)
+		{
+			int row, col, rows, cols;
+			domain_bounds (&layout, r, &row, &col, &rows, &cols);
+
+			ck_assert_int_eq (row, 100 * (r / 2));
+			ck_assert_int_eq (col, 100 * (r % 2));
+			cells += (long) rows * cols;
+		}
+
+	ck_assert_int_eq (cells, 300 * 200);
+
+	// The torus wraps on both axes
+	ck_assert_int_eq (domain_neighbor (&layout, 0, 0, 0), 1);
+	ck_assert_int_eq (domain_neighbor (&layout, 0, 1, 0), 4);
+	ck_assert_int_eq (domain_neighbor (&layout, 5, 1, 1), 1);
+	ck_assert_int_eq (domain_neighbor (&layout, 5, 0, 1), 4);
+}
+END_TEST
+
+static void
+check_domain (const char *transport, int ranks, int rows, int cols, int halo)
+{
+	Config *cfg = config_new ();
+
+	cfg->rows = rows;
+	cfg->cols = cols;
+	cfg->seed = 42;
+	cfg->generations = GENS;
+	cfg->ranks = ranks;
+	cfg->halo = halo;
+	cfg->transport = transport;
+
+	Domain *domain = domain_new (cfg);
+	domain_run (domain);
+
+	// The same run in one piece
+	Grid *cur = grid_new (rows, cols);
+	Grid *next = grid_new (rows, cols);
+	Rule *rule = rule_new (cfg->rule);
+	Rand *rng = rand_new (cfg->seed);
+	Cell cell = {0};
+
+	cell_seed_random_generation (cur, rng, cfg->live_percent, NULL);
+
+	for (int gen = 0; gen < GENS; gen++)
+		{
+			cell_step_generation (next, cur, rule, &cell);
+
+			Grid *tmp = cur;
+			cur = next;
+			next = tmp;
+		}
+
+	long population = 0;
+	for (int i = 0; i < rows * cols; i++)
+		population += cur->data[i];
+
+	ck_assert_int_eq (domain_population (domain), population);
+	ck_assert (domain_checksum (domain) == domain_grid_checksum (cur));
+
+	domain_free (domain);
+	rand_free (rng);
+	rule_free (rule);
+	grid_free (cur);
+	grid_free (next);
+	config_free (cfg);
+}
+
+START_TEST (test_domain_shm)
+{
+	check_domain ("shm", 4, 50, 70, 1);
+	check_domain ("shm", 3, 31, 29, 4);
+}
+END_TEST
+
+START_TEST (test_domain_unix)
+{
+	check_domain ("unix", 4, 50, 70, 3);
+	check_domain ("unix", 2, 20, 61, 1);
+}
+END_TEST
+
+START_TEST (test_domain_tcp)
+{
+	check_domain ("tcp", 6, 45, 40, 2);
+	check_domain ("tcp", 1, 17, 23, 5);
+}
+END_TEST
+
+Suite *
+make_domain_suite (void)
+{
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create ("Domain");
+
+	/* Core test case */
+	tc_core = tcase_create ("Core");
+
+	tcase_add_test (tc_core, test_domain_layout);
+	tcase_add_test (tc_core, test_domain_shm);
+	tcase_add_test (tc_core, test_domain_unix);
+	tcase_add_test (tc_core, test_domain_tcp);
+
+	suite_add_tcase (s, tc_core);
+
+	return s;
+}
@@ -0,0 +1,529 @@
+#include "check_conga.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "../src/grid.h"
+#include "../src/cell.h"
+#include "../src/rule.h"
+#include "../src/rand.h"
+#include "../src/engine.h"
+#include "../src/bitgrid.h"
+
+#define GENS          40
+#define SEED          23
+#define RANDOM_RULES  16
+#define THREADS       3
+
+#define FNV_OFFSET    0xcbf29ce484222325ULL
+#define FNV_PRIME     0x100000001b3ULL
+
+// 1xN, Nx1, primes and sizes around the 64 bit word
+static const int dims[][2] =
+{
+	{1,   1},
+	{1,   67},
+	{67,  1},
+	{2,   2},
+	{7,   13},
+	{31,  67},
+	{3,   129},
+	{64,  64},
+	{61,  127},
+	{5,   191}
+};
+
+static uint64_t
+grid_hash (const Grid *grid)
+{
+	uint64_t hash = FNV_OFFSET;
+
+	for (int i = 0; i < grid->rows * grid->cols; i++)
+		{
+			hash ^= (uint64_t) grid->data[i];
+			hash *= FNV_PRIME;
+		}
+
+	return hash;
+}
+
+static void
+swap_grids (Grid **a, Grid **b)
+{
+	Grid *tmp = *a;
+	*a = *b;
+	*b = tmp;
+}
+
+/*
+ * Run the dense reference and the engine side by side from
+ * the same random grid, comparing the hash of every generation
+ * and reporting the first divergent cell
+ */
+static void
+engine_diff (const char *name, const char *rule_str, int rows, int cols, long seed)
+{
+	Grid *ref_cur  = grid_new (rows, cols);
+	Grid *ref_next = grid_new (rows, cols);
+	Grid *cur      = grid_new (rows, cols);
+	Grid *next     = grid_new (rows, cols);
+
+	Rule *rule = rule_new (rule_str);
+	Rand *rng = rand_new (seed);
+
+	Cell ref_cell = {0};
+	Cell cell = {0};
+
+	cell_seed_random_generation (ref_cur, rng, 0.4, NULL);
+	cell_seed_from_grid (cur, ref_cur, NULL);
+
+	Engine *engine = engine_new (name, rows, cols, rule, THREADS);
+
+	for (int g = 1; g <= GENS; g++)
+		{
+			cell_step_generation (ref_next, ref_cur, rule, &ref_cell);
+			engine_step (engine, next, cur, &cell);
+
+			if (grid_hash (next) != grid_hash (ref_next))
+				for (int i = 0; i < rows; i++)
+					for (int j = 0; j < cols; j++)
+						if (GRID_GET (next, i, j) != GRID_GET (ref_next, i, j))
+							ck_abort_msg ("engine '%s' diverges from dense at gen %d, "
+									"cell (%d, %d): %d != %d [rule %s, %dx%d, seed %ld]",
+									name, g, i, j, GRID_GET (next, i, j),
+									GRID_GET (ref_next, i, j), rule_str, rows, cols, seed);
+
+			ck_assert_msg (cell.alive == ref_cell.alive && cell.gen == ref_cell.gen,
+					"engine '%s' cell count diverges from dense at gen %d [rule %s, %dx%d]",
+					name, g, rule_str, rows, cols);
+
+			swap_grids (&ref_cur, &ref_next);
+			swap_grids (&cur, &next);
+		}
+
+	engine_free (engine);
+	rand_free (rng);
+	rule_free (rule);
+	grid_free (ref_cur);
+	grid_free (ref_next);
+	grid_free (cur);
+	grid_free (next);
+}
+
+START_TEST (test_engine_rule_aliases)
+{
+	for (const EngineDef *def = engine_defs; def->name != NULL; def++)
+		for (const RuleAlias *a = rule_aliases; a->name != NULL; a++)
+			engine_diff (def->name, a->name, dims[_i][0], dims[_i][1], SEED);
+}
+END_TEST
+
+START_TEST (test_engine_random_rules)
+{
+	Rand *rng = rand_new (SEED + _i);
+	char rule[32];
+
+	for (int r = 0; r < RANDOM_RULES; r++)
+		{
+			int birth = RAND_INT (rng, 1 << 9);
+			int survive = RAND_INT (rng, 1 << 9);
+			char *p = rule;
+
+			*p++ = 'B';
+			for (int n = 0; n < 9; n++)
+				if (birth & (1 << n))
+					*p++ = '0' + n;
+
+			*p++ = '/';
+			*p++ = 'S';
+			for (int n = 0; n < 9; n++)
+				if (survive & (1 << n))
+					*p++ = '0' + n;
+
+			*p = '\0';
+
+			for (const EngineDef *def = engine_defs; def->name != NULL; def++)
+				engine_diff (def->name, rule, dims[_i][0], dims[_i][1], SEED + r);
+		}
+
+	rand_free (rng);
+}
+END_TEST
+
+// Several tiles of the temporal engine, with a partial last one
+static const int dims_many[][2] =
+{
+	{300, 1100},
+	{513, 65},
+	{1,   2049}
+};
+
+static const int gens_many[] = {1, 2, 7, BITGRID_BLOCK_MAX + 5};
+
+/*
+ * engine_step_many against as many dense generations, same
+ * grid and Cell accounting
+ */
+static void
+engine_diff_many (const char *name, int rows, int cols, int gens, long seed)
+{
+	Grid *ref_cur  = grid_new (rows, cols);
+	Grid *ref_next = grid_new (rows, cols);
+	Grid *cur      = grid_new (rows, cols);
+	Grid *next     = grid_new (rows, cols);
+
+	Rule *rule = rule_new ("conway");
+	Rand *rng = rand_new (seed);
+
+	Cell ref_cell = {0};
+	Cell cell = {0};
+
+	cell_seed_random_generation (ref_cur, rng, 0.4, NULL);
+	cell_seed_from_grid (cur, ref_cur, NULL);
+
+	Engine *engine = engine_new (name, rows, cols, rule, THREADS);
+
+	for (int g = 0; g < gens; g++)
+		{
+			cell_step_generation (ref_next, ref_cur, rule, &ref_cell);
+			swap_grids (&ref_cur, &ref_next);
+		}
+
+	engine_step_many (engine, next, cur, gens, &cell);
+
+	for (int i = 0; i < rows; i++)
+		for (int j = 0; j < cols; j++)
+			if (GRID_GET (next, i, j) != GRID_GET (ref_cur, i, j))
+				ck_abort_msg ("engine '%s' diverges from dense after %d gens, "
+						"cell (%d, %d): %d != %d [%dx%d]", name, gens, i, j,
+						GRID_GET (next, i, j), GRID_GET (ref_cur, i, j), rows, cols);
+
+	ck_assert_msg (cell.alive == ref_cell.alive && cell.gen == ref_cell.gen,
+			"engine '%s' cell count diverges from dense after %d gens [%dx%d]",
+			name, gens, rows, cols);
+
+	engine_free (engine);
+	rand_free (rng);
+	rule_free (rule);
+	grid_free (ref_cur);
+	grid_free (ref_next);
+	grid_free (cur);
+	grid_free (next);
+}
+
+START_TEST (test_engine_step_many)
+{
+	int num_gens = sizeof (gens_many) / sizeof (gens_many[0]);
+
+	for (const EngineDef *def = engine_defs; def->name != NULL; def++)
+		for (int g = 0; g < num_gens; g++)
+			{
+				engine_diff_many (def->name, dims_many[_i][0], dims_many[_i][1],
+						gens_many[g], SEED + g);
+
+				for (int d = 0; d < sizeof (dims) / sizeof (dims[0]); d++)
+					engine_diff_many (def->name, dims[d][0], dims[d][1],
+							gens_many[g], SEED + d);
+			}
+}
+END_TEST
+
+/*
+ * Steps auto against dense from grid, flipping a cell before
+ * gen edit_at, and returns what auto logged and in current the
+ * engine it stepped with before the flip
+ */
+static char *
+engine_auto_run (Grid *grid, int threads, int gens, int edit_at,
+		const char **current)
+{
+	static char log[4096];
+
+	Grid *ref_next = grid_new (grid->rows, grid->cols);
+	Grid *ref_cur  = grid_new (grid->rows, grid->cols);
+	Grid *next     = grid_new (grid->rows, grid->cols);
+	Grid *cur      = grid;
+
+	Rule *rule = rule_new ("conway");
+	FILE *fp = tmpfile ();
+
+	Cell ref_cell = {0};
+	Cell cell = {0};
+
+	cell_seed_from_grid (ref_cur, grid, NULL);
+
+	Engine *engine = engine_new ("auto", grid->rows, grid->cols, rule, threads);
+	engine_set_log (engine, fp);
+
+	for (int g = 1; g <= gens; g++)
+		{
+			if (g == edit_at)
+				{
+					GRID_SET (cur, 0, 0, !GRID_GET (cur, 0, 0));
+					GRID_SET (ref_cur, 0, 0, !GRID_GET (ref_cur, 0, 0));
+					engine_reset (engine);
+				}
+
+			cell_step_generation (ref_next, ref_cur, rule, &ref_cell);
+			engine_step (engine, next, cur, &cell);
+
+			ck_assert_msg (grid_hash (next) == grid_hash (ref_next)
+					&& cell.alive == ref_cell.alive,
+					"engine 'auto' diverges from dense at gen %d on %s", g,
+					engine_current (engine));
+
+			swap_grids (&ref_cur, &ref_next);
+			swap_grids (&cur, &next);
+
+			if (g == edit_at - 1 && current != NULL)
+				*current = engine_current (engine);
+		}
+
+	rewind (fp);
+	log[fread (log, 1, sizeof (log) - 1, fp)] = '\0';
+	fclose (fp);
+
+	engine_free (engine);
+	rule_free (rule);
+	grid_free (ref_cur);
+	grid_free (ref_next);
+	grid_free (cur == grid ? next : cur);
+
+	return log;
+}
+
+START_TEST (test_engine_auto_cycle)
+{
+	Grid *grid = grid_new (64, 64);
+	const char *current = NULL;
+
+	// A blinker is replayed, until an edit breaks the cycle
+	GRID_SET (grid, 10, 10, 1);
+	GRID_SET (grid, 10, 11, 1);
+	GRID_SET (grid, 10, 12, 1);
+
+	char *log = engine_auto_run (grid, 1, 80, 60, &current);
+
+	ck_assert_str_eq (current, "cycle");
+	ck_assert_msg (strstr (log, "-> cycle: repeats every 2 generations") != NULL,
+			"no switch to the cycle in:\n%s", log);
+	ck_assert_msg (strstr (log, "cycle -> bitpack: the grid left the cycle") != NULL,
+			"no switch out of the cycle in:\n%s", log);
+
+	grid_free (grid);
+}
+END_TEST
+
+START_TEST (test_engine_auto_switch)
+{
+	Grid *grid = grid_new (512, 512);
+
+	// A glider changes only the tiles around it
+	GRID_SET (grid, 1, 2, 1);
+	GRID_SET (grid, 2, 3, 1);
+	GRID_SET (grid, 3, 1, 1);
+	GRID_SET (grid, 3, 2, 1);
+	GRID_SET (grid, 3, 3, 1);
+
+	char *log = engine_auto_run (grid, THREADS, 80, 0, NULL);
+
+	ck_assert_msg (strstr (log, "engine bitpack -> steal: few tiles change") != NULL,
+			"no switch to steal in:\n%s", log);
+
+	grid_free (grid);
+}
+END_TEST
+
+/*
+ * steal against dense on a grid where few tiles change, stepped
+ * as its own output, after an edit, from a grid of its own and
+ * several generations at once
+ */
+START_TEST (test_engine_steal_follows)
+{
+	int rows = 300, cols = 1100;
+
+	Grid *ref_cur  = grid_new (rows, cols);
+	Grid *ref_next = grid_new (rows, cols);
+	Grid *cur      = grid_new (rows, cols);
+	Grid *next     = grid_new (rows, cols);
+	Grid *other    = grid_new (rows, cols);
+
+	Rule *rule = rule_new ("conway");
+	Rand *rng = rand_new (SEED);
+	Engine *engine = engine_new ("steal", rows, cols, rule, THREADS);
+
+	Cell ref_cell = {0};
+	Cell cell = {0};
+
+	// A soup in one corner, across the edges of the grid
+	for (int i = -20; i < 20; i++)
+		for (int j = -20; j < 20; j++)
+			GRID_SET (ref_cur, (i + rows) % rows, (j + cols) % cols,
+					RAND_INT (rng, 100) < 40);
+
+	cell_seed_from_grid (cur, ref_cur, NULL);
+
+	for (int g = 1; g <= 3 * GENS; g++)
+		{
+			int gens = 1;
+
+			if (g == GENS)
+				{
+					// Written behind its back
+					GRID_SET (cur, rows / 2, cols / 2, 1);
+					GRID_SET (cur, rows / 2, cols / 2 + 1, 1);
+					GRID_SET (cur, rows / 2, cols / 2 + 2, 1);
+					cell_seed_from_grid (ref_cur, cur, NULL);
+					engine_reset (engine);
+				}
+			else if (g == GENS + 10)
+				{
+					// Not the grid it stepped into
+					cell_seed_from_grid (other, cur, NULL);
+					swap_grids (&cur, &other);
+				}
+			else if (g > 2 * GENS)
+				gens = 1 + g % 3;
+
+			for (int k = 0; k < gens; k++)
+				{
+					cell_step_generation (ref_next, ref_cur, rule, &ref_cell);
+					swap_grids (&ref_cur, &ref_next);
+				}
+
+			engine_step_many (engine, next, cur, gens, &cell);
+
+			ck_assert_msg (grid_hash (next) == grid_hash (ref_cur),
+					"engine 'steal' diverges from dense at gen %d", ref_cell.gen);
+			ck_assert_int_eq (cell.alive, ref_cell.alive);
+
+			swap_grids (&cur, &next);
+		}
+
+	engine_free (engine);
+	rand_free (rng);
+	rule_free (rule);
+	grid_free (ref_cur);
+	grid_free (ref_next);
+	grid_free (cur);
+	grid_free (next);
+	grid_free (other);
+}
+END_TEST
+
+/*
+ * Every cell a step changed is in a tile engine_changes flags,
+ * and a step of several generations or a reset leave none
+ */
+START_TEST (test_engine_changes)
+{
+	int rows = 130, cols = 300;
+
+	Grid *cur  = grid_new (rows, cols);
+	Grid *next = grid_new (rows, cols);
+	Rule *rule = rule_new ("conway");
+	Rand *rng = rand_new (SEED);
+
+	for (const EngineDef *def = engine_defs; def->name != NULL; def++)
+		{
+			Engine *engine = engine_new (def->name, rows, cols, rule, THREADS);
+			GridChanges changes;
+			long flagged = 0;
+
+			// A soup across the bottom right corner
+			for (int i = 0; i < rows * cols; i++)
+				cur->data[i] = 0;
+
+			for (int i = rows - 20; i < rows; i++)
+				for (int j = cols - 20; j < cols; j++)
+					GRID_SET (cur, i, j, RAND_INT (rng, 100) < 40);
+
+			for (int g = 1; g <= GENS; g++)
+				{
+					engine_step_many (engine, next, cur, 1, NULL);
+
+					if (!engine_changes (engine, &changes))
+						{
+							ck_assert_msg (def->changes == NULL || strcmp (def->name, "auto") == 0,
+									"engine '%s' kept no changes at gen %d", def->name, g);
+							swap_grids (&cur, &next);
+							continue;
+						}
+
+					for (int i = 0; i < rows; i++)
+						for (int j = 0; j < cols; j++)
+							{
+								int flag = changes.map[(i / changes.tile_rows) * changes.cols
+										+ j / changes.tile_cols];
+
+								ck_assert_msg (flag || GRID_GET (next, i, j) == GRID_GET (cur, i, j),
+										"engine '%s' changed (%d, %d) at gen %d out of its map",
+										def->name, i, j, g);
+
+								flagged += flag;
+							}
+
+					swap_grids (&cur, &next);
+				}
+
+			// Not the whole grid, but not nothing either
+			if (def->changes != NULL)
+				ck_assert_msg (flagged > 0 && flagged < (long) GENS * rows * cols,
+						"engine '%s' flagged %ld cells", def->name, flagged);
+
+			engine_step_many (engine, next, cur, 2, NULL);
+			ck_assert_int_eq (engine_changes (engine, &changes), 0);
+
+			engine_step_many (engine, cur, next, 1, NULL);
+			engine_reset (engine);
+			ck_assert_int_eq (engine_changes (engine, &changes), 0);
+
+			engine_free (engine);
+		}
+
+	rand_free (rng);
+	rule_free (rule);
+	grid_free (cur);
+	grid_free (next);
+}
+END_TEST
+
+START_TEST (test_engine_is_valid)
+{
+	for (const EngineDef *def = engine_defs; def->name != NULL; def++)
+		ck_assert_int_eq (engine_is_valid (def->name), 1);
+
+	ck_assert_int_eq (engine_is_valid (""), 0);
+	ck_assert_int_eq (engine_is_valid ("ponga"), 0);
+}
+END_TEST
+
+Suite *
+make_engine_suite (void)
+{
+	Suite *s;
+	TCase *tc_core;
+
+	int num_dims = sizeof (dims) / sizeof (dims[0]);
+	int num_dims_many = sizeof (dims_many) / sizeof (dims_many[0]);
+
+	s = suite_create ("Engine");
+
+	/* Core test case */
+	tc_core = tcase_create ("Core");
+	tcase_set_timeout (tc_core, 60);
+
+	tcase_add_test (tc_core, test_engine_is_valid);
+	tcase_add_loop_test (tc_core, test_engine_rule_aliases, 0, num_dims);
+	tcase_add_loop_test (tc_core, test_engine_random_rules, 0, num_dims);
+	tcase_add_loop_test (tc_core, test_engine_step_many, 0, num_dims_many);
+	tcase_add_test (tc_core, test_engine_auto_cycle);
+	tcase_add_test (tc_core, test_engine_auto_switch);
+	tcase_add_test (tc_core, test_engine_steal_follows);
+	tcase_add_test (tc_core, test_engine_changes);
+
+	suite_add_tcase (s, tc_core);
+
+	return s;
+}
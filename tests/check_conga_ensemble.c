@@ -0,0 +1,141 @@
+#include "check_conga.h"
+
+#include "../src/config.h"
+#include "../src/ensemble.c"
+
+#define ROWS  13
+#define COLS  17
+#define GENS  40
+#define SEED  17
+
+static const char *rules[] =
+{
+	"B3/S23",
+	"B36/S23",
+	"B2/S",
+	"B1357/S1357",
+	"B0/S8",
+	"B012345678/S012345678"
+};
+
+START_TEST (test_bitlife_next)
+{
+	BitRule bit_rule;
+	Rule *rule = rule_new (rules[_i]);
+
+	bitlife_rule_init (&bit_rule, rule);
+
+	// Every cell state for every neighbourhood
+	for (int state = 0; state < 512; state++)
+		{
+			uint64_t n[8], alive = state & 1 ? ~0ULL : 0;
+			int neighbors = 0;
+
+			for (int k = 0; k < 8; k++)
+				{
+					n[k] = state & (2 << k) ? ~0ULL : 0;
+					neighbors += !!(state & (2 << k));
+				}
+
+			uint64_t next = bitlife_next (&bit_rule, alive,
+					n[0], n[1], n[2], n[3], n[4], n[5], n[6], n[7]);
+
+			ck_assert (next == (rule_next_state (rule, state & 1, neighbors)
+						? ~0ULL : 0));
+		}
+
+	rule_free (rule);
+}
+END_TEST
+
+START_TEST (test_ensemble_matches_reference)
+{
+	Config cfg = {
+		.rows         = ROWS,
+		.cols         = COLS,
+		.seed         = SEED,
+		.generations  = GENS,
+		.live_percent = 0.4,
+		.rule         = rules[_i]
+	};
+
+	Ensemble *ensemble = ensemble_new (&cfg);
+	Rule *rule = rule_new (cfg.rule);
+
+	Grid *grid_cur  = grid_new (ROWS, COLS);
+	Grid *grid_next = grid_new (ROWS, COLS);
+
+	for (int g = 0; g < GENS; g++)
+		ensemble_step (ensemble);
+
+	for (int k = 0; k < ENSEMBLE_UNIVERSES; k += 7)
+		{
+			Rand *rng = rand_new (SEED + k);
+			cell_seed_random_generation (grid_cur, rng, cfg.live_percent, NULL);
+			rand_free (rng);
+
+			for (int g = 0; g < GENS; g++)
+				{
+					cell_step_generation (grid_next, grid_cur, rule, NULL);
+
+					Grid *tmp = grid_cur;
+					grid_cur = grid_next;
+					grid_next = tmp;
+				}
+
+			for (int i = 0; i < ROWS; i++)
+				for (int j = 0; j < COLS; j++)
+					ck_assert_int_eq ((CELL (ensemble, cur, i, j) >> k) & 1,
+							GRID_GET (grid_cur, i, j));
+		}
+
+	grid_free (grid_cur);
+	grid_free (grid_next);
+	rule_free (rule);
+	ensemble_free (ensemble);
+}
+END_TEST
+
+START_TEST (test_ensemble_stable_since)
+{
+	Config cfg = {
+		.rows         = ROWS,
+		.cols         = COLS,
+		.seed         = SEED,
+		.generations  = GENS,
+		.live_percent = 0.4,
+		.rule         = "B/S012345678"
+	};
+
+	Ensemble *ensemble = ensemble_new (&cfg);
+	ensemble_run (ensemble);
+
+	// Nothing is ever born or dies
+	for (int k = 0; k < ENSEMBLE_UNIVERSES; k++)
+		ck_assert_int_eq (ensemble->stable_since[k], 0);
+
+	ensemble_free (ensemble);
+}
+END_TEST
+
+Suite *
+make_ensemble_suite (void)
+{
+	Suite *s;
+	TCase *tc_core;
+
+	int num_rules = sizeof (rules) / sizeof (char *);
+
+	s = suite_create ("Ensemble");
+
+	/* Core test case */
+	tc_core = tcase_create ("Core");
+
+	tcase_add_loop_test (tc_core, test_bitlife_next, 0, num_rules);
+	tcase_add_loop_test (tc_core, test_ensemble_matches_reference, 0, num_rules);
+	tcase_add_test (tc_core, test_ensemble_stable_since);
+
+	suite_add_tcase (s, tc_core);
+
+	return s;
+}
@@ -0,0 +1,112 @@
+#include "check_conga.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "../src/wrapper.h"
+#include "../src/grid.h"
+#include "../src/frames.h"
+
+#define ROWS 5
+#define COLS 7
+
+START_TEST (test_frames_pixels_row)
+{
+	int cells[40];
+	uint8_t pixels[40];
+
+	// Every length around the vector width, odd tails included
+	for (int n = 0; n <= 40; n++)
+		{
+			for (int j = 0; j < n; j++)
+				cells[j] = (j * 7 + n) % 3 == 0;
+
+			memset (pixels, 0x55, sizeof (pixels));
+			frames_pixels_row (pixels, cells, n);
+
+			for (int j = 0; j < n; j++)
+				ck_assert_int_eq (pixels[j], cells[j] ? 0 : 255);
+
+			for (int j = n; j < 40; j++)
+				ck_assert_int_eq (pixels[j], 0x55);
+		}
+}
+END_TEST
+
+START_TEST (test_frames_ppm_scale)
+{
+	char prefix[] = "/tmp/check_conga_framesXXXXXX";
+	int fd = mkstemp (prefix);
+	ck_assert_int_ge (fd, 0);
+	close (fd);
+
+	Grid *grid = grid_new (ROWS, COLS);
+
+	// Full 2x2 block, one quarter block and the partial last column
+	GRID_SET (grid, 0, 0, 1);
+	GRID_SET (grid, 0, 1, 1);
+	GRID_SET (grid, 1, 0, 1);
+	GRID_SET (grid, 1, 1, 1);
+	GRID_SET (grid, 2, 3, 1);
+	GRID_SET (grid, 4, 6, 1);
+
+	FrameWriter *frames = frames_new (prefix, ROWS, COLS, 2, 1);
+
+	frames_write (frames, grid, 0);
+	frames_write (frames, grid, 1);
+	frames_write (frames, grid, 2);
+	ck_assert_int_eq (frames_count (frames), 2);
+
+	frames_free (frames);
+
+	char *path = NULL;
+	xasprintf (&path, "%s%06d.ppm", prefix, 2);
+
+	FILE *fp = xfopen (path, "rb");
+	int width = 0, height = 0, max = 0;
+	uint8_t rgb[4 * 3 * 3];
+
+	ck_assert_int_eq (fscanf (fp, "P6 %d %d %d", &width, &height, &max), 3);
+	ck_assert_int_eq (fgetc (fp), '\n');
+	ck_assert_int_eq (width, 4);
+	ck_assert_int_eq (height, 3);
+	ck_assert_int_eq (max, 255);
+	ck_assert_int_eq (fread (rgb, 1, sizeof (rgb), fp), sizeof (rgb));
+
+	xfclose (fp);
+
+	ck_assert_int_eq (rgb[0], 0);
+	ck_assert_int_eq (rgb[1 * 3], 255);
+	ck_assert_int_eq (rgb[(4 + 1) * 3], 191);
+	ck_assert_int_eq (rgb[(8 + 3) * 3], 0);
+	ck_assert_int_eq (rgb[(8 + 3) * 3 + 2], 0);
+
+	unlink (path);
+	xfree (path);
+
+	xasprintf (&path, "%s%06d.ppm", prefix, 0);
+	unlink (path);
+	unlink (prefix);
+	xfree (path);
+	grid_free (grid);
+}
+END_TEST
+
+Suite *
+make_frames_suite (void)
+{
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create ("Frames");
+
+	/* Core test case */
+	tc_core = tcase_create ("Core");
+
+	tcase_add_test (tc_core, test_frames_pixels_row);
+	tcase_add_test (tc_core, test_frames_ppm_scale);
+
+	suite_add_tcase (s, tc_core);
+
+	return s;
+}
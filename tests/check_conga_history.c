@@ -0,0 +1,150 @@
+#include "check_conga.h"
+
+#include <string.h>
+#include "../src/wrapper.h"
+#include "../src/grid.h"
+#include "../src/cell.h"
+#include "../src/rule.h"
+#include "../src/rand.h"
+#include "../src/history.h"
+
+#define ROWS  24
+#define COLS  31
+#define GENS  300
+#define SEED  17
+
+static Grid **gens = NULL;
+
+static void
+setup (void)
+{
+	Rule *rule = rule_new ("B3/S23");
+	Rand *rng = rand_new (SEED);
+
+	gens = xcalloc (GENS + 1, sizeof (Grid *));
+	gens[0] = grid_new (ROWS, COLS);
+
+	cell_seed_random_generation (gens[0], rng, 0.4, NULL);
+
+	for (int g = 1; g <= GENS; g++)
+		{
+			gens[g] = grid_new (ROWS, COLS);
+			cell_step_generation (gens[g], gens[g - 1], rule, NULL);
+		}
+
+	rand_free (rng);
+	rule_free (rule);
+}
+
+static void
+teardown (void)
+{
+	for (int g = 0; g <= GENS; g++)
+		grid_free (gens[g]);
+
+	xfree (gens);
+}
+
+static int
+grid_equal (const Grid *a, const Grid *b)
+{
+	return memcmp (a->data, b->data, sizeof (int) * a->rows * a->cols) == 0;
+}
+
+START_TEST (test_history_seek)
+{
+	History *history = history_new (gens[0], 0, (size_t) -1);
+	Grid *grid = grid_new (ROWS, COLS);
+
+	for (int g = 1; g <= GENS; g++)
+		history_push (history, gens[g], gens[g - 1], g);
+
+	ck_assert_int_eq (history_oldest (history), 0);
+	ck_assert_int_eq (history_newest (history), GENS);
+
+	memcpy (grid->data, gens[GENS]->data, sizeof (int) * ROWS * COLS);
+
+	int cur = GENS;
+	int targets[] = {GENS - 1, 0, 129, 127, 128, 250, GENS, 1};
+
+	for (int i = 0; i < sizeof (targets) / sizeof (int); i++)
+		{
+			ck_assert (history_seek (history, grid, cur, targets[i]));
+			ck_assert (grid_equal (grid, gens[targets[i]]));
+			cur = targets[i];
+		}
+
+	ck_assert (!history_seek (history, grid, cur, GENS + 1));
+	ck_assert (!history_seek (history, grid, cur, -1));
+
+	grid_free (grid);
+	history_free (history);
+}
+END_TEST
+
+START_TEST (test_history_fork)
+{
+	History *history = history_new (gens[0], 0, (size_t) -1);
+
+	for (int g = 1; g <= 10; g++)
+		history_push (history, gens[g], gens[g - 1], g);
+
+	// Rewind to 4 and step again
+	history_push (history, gens[5], gens[4], 5);
+
+	ck_assert_int_eq (history_newest (history), 5);
+
+	history_free (history);
+}
+END_TEST
+
+START_TEST (test_history_budget)
+{
+	size_t budget = 4096;
+	History *history = history_new (gens[0], 0, budget);
+	Grid *grid = grid_new (ROWS, COLS);
+
+	for (int g = 1; g <= GENS; g++)
+		history_push (history, gens[g], gens[g - 1], g);
+
+	ck_assert_int_le (history_memory (history), budget);
+	ck_assert_int_gt (history_oldest (history), 0);
+	ck_assert_int_eq (history_newest (history), GENS);
+
+	int oldest = history_oldest (history);
+
+	memcpy (grid->data, gens[GENS]->data, sizeof (int) * ROWS * COLS);
+
+	ck_assert (history_seek (history, grid, GENS, oldest));
+	ck_assert (grid_equal (grid, gens[oldest]));
+	ck_assert (!history_seek (history, grid, oldest, oldest - 1));
+
+	// Fork from the oldest state
+	history_push (history, gens[oldest + 1], gens[oldest], oldest + 1);
+	ck_assert_int_eq (history_oldest (history), oldest);
+
+	grid_free (grid);
+	history_free (history);
+}
+END_TEST
+
+Suite *
+make_history_suite (void)
+{
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create ("History");
+
+	/* Core test case */
+	tc_core = tcase_create ("Core");
+
+	tcase_add_checked_fixture (tc_core, setup, teardown);
+	tcase_add_test (tc_core, test_history_seek);
+	tcase_add_test (tc_core, test_history_fork);
+	tcase_add_test (tc_core, test_history_budget);
+
+	suite_add_tcase (s, tc_core);
+
+	return s;
+}
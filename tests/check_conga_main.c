@@ -14,6 +14,23 @@ main (void)
 	srunner_add_suite (sr, make_utils_suite ());
 	srunner_add_suite (sr, make_rule_suite ());
 	srunner_add_suite (sr, make_pattern_suite ());
+	srunner_add_suite (sr, make_delta_suite ());
+	srunner_add_suite (sr, make_history_suite ());
+	srunner_add_suite (sr, make_ensemble_suite ());
+	srunner_add_suite (sr, make_bitgrid_suite ());
+	srunner_add_suite (sr, make_tilegrid_suite ());
+	srunner_add_suite (sr, make_engine_suite ());
+	srunner_add_suite (sr, make_render_suite ());
+	srunner_add_suite (sr, make_frames_suite ());
+	srunner_add_suite (sr, make_shm_suite ());
+	srunner_add_suite (sr, make_stream_suite ());
+	srunner_add_suite (sr, make_domain_suite ());
+	srunner_add_suite (sr, make_diskgrid_suite ());
+	srunner_add_suite (sr, make_pages_suite ());
+	srunner_add_suite (sr, make_steal_suite ());
+	srunner_add_suite (sr, make_universe_suite ());
+	srunner_add_suite (sr, make_sweep_suite ());
+	srunner_add_suite (sr, make_soup_suite ());
 
 	srunner_run_all (sr, CK_NORMAL);
 	number_failed = srunner_ntests_failed (sr);
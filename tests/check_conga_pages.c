@@ -0,0 +1,103 @@
+#define _GNU_SOURCE
+
+#include "check_conga.h"
+
+#include <stdint.h>
+#include <sched.h>
+#include <pthread.h>
+#include "../src/grid.h"
+#include "../src/pages.h"
+#include "../src/parallel.h"
+
+START_TEST (test_pages_alloc)
+{
+	// Not a whole number of huge pages, nor of bands
+	size_t size = 5 * PAGES_HUGE_SIZE + 12345;
+	uint8_t *mem = pages_alloc (size, 3);
+	PagesStats stats;
+
+	ck_assert_msg (((uintptr_t) mem & (PAGES_HUGE_SIZE - 1)) == 0,
+			"pages not aligned on a huge page");
+
+	for (size_t i = 0; i < size; i++)
+		if (mem[i] != 0)
+			ck_abort_msg ("byte %zu not zeroed", i);
+
+	mem[0] = 1;
+	mem[size - 1] = 1;
+
+	pages_stats (mem, size, &stats);
+
+	ck_assert_msg (stats.size == 6 * PAGES_HUGE_SIZE, "size %zu", stats.size);
+	ck_assert_msg (stats.huge <= stats.size, "huge %zu > size", stats.huge);
+
+	pages_free (mem, size);
+}
+END_TEST
+
+START_TEST (test_pages_grid)
+{
+	Grid *small = grid_new (64, 64);
+	Grid *large = grid_new_banded (1024, 1024, 2);
+
+	ck_assert_int_eq (pages_wanted (64 * 64 * sizeof (int)), 0);
+	ck_assert_int_eq (small->alloc, GRID_ALLOC_HEAP);
+	ck_assert_int_eq (large->alloc, GRID_ALLOC_PAGES);
+
+	GRID_SET (large, 1023, 1023, 1);
+	ck_assert_int_eq (GRID_GET (large, 1023, 1023), 1);
+	ck_assert_int_eq (GRID_GET (large, 0, 0), 0);
+
+	grid_free (small);
+	grid_free (large);
+}
+END_TEST
+
+START_TEST (test_pages_pin)
+{
+	cpu_set_t before, pinned, after;
+
+	pthread_getaffinity_np (pthread_self (), sizeof (cpu_set_t), &before);
+
+	// A band runs within the CPUs the thread had
+	parallel_pin (1, 3);
+	pthread_getaffinity_np (pthread_self (), sizeof (cpu_set_t), &pinned);
+
+	ck_assert_int_gt (CPU_COUNT (&pinned), 0);
+
+	for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+		if (CPU_ISSET (cpu, &pinned))
+			ck_assert_msg (CPU_ISSET (cpu, &before), "cpu %d not allowed", cpu);
+
+	parallel_unpin ();
+
+	// The calling thread touches a band, and is let go after
+	size_t size = 3 * PAGES_HUGE_SIZE;
+	void *mem = pages_alloc (size, 3);
+
+	pthread_getaffinity_np (pthread_self (), sizeof (cpu_set_t), &after);
+	ck_assert_msg (CPU_EQUAL (&before, &after), "calling thread left pinned");
+
+	pages_free (mem, size);
+}
+END_TEST
+
+Suite *
+make_pages_suite (void)
+{
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create ("Pages");
+
+	/* Core test case */
+	tc_core = tcase_create ("Core");
+
+	tcase_add_test (tc_core, test_pages_alloc);
+	tcase_add_test (tc_core, test_pages_grid);
+	tcase_add_test (tc_core, test_pages_pin);
+
+	suite_add_tcase (s, tc_core);
+
+	return s;
+}
@@ -2,6 +2,8 @@
 
 #include "check_conga.h"
 
+#include <stdlib.h>
+#include <unistd.h>
 #include "../src/wrapper.h"
 #include "../src/pattern.c"
 
@@ -60,7 +62,7 @@ teardown (void)
 
 START_TEST (test_pattern_rle_header_parse)
 {
-	ck_assert (pattern_rle_header_parse (pattern, header[_i]));
+	ck_assert (pattern_rle_header_parse (pattern, header[_i], NULL));
 
 	ck_assert_int_eq (pattern->header.cols, val[_i][0].num);
 	ck_assert_int_eq (pattern->header.rows, val[_i][1].num);
@@ -72,7 +74,11 @@ END_TEST
 
 START_TEST (test_pattern_rle_header_parse_fail)
 {
-	ck_assert (!pattern_rle_header_parse (pattern, header_fail[_i]));
+	char err[128] = "";
+	PatternDiag diag = {err, sizeof (err)};
+
+	ck_assert (!pattern_rle_header_parse (pattern, header_fail[_i], &diag));
+	ck_assert_msg (strncmp (err, "Invalid header", 14) == 0, "error '%s'", err);
 }
 END_TEST
 
@@ -87,11 +93,11 @@ START_TEST (test_pattern_rle_parse)
 	};
 
 	int rows = 0, cols = 0;
-	int rc = pattern_rle_parse (NULL, rle, &rows, &cols);
+	int rc = pattern_rle_parse (NULL, rle, &rows, &cols, NULL);
 
 	pattern->grid = grid_new (rows, cols);
 
-	rc = pattern_rle_parse (pattern, rle, NULL, NULL);
+	rc = pattern_rle_parse (pattern, rle, NULL, NULL, NULL);
 	ck_assert (rc);
 
 	for (int i = 0; i < pattern->grid->rows; i++)
@@ -100,6 +106,40 @@ START_TEST (test_pattern_rle_parse)
 }
 END_TEST
 
+START_TEST (test_pattern_load)
+{
+	char path[] = "/tmp/check_conga_pattern_XXXXXX";
+	char err[128];
+	int fd = mkstemp (path);
+
+	ck_assert_int_ge (fd, 0);
+	ck_assert_int_eq (write (fd, "x = 3, y = 3\nbo?o!\n", 19), 19);
+	close (fd);
+
+	Pattern *p = pattern_load ("glider", err, sizeof (err));
+
+	ck_assert_ptr_nonnull (p);
+	ck_assert_str_eq (err, "");
+	ck_assert_int_eq (p->grid->rows, 3);
+	pattern_free (p);
+
+	// Why, and nothing fatal
+	ck_assert_ptr_null (pattern_load ("/nonexistent/ponga.rle", err, sizeof (err)));
+	ck_assert_msg (strncmp (err, "Could not open", 14) == 0, "error '%s'", err);
+
+	ck_assert_ptr_null (pattern_load (path, err, sizeof (err)));
+	ck_assert_str_eq (err, "Mistery character '?'");
+
+	ck_assert_ptr_null (pattern_new_from_rle ("bo$o!", err, sizeof (err)));
+	ck_assert_str_eq (err, "Empty or truncated RLE text");
+
+	// Or only whether
+	ck_assert_ptr_null (pattern_load (path, NULL, 0));
+
+	unlink (path);
+}
+END_TEST
+
 Suite *
 make_pattern_suite (void)
 {
@@ -117,6 +157,7 @@ make_pattern_suite (void)
 	tcase_add_loop_test (tc_core, test_pattern_rle_header_parse_fail,
 			0, HEADER_SIZE (header_fail));
 	tcase_add_test (tc_core, test_pattern_rle_parse);
+	tcase_add_test (tc_core, test_pattern_load);
 
 	suite_add_tcase (s, tc_core);
 
@@ -0,0 +1,165 @@
+#include "check_conga.h"
+
+#include "../src/grid.h"
+#include "../src/cell.h"
+#include "../src/rand.h"
+#include "../src/render.h"
+#include "../src/render_fb.h"
+#include "../src/render_ansi.h"
+
+#include <string.h>
+#include <unistd.h>
+
+#define ROWS  16
+#define COLS  24
+#define SEED  31
+
+static int
+expected_shade (const Grid *grid, int row, int col, int fac)
+{
+	int acm = 0;
+
+	for (int x = 0; x < fac && row + x < grid->rows; x++)
+		for (int y = 0; y < fac && col + y < grid->cols; y++)
+			acm += GRID_GET (grid, row + x, col + y);
+
+	int shade = (acm * RENDER_SHADES + fac - 1) / fac;
+	return shade < RENDER_SHADES ? shade : RENDER_SHADES;
+}
+
+START_TEST (test_render_fb_shading)
+{
+	Grid *grid = grid_new (ROWS, COLS);
+	Rand *rng = rand_new (SEED);
+	RenderStat stat = {0};
+
+	cell_seed_random_generation (grid, rng, 0.3, NULL);
+
+	Render *render = render_new_backend (&render_fb_backend, "test", 4, 6);
+	RenderFb *fb = render_backend_state (render);
+
+	int fac = 1 << _i;
+
+	for (int s = 0; s < _i; s++)
+		render_scale (render, grid, +1);
+
+	render_draw (render, grid, &stat);
+
+	ck_assert_int_eq (fb->frames, 1);
+
+	for (int i = 0; i < fb->rows && i * fac < ROWS; i++)
+		for (int j = 0; j < fb->cols && j * fac < COLS; j++)
+			ck_assert_int_eq (fb->shades[i * fb->cols + j],
+					expected_shade (grid, i * fac, j * fac, fac));
+
+	render_free (render);
+	rand_free (rng);
+	grid_free (grid);
+}
+END_TEST
+
+START_TEST (test_render_fb_scroll)
+{
+	Grid *grid = grid_new (ROWS, COLS);
+	RenderStat stat = {0};
+
+	GRID_SET (grid, 5, 7, 1);
+
+	Render *render = render_new_backend (&render_fb_backend, "test", 4, 6);
+	RenderFb *fb = render_backend_state (render);
+
+	ck_assert_int_eq (render_scroll (render, grid, 4, 5), 1);
+	render_draw (render, grid, &stat);
+
+	for (int i = 0; i < fb->rows; i++)
+		for (int j = 0; j < fb->cols; j++)
+			ck_assert_int_eq (fb->shades[i * fb->cols + j],
+					i == 1 && j == 2 ? RENDER_SHADES : 0);
+
+	// Clamped to the bottom right corner
+	ck_assert_int_eq (render_scroll (render, grid, ROWS, COLS), 1);
+	ck_assert_int_eq (render_scroll (render, grid, 1, 1), 0);
+
+	render_free (render);
+	grid_free (grid);
+}
+END_TEST
+
+static int
+count_substr (const char *str, const char *sub)
+{
+	int n = 0;
+
+	for (const char *p = str; (p = strstr (p, sub)) != NULL; p++)
+		n++;
+
+	return n;
+}
+
+static long
+read_frame (int fd, char *buf, size_t size)
+{
+	ssize_t n = read (fd, buf, size - 1);
+	ck_assert_int_gt (n, 0);
+	buf[n] = '\0';
+	return n;
+}
+
+START_TEST (test_render_ansi_changed_cells)
+{
+	Grid *grid = grid_new (8, 8);
+	RenderStat stat = {0};
+	char buf[4096];
+	int fds[2];
+
+	ck_assert_int_eq (pipe (fds), 0);
+
+	Render *render = render_new_backend (&render_ansi_backend, "test", 8, 8);
+	RenderAnsi *ansi = render_backend_state (render);
+
+	render_ansi_set_fd (ansi, fds[1]);
+
+	// First frame clears the screen and draws everything
+	render_draw (render, grid, &stat);
+	ck_assert_int_eq (read_frame (fds[0], buf, sizeof (buf)),
+			render_ansi_frame_bytes (ansi));
+	ck_assert_int_eq (count_substr (buf, "\033[2J"), 1);
+
+	// Nothing changed in the grid, only the status line is sent
+	render_draw (render, grid, &stat);
+	read_frame (fds[0], buf, sizeof (buf));
+	ck_assert_int_eq (count_substr (buf, "\033[48;5;"), 0);
+
+	// One cell born, one color change and one jump to it
+	GRID_SET (grid, 3, 5, 1);
+	render_draw (render, grid, &stat);
+	read_frame (fds[0], buf, sizeof (buf));
+	ck_assert_int_eq (count_substr (buf, "\033[48;5;"), 1);
+	ck_assert_int_eq (count_substr (buf, "H\033[48;5;16m  "), 1);
+
+	render_free (render);
+	grid_free (grid);
+	close (fds[0]);
+	close (fds[1]);
+}
+END_TEST
+
+Suite *
+make_render_suite (void)
+{
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create ("Render");
+
+	/* Core test case */
+	tc_core = tcase_create ("Core");
+
+	tcase_add_loop_test (tc_core, test_render_fb_shading, 0, 4);
+	tcase_add_test (tc_core, test_render_fb_scroll);
+	tcase_add_test (tc_core, test_render_ansi_changed_cells);
+
+	suite_add_tcase (s, tc_core);
+
+	return s;
+}
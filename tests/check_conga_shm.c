@@ -0,0 +1,119 @@
+#include "check_conga.h"
+
+#include <stdio.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "../src/grid.h"
+#include "../src/shm.h"
+
+#define ROWS 33
+#define COLS 65
+#define GENS 5000
+
+static char name[64];
+
+static void
+setup (void)
+{
+	snprintf (name, sizeof (name), "/check_conga_%d", (int) getpid ());
+}
+
+START_TEST (test_shm_name)
+{
+	ck_assert (shm_name_is_valid ("/conga"));
+	ck_assert (!shm_name_is_valid ("conga"));
+	ck_assert (!shm_name_is_valid ("/"));
+	ck_assert (!shm_name_is_valid ("/con/ga"));
+	ck_assert (!shm_name_is_valid (NULL));
+}
+END_TEST
+
+START_TEST (test_shm_publish)
+{
+	ShmGrid *shm = shm_grid_new (name, ROWS, COLS);
+	ShmGrid *viewer = shm_grid_open (name);
+	Grid *grid = grid_new (ROWS, COLS);
+
+	Grid *shared = grid_new_extern (ROWS, COLS, shm_grid_data (shm, 1));
+	GRID_SET (shared, 3, 4, 1);
+
+	shm_grid_publish (shm, shared->data, 7);
+
+	ck_assert_int_eq (shm_grid_read (viewer, grid), 7);
+	ck_assert_int_eq (GRID_GET (grid, 3, 4), 1);
+	ck_assert_int_eq (GRID_GET (grid, 4, 3), 0);
+
+	// Extern cells are left to their owner
+	grid_free (shared);
+
+	shm_grid_free (viewer);
+	shm_grid_free (shm);
+	grid_free (grid);
+}
+END_TEST
+
+static void *
+writer (void *arg)
+{
+	ShmGrid *shm = arg;
+
+	for (int gen = 1; gen <= GENS; gen++)
+		{
+			int *data = shm_grid_data (shm, gen & 1);
+
+			for (int i = 0; i < ROWS * COLS; i++)
+				data[i] = gen;
+
+			shm_grid_publish (shm, data, gen);
+		}
+
+	return NULL;
+}
+
+START_TEST (test_shm_seqlock)
+{
+	ShmGrid *shm = shm_grid_new (name, ROWS, COLS);
+	ShmGrid *viewer = shm_grid_open (name);
+	Grid *grid = grid_new (ROWS, COLS);
+	pthread_t thread;
+
+	shm_grid_publish (shm, shm_grid_data (shm, 0), 0);
+	pthread_create (&thread, NULL, writer, shm);
+
+	// Every read is a whole generation, never a mix of two
+	for (long gen = 0; gen < GENS; )
+		{
+			gen = shm_grid_read (viewer, grid);
+
+			for (int i = 0; i < ROWS * COLS; i++)
+				ck_assert_int_eq (grid->data[i], gen);
+		}
+
+	pthread_join (thread, NULL);
+
+	shm_grid_free (viewer);
+	shm_grid_free (shm);
+	grid_free (grid);
+}
+END_TEST
+
+Suite *
+make_shm_suite (void)
+{
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create ("Shm");
+
+	/* Core test case */
+	tc_core = tcase_create ("Core");
+	tcase_add_checked_fixture (tc_core, setup, NULL);
+
+	tcase_add_test (tc_core, test_shm_name);
+	tcase_add_test (tc_core, test_shm_publish);
+	tcase_add_test (tc_core, test_shm_seqlock);
+
+	suite_add_tcase (s, tc_core);
+
+	return s;
+}
@@ -0,0 +1,301 @@
+#include "check_conga.h"
+
+#include "../src/config.h"
+#include "../src/soup.c"
+
+#define SOUP_SIZE 16
+#define SEED      29
+
+typedef struct
+{
+	int y;
+	int x;
+} SoupCell;
+
+static const SoupCell block[]   = {{0, 0}, {0, 1}, {1, 0}, {1, 1}};
+static const SoupCell blinker[] = {{0, 0}, {0, 1}, {0, 2}};
+static const SoupCell glider[]  = {{0, 1}, {1, 2}, {2, 0}, {2, 1}, {2, 2}};
+
+// The glider one generation on
+static const SoupCell glider1[] = {{0, 0}, {0, 2}, {1, 1}, {1, 2}, {2, 1}};
+
+static Soup *
+soup_from_rule (const char *rule, int soups, int threads)
+{
+	Config cfg = {
+		.rule         = rule,
+		.seed         = SEED,
+		.soups        = soups,
+		.soup_size    = SOUP_SIZE,
+		.live_percent = 0.4,
+		.threads      = threads
+	};
+
+	return soup_new (&cfg);
+}
+
+// Turned a quarter 'turns' times within a 3x3 box, wrapped
+// around the board
+static void
+soup_put (SoupWorker *w, const SoupCell *cells, int n, int row, int col, int turns)
+{
+	for (int k = 0; k < n; k++)
+		{
+			int y = cells[k].y, x = cells[k].x;
+
+			for (int t = 0; t < turns; t++)
+				{
+					int tmp = y;
+					y = x;
+					x = 2 - tmp;
+				}
+
+			BITGRID_SET (w->cur, (row + y) % w->cur->rows,
+					(col + x) % w->cur->cols, 1);
+		}
+}
+
+static const CensusEntry *
+soup_only_entry (const Census *census)
+{
+	ck_assert_int_eq (census->len, 1);
+
+	for (int i = 0; i < census->size; i++)
+		if (census->entries[i].count > 0)
+			return &census->entries[i];
+
+	return NULL;
+}
+
+static const CensusEntry *
+soup_find_class (const Census *census, ObjectClass class)
+{
+	for (int i = 0; i < census->size; i++)
+		if (census->entries[i].count > 0 && census->entries[i].class == class)
+			return &census->entries[i];
+
+	return NULL;
+}
+
+START_TEST (test_soup_lone_objects)
+{
+	static const struct
+	{
+		const SoupCell *cells;
+		int             n;
+		ObjectClass     class;
+		int             period;
+		const char     *prefix;
+	} cases[] =
+	{
+		{block,   4, OBJECT_STILL_LIFE, 1, "xs4_"},
+		{blinker, 3, OBJECT_OSCILLATOR, 2, "xp2_"},
+		{glider,  5, OBJECT_SPACESHIP,  4, "xq4_"}
+	};
+
+	Soup *soup = soup_from_rule ("conway", 1, 1);
+
+	for (int c = 0; c < sizeof (cases) / sizeof (cases[0]); c++)
+		{
+			SoupWorker w;
+			char code[64];
+
+			soup_worker_init (&w, soup);
+			soup_put (&w, cases[c].cells, cases[c].n, 20, 30, 0);
+			soup_separate (&w);
+
+			const CensusEntry *e = soup_only_entry (&w.census);
+
+			ck_assert_int_eq (e->class, cases[c].class);
+			ck_assert_int_eq (e->period, cases[c].period);
+			ck_assert_int_eq (e->count, 1);
+
+			soup_object_code (e, code, sizeof (code));
+			ck_assert_msg (strncmp (code, cases[c].prefix, strlen (cases[c].prefix)) == 0,
+					"'%s' is not a %s object", code, cases[c].prefix);
+
+			census_destroy (&w.census);
+			soup_worker_destroy (&w);
+		}
+
+	soup_free (soup);
+}
+END_TEST
+
+START_TEST (test_soup_same_object)
+{
+	Soup *soup = soup_from_rule ("conway", 1, 1);
+	SoupWorker w;
+
+	soup_worker_init (&w, soup);
+
+	// Every rotation of two phases of the glider, and both blinkers,
+	// one of them across the edge of the board
+	for (int t = 0; t < 4; t++)
+		{
+			soup_put (&w, glider, 5, 4, 4 + 8 * t, t);
+			soup_put (&w, glider1, 5, 14, 4 + 8 * t, t);
+		}
+
+	soup_put (&w, blinker, 3, 30, 10, 0);
+	soup_put (&w, blinker, 3, 30, w.cur->cols - 1, 0);
+	soup_put (&w, blinker, 3, 40, 10, 1);
+
+	soup_separate (&w);
+
+	ck_assert_int_eq (w.census.len, 2);
+
+	const CensusEntry *e = soup_find_class (&w.census, OBJECT_SPACESHIP);
+	ck_assert_ptr_nonnull (e);
+	ck_assert_int_eq (e->count, 8);
+
+	e = soup_find_class (&w.census, OBJECT_OSCILLATOR);
+	ck_assert_ptr_nonnull (e);
+	ck_assert_int_eq (e->count, 3);
+
+	census_destroy (&w.census);
+	soup_worker_destroy (&w);
+	soup_free (soup);
+}
+END_TEST
+
+START_TEST (test_soup_mess)
+{
+	Soup *soup = soup_from_rule ("conway", 1, 1);
+	SoupWorker w;
+
+	soup_worker_init (&w, soup);
+
+	// Full rows across the edge, past SOUP_OBJECT_MAX cells
+	int side = w.cur->cols, rows = SOUP_OBJECT_MAX / side + 3;
+
+	for (int i = 0; i < rows; i++)
+		for (int j = 0; j < side; j++)
+			BITGRID_SET (w.cur, 10 + i, j, 1);
+
+	soup_separate (&w);
+
+	const CensusEntry *e = soup_only_entry (&w.census);
+	char code[64];
+
+	ck_assert_int_eq (e->class, OBJECT_MESS);
+	ck_assert_int_eq (e->population, 0);
+	ck_assert_int_eq (e->count, 1);
+
+	soup_object_code (e, code, sizeof (code));
+	ck_assert_str_eq (code, "zz_mess");
+
+	// Messes of any size are counted in the same row
+	SoupWorker other;
+
+	soup_worker_init (&other, soup);
+
+	for (int i = 0; i < rows + 5; i++)
+		for (int j = 0; j < side; j++)
+			BITGRID_SET (other.cur, 5 + i, j, 1);
+
+	soup_separate (&other);
+	census_merge (&soup->census, &w.census);
+	census_merge (&soup->census, &other.census);
+
+	e = soup_only_entry (&soup->census);
+	ck_assert_int_eq (e->class, OBJECT_MESS);
+	ck_assert_int_eq (e->population, 0);
+	ck_assert_int_eq (e->count, 2);
+
+	census_destroy (&w.census);
+	census_destroy (&other.census);
+	soup_worker_destroy (&w);
+	soup_worker_destroy (&other);
+	soup_free (soup);
+}
+END_TEST
+
+START_TEST (test_soup_merge)
+{
+	Soup *soup = soup_from_rule ("conway", 1, 1);
+	SoupWorker a, b;
+
+	soup_worker_init (&a, soup);
+	soup_worker_init (&b, soup);
+
+	soup_put (&a, block, 4, 10, 10, 0);
+	soup_put (&a, block, 4, 10, 20, 0);
+	soup_put (&b, block, 4, 30, 30, 0);
+	soup_put (&b, glider, 5, 40, 40, 0);
+
+	soup_separate (&a);
+	soup_separate (&b);
+
+	census_merge (&soup->census, &a.census);
+	census_merge (&soup->census, &b.census);
+
+	ck_assert_int_eq (soup->census.len, 2);
+	ck_assert_int_eq (soup_find_class (&soup->census, OBJECT_STILL_LIFE)->count, 3);
+	ck_assert_int_eq (soup_find_class (&soup->census, OBJECT_SPACESHIP)->count, 1);
+
+	census_destroy (&a.census);
+	census_destroy (&b.census);
+	soup_worker_destroy (&a);
+	soup_worker_destroy (&b);
+	soup_free (soup);
+
+	// However the soups are split between workers
+	Soup *one = soup_from_rule ("conway", 6, 1);
+	Soup *many = soup_from_rule ("conway", 6, 3);
+
+	soup_run (one);
+	soup_run (many);
+
+	ck_assert_int_eq (many->census.len, one->census.len);
+
+	for (int i = 0; i < one->census.size; i++)
+		{
+			const CensusEntry *e = &one->census.entries[i];
+
+			if (e->count == 0)
+				continue;
+
+			int found = 0;
+
+			for (int j = 0; j < many->census.size; j++)
+				{
+					const CensusEntry *f = &many->census.entries[j];
+
+					if (f->count > 0 && f->hash == e->hash && f->class == e->class
+							&& f->period == e->period)
+						{
+							ck_assert_int_eq (f->count, e->count);
+							found = 1;
+						}
+				}
+
+			ck_assert_msg (found, "object %016llx is missing",
+					(unsigned long long) e->hash);
+		}
+
+	soup_free (one);
+	soup_free (many);
+}
+END_TEST
+
+Suite *
+make_soup_suite (void)
+{
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create ("Soup");
+
+	/* Core test case */
+	tc_core = tcase_create ("Core");
+
+	tcase_add_test (tc_core, test_soup_lone_objects);
+	tcase_add_test (tc_core, test_soup_same_object);
+	tcase_add_test (tc_core, test_soup_mess);
+	tcase_add_test (tc_core, test_soup_merge);
+
+	suite_add_tcase (s, tc_core);
+
+	return s;
+}
@@ -0,0 +1,147 @@
+#include "check_conga.h"
+
+#include <stdint.h>
+#include "../src/steal.h"
+
+#define WORKERS 4
+#define TASKS   1000
+#define ROUNDS  20
+
+typedef struct
+{
+	int  runs[TASKS];
+	long sum;
+	int  worker_max;
+} StealCount;
+
+static void
+count_task (int worker, long task, void *arg)
+{
+	StealCount *count = arg;
+
+	__atomic_fetch_add (&count->runs[task], 1, __ATOMIC_RELAXED);
+
+	// Uneven: the first tasks are much heavier
+	volatile long x = 0;
+	for (long i = 0; i < (task < 50 ? 20000 : 10); i++)
+		x += i;
+
+	__atomic_fetch_add (&count->sum, task, __ATOMIC_RELAXED);
+
+	if (worker > count->worker_max)
+		__atomic_store_n (&count->worker_max, worker, __ATOMIC_RELAXED);
+}
+
+START_TEST (test_steal_pool_run)
+{
+	StealPool *pool = steal_pool_new (WORKERS, TASKS);
+	long tasks[TASKS];
+	long expect = 0;
+
+	for (long t = 0; t < TASKS; t++)
+		tasks[t] = t;
+
+	for (int r = 0; r < ROUNDS; r++)
+		{
+			// Any subset, down to none at all
+			long len = TASKS * r / (ROUNDS - 1);
+			StealCount count = {{0}};
+
+			steal_pool_run (pool, tasks, len, count_task, &count);
+
+			for (long t = 0; t < TASKS; t++)
+				ck_assert_int_eq (count.runs[t], t < len);
+
+			ck_assert_int_eq (count.sum, len * (len - 1) / 2);
+			ck_assert_int_lt (count.worker_max, WORKERS);
+
+			expect += len;
+		}
+
+	long total = 0, steals = 0;
+
+	for (int w = 0; w < steal_pool_workers (pool); w++)
+		{
+			total += steal_pool_stats (pool, w)->tasks;
+			steals += steal_pool_stats (pool, w)->steals;
+		}
+
+	ck_assert_int_eq (total, expect);
+	ck_assert (steals <= total);
+
+	steal_pool_free (pool);
+}
+END_TEST
+
+START_TEST (test_steal_pool_run_split)
+{
+	static const long splits[][WORKERS + 1] =
+	{
+		{0, 250,   500,   750,   TASKS},
+		{0, 0,     0,     TASKS, TASKS},
+		{0, TASKS, TASKS, TASKS, TASKS},
+		{0, 10,    990,   995,   TASKS},
+		{0, 0,     0,     0,     0    }
+	};
+
+	StealPool *pool = steal_pool_new (WORKERS, TASKS);
+	long tasks[TASKS];
+
+	for (long t = 0; t < TASKS; t++)
+		tasks[t] = t;
+
+	// Uneven and empty shares, each task still run once
+	for (int s = 0; s < sizeof (splits) / sizeof (splits[0]); s++)
+		{
+			long len = splits[s][WORKERS];
+			StealCount count = {{0}};
+
+			steal_pool_run_split (pool, tasks, splits[s], count_task, &count);
+
+			for (long t = 0; t < TASKS; t++)
+				ck_assert_int_eq (count.runs[t], t < len);
+
+			ck_assert_int_eq (count.sum, len * (len - 1) / 2);
+		}
+
+	steal_pool_free (pool);
+}
+END_TEST
+
+START_TEST (test_steal_pool_single)
+{
+	StealPool *pool = steal_pool_new (1, TASKS);
+	StealCount count = {{0}};
+	long tasks[TASKS];
+
+	for (long t = 0; t < TASKS; t++)
+		tasks[t] = t;
+
+	steal_pool_run (pool, tasks, TASKS, count_task, &count);
+
+	ck_assert_int_eq (steal_pool_stats (pool, 0)->tasks, TASKS);
+	ck_assert_int_eq (steal_pool_stats (pool, 0)->steals, 0);
+
+	steal_pool_free (pool);
+}
+END_TEST
+
+Suite *
+make_steal_suite (void)
+{
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create ("Steal");
+
+	/* Core test case */
+	tc_core = tcase_create ("Core");
+
+	tcase_add_test (tc_core, test_steal_pool_run);
+	tcase_add_test (tc_core, test_steal_pool_run_split);
+	tcase_add_test (tc_core, test_steal_pool_single);
+
+	suite_add_tcase (s, tc_core);
+
+	return s;
+}
@@ -0,0 +1,238 @@
+#include "check_conga.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "../src/wrapper.h"
+#include "../src/grid.h"
+#include "../src/delta.h"
+#include "../src/stream.h"
+
+#define ROWS 40
+#define COLS 50
+
+static char path[64];
+
+// Server driven while the client waits, as the run loop would
+static StreamServer *pump_server;
+static const Grid   *pump_grid;
+static int           pump_gen;
+
+static void
+setup (void)
+{
+	snprintf (path, sizeof (path), "/tmp/check_conga_%d.sock", (int) getpid ());
+}
+
+static int
+connect_to (const char *addr)
+{
+	struct sockaddr_un sa = {.sun_family = AF_UNIX};
+	strncpy (sa.sun_path, addr, sizeof (sa.sun_path) - 1);
+
+	int fd = socket (AF_UNIX, SOCK_STREAM, 0);
+	ck_assert_int_ge (fd, 0);
+	ck_assert_int_eq (connect (fd, (struct sockaddr *) &sa, sizeof (sa)), 0);
+
+	return fd;
+}
+
+static void
+read_all (int fd, uint8_t *buf, size_t len)
+{
+	while (len > 0)
+		{
+			ssize_t n = recv (fd, buf, len, pump_server != NULL ? MSG_DONTWAIT : 0);
+
+			if (n < 0 && errno == EAGAIN)
+				{
+					stream_server_update (pump_server, pump_grid, pump_gen);
+					continue;
+				}
+
+			ck_assert_int_gt (n, 0);
+			buf += n;
+			len -= n;
+		}
+}
+
+static uint64_t
+read_varint (int fd)
+{
+	uint8_t buf[10];
+	uint64_t x = 0;
+
+	for (int i = 0; i < 10; i++)
+		{
+			read_all (fd, buf + i, 1);
+
+			if (delta_get_varint (buf, i + 1, &x) > 0)
+				return x;
+		}
+
+	ck_assert_msg (0, "varint too long");
+	return 0;
+}
+
+// Reads one frame and applies it to the client copy of the view
+static char
+read_frame (int fd, Grid *view, uint64_t *gen)
+{
+	uint8_t type;
+	read_all (fd, &type, 1);
+
+	uint64_t v[6];
+	for (int k = 0; k < 6; k++)
+		v[k] = read_varint (fd);
+
+	*gen = v[0];
+	ck_assert_int_eq (v[3], view->rows);
+	ck_assert_int_eq (v[4], view->cols);
+
+	uint8_t *payload = xmalloc (v[5]);
+	read_all (fd, payload, v[5]);
+
+	if (type == 'K')
+		memset (view->data, 0, (size_t) view->rows * view->cols * sizeof (int));
+
+	delta_apply (view, payload, v[5]);
+	xfree (payload);
+
+	return type;
+}
+
+static void
+assert_view (const Grid *view, const Grid *grid, int row, int col)
+{
+	for (int i = 0; i < view->rows; i++)
+		for (int j = 0; j < view->cols; j++)
+			ck_assert_int_eq (GRID_GET (view, i, j), GRID_GET (grid, row + i, col + j));
+}
+
+START_TEST (test_stream_keyframe_delta)
+{
+	StreamServer *server = stream_server_new (path, ROWS, COLS);
+	Grid *grid = grid_new (ROWS, COLS);
+	Grid *view = grid_new (ROWS, COLS);
+	uint64_t gen = 0;
+	uint8_t hello[5];
+
+	GRID_SET (grid, 1, 2, 1);
+	GRID_SET (grid, 39, 49, 1);
+
+	int fd = connect_to (path);
+	stream_server_update (server, grid, 0);
+
+	read_all (fd, hello, sizeof (hello));
+	ck_assert (memcmp (hello, STREAM_MAGIC, 4) == 0);
+	ck_assert_int_eq (hello[4], STREAM_VERSION);
+	ck_assert_int_eq (read_varint (fd), ROWS);
+	ck_assert_int_eq (read_varint (fd), COLS);
+
+	ck_assert_int_eq (read_frame (fd, view, &gen), 'K');
+	ck_assert_int_eq (gen, 0);
+	assert_view (view, grid, 0, 0);
+
+	GRID_SET (grid, 1, 2, 0);
+	GRID_SET (grid, 20, 30, 1);
+	stream_server_update (server, grid, 1);
+
+	ck_assert_int_eq (read_frame (fd, view, &gen), 'D');
+	ck_assert_int_eq (gen, 1);
+	assert_view (view, grid, 0, 0);
+
+	// Subscribing to a viewport brings a keyframe of it
+	uint8_t sub[] = {'V', 10, 20, 5, 15};
+	ck_assert_int_eq (write (fd, sub, sizeof (sub)), sizeof (sub));
+
+	Grid *sub_view = grid_new (5, 15);
+
+	// The request may take a moment to arrive
+	for (int i = 0; i < 100; i++)
+		{
+			stream_server_update (server, grid, 1);
+			usleep (1000);
+		}
+
+	ck_assert_int_eq (read_frame (fd, sub_view, &gen), 'K');
+	assert_view (sub_view, grid, 10, 20);
+
+	close (fd);
+	stream_server_update (server, grid, 2);
+
+	stream_server_free (server);
+	grid_free (sub_view);
+	grid_free (view);
+	grid_free (grid);
+
+	ck_assert_int_ne (access (path, F_OK), 0);
+}
+END_TEST
+
+START_TEST (test_stream_slow_client)
+{
+	StreamServer *server = stream_server_new (path, ROWS * 20, COLS * 20);
+	Grid *grid = grid_new (ROWS * 20, COLS * 20);
+	Grid *view = grid_new (ROWS * 20, COLS * 20);
+	uint64_t gen = 0;
+	uint8_t hello[5];
+	int last = 0;
+
+	int fd = connect_to (path);
+
+	// The client reads nothing, the server must not block
+	for (int g = 0; g < 200; g++)
+		{
+			for (int i = 0; i < grid->rows * grid->cols; i++)
+				grid->data[i] = (i + g) % 3 == 0;
+
+			stream_server_update (server, grid, g);
+			last = g;
+		}
+
+	pump_server = server;
+	pump_grid = grid;
+	pump_gen = last;
+
+	read_all (fd, hello, sizeof (hello));
+	read_varint (fd);
+	read_varint (fd);
+
+	// Once it catches up, it skips straight to the latest generation
+	do
+		read_frame (fd, view, &gen);
+	while (gen != (uint64_t) last);
+
+	pump_server = NULL;
+
+	assert_view (view, grid, 0, 0);
+
+	close (fd);
+	stream_server_free (server);
+	grid_free (view);
+	grid_free (grid);
+}
+END_TEST
+
+Suite *
+make_stream_suite (void)
+{
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create ("Stream");
+
+	/* Core test case */
+	tc_core = tcase_create ("Core");
+	tcase_add_checked_fixture (tc_core, setup, NULL);
+
+	tcase_add_test (tc_core, test_stream_keyframe_delta);
+	tcase_add_test (tc_core, test_stream_slow_client);
+
+	suite_add_tcase (s, tc_core);
+
+	return s;
+}
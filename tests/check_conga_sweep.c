@@ -0,0 +1,152 @@
+#include "check_conga.h"
+
+#include "../src/config.h"
+#include "../src/sweep.c"
+
+#define SIDE  16
+#define GENS  40
+#define SEED  29
+
+static Sweep *
+sweep_from_spec (const char *spec, const char *pattern, int side)
+{
+	Config cfg = {
+		.rows         = side,
+		.cols         = side,
+		.seed         = SEED,
+		.generations  = GENS,
+		.live_percent = 0.4,
+		.threads      = 2,
+		.pattern      = pattern,
+		.sweep        = spec
+	};
+
+	return sweep_new (&cfg);
+}
+
+static const SweepResult *
+sweep_find (const Sweep *sweep, const char *rule)
+{
+	for (int i = 0; i < sweep->len; i++)
+		if (strcmp (sweep->results[i].rule, rule) == 0)
+			return &sweep->results[i];
+
+	return NULL;
+}
+
+START_TEST (test_sweep_wildcard_count)
+{
+	static const struct
+	{
+		const char *spec;
+		int         len;
+	} cases[] =
+	{
+		{"B3x/S23",  9  },
+		{"B3xx/S23", 37 },
+		{"Bx/Sx",    100},
+		{"B3/S23x",  8  }
+	};
+
+	for (int c = 0; c < sizeof (cases) / sizeof (cases[0]); c++)
+		{
+			Sweep *sweep = sweep_from_spec (cases[c].spec, NULL, SIDE);
+
+			ck_assert_msg (sweep->len == cases[c].len, "'%s' expands to %d rules, not %d",
+					cases[c].spec, sweep->len, cases[c].len);
+
+			sweep_free (sweep);
+		}
+}
+END_TEST
+
+START_TEST (test_sweep_dedupe)
+{
+	// conway, life and B3/S23 are all the first rule of B3x/S23
+	Sweep *sweep = sweep_from_spec ("B3x/S23,B3/S23,conway,life,S23/B3", NULL, SIDE);
+
+	ck_assert_int_eq (sweep->len, 9);
+	ck_assert_ptr_nonnull (sweep_find (sweep, "B3/S23"));
+	ck_assert_ptr_null (sweep_find (sweep, "conway"));
+
+	sweep_free (sweep);
+
+	// Of B36x/S23 only the seven with three birth digits are new
+	sweep = sweep_from_spec ("B3x/S23,B36x/S23", NULL, SIDE);
+	ck_assert_int_eq (sweep->len, 16);
+	sweep_free (sweep);
+}
+END_TEST
+
+START_TEST (test_sweep_alias)
+{
+	ck_assert_int_eq (sweep_spec_is_valid ("2x2"), 1);
+	ck_assert_int_eq (sweep_spec_is_valid ("2X2,B3x/S23"), 1);
+	ck_assert_int_eq (sweep_spec_is_valid ("Bx"), 0);
+	ck_assert_int_eq (sweep_spec_is_valid ("B9x/S"), 0);
+	ck_assert_int_eq (sweep_spec_is_valid ("B3x/S23,ponga"), 0);
+
+	// No rules to sweep
+	ck_assert_int_eq (sweep_spec_is_valid (""), 0);
+	ck_assert_int_eq (sweep_spec_is_valid (","), 0);
+	ck_assert_int_eq (sweep_spec_is_valid (",,"), 0);
+
+	Sweep *sweep = sweep_from_spec ("2x2,B36/S125", NULL, SIDE);
+
+	ck_assert_int_eq (sweep->len, 1);
+	ck_assert_str_eq (sweep->results[0].rule, "2x2");
+	ck_assert_int_eq (sweep->results[0].bit_rule.birth, (1 << 3) | (1 << 6));
+	ck_assert_int_eq (sweep->results[0].bit_rule.survive, (1 << 1) | (1 << 2) | (1 << 5));
+
+	sweep_free (sweep);
+}
+END_TEST
+
+START_TEST (test_sweep_classify)
+{
+	// The glider is back where it started after 4 generations a cell
+	Sweep *sweep = sweep_from_spec ("conway,B/S012345678,B/S", "glider", 6);
+	sweep_run (sweep);
+
+	const SweepResult *r = sweep_find (sweep, "conway");
+
+	ck_assert_int_eq (r->stable_gen, 0);
+	ck_assert_int_eq (r->period, 4 * 6);
+	ck_assert_int_eq (r->alive, 5);
+
+	// Nothing is born nor dies
+	r = sweep_find (sweep, "B/S012345678");
+	ck_assert_int_eq (r->stable_gen, 0);
+	ck_assert_int_eq (r->period, 1);
+	ck_assert_int_eq (r->alive, 5);
+
+	// Everything dies at once and stays dead
+	r = sweep_find (sweep, "B/S");
+	ck_assert_int_eq (r->stable_gen, 1);
+	ck_assert_int_eq (r->period, 1);
+	ck_assert_int_eq (r->alive, 0);
+
+	sweep_free (sweep);
+}
+END_TEST
+
+Suite *
+make_sweep_suite (void)
+{
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create ("Sweep");
+
+	/* Core test case */
+	tc_core = tcase_create ("Core");
+
+	tcase_add_test (tc_core, test_sweep_wildcard_count);
+	tcase_add_test (tc_core, test_sweep_dedupe);
+	tcase_add_test (tc_core, test_sweep_alias);
+	tcase_add_test (tc_core, test_sweep_classify);
+
+	suite_add_tcase (s, tc_core);
+
+	return s;
+}
@@ -0,0 +1,141 @@
+#include "check_conga.h"
+
+#include "../src/grid.h"
+#include "../src/cell.h"
+#include "../src/rule.h"
+#include "../src/rand.h"
+#include "../src/tilegrid.h"
+
+#define GENS  30
+#define SEED  17
+
+// Partial tiles on either side, and several of them each way
+static const int dims[][2] =
+{
+	{1,   1},
+	{1,   70},
+	{64,  64},
+	{65,  1},
+	{7,   63},
+	{130, 65},
+	{3,   129},
+	{200, 300}
+};
+
+START_TEST (test_tilegrid_roundtrip)
+{
+	Grid *grid = grid_new (dims[_i][0], dims[_i][1]);
+	Grid *back = grid_new (dims[_i][0], dims[_i][1]);
+	TileGrid *tile_grid = tilegrid_new (dims[_i][0], dims[_i][1]);
+	Rand *rng = rand_new (SEED);
+
+	cell_seed_random_generation (grid, rng, 0.5, NULL);
+
+	tilegrid_from_grid (tile_grid, grid);
+	tilegrid_to_grid (back, tile_grid);
+
+	long alive = 0;
+	for (int i = 0; i < grid->rows * grid->cols; i++)
+		{
+			ck_assert_int_eq (grid->data[i], back->data[i]);
+			alive += grid->data[i];
+		}
+
+	ck_assert_int_eq (tilegrid_population (tile_grid), alive);
+
+	rand_free (rng);
+	tilegrid_free (tile_grid);
+	grid_free (grid);
+	grid_free (back);
+}
+END_TEST
+
+START_TEST (test_tilegrid_step)
+{
+	int rows = dims[_i][0], cols = dims[_i][1];
+
+	Grid *grid_cur  = grid_new (rows, cols);
+	Grid *grid_next = grid_new (rows, cols);
+	Grid *check     = grid_new (rows, cols);
+
+	TileGrid *tile_cur  = tilegrid_new (rows, cols);
+	TileGrid *tile_next = tilegrid_new (rows, cols);
+
+	Rule *rule = rule_new ("B36/S23");
+	Rand *rng = rand_new (SEED);
+	BitRule bit_rule;
+
+	bitlife_rule_init (&bit_rule, rule);
+	cell_seed_random_generation (grid_cur, rng, 0.4, NULL);
+	tilegrid_from_grid (tile_cur, grid_cur);
+
+	for (int g = 0; g < GENS; g++)
+		{
+			cell_step_generation (grid_next, grid_cur, rule, NULL);
+			tilegrid_step (tile_next, tile_cur, &bit_rule);
+
+			tilegrid_to_grid (check, tile_next);
+
+			for (int i = 0; i < rows * cols; i++)
+				ck_assert_int_eq (check->data[i], grid_next->data[i]);
+
+			Grid *tmp = grid_cur;
+			grid_cur = grid_next;
+			grid_next = tmp;
+
+			TileGrid *tile_tmp = tile_cur;
+			tile_cur = tile_next;
+			tile_next = tile_tmp;
+		}
+
+	rand_free (rng);
+	rule_free (rule);
+	tilegrid_free (tile_cur);
+	tilegrid_free (tile_next);
+	grid_free (grid_cur);
+	grid_free (grid_next);
+	grid_free (check);
+}
+END_TEST
+
+START_TEST (test_tilegrid_z_order)
+{
+	TileGrid *grid = tilegrid_new (3 * TILEGRID_SIDE, 5 * TILEGRID_SIDE);
+
+	// Z-order, skipping the tiles past the last row
+	const long expect[3][5] =
+	{
+		{0, 1, 4,  5,  12},
+		{2, 3, 6,  7,  13},
+		{8, 9, 10, 11, 14}
+	};
+
+	for (int tr = 0; tr < 3; tr++)
+		for (int tc = 0; tc < 5; tc++)
+			ck_assert_int_eq (grid->slot[tr * 5 + tc], expect[tr][tc]);
+
+	tilegrid_free (grid);
+}
+END_TEST
+
+Suite *
+make_tilegrid_suite (void)
+{
+	Suite *s;
+	TCase *tc_core;
+
+	int num_dims = sizeof (dims) / sizeof (dims[0]);
+
+	s = suite_create ("TileGrid");
+
+	/* Core test case */
+	tc_core = tcase_create ("Core");
+
+	tcase_add_test (tc_core, test_tilegrid_z_order);
+	tcase_add_loop_test (tc_core, test_tilegrid_roundtrip, 0, num_dims);
+	tcase_add_loop_test (tc_core, test_tilegrid_step, 0, num_dims);
+
+	suite_add_tcase (s, tc_core);
+
+	return s;
+}
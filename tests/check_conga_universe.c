@@ -0,0 +1,191 @@
+#include "check_conga.h"
+
+#include <stdio.h>
+#include <string.h>
+#include "../src/universe.h"
+
+#define ROWS 48
+#define COLS 80
+
+static unsigned char cells[ROWS * COLS];
+static unsigned char other[ROWS * COLS];
+
+// A soup in the middle, the same for every test
+static void
+universe_seed (Universe *universe)
+{
+	memset (cells, 0, sizeof (cells));
+
+	for (int i = 10; i < 30; i++)
+		for (int j = 20; j < 60; j++)
+			cells[i * COLS + j] = (i * 7 + j * 13) % 5 < 2;
+
+	ck_assert_int_eq (universe_write (universe, 0, 0, ROWS, COLS, cells), 0);
+}
+
+START_TEST (test_universe_new)
+{
+	ck_assert_ptr_null (universe_new (ROWS, COLS, "ponga", NULL, 1));
+	ck_assert_ptr_null (universe_new (ROWS, COLS, NULL, "ponga", 1));
+
+	Universe *universe = universe_new (ROWS, COLS, NULL, NULL, 1);
+	UniverseBox box;
+
+	ck_assert_ptr_nonnull (universe);
+	ck_assert_int_eq (universe_generation (universe), 0);
+	ck_assert_int_eq (universe_population (universe), 0);
+	ck_assert_int_eq (universe_bounds (universe, &box), 0);
+
+	universe_free (universe);
+}
+END_TEST
+
+START_TEST (test_universe_step)
+{
+	Universe *dense = universe_new (ROWS, COLS, "highlife", "dense", 1);
+	Universe *autos = universe_new (ROWS, COLS, "highlife", "auto", 3);
+
+	universe_seed (dense);
+	universe_seed (autos);
+
+	// In one call and in uneven ones, across several blocks
+	universe_step (dense, 150);
+
+	universe_step (autos, 1);
+	universe_step (autos, 0);
+	universe_step (autos, 37);
+	universe_step (autos, 112);
+
+	ck_assert_int_eq (universe_generation (autos), 150);
+
+	universe_read (dense, 0, 0, ROWS, COLS, cells);
+	universe_read (autos, 0, 0, ROWS, COLS, other);
+
+	ck_assert_int_eq (memcmp (cells, other, sizeof (cells)), 0);
+	ck_assert_int_eq (universe_population (autos), universe_population (dense));
+
+	universe_free (dense);
+	universe_free (autos);
+}
+END_TEST
+
+START_TEST (test_universe_pattern)
+{
+	Universe *universe = universe_new (ROWS, COLS, "conway", "bitpack", 1);
+	UniverseBox box;
+
+	ck_assert_int_eq (universe_put_pattern (universe, "ponga", 0, 0), -1);
+	ck_assert_str_eq (universe_error (universe), "Could not open 'ponga': "
+			"No such file or directory");
+	ck_assert_int_eq (universe_put_pattern (universe, "glider", ROWS - 2, 0), -1);
+	ck_assert_str_eq (universe_error (universe), "Pattern of 3x3 does not fit at (46, 0)");
+	ck_assert_int_eq (universe_put_pattern (universe, "glider", 5, 7), 0);
+	ck_assert_str_eq (universe_error (universe), "");
+
+	ck_assert_int_eq (universe_population (universe), 5);
+	ck_assert_int_eq (universe_bounds (universe, &box), 1);
+	ck_assert_int_eq (box.row, 5);
+	ck_assert_int_eq (box.col, 7);
+	ck_assert_int_eq (box.rows, 3);
+	ck_assert_int_eq (box.cols, 3);
+
+	// A glider is itself one cell down and right every 4 generations
+	universe_step (universe, 8);
+
+	ck_assert_int_eq (universe_population (universe), 5);
+	ck_assert_int_eq (universe_bounds (universe, &box), 1);
+	ck_assert_int_eq (box.row, 7);
+	ck_assert_int_eq (box.col, 9);
+
+	universe_free (universe);
+}
+END_TEST
+
+START_TEST (test_universe_read_write)
+{
+	Universe *universe = universe_new (ROWS, COLS, NULL, NULL, 1);
+	unsigned char block[3 * 4] = {1, 1, 0, 2, 0, 0, 0, 0, 1, 0, 0, 1};
+	unsigned char back[3 * 4];
+
+	ck_assert_int_eq (universe_write (universe, ROWS - 2, 0, 3, 4, block), -1);
+	ck_assert_int_eq (universe_write (universe, 0, COLS - 3, 3, 4, block), -1);
+	ck_assert_int_eq (universe_write (universe, -1, 0, 3, 4, block), -1);
+	ck_assert_int_eq (universe_read (universe, 0, 0, ROWS + 1, 1, back), -1);
+
+	ck_assert_int_eq (universe_write (universe, ROWS - 3, COLS - 4, 3, 4, block), 0);
+	ck_assert_int_eq (universe_read (universe, ROWS - 3, COLS - 4, 3, 4, back), 0);
+
+	// Anything but 0 is alive, and read back as 1
+	for (int i = 0; i < 3 * 4; i++)
+		ck_assert_int_eq (back[i], block[i] != 0);
+
+	ck_assert_int_eq (universe_population (universe), 5);
+
+	universe_free (universe);
+}
+END_TEST
+
+START_TEST (test_universe_save_load)
+{
+	Universe *universe = universe_new (ROWS, COLS, "B36/S23", "tiled", 1);
+	FILE *fp = tmpfile ();
+
+	universe_seed (universe);
+	universe_step (universe, 7);
+
+	ck_assert_int_eq (universe_save (universe, fp), 0);
+	rewind (fp);
+
+	Universe *loaded = universe_load (fp, "bitpack", 1);
+
+	ck_assert_ptr_nonnull (loaded);
+	ck_assert_int_eq (universe_generation (loaded), 7);
+
+	// Same cells, and the same rule from there on
+	for (int round = 0; round < 2; round++)
+		{
+			universe_read (universe, 0, 0, ROWS, COLS, cells);
+			universe_read (loaded, 0, 0, ROWS, COLS, other);
+
+			ck_assert_int_eq (memcmp (cells, other, sizeof (cells)), 0);
+
+			universe_step (universe, 20);
+			universe_step (loaded, 20);
+		}
+
+	fclose (fp);
+
+	// Not a pattern
+	fp = tmpfile ();
+	fputs ("x = 3, y = 3\nbo?o!\n", fp);
+	rewind (fp);
+
+	ck_assert_ptr_null (universe_load (fp, NULL, 1));
+
+	fclose (fp);
+	universe_free (universe);
+	universe_free (loaded);
+}
+END_TEST
+
+Suite *
+make_universe_suite (void)
+{
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create ("Universe");
+
+	/* Core test case */
+	tc_core = tcase_create ("Core");
+
+	tcase_add_test (tc_core, test_universe_new);
+	tcase_add_test (tc_core, test_universe_step);
+	tcase_add_test (tc_core, test_universe_pattern);
+	tcase_add_test (tc_core, test_universe_read_write);
+	tcase_add_test (tc_core, test_universe_save_load);
+
+	suite_add_tcase (s, tc_core);
+
+	return s;
+}